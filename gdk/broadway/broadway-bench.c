@@ -0,0 +1,273 @@
+/* broadway-bench.c - Replays surface updates through the Broadway encoder
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs surface updates through the same encoding and compression
+ * broadwayd uses, without a browser or a client, and reports
+ * frames per second and bytes per frame.
+ *
+ * The updates are read from a file recorded by running broadwayd
+ * with BROADWAY_RECORD=FILE. Without a file, a window scrolling
+ * through some text-like content is synthesized.
+ */
+
+#include "config.h"
+
+#include "broadway-output.h"
+
+#include <cairo.h>
+#include <string.h>
+#include <stdlib.h>
+
+typedef struct {
+  guint32 id;
+  int width;
+  int height;
+  int stride;
+  guint8 *data;
+} Update;
+
+static int n_repeats = 5;
+static int n_synthesized = 100;
+
+static GOptionEntry options[] = {
+  { "repeat", 'r', 0, G_OPTION_ARG_INT, &n_repeats, "Replay the updates N times", "N" },
+  { "frames", 'f', 0, G_OPTION_ARG_INT, &n_synthesized, "Synthesize N updates if no file is given", "N" },
+  { NULL }
+};
+
+static GArray *
+load_updates (GMappedFile  *file,
+              GError      **error)
+{
+  GArray *updates;
+  const guint8 *data, *end;
+  gsize magic_len;
+
+  data = (const guint8 *) g_mapped_file_get_contents (file);
+  end = data + g_mapped_file_get_length (file);
+  magic_len = strlen (BROADWAY_RECORD_MAGIC);
+
+  if ((gsize) (end - data) < magic_len ||
+      memcmp (data, BROADWAY_RECORD_MAGIC, magic_len) != 0)
+    {
+      g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                           "Not a Broadway recording");
+      return NULL;
+    }
+  data += magic_len;
+
+  updates = g_array_new (FALSE, FALSE, sizeof (Update));
+
+  while (data < end)
+    {
+      Update update;
+      guint32 header[3];
+
+      if ((gsize) (end - data) < sizeof header)
+        break;
+
+      memcpy (header, data, sizeof header);
+      data += sizeof header;
+
+      update.id = GUINT32_FROM_LE (header[0]);
+      update.width = GUINT32_FROM_LE (header[1]);
+      update.height = GUINT32_FROM_LE (header[2]);
+      update.stride = update.width * 4;
+      update.data = (guint8 *) data;
+
+      if (update.stride > 0 &&
+          (gsize) (end - data) / update.stride < (gsize) update.height)
+        break;
+      data += update.stride * update.height;
+
+      g_array_append_val (updates, update);
+    }
+
+  if (data != end)
+    g_printerr ("Ignoring truncated update at the end of the recording\n");
+
+  return updates;
+}
+
+static GArray *
+synthesize_updates (void)
+{
+  GArray *updates;
+  int i, line;
+
+  updates = g_array_new (FALSE, FALSE, sizeof (Update));
+
+  for (i = 0; i < n_synthesized; i++)
+    {
+      cairo_surface_t *surface;
+      cairo_t *cr;
+      Update update;
+
+      update.id = 1;
+      update.width = 1280;
+      update.height = 800;
+      update.stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, update.width);
+      update.data = g_malloc0 (update.stride * update.height);
+
+      surface = cairo_image_surface_create_for_data (update.data, CAIRO_FORMAT_ARGB32,
+                                                     update.width, update.height,
+                                                     update.stride);
+      cr = cairo_create (surface);
+
+      cairo_set_source_rgb (cr, 0.95, 0.95, 0.95);
+      cairo_paint (cr);
+
+      /* A toolbar that stays put, and lines of "words" that
+       * scroll up by a few pixels every frame */
+      cairo_set_source_rgb (cr, 0.8, 0.8, 0.85);
+      cairo_rectangle (cr, 0, 0, update.width, 40);
+      cairo_fill (cr);
+
+      cairo_rectangle (cr, 0, 40, update.width, update.height - 40);
+      cairo_clip (cr);
+
+      for (line = 0; line < 60; line++)
+        {
+          int y = 48 + line * 18 - (i * 7) % 18;
+          int x = 10, word;
+
+          for (word = 0; x < update.width - 60; word++)
+            {
+              int w = 12 + ((line + i / 3) * 7 + word * 13) % 50;
+
+              cairo_set_source_rgb (cr, 0.1 + (word % 3) * 0.2, 0.1, 0.2);
+              cairo_rectangle (cr, x, y, w, 10);
+              cairo_fill (cr);
+              x += w + 6;
+            }
+        }
+
+      cairo_destroy (cr);
+      cairo_surface_destroy (surface);
+
+      g_array_append_val (updates, update);
+    }
+
+  return updates;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *context;
+  GError *error = NULL;
+  GMappedFile *file = NULL;
+  GArray *updates;
+  GHashTable *buffers;
+  GOutputStream *out;
+  BroadwayOutput *output;
+  gint64 start, elapsed;
+  gsize total_bytes;
+  guint n_frames, i;
+  int repeat;
+
+  context = g_option_context_new ("[FILE]");
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (argc > 1)
+    {
+      file = g_mapped_file_new (argv[1], FALSE, &error);
+      if (file == NULL)
+        {
+          g_printerr ("%s\n", error->message);
+          return 1;
+        }
+
+      updates = load_updates (file, &error);
+      if (updates == NULL)
+        {
+          g_printerr ("%s: %s\n", argv[1], error->message);
+          return 1;
+        }
+    }
+  else
+    updates = synthesize_updates ();
+
+  if (updates->len == 0)
+    {
+      g_printerr ("No updates to replay\n");
+      return 1;
+    }
+
+  out = g_memory_output_stream_new_resizable ();
+  output = broadway_output_new (out, 0);
+  buffers = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) broadway_buffer_destroy);
+
+  total_bytes = 0;
+  n_frames = 0;
+  start = g_get_monotonic_time ();
+
+  for (repeat = 0; repeat < n_repeats; repeat++)
+    {
+      /* Start every round like a newly connected client */
+      g_hash_table_remove_all (buffers);
+
+      for (i = 0; i < updates->len; i++)
+        {
+          Update *update = &g_array_index (updates, Update, i);
+          BroadwayBuffer *buffer, *prev;
+
+          prev = g_hash_table_lookup (buffers, GUINT_TO_POINTER (update->id));
+
+          buffer = broadway_buffer_create (update->width, update->height,
+                                           update->data, update->stride);
+          broadway_output_put_buffer (output, update->id, prev, buffer);
+          broadway_output_flush (output);
+          g_hash_table_insert (buffers, GUINT_TO_POINTER (update->id), buffer);
+
+          total_bytes += g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out));
+          g_seekable_seek (G_SEEKABLE (out), 0, G_SEEK_SET, NULL, NULL);
+          g_seekable_truncate (G_SEEKABLE (out), 0, NULL, NULL);
+          n_frames++;
+        }
+    }
+
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%u frames in %.2f s: %.1f frames/sec, %" G_GSIZE_FORMAT " bytes/frame (%u cpus)\n",
+           n_frames, elapsed / (double) G_USEC_PER_SEC,
+           n_frames * (double) G_USEC_PER_SEC / elapsed,
+           total_bytes / n_frames,
+           g_get_num_processors ());
+
+  g_hash_table_destroy (buffers);
+  broadway_output_free (output);
+  g_object_unref (out);
+
+  if (file)
+    g_mapped_file_unref (file);
+  else
+    {
+      for (i = 0; i < updates->len; i++)
+        g_free (g_array_index (updates, Update, i).data);
+    }
+  g_array_free (updates, TRUE);
+
+  return 0;
+}
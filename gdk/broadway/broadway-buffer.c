@@ -38,11 +38,23 @@ struct entry {
 struct _BroadwayBuffer {
   guint8 *data;
   struct entry *table;
+  guint32 *grid_hashes;
+  guint32 *strip_hashes;
   int width, height, stride;
   int encoded;
   int block_stride, length, block_count, shift;
   int stats[5];
   int clashes;
+
+  /* Area that was scrolled by scroll_dy rows since prev */
+  gboolean has_scroll;
+  int scroll_x, scroll_y, scroll_width, scroll_height, scroll_dy;
+
+  /* The only parts that changed since damage_prev, if the buffer
+   * was created from it, and whether just those get encoded */
+  cairo_region_t *damage;
+  BroadwayBuffer *damage_prev;
+  gboolean encode_damage;
 };
 
 static const guint32 prime = 0x1f821e2d;
@@ -57,6 +69,15 @@ static const guint32 end_vprime = 0xcdb99001;	/* vprime^block_size */
 static const guint32 step = 0x0ac93019;
 static const int block_size = 32, block_mask = 31;
 
+/* Only encode the damage if it covers less than this fraction
+ * of the buffer, otherwise looking for blocks and scrolls pays off */
+#define DAMAGE_MAX_FRACTION 2
+
+/* Don't bother with scrolls that are found by less than this many
+ * strips, or that copy less than this many pixels */
+#define SCROLL_MIN_VOTES 64
+#define SCROLL_MIN_AREA (4 * 32 * 32)
+
 static gboolean
 verify_block_match (BroadwayBuffer *buffer, int x, int y,
                     BroadwayBuffer *prev, struct entry *entry)
@@ -90,7 +111,7 @@ verify_block_match (BroadwayBuffer *buffer, int x, int y,
       old = prev->data + (entry->y + i) * prev->stride + entry->x * 4;
       if (memcmp (match, old, w1 * 4) != 0)
         {
-          buffer->clashes++;
+          g_atomic_int_inc (&buffer->clashes);
           return FALSE;
         }
     }
@@ -164,6 +185,10 @@ struct encoder {
  *     - 0x00 2x xx xx 0x xxxx yyyy: block ref, block number x (20 bits) at x, y
  *     - 0x00 3x xx xx 0xaarrggbb : solid color run, length x
  *     - 0x00 4x xx xx 0xaarrggbb : delta run, length x
+ *     - 0x00 50 00 00 0x xxxx yyyy 0x wwww hhhh 0x xxxx yyyy :
+ *       copy rect, copies the w x h rectangle at the first position
+ *       of the previous frame to the second one. Only at the start
+ *       of the stream, before any pixels.
  *
  */
 
@@ -264,6 +289,28 @@ encoder_flush (struct encoder *encoder)
   encode_run (encoder);
 }
 
+/* Adds n pixels that are the same as in the previous frame, the
+ * last of which has the given color. */
+static void
+encode_unchanged (struct encoder *encoder, guint32 n, guint32 color)
+{
+  if (n == 0)
+    return;
+
+  encode_run (encoder);
+
+  while (n > 0xFFFFF)
+    {
+      emit (encoder, 0x00100000 | 0xFFFFF);
+      n -= 0xFFFFF;
+    }
+
+  encoder->color = color;
+  encoder->color_run = 1;
+  encoder->delta = 0;
+  encoder->delta_run = n;
+}
+
 
 static void
 encode_block (struct encoder *encoder, struct entry *entry, int x, int y)
@@ -283,6 +330,10 @@ broadway_buffer_destroy (BroadwayBuffer *buffer)
 {
   g_free (buffer->data);
   g_free (buffer->table);
+  g_free (buffer->grid_hashes);
+  g_free (buffer->strip_hashes);
+  if (buffer->damage)
+    cairo_region_destroy (buffer->damage);
   g_free (buffer);
 }
 
@@ -327,11 +378,11 @@ unpremultiply_line (void *destp, void *srcp, int width)
     }
 }
 
-BroadwayBuffer *
-broadway_buffer_create (int width, int height, guint8 *data, int stride)
+static BroadwayBuffer *
+buffer_new (int width, int height)
 {
   BroadwayBuffer *buffer;
-  int y, bits_required;
+  int bits_required;
 
   buffer = g_new0 (BroadwayBuffer, 1);
   buffer->width = width;
@@ -346,37 +397,355 @@ broadway_buffer_create (int width, int height, guint8 *data, int stride)
   buffer->length = 1 << bits_required;
 
   buffer->table = g_malloc0 (buffer->length * sizeof buffer->table[0]);
+  buffer->grid_hashes = g_malloc (buffer->block_count * sizeof buffer->grid_hashes[0]);
 
   memset (buffer->stats, 0, sizeof buffer->stats);
   buffer->clashes = 0;
 
   buffer->data = g_malloc (buffer->stride * height);
 
+  return buffer;
+}
+
+BroadwayBuffer *
+broadway_buffer_create (int width, int height, guint8 *data, int stride)
+{
+  BroadwayBuffer *buffer;
+  int y;
+
+  buffer = buffer_new (width, height);
+
   for (y = 0; y < height; y++)
     unpremultiply_line (buffer->data + y * buffer->stride, data + y * stride, width);
 
   return buffer;
 }
 
+/* Like broadway_buffer_create(), but only the @damage area of @data
+ * differs from @prev, so the rest is taken from there. @prev has to
+ * stay alive until @buffer has been encoded against it. */
+BroadwayBuffer *
+broadway_buffer_create_damaged (BroadwayBuffer       *prev,
+                                int                   width,
+                                int                   height,
+                                guint8               *data,
+                                int                   stride,
+                                const cairo_region_t *damage)
+{
+  BroadwayBuffer *buffer;
+  cairo_rectangle_int_t bounds = { 0, 0, width, height };
+  cairo_rectangle_int_t rect;
+  int i, y, n_rects;
+
+  if (prev == NULL || damage == NULL ||
+      prev->width != width || prev->height != height)
+    return broadway_buffer_create (width, height, data, stride);
+
+  buffer = buffer_new (width, height);
+  memcpy (buffer->data, prev->data, buffer->stride * height);
+
+  /* Entries that are stale in the damaged area fail
+   * verify_block_match(), the others still work */
+  memcpy (buffer->table, prev->table, buffer->length * sizeof buffer->table[0]);
+  buffer->encoded = prev->encoded;
+
+  buffer->damage = cairo_region_copy (damage);
+  cairo_region_intersect_rectangle (buffer->damage, &bounds);
+  buffer->damage_prev = prev;
+
+  n_rects = cairo_region_num_rectangles (buffer->damage);
+  for (i = 0; i < n_rects; i++)
+    {
+      cairo_region_get_rectangle (buffer->damage, i, &rect);
+      for (y = rect.y; y < rect.y + rect.height; y++)
+        unpremultiply_line (buffer->data + y * buffer->stride + rect.x * 4,
+                            data + y * stride + rect.x * 4,
+                            rect.width);
+    }
+
+  return buffer;
+}
+
+static void
+ensure_strip_hashes (BroadwayBuffer *buffer)
+{
+  guint32 *line, h;
+  int x, y, j;
+
+  if (buffer->strip_hashes)
+    return;
+
+  buffer->strip_hashes = g_new (guint32, buffer->block_stride * buffer->height);
+
+  for (y = 0; y < buffer->height; y++)
+    {
+      line = (guint32 *) (buffer->data + y * buffer->stride);
+
+      for (x = 0; x < buffer->block_stride; x++)
+        {
+          h = 0;
+          for (j = x * block_size; j < MIN (buffer->width, (x + 1) * block_size); j++)
+            h = h * prime + line[j];
+
+          buffer->strip_hashes[y * buffer->block_stride + x] = h;
+        }
+    }
+}
+
+/* Scrolling moves a big area of the previous frame up or down, which
+ * only some of the 32x32 blocks can find. So look for that directly:
+ * every row is split into block_size wide strips, and the strips that
+ * changed vote for the row they came from in prev, if they only occur
+ * once there. The winning offset is then used to find the largest
+ * rectangle of strips that match prev at that offset.
+ */
+static void
+find_scroll (BroadwayBuffer *buffer,
+             BroadwayBuffer *prev)
+{
+  GHashTable *rows;
+  guint32 *old_hashes, *new_hashes;
+  int *votes, *heights, *stack;
+  int n_strips, width, height;
+  int x, y, dy, top, best_votes, best_area;
+  gpointer key, value;
+
+  buffer->has_scroll = FALSE;
+
+  if (prev == NULL ||
+      prev->width != buffer->width ||
+      prev->height != buffer->height)
+    return;
+
+  ensure_strip_hashes (prev);
+  ensure_strip_hashes (buffer);
+
+  n_strips = buffer->block_stride;
+  width = buffer->width;
+  height = buffer->height;
+  old_hashes = prev->strip_hashes;
+  new_hashes = buffer->strip_hashes;
+
+  /* Maps strips of prev to their row, or -1 if they are not unique */
+  rows = g_hash_table_new (NULL, NULL);
+  for (y = 0; y < height; y++)
+    for (x = 0; x < n_strips; x++)
+      {
+        key = GUINT_TO_POINTER (old_hashes[y * n_strips + x] ^ (x * step));
+        if (g_hash_table_contains (rows, key))
+          g_hash_table_insert (rows, key, GINT_TO_POINTER (-1));
+        else
+          g_hash_table_insert (rows, key, GINT_TO_POINTER (y));
+      }
+
+  votes = g_new0 (int, 2 * height);
+  for (y = 0; y < height; y++)
+    for (x = 0; x < n_strips; x++)
+      {
+        if (new_hashes[y * n_strips + x] == old_hashes[y * n_strips + x])
+          continue;
+
+        key = GUINT_TO_POINTER (new_hashes[y * n_strips + x] ^ (x * step));
+        if (g_hash_table_lookup_extended (rows, key, NULL, &value) &&
+            GPOINTER_TO_INT (value) >= 0)
+          votes[y - GPOINTER_TO_INT (value) + height]++;
+      }
+
+  g_hash_table_destroy (rows);
+
+  dy = 0;
+  best_votes = SCROLL_MIN_VOTES - 1;
+  for (y = 0; y < 2 * height; y++)
+    {
+      if (votes[y] > best_votes)
+        {
+          best_votes = votes[y];
+          dy = y - height;
+        }
+    }
+
+  g_free (votes);
+
+  if (dy == 0)
+    return;
+
+  /* Find the largest rectangle of strips that match prev when
+   * shifted by dy, going down the rows and keeping the number of
+   * matching rows above every strip in heights */
+  heights = g_new0 (int, n_strips);
+  stack = g_new (int, n_strips + 1);
+  best_area = SCROLL_MIN_AREA - 1;
+
+  for (y = MAX (0, dy); y < MIN (height, height + dy); y++)
+    {
+      for (x = 0; x < n_strips; x++)
+        {
+          if (new_hashes[y * n_strips + x] == old_hashes[(y - dy) * n_strips + x])
+            heights[x]++;
+          else
+            heights[x] = 0;
+        }
+
+      top = 0;
+      for (x = 0; x <= n_strips; x++)
+        {
+          int h = x < n_strips ? heights[x] : 0;
+
+          while (top > 0 && heights[stack[top - 1]] >= h)
+            {
+              int bar_height = heights[stack[--top]];
+              int left = top > 0 ? stack[top - 1] + 1 : 0;
+              int bar_width = MIN (x * block_size, width) - left * block_size;
+
+              if (bar_width * bar_height > best_area)
+                {
+                  best_area = bar_width * bar_height;
+                  buffer->has_scroll = TRUE;
+                  buffer->scroll_x = left * block_size;
+                  buffer->scroll_y = y - bar_height + 1;
+                  buffer->scroll_width = bar_width;
+                  buffer->scroll_height = bar_height;
+                  buffer->scroll_dy = dy;
+                }
+            }
+
+          stack[top++] = x;
+        }
+    }
+
+  g_free (heights);
+  g_free (stack);
+}
+
+static void
+encode_damage (BroadwayBuffer *buffer,
+               BroadwayBuffer *prev,
+               GString        *dest)
+{
+  struct encoder encoder = { 0 };
+  cairo_rectangle_int_t rect;
+  guint32 *pixels, *line, *prev_line;
+  int n_rects, first, last, i, j, k, pos;
+
+  encoder.dest = dest;
+  pixels = (guint32 *) buffer->data;
+  n_rects = cairo_region_num_rectangles (buffer->damage);
+  pos = 0;
+
+  /* The rectangles of a region come in bands of the same y and
+   * height, sorted by x, so go through every row of a band and
+   * skip from one rectangle to the next */
+  for (first = 0; first < n_rects; first = last)
+    {
+      cairo_rectangle_int_t band;
+
+      cairo_region_get_rectangle (buffer->damage, first, &band);
+      for (last = first + 1; last < n_rects; last++)
+        {
+          cairo_region_get_rectangle (buffer->damage, last, &rect);
+          if (rect.y != band.y)
+            break;
+        }
+
+      for (i = band.y; i < band.y + band.height; i++)
+        {
+          line = (guint32 *) (buffer->data + i * buffer->stride);
+          prev_line = (guint32 *) (prev->data + i * prev->stride);
+
+          for (k = first; k < last; k++)
+            {
+              cairo_region_get_rectangle (buffer->damage, k, &rect);
+
+              j = i * buffer->width + rect.x;
+              encode_unchanged (&encoder, j - pos, j > 0 ? pixels[j - 1] : 0);
+
+              for (j = rect.x; j < rect.x + rect.width; j++)
+                encode_pixel (&encoder, line[j], prev_line[j]);
+
+              pos = i * buffer->width + rect.x + rect.width;
+            }
+        }
+    }
+
+  j = buffer->width * buffer->height;
+  encode_unchanged (&encoder, j - pos, j > 0 ? pixels[j - 1] : 0);
+
+  encoder_flush (&encoder);
+}
+
+/* Has to be called before encoding any rows of @buffer. Returns
+ * %TRUE if @buffer only needs its damage encoded, in which case
+ * it has to be encoded in one go. */
+gboolean
+broadway_buffer_begin_encode (BroadwayBuffer *buffer,
+                              BroadwayBuffer *prev)
+{
+  cairo_rectangle_int_t rect;
+  int i, n_rects;
+  gint64 area;
+
+  buffer->encode_damage = FALSE;
+
+  if (buffer->damage != NULL && prev != NULL && prev == buffer->damage_prev)
+    {
+      area = 0;
+      n_rects = cairo_region_num_rectangles (buffer->damage);
+      for (i = 0; i < n_rects; i++)
+        {
+          cairo_region_get_rectangle (buffer->damage, i, &rect);
+          area += rect.width * rect.height;
+        }
+
+      if (area * DAMAGE_MAX_FRACTION < (gint64) buffer->width * buffer->height)
+        {
+          buffer->encode_damage = TRUE;
+          buffer->has_scroll = FALSE;
+          return TRUE;
+        }
+    }
+
+  find_scroll (buffer, prev);
+
+  return FALSE;
+}
+
+/* Encodes rows y0 to y1 of @buffer. Different row ranges of the
+ * same buffer can be encoded from different threads at the same
+ * time; the encoded ranges have to be appended to each other in
+ * order, and broadway_buffer_finish_encode() has to be called
+ * once all of them are done.
+ *
+ * Runs end at y1, and blocks are only matched if they do not reach
+ * below y1, so no range depends on how the others were encoded.
+ */
 void
-broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *dest)
+broadway_buffer_encode_rows (BroadwayBuffer *buffer,
+                             BroadwayBuffer *prev,
+                             int             y0,
+                             int             y1,
+                             GString        *dest)
 {
   struct entry *entry;
   int i, j, k;
-  int x0, x1, y0, y1;
+  int x0, x1;
   guint32 *block_hashes;
-  guint32 hash, bottom_hash, h, *line, *bottom, *prev_line;
+  guint32 hash, bottom_hash, h, *line, *bottom, *prev_line, *scroll_line;
   int width, height;
   struct encoder encoder = { 0 };
   int *skyline, skyline_pixels;
   int matches;
 
+  if (buffer->encode_damage)
+    {
+      g_return_if_fail (y0 == 0 && y1 == buffer->height);
+      encode_damage (buffer, prev, dest);
+      return;
+    }
+
   width = buffer->width;
   height = buffer->height;
   x0 = 0;
   x1 = width;
-  y0 = 0;
-  y1 = height;
 
   skyline = g_malloc0 ((width + block_size) * sizeof skyline[0]);
 
@@ -385,8 +754,16 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
   matches = 0;
   encoder.dest = dest;
 
+  if (y0 == 0 && y1 > 0 && buffer->has_scroll)
+    {
+      emit (&encoder, 0x00500000);
+      emit (&encoder, (buffer->scroll_x << 16) | (buffer->scroll_y - buffer->scroll_dy));
+      emit (&encoder, (buffer->scroll_width << 16) | buffer->scroll_height);
+      emit (&encoder, (buffer->scroll_x << 16) | buffer->scroll_y);
+    }
+
   // Calculate the block hashes for the first row
-  for (i = y0; i < MIN(y1, y0 + block_size); i++)
+  for (i = y0; i < MIN(height, y0 + block_size); i++)
     {
       line = (guint32 *)(buffer->data + i * buffer->stride);
       hash = 0;
@@ -424,6 +801,15 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
       else
         prev_line = NULL;
 
+      /* The client applies the copy rect before decoding the pixels,
+       * so pixels in it are relative to the scrolled prev */
+      if (buffer->has_scroll &&
+          i >= buffer->scroll_y &&
+          i < buffer->scroll_y + buffer->scroll_height)
+        scroll_line = (guint32 *) (prev->data + (i - buffer->scroll_dy) * prev->stride);
+      else
+        scroll_line = NULL;
+
       for (j = x0; j < x0 + block_size; j++)
         {
           hash = hash * prime;
@@ -454,6 +840,7 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
               entry = lookup_block (prev, h);
               if (entry && entry->count < 2 &&
                   skyline_pixels >= block_size &&
+                  (i + block_size <= y1 || y1 == height) &&
                   verify_block_match (buffer, j, i, prev, entry) &&
                   (entry->x != j || entry->y != i))
                 {
@@ -467,7 +854,12 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
                 }
               else
                 {
-                  if (prev_line && j < prev->width)
+                  if (scroll_line &&
+                      j >= buffer->scroll_x &&
+                      j < buffer->scroll_x + buffer->scroll_width)
+                    encode_pixel (&encoder, line[j],
+                                  scroll_line[j]);
+                  else if (prev_line && j < prev->width)
                     encode_pixel (&encoder, line[j],
                                   prev_line[j]);
                   else
@@ -482,10 +874,11 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
           else
             skyline_pixels++;
 
-          /* Insert block in hash table if we're on a
-           * grid point. */
+          /* Remember the block hash if we're on a grid point,
+           * broadway_buffer_finish_encode() inserts it in the
+           * hash table. */
           if (((i | j) & block_mask) == 0 && !buffer->encoded)
-            insert_block (buffer, block_hashes[j], j, i);
+            buffer->grid_hashes[(buffer->block_stride * i + j) / block_size] = block_hashes[j];
 
           /* Update sliding block hash */
           block_hashes[j] =
@@ -523,6 +916,119 @@ broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *d
 
   g_free (skyline);
   g_free (block_hashes);
+}
+
+/* Same as the sliding hash broadway_buffer_encode_rows() computes
+ * for the block at @x, @y, for when it didn't go over those rows */
+static guint32
+hash_block (BroadwayBuffer *buffer, int x, int y)
+{
+  guint32 hash, block_hash, *line;
+  int i, j;
+
+  block_hash = 0;
+  for (i = y; i < y + block_size; i++)
+    {
+      hash = 0;
+      if (i < buffer->height)
+        {
+          line = (guint32 *) (buffer->data + i * buffer->stride);
+          for (j = x; j < x + block_size; j++)
+            {
+              hash = hash * prime;
+              if (j < buffer->width)
+                hash += line[j];
+            }
+        }
+      block_hash = block_hash * vprime + hash;
+    }
+
+  return block_hash;
+}
+
+void
+broadway_buffer_finish_encode (BroadwayBuffer *buffer)
+{
+  cairo_rectangle_int_t rect;
+  cairo_region_t *blocks;
+  struct entry *entry;
+  int i, n_rects, x, y;
+  guint32 h;
+
+  if (buffer->encode_damage)
+    {
+      /* Encoding just the damage doesn't compute the block hashes,
+       * so hash the blocks that changed here. The table has the
+       * entries of the buffer we were created from, unless that
+       * was never fully encoded, in which case it has to be built
+       * from scratch. */
+      if (!buffer->encoded)
+        {
+          for (y = 0; y < buffer->height; y += block_size)
+            for (x = 0; x < buffer->width; x += block_size)
+              insert_block (buffer, hash_block (buffer, x, y), x, y);
+        }
+      else
+        {
+          /* Round out to whole blocks first so that each is only
+           * inserted once */
+          blocks = cairo_region_create ();
+          n_rects = cairo_region_num_rectangles (buffer->damage);
+          for (i = 0; i < n_rects; i++)
+            {
+              cairo_region_get_rectangle (buffer->damage, i, &rect);
+              x = rect.x & ~block_mask;
+              y = rect.y & ~block_mask;
+              rect.width = ((rect.x + rect.width + block_mask) & ~block_mask) - x;
+              rect.height = ((rect.y + rect.height + block_mask) & ~block_mask) - y;
+              rect.x = x;
+              rect.y = y;
+              cairo_region_union_rectangle (blocks, &rect);
+            }
+
+          n_rects = cairo_region_num_rectangles (blocks);
+          for (i = 0; i < n_rects; i++)
+            {
+              cairo_region_get_rectangle (blocks, i, &rect);
+              for (y = rect.y; y < rect.y + rect.height; y += block_size)
+                for (x = rect.x; x < rect.x + rect.width; x += block_size)
+                  {
+                    h = hash_block (buffer, x, y);
+                    entry = lookup_block (buffer, h);
+                    /* Unchanged blocks are already in there */
+                    if (entry == NULL || entry->x != x || entry->y != y)
+                      insert_block (buffer, h, x, y);
+                  }
+            }
+          cairo_region_destroy (blocks);
+        }
+
+      buffer->encoded = TRUE;
+    }
+
+  /* Later encodes are against other buffers, if at all */
+  buffer->encode_damage = FALSE;
+  buffer->damage_prev = NULL;
+  if (buffer->damage)
+    {
+      cairo_region_destroy (buffer->damage);
+      buffer->damage = NULL;
+    }
+
+  if (buffer->encoded)
+    return;
+
+  for (y = 0; y < buffer->height; y += block_size)
+    for (x = 0; x < buffer->width; x += block_size)
+      insert_block (buffer, buffer->grid_hashes[(buffer->block_stride * y + x) / block_size], x, y);
 
   buffer->encoded = TRUE;
 }
+
+void
+broadway_buffer_encode (BroadwayBuffer *buffer, BroadwayBuffer *prev, GString *dest)
+{
+  broadway_buffer_begin_encode (buffer, prev);
+  broadway_buffer_encode_rows (buffer, prev, 0, buffer->height, dest);
+  broadway_buffer_finish_encode (buffer);
+}
@@ -3,17 +3,40 @@
 
 #include "broadway-protocol.h"
 #include <glib-object.h>
+#include <cairo.h>
 
 typedef struct _BroadwayBuffer BroadwayBuffer;
 
+/* broadwayd writes the surface updates it gets to the file named
+ * in BROADWAY_RECORD, for replaying them with broadway-bench. The
+ * file starts with BROADWAY_RECORD_MAGIC, followed by one record
+ * per update: the window id, width and height as little endian
+ * guint32, then width * height premultiplied CAIRO_FORMAT_ARGB32
+ * pixels in host byte order. */
+#define BROADWAY_RECORD_MAGIC "BWRECORD"
+
 BroadwayBuffer *broadway_buffer_create     (int             width,
                                             int             height,
                                             guint8         *data,
                                             int             stride);
+BroadwayBuffer *broadway_buffer_create_damaged (BroadwayBuffer       *prev,
+                                                int                   width,
+                                                int                   height,
+                                                guint8               *data,
+                                                int                   stride,
+                                                const cairo_region_t *damage);
 void            broadway_buffer_destroy    (BroadwayBuffer *buffer);
 void            broadway_buffer_encode     (BroadwayBuffer *buffer,
                                             BroadwayBuffer *prev,
                                             GString        *dest);
+gboolean        broadway_buffer_begin_encode (BroadwayBuffer *buffer,
+                                              BroadwayBuffer *prev);
+void            broadway_buffer_encode_rows (BroadwayBuffer *buffer,
+                                             BroadwayBuffer *prev,
+                                             int             y0,
+                                             int             y1,
+                                             GString        *dest);
+void            broadway_buffer_finish_encode (BroadwayBuffer *buffer);
 int             broadway_buffer_get_width  (BroadwayBuffer *buffer);
 int             broadway_buffer_get_height (BroadwayBuffer *buffer);
 
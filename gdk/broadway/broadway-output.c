@@ -286,17 +286,140 @@ broadway_output_set_transient_for (BroadwayOutput *output,
   append_uint16 (output, parent_id);
 }
 
+/* Large buffers are split into bands of rows that are encoded and
+ * compressed on a pool of worker threads. Each band gets its own
+ * deflate stream ending in a sync flush, so the concatenated bands
+ * are still a single raw deflate stream for the client.
+ */
+#define PUT_BUFFER_THREAD_THRESHOLD (256 * 256)
+#define PUT_BUFFER_MAX_BANDS 4
+
+typedef struct {
+  GMutex mutex;
+  GCond  cond;
+  guint  pending;
+} EncodeBarrier;
+
+typedef struct {
+  EncodeBarrier  *barrier;
+  BroadwayBuffer *buffer;
+  BroadwayBuffer *prev_buffer;
+  int             y0;
+  int             y1;
+  gboolean        last;
+  GString        *compressed;
+} EncodeBand;
+
+static void
+compress_data (const char *data,
+               gsize       len,
+               gboolean    last,
+               GString    *dest)
+{
+  GZlibCompressor *compressor;
+  GConverterResult result;
+  GError *error = NULL;
+  gsize old_len, avail, read, written;
+  gboolean done;
+
+  compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1);
+
+  do
+    {
+      old_len = dest->len;
+      avail = len / 4 + 4096;
+      g_string_set_size (dest, old_len + avail);
+
+      read = written = 0;
+      result = g_converter_convert (G_CONVERTER (compressor),
+                                    data, len,
+                                    dest->str + old_len, avail,
+                                    last ? G_CONVERTER_INPUT_AT_END : G_CONVERTER_FLUSH,
+                                    &read, &written, &error);
+      if (result == G_CONVERTER_ERROR)
+        {
+          g_warning ("compression failed: %s\n", error->message);
+          g_error_free (error);
+          g_string_set_size (dest, old_len);
+          break;
+        }
+
+      data += read;
+      len -= read;
+      g_string_set_size (dest, old_len + written);
+
+      /* A flush is only complete if it did not fill the output */
+      if (last)
+        done = result == G_CONVERTER_FINISHED;
+      else
+        done = result == G_CONVERTER_FLUSHED && len == 0 && written < avail;
+    }
+  while (!done);
+
+  g_object_unref (compressor);
+}
+
+static void
+encode_band (EncodeBand *band)
+{
+  GString *encoded;
+
+  encoded = g_string_new ("");
+  broadway_buffer_encode_rows (band->buffer, band->prev_buffer,
+                               band->y0, band->y1, encoded);
+  compress_data (encoded->str, encoded->len, band->last, band->compressed);
+  g_string_free (encoded, TRUE);
+}
+
+static void
+encode_band_thread_func (gpointer data,
+                         gpointer user_data)
+{
+  EncodeBand *band = data;
+  EncodeBarrier *barrier = band->barrier;
+
+  encode_band (band);
+
+  g_mutex_lock (&barrier->mutex);
+  barrier->pending--;
+  if (barrier->pending == 0)
+    g_cond_signal (&barrier->cond);
+  g_mutex_unlock (&barrier->mutex);
+}
+
+static GThreadPool *
+get_encode_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint n_threads = MIN (g_get_num_processors (), PUT_BUFFER_MAX_BANDS);
+
+      /* The calling thread encodes one of the bands itself */
+      if (n_threads > 1)
+        pool = g_thread_pool_new (encode_band_thread_func, NULL,
+                                  n_threads - 1, FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
 void
 broadway_output_put_buffer (BroadwayOutput *output,
                             int             id,
                             BroadwayBuffer *prev_buffer,
                             BroadwayBuffer *buffer)
 {
+  EncodeBarrier barrier;
+  EncodeBand *bands;
+  GThreadPool *pool;
   gsize len;
   int w, h;
-  GZlibCompressor *compressor;
-  GOutputStream *out, *out_mem;
-  GString *encoded;
+  guint i, n_bands;
 
   write_header (output, BROADWAY_OP_PUT_BUFFER);
 
@@ -307,26 +430,57 @@ broadway_output_put_buffer (BroadwayOutput *output,
   append_uint16 (output, w);
   append_uint16 (output, h);
 
-  encoded = g_string_new ("");
-  broadway_buffer_encode (buffer, prev_buffer, encoded);
+  pool = get_encode_thread_pool ();
+  if (broadway_buffer_begin_encode (buffer, prev_buffer) ||
+      pool == NULL || w * h < PUT_BUFFER_THREAD_THRESHOLD)
+    n_bands = 1;
+  else
+    n_bands = MIN (g_get_num_processors (), PUT_BUFFER_MAX_BANDS);
 
-  compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW, -1);
-  out_mem = g_memory_output_stream_new_resizable ();
-  out = g_converter_output_stream_new (out_mem, G_CONVERTER (compressor));
-  g_object_unref (compressor);
+  bands = g_newa (EncodeBand, n_bands);
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].barrier = &barrier;
+      bands[i].buffer = buffer;
+      bands[i].prev_buffer = prev_buffer;
+      bands[i].y0 = h * i / n_bands;
+      bands[i].y1 = h * (i + 1) / n_bands;
+      bands[i].last = i == n_bands - 1;
+      bands[i].compressed = g_string_new ("");
+    }
 
-  if (!g_output_stream_write_all (out, encoded->str, encoded->len,
-                                  NULL, NULL, NULL) ||
-      !g_output_stream_close (out, NULL, NULL))
-    g_warning ("compression failed\n");
+  if (n_bands == 1)
+    encode_band (&bands[0]);
+  else
+    {
+      g_mutex_init (&barrier.mutex);
+      g_cond_init (&barrier.cond);
+      barrier.pending = n_bands - 1;
 
+      for (i = 1; i < n_bands; i++)
+        g_thread_pool_push (pool, &bands[i], NULL);
 
-  len = g_memory_output_stream_get_data_size (G_MEMORY_OUTPUT_STREAM (out_mem));
-  append_uint32 (output, len);
+      encode_band (&bands[0]);
 
-  g_string_append_len (output->buf, g_memory_output_stream_get_data (G_MEMORY_OUTPUT_STREAM (out_mem)), len);
+      g_mutex_lock (&barrier.mutex);
+      while (barrier.pending > 0)
+        g_cond_wait (&barrier.cond, &barrier.mutex);
+      g_mutex_unlock (&barrier.mutex);
 
-  g_string_free (encoded, TRUE);
-  g_object_unref (out);
-  g_object_unref (out_mem);
+      g_mutex_clear (&barrier.mutex);
+      g_cond_clear (&barrier.cond);
+    }
+
+  broadway_buffer_finish_encode (buffer);
+
+  len = 0;
+  for (i = 0; i < n_bands; i++)
+    len += bands[i].compressed->len;
+  append_uint32 (output, len);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      g_string_append_len (output->buf, bands[i].compressed->str, bands[i].compressed->len);
+      g_string_free (bands[i].compressed, TRUE);
+    }
 }
@@ -192,8 +192,15 @@ typedef struct {
   char name[36];
   guint32 width;
   guint32 height;
+  /* The area that changed since the last update of the
+   * window, or everything if n_rects is 0 */
+  guint32 n_rects;
+  BroadwayRect rects[1];
 } BroadwayRequestUpdate;
 
+/* Updates with more damage rectangles than this send their extents */
+#define BROADWAY_MAX_UPDATE_RECTS 32
+
 typedef struct {
   BroadwayRequestBase base;
   guint32 id;
@@ -76,6 +76,9 @@ struct _BroadwayServer {
   int future_root_y;
   guint32 future_state;
   int future_mouse_in_toplevel;
+
+  /* Surface updates are written here if BROADWAY_RECORD is set */
+  GOutputStream *record;
 };
 
 struct _BroadwayServerClass
@@ -114,8 +117,10 @@ struct BroadwayWindow {
   BroadwayBuffer *buffer;
   gboolean buffer_synced;
 
-  char *cached_surface_name;
-  cairo_surface_t *cached_surface;
+  /* Clients alternate between two surfaces per window */
+  char *cached_surface_name[2];
+  cairo_surface_t *cached_surface[2];
+  int next_cached_surface;
 };
 
 static void broadway_server_resync_windows (BroadwayServer *server);
@@ -147,6 +152,28 @@ broadway_server_init (BroadwayServer *server)
   g_hash_table_insert (server->id_ht,
 		       GINT_TO_POINTER (root->id),
 		       root);
+
+  if (g_getenv ("BROADWAY_RECORD"))
+    {
+      GError *error = NULL;
+      GFile *file;
+
+      file = g_file_new_for_path (g_getenv ("BROADWAY_RECORD"));
+      server->record = (GOutputStream *) g_file_replace (file, NULL, FALSE,
+                                                         G_FILE_CREATE_REPLACE_DESTINATION,
+                                                         NULL, &error);
+      g_object_unref (file);
+
+      if (server->record == NULL ||
+          !g_output_stream_write_all (server->record,
+                                      BROADWAY_RECORD_MAGIC, strlen (BROADWAY_RECORD_MAGIC),
+                                      NULL, NULL, &error))
+        {
+          g_warning ("Can't record surface updates: %s", error->message);
+          g_error_free (error);
+          g_clear_object (&server->record);
+        }
+    }
 }
 
 static void
@@ -155,6 +182,7 @@ broadway_server_finalize (GObject *object)
   BroadwayServer *server = BROADWAY_SERVER (object);
 
   g_free (server->address);
+  g_clear_object (&server->record);
 
   G_OBJECT_CLASS (broadway_server_parent_class)->finalize (object);
 }
@@ -1365,6 +1393,7 @@ broadway_server_destroy_window (BroadwayServer *server,
 				gint id)
 {
   BroadwayWindow *window;
+  guint i;
 
   if (server->mouse_in_toplevel_id == id)
     {
@@ -1387,10 +1416,12 @@ broadway_server_destroy_window (BroadwayServer *server,
       g_hash_table_remove (server->id_ht,
 			   GINT_TO_POINTER (id));
 
-      if (window->cached_surface_name != NULL)
-	g_free (window->cached_surface_name);
-      if (window->cached_surface != NULL)
-	cairo_surface_destroy (window->cached_surface);
+      for (i = 0; i < G_N_ELEMENTS (window->cached_surface); i++)
+	{
+	  g_free (window->cached_surface_name[i]);
+	  if (window->cached_surface[i] != NULL)
+	    cairo_surface_destroy (window->cached_surface[i]);
+	}
 
       g_free (window);
     }
@@ -1525,10 +1556,51 @@ broadway_server_has_client (BroadwayServer *server)
   return server->output != NULL;
 }
 
+static void
+record_window_update (BroadwayServer  *server,
+                      gint             id,
+                      cairo_surface_t *surface)
+{
+  guint32 header[3];
+  guchar *data;
+  int width, height, stride, y;
+  GError *error = NULL;
+
+  width = cairo_image_surface_get_width (surface);
+  height = cairo_image_surface_get_height (surface);
+  stride = cairo_image_surface_get_stride (surface);
+  data = cairo_image_surface_get_data (surface);
+
+  header[0] = GUINT32_TO_LE (id);
+  header[1] = GUINT32_TO_LE (width);
+  header[2] = GUINT32_TO_LE (height);
+
+  if (g_output_stream_write_all (server->record, header, sizeof header,
+                                 NULL, NULL, &error))
+    {
+      for (y = 0; y < height; y++)
+        {
+          if (!g_output_stream_write_all (server->record, data + y * stride, width * 4,
+                                          NULL, NULL, &error))
+            break;
+        }
+    }
+
+  if (error)
+    {
+      g_warning ("Stopped recording surface updates: %s", error->message);
+      g_error_free (error);
+      g_clear_object (&server->record);
+    }
+}
+
+/* @damage is the area that changed since the last update, or
+ * %NULL if everything might have */
 void
 broadway_server_window_update (BroadwayServer *server,
 			       gint id,
-			       cairo_surface_t *surface)
+			       cairo_surface_t *surface,
+			       cairo_region_t *damage)
 {
   BroadwayWindow *window;
   BroadwayBuffer *buffer;
@@ -1544,9 +1616,14 @@ broadway_server_window_update (BroadwayServer *server,
   g_assert (window->width == cairo_image_surface_get_width (surface));
   g_assert (window->height == cairo_image_surface_get_height (surface));
 
-  buffer = broadway_buffer_create (window->width, window->height,
-                                   cairo_image_surface_get_data (surface),
-                                   cairo_image_surface_get_stride (surface));
+  if (server->record != NULL)
+    record_window_update (server, window->id, surface);
+
+  buffer = broadway_buffer_create_damaged (window->buffer,
+                                           window->width, window->height,
+                                           cairo_image_surface_get_data (surface),
+                                           cairo_image_surface_get_stride (surface),
+                                           damage);
 
   if (server->output != NULL)
     {
@@ -1717,15 +1794,19 @@ broadway_server_open_surface (BroadwayServer *server,
   cairo_surface_t *surface;
   gsize size;
   void *ptr;
+  guint i;
 
   window = g_hash_table_lookup (server->id_ht,
 				GINT_TO_POINTER (id));
   if (window == NULL)
     return NULL;
 
-  if (window->cached_surface_name != NULL &&
-      strcmp (name, window->cached_surface_name) == 0)
-    return cairo_surface_reference (window->cached_surface);
+  for (i = 0; i < G_N_ELEMENTS (window->cached_surface); i++)
+    {
+      if (window->cached_surface_name[i] != NULL &&
+	  strcmp (name, window->cached_surface_name[i]) == 0)
+	return cairo_surface_reference (window->cached_surface[i]);
+    }
 
   size = width * height * sizeof (guint32);
 
@@ -1748,13 +1829,15 @@ broadway_server_open_surface (BroadwayServer *server,
   cairo_surface_set_user_data (surface, &shm_cairo_key,
 			       data, shm_data_unmap);
 
-  if (window->cached_surface_name != NULL)
-    g_free (window->cached_surface_name);
-  window->cached_surface_name = g_strdup (name);
+  i = window->next_cached_surface;
+  window->next_cached_surface = (i + 1) % G_N_ELEMENTS (window->cached_surface);
+
+  g_free (window->cached_surface_name[i]);
+  window->cached_surface_name[i] = g_strdup (name);
 
-  if (window->cached_surface != NULL)
-    cairo_surface_destroy (window->cached_surface);
-  window->cached_surface = cairo_surface_reference (surface);
+  if (window->cached_surface[i] != NULL)
+    cairo_surface_destroy (window->cached_surface[i]);
+  window->cached_surface[i] = cairo_surface_reference (surface);
 
   return surface;
 }
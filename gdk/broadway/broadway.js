@@ -502,6 +502,35 @@ function decodeBuffer(context, oldData, w, h, data, debug)
                     markRun(imageData.data, start, len, 0xff, 0x00, 0xff);
                 break;
 
+            case 0x50: // Copy rect
+                b = data[src++];
+                g = data[src++];
+                r = data[src++];
+                alpha = data[src++];
+                var srcX = alpha << 8 | r;
+                var srcY = g << 8 | b;
+
+                b = data[src++];
+                g = data[src++];
+                r = data[src++];
+                alpha = data[src++];
+                var copyWidth = alpha << 8 | r;
+                var copyHeight = g << 8 | b;
+
+                b = data[src++];
+                g = data[src++];
+                r = data[src++];
+                alpha = data[src++];
+                var destX = alpha << 8 | r;
+                var destY = g << 8 | b;
+
+                copyRect(oldData, srcX, srcY, imageData, destX, destY, copyWidth, copyHeight);
+                if (debug) // copied rects are yellow
+                    markRect(oldData, srcX, srcY, imageData, destX, destY, copyWidth, copyHeight, 128, 128, 0x00);
+
+                //log("Got copy rect (" + srcX + "," + srcY + ") to " + destX + "," + destY + ", size " + copyWidth + "x" + copyHeight);
+                break;
+
             default:
                 alert("Unknown buffer commend " + cmd);
             }
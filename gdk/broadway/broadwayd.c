@@ -198,6 +198,7 @@ client_handle_request (BroadwayClient *client,
   BroadwayReplyGrabPointer reply_grab_pointer;
   BroadwayReplyUngrabPointer reply_ungrab_pointer;
   cairo_surface_t *surface;
+  cairo_region_t *damage;
   guint32 before_serial, now_serial;
 
   before_serial = broadway_server_get_next_serial (server);
@@ -261,10 +262,22 @@ client_handle_request (BroadwayClient *client,
 					      request->update.height);
       if (surface != NULL)
 	{
+	  /* Only trust as many rectangles as were actually sent */
+	  damage = NULL;
+	  if (request->update.n_rects > 0 &&
+	      request->update.n_rects <= BROADWAY_MAX_UPDATE_RECTS &&
+	      sizeof (BroadwayRequestUpdate) +
+	      (request->update.n_rects - 1) * sizeof (BroadwayRect) <= request->base.size)
+	    damage = cairo_region_create_rectangles ((cairo_rectangle_int_t *)request->update.rects,
+						     request->update.n_rects);
+
 	  broadway_server_window_update (server,
 					 request->update.id,
-					 surface);
+					 surface,
+					 damage);
 	  cairo_surface_destroy (surface);
+	  if (damage)
+	    cairo_region_destroy (damage);
 	}
       break;
     case BROADWAY_REQUEST_MOVE_RESIZE:
@@ -349,6 +362,8 @@ client_fill_cb (GObject *source_object,
 	      remaining -= size;
 	      buffer += size;
 	    }
+	  else
+	    break;
 	}
       
       /* This is guaranteed not to block */
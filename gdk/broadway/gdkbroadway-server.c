@@ -43,7 +43,10 @@ struct _GdkBroadwayServer {
 
   guint process_input_idle;
   GList *incomming;
-  
+
+  /* Serial of the last sync request the server replied to */
+  guint32 synced_serial;
+
 };
 
 struct _GdkBroadwayServerClass
@@ -318,6 +321,8 @@ process_input_messages (GdkBroadwayServer *server)
 
       if (reply->base.type == BROADWAY_REPLY_EVENT)
 	_gdk_broadway_events_got_input (&reply->event.msg);
+      else if (reply->base.type == BROADWAY_REPLY_SYNC)
+	server->synced_serial = MAX (server->synced_serial, reply->base.in_reply_to);
       else
 	g_warning ("Unhandled reply type %d\n", reply->base.type);
       g_free (reply);
@@ -402,6 +407,36 @@ _gdk_broadway_server_sync (GdkBroadwayServer *server)
   return;
 }
 
+/* Sends a sync request without waiting for the reply. Once
+ * _gdk_broadway_server_wait_for_sync() returns for the serial,
+ * the server has handled all the requests before it. */
+guint32
+_gdk_broadway_server_sync_async (GdkBroadwayServer *server)
+{
+  BroadwayRequestSync msg;
+
+  return gdk_broadway_server_send_message (server, msg,
+					   BROADWAY_REQUEST_SYNC);
+}
+
+void
+_gdk_broadway_server_wait_for_sync (GdkBroadwayServer *server,
+				    guint32            serial)
+{
+  BroadwayReply *reply;
+
+  /* Replies come in order, so all earlier ones are in */
+  if (serial <= server->synced_serial)
+    return;
+
+  reply = gdk_broadway_server_wait_for_reply (server, serial);
+
+  g_assert (reply->base.type == BROADWAY_REPLY_SYNC);
+  server->synced_serial = serial;
+
+  g_free (reply);
+}
+
 void
 _gdk_broadway_server_query_mouse (GdkBroadwayServer *server,
 				  guint32            *toplevel,
@@ -700,13 +735,20 @@ _gdk_broadway_server_create_surface (int                 width,
   return surface;
 }
 
+/* @damage is the area that changed since the last update of the
+ * window, or %NULL for all of it. The server might still read
+ * @surface until it handled the request. */
 void
 _gdk_broadway_server_window_update (GdkBroadwayServer *server,
 				    gint id,
-				    cairo_surface_t *surface)
+				    cairo_surface_t *surface,
+				    cairo_region_t *damage)
 {
-  BroadwayRequestUpdate msg;
+  BroadwayRequestUpdate *msg;
   BroadwayShmSurfaceData *data;
+  cairo_rectangle_int_t extents;
+  gsize size;
+  int i, n_rects;
 
   if (surface == NULL)
     return;
@@ -714,13 +756,38 @@ _gdk_broadway_server_window_update (GdkBroadwayServer *server,
   data = cairo_surface_get_user_data (surface, &gdk_broadway_shm_cairo_key);
   g_assert (data != NULL);
 
-  msg.id = id;
-  memcpy (msg.name, data->name, 36);
-  msg.width = cairo_image_surface_get_width (surface);
-  msg.height = cairo_image_surface_get_height (surface);
+  msg = g_alloca (sizeof (BroadwayRequestUpdate) +
+		  sizeof (BroadwayRect) * (BROADWAY_MAX_UPDATE_RECTS - 1));
+  /* rects[0] is sent even if there are no rectangles */
+  memset (msg, 0, sizeof (BroadwayRequestUpdate));
 
-  gdk_broadway_server_send_message (server, msg,
-				    BROADWAY_REQUEST_UPDATE);
+  msg->id = id;
+  memcpy (msg->name, data->name, 36);
+  msg->width = cairo_image_surface_get_width (surface);
+  msg->height = cairo_image_surface_get_height (surface);
+
+  n_rects = damage ? cairo_region_num_rectangles (damage) : 0;
+  size = sizeof (BroadwayRequestUpdate) + sizeof (BroadwayRect) * MAX (n_rects - 1, 0);
+
+  if (n_rects > BROADWAY_MAX_UPDATE_RECTS)
+    {
+      cairo_region_get_extents (damage, &extents);
+      msg->n_rects = 1;
+      msg->rects[0].x = extents.x;
+      msg->rects[0].y = extents.y;
+      msg->rects[0].width = extents.width;
+      msg->rects[0].height = extents.height;
+      size = sizeof (BroadwayRequestUpdate);
+    }
+  else
+    {
+      msg->n_rects = n_rects;
+      for (i = 0; i < n_rects; i++)
+	cairo_region_get_rectangle (damage, i, (cairo_rectangle_int_t *)&msg->rects[i]);
+    }
+
+  gdk_broadway_server_send_message_with_size (server, (BroadwayRequestBase *) msg, size,
+					      BROADWAY_REQUEST_UPDATE);
 }
 
 gboolean
@@ -18,6 +18,9 @@ GdkBroadwayServer *_gdk_broadway_server_new                      (const char
 								  GError            **error);
 void               _gdk_broadway_server_flush                    (GdkBroadwayServer  *server);
 void               _gdk_broadway_server_sync                     (GdkBroadwayServer  *server);
+guint32            _gdk_broadway_server_sync_async               (GdkBroadwayServer  *server);
+void               _gdk_broadway_server_wait_for_sync            (GdkBroadwayServer  *server,
+								  guint32             serial);
 gulong             _gdk_broadway_server_get_next_serial          (GdkBroadwayServer  *server);
 guint32            _gdk_broadway_server_get_last_seen_time       (GdkBroadwayServer  *server);
 gboolean           _gdk_broadway_server_lookahead_event          (GdkBroadwayServer  *server,
@@ -63,7 +66,8 @@ cairo_surface_t   *_gdk_broadway_server_create_surface           (int
 								  int                 height);
 void               _gdk_broadway_server_window_update            (GdkBroadwayServer  *server,
 								  gint                id,
-								  cairo_surface_t    *surface);
+								  cairo_surface_t    *surface,
+								  cairo_region_t     *damage);
 gboolean           _gdk_broadway_server_window_move_resize       (GdkBroadwayServer  *server,
 								  gint                id,
 								  gboolean            with_move,
@@ -81,16 +81,86 @@ G_DEFINE_TYPE (GdkWindowImplBroadway,
 	       gdk_window_impl_broadway,
 	       GDK_TYPE_WINDOW_IMPL)
 
+/* The server reads updates from one of two shm surfaces, which we
+ * copy what changed into. Instead of syncing after every update, we
+ * only wait for the server to be done with the surface we are about
+ * to reuse, which it usually is as that was two updates ago. */
 static void
-update_dirty_windows_and_sync (void)
+update_window (GdkBroadwayDisplay    *display,
+	       GdkWindowImplBroadway *impl)
+{
+  cairo_surface_t *shm_surface;
+  cairo_region_t *copy;
+  cairo_t *cr;
+  int i, w, h;
+
+  if (impl->surface == NULL ||
+      (impl->damage != NULL && cairo_region_is_empty (impl->damage)))
+    return;
+
+  w = cairo_image_surface_get_width (impl->surface);
+  h = cairo_image_surface_get_height (impl->surface);
+
+  i = impl->next_shm_surface;
+  impl->next_shm_surface = (i + 1) % G_N_ELEMENTS (impl->shm_surfaces);
+
+  _gdk_broadway_server_wait_for_sync (display->server, impl->shm_sync_serials[i]);
+
+  shm_surface = impl->shm_surfaces[i];
+  if (shm_surface != NULL &&
+      (cairo_image_surface_get_width (shm_surface) != w ||
+       cairo_image_surface_get_height (shm_surface) != h))
+    {
+      cairo_surface_destroy (shm_surface);
+      shm_surface = NULL;
+    }
+
+  /* The shm surface has what we sent in the update before the
+   * last one, so copy what changed since then */
+  if (shm_surface != NULL && impl->damage != NULL && impl->last_damage != NULL)
+    {
+      copy = cairo_region_copy (impl->damage);
+      cairo_region_union (copy, impl->last_damage);
+    }
+  else
+    {
+      cairo_rectangle_int_t rect = { 0, 0, w, h };
+
+      if (shm_surface == NULL)
+	shm_surface = _gdk_broadway_server_create_surface (w, h);
+      copy = cairo_region_create_rectangle (&rect);
+    }
+  impl->shm_surfaces[i] = shm_surface;
+
+  cr = cairo_create (shm_surface);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, impl->surface, 0, 0);
+  gdk_cairo_region (cr, copy);
+  cairo_fill (cr);
+  cairo_destroy (cr);
+  cairo_surface_flush (shm_surface);
+  cairo_region_destroy (copy);
+
+  _gdk_broadway_server_window_update (display->server,
+				      impl->id,
+				      shm_surface,
+				      impl->damage);
+  impl->shm_sync_serials[i] = _gdk_broadway_server_sync_async (display->server);
+
+  if (impl->last_damage)
+    cairo_region_destroy (impl->last_damage);
+  impl->last_damage = impl->damage;
+  impl->damage = cairo_region_create ();
+}
+
+static void
+update_dirty_windows (void)
 {
   GList *l;
   GdkBroadwayDisplay *display;
-  gboolean updated_surface;
 
   display = GDK_BROADWAY_DISPLAY (gdk_display_get_default ());
 
-  updated_surface = FALSE;
   for (l = display->toplevels; l != NULL; l = l->next)
     {
       GdkWindowImplBroadway *impl = l->data;
@@ -98,19 +168,11 @@ update_dirty_windows_and_sync (void)
       if (impl->dirty)
 	{
 	  impl->dirty = FALSE;
-	  updated_surface = TRUE;
-	  _gdk_broadway_server_window_update (display->server,
-					      impl->id,
-					      impl->surface);
+	  update_window (display, impl);
 	}
     }
 
-  /* We sync here to ensure all references to the impl->surface memory
-     is done, as we may later paint new data in them. */
-  if (updated_surface)
-    gdk_display_sync (GDK_DISPLAY (display));
-  else
-    gdk_display_flush (GDK_DISPLAY (display));
+  gdk_display_flush (GDK_DISPLAY (display));
 }
 
 static guint flush_id = 0;
@@ -217,7 +279,7 @@ static void
 on_frame_clock_after_paint (GdkFrameClock *clock,
                             GdkWindow     *window)
 {
-  update_dirty_windows_and_sync ();
+  update_dirty_windows ();
 }
 
 static void
@@ -277,10 +339,13 @@ _gdk_broadway_window_resize_surface (GdkWindow *window)
     {
       cairo_surface_destroy (impl->surface);
 
-      impl->surface = _gdk_broadway_server_create_surface (gdk_window_get_width (impl->wrapper),
-							   gdk_window_get_height (impl->wrapper));
+      impl->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						  gdk_window_get_width (impl->wrapper),
+						  gdk_window_get_height (impl->wrapper));
     }
 
+  g_clear_pointer (&impl->damage, cairo_region_destroy);
+
   if (impl->ref_surface)
     {
       cairo_surface_set_user_data (impl->ref_surface, &gdk_broadway_cairo_key,
@@ -314,7 +379,18 @@ gdk_window_broadway_ref_cairo_surface (GdkWindow *window)
 
   /* Create actual backing store if missing */
   if (!impl->surface)
-    impl->surface = _gdk_broadway_server_create_surface (w, h);
+    {
+      impl->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, w, h);
+      g_clear_pointer (&impl->damage, cairo_region_destroy);
+    }
+
+  /* We only know what a paint touched, so anything drawn through
+   * gdk_cairo_create() outside of one means a full update */
+  if (window->current_paint.region == NULL)
+    {
+      g_clear_pointer (&impl->damage, cairo_region_destroy);
+      impl->dirty = TRUE;
+    }
 
   /* Create a destroyable surface referencing the real one */
   if (!impl->ref_surface)
@@ -333,6 +409,16 @@ gdk_window_broadway_ref_cairo_surface (GdkWindow *window)
   return impl->ref_surface;
 }
 
+/* Don't go through ref_cairo_surface(), which would force a full update */
+static cairo_surface_t *
+gdk_window_broadway_create_similar_image_surface (GdkWindow      *window,
+						  cairo_format_t  format,
+						  int             width,
+						  int             height)
+{
+  return cairo_image_surface_create (format, width, height);
+}
+
 static void
 _gdk_broadway_window_destroy (GdkWindow *window,
 			      gboolean   recursing,
@@ -340,6 +426,7 @@ _gdk_broadway_window_destroy (GdkWindow *window,
 {
   GdkWindowImplBroadway *impl;
   GdkBroadwayDisplay *broadway_display;
+  guint i;
 
   g_return_if_fail (GDK_IS_WINDOW (window));
 
@@ -362,6 +449,21 @@ _gdk_broadway_window_destroy (GdkWindow *window,
     }
 
   broadway_display = GDK_BROADWAY_DISPLAY (gdk_window_get_display (window));
+
+  /* The server might not have opened the shm surfaces yet */
+  for (i = 0; i < G_N_ELEMENTS (impl->shm_surfaces); i++)
+    {
+      if (impl->shm_surfaces[i] == NULL)
+	continue;
+
+      _gdk_broadway_server_wait_for_sync (broadway_display->server,
+					  impl->shm_sync_serials[i]);
+      cairo_surface_destroy (impl->shm_surfaces[i]);
+      impl->shm_surfaces[i] = NULL;
+    }
+
+  g_clear_pointer (&impl->damage, cairo_region_destroy);
+  g_clear_pointer (&impl->last_damage, cairo_region_destroy);
   g_hash_table_remove (broadway_display->id_ht, GINT_TO_POINTER(impl->id));
 
   _gdk_broadway_server_destroy_window (broadway_display->server,
@@ -985,6 +1087,9 @@ gdk_broadway_window_end_paint (GdkWindow *window)
   GdkWindowImplBroadway *impl;
   impl = GDK_WINDOW_IMPL_BROADWAY (window->impl);
   impl->dirty = TRUE;
+
+  if (impl->damage)
+    cairo_region_union (impl->damage, window->current_paint.region);
 }
 
 static gboolean
@@ -1496,6 +1601,7 @@ gdk_window_impl_broadway_class_init (GdkWindowImplBroadwayClass *klass)
   object_class->finalize = gdk_window_impl_broadway_finalize;
 
   impl_class->ref_cairo_surface = gdk_window_broadway_ref_cairo_surface;
+  impl_class->create_similar_image_surface = gdk_window_broadway_create_similar_image_surface;
   impl_class->show = gdk_window_broadway_show;
   impl_class->hide = gdk_window_broadway_hide;
   impl_class->withdraw = gdk_window_broadway_withdraw;
@@ -53,6 +53,16 @@ struct _GdkWindowImplBroadway
   cairo_surface_t *last_surface;
   cairo_surface_t *ref_surface;
 
+  /* The shm surfaces the server reads updates from, used in turn */
+  cairo_surface_t *shm_surfaces[2];
+  guint32 shm_sync_serials[2];
+  int next_shm_surface;
+
+  /* What was painted since the last update and what changed in
+   * that one, NULL if everything did */
+  cairo_region_t *damage;
+  cairo_region_t *last_damage;
+
   GdkCursor *cursor;
   GHashTable *device_cursor;
 
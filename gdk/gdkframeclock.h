@@ -105,6 +105,14 @@ void gdk_frame_clock_get_refresh_info (GdkFrameClock *frame_clock,
                                        gint64        *refresh_interval_return,
                                        gint64        *presentation_time_return);
 
+/* These are GdkFrameTimings functions, but need GdkFrameClockPhase */
+GDK_AVAILABLE_IN_ALL
+gint64 gdk_frame_timings_get_phase_start_time (GdkFrameTimings    *timings,
+                                               GdkFrameClockPhase  phase);
+GDK_AVAILABLE_IN_ALL
+gint64 gdk_frame_timings_get_phase_duration   (GdkFrameTimings    *timings,
+                                               GdkFrameClockPhase  phase);
+
 G_END_DECLS
 
 #endif /* __GDK_FRAME_CLOCK_H__ */
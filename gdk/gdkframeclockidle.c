@@ -44,6 +44,10 @@ struct _GdkFrameClockIdlePrivate
   gint64 min_next_frame_time;
   gint64 sleep_serial;
 
+  /* The last ::flush-events, recorded in the timings of the next frame */
+  gint64 flush_start_time;
+  gint64 flush_end_time;
+
   guint flush_idle_id;
   guint paint_idle_id;
   guint freeze_count;
@@ -61,6 +65,18 @@ struct _GdkFrameClockIdlePrivate
 static gboolean gdk_frame_clock_flush_idle (void *data);
 static gboolean gdk_frame_clock_paint_idle (void *data);
 
+static void
+record_phase (GdkFrameTimings    *timings,
+              GdkFrameClockPhase  phase,
+              gint64              start_time,
+              gint64              end_time)
+{
+  gint i = g_bit_nth_lsf (phase, -1);
+
+  timings->phase_start_time[i] = start_time;
+  timings->phase_end_time[i] = end_time;
+}
+
 G_DEFINE_TYPE_WITH_PRIVATE (GdkFrameClockIdle, gdk_frame_clock_idle, GDK_TYPE_FRAME_CLOCK)
 
 static gint64 sleep_serial;
@@ -307,7 +323,9 @@ gdk_frame_clock_flush_idle (void *data)
   priv->phase = GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS;
   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS;
 
+  priv->flush_start_time = g_get_monotonic_time ();
   g_signal_emit_by_name (G_OBJECT (clock), "flush-events");
+  priv->flush_end_time = g_get_monotonic_time ();
 
   if ((priv->requested & ~GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS) != 0 ||
       priv->updating_count > 0)
@@ -326,6 +344,7 @@ gdk_frame_clock_paint_idle (void *data)
   GdkFrameClockIdlePrivate *priv = clock_idle->priv;
   gboolean skip_to_resume_events;
   GdkFrameTimings *timings = NULL;
+  gint64 start_time;
 
   priv->paint_idle_id = 0;
   priv->in_paint_idle = TRUE;
@@ -358,6 +377,14 @@ gdk_frame_clock_paint_idle (void *data)
               timings->frame_time = priv->frame_time;
               timings->slept_before = priv->sleep_serial != get_sleep_serial ();
 
+              if (priv->flush_start_time != 0)
+                {
+                  record_phase (timings, GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS,
+                                priv->flush_start_time, priv->flush_end_time);
+                  priv->flush_start_time = 0;
+                  priv->flush_end_time = 0;
+                }
+
               priv->phase = GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
 
               /* We always emit ::before-paint and ::after-paint if
@@ -366,7 +393,10 @@ gdk_frame_clock_paint_idle (void *data)
                * in them.
                */
               priv->requested &= ~GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT;
+              start_time = g_get_monotonic_time ();
               g_signal_emit_by_name (G_OBJECT (clock), "before-paint");
+              record_phase (timings, GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT,
+                            start_time, g_get_monotonic_time ());
               priv->phase = GDK_FRAME_CLOCK_PHASE_UPDATE;
             }
           /* fallthrough */
@@ -377,7 +407,10 @@ gdk_frame_clock_paint_idle (void *data)
                   priv->updating_count > 0)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_UPDATE;
+                  start_time = g_get_monotonic_time ();
                   g_signal_emit_by_name (G_OBJECT (clock), "update");
+                  record_phase (timings, GDK_FRAME_CLOCK_PHASE_UPDATE,
+                                start_time, g_get_monotonic_time ());
                 }
             }
           /* fallthrough */
@@ -401,12 +434,16 @@ gdk_frame_clock_paint_idle (void *data)
 	       * resizes and natural size changes.
 	       */
 	      iter = 0;
+              start_time = g_get_monotonic_time ();
               while ((priv->requested & GDK_FRAME_CLOCK_PHASE_LAYOUT) &&
 		     priv->freeze_count == 0 && iter++ < 4)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_LAYOUT;
                   g_signal_emit_by_name (G_OBJECT (clock), "layout");
                 }
+              if (iter > 0)
+                record_phase (timings, GDK_FRAME_CLOCK_PHASE_LAYOUT,
+                              start_time, g_get_monotonic_time ());
 	      if (iter == 5)
 		g_warning ("gdk-frame-clock: layout continuously requested, giving up after 4 tries");
             }
@@ -427,7 +464,10 @@ gdk_frame_clock_paint_idle (void *data)
               if (priv->requested & GDK_FRAME_CLOCK_PHASE_PAINT)
                 {
                   priv->requested &= ~GDK_FRAME_CLOCK_PHASE_PAINT;
+                  start_time = g_get_monotonic_time ();
                   g_signal_emit_by_name (G_OBJECT (clock), "paint");
+                  record_phase (timings, GDK_FRAME_CLOCK_PHASE_PAINT,
+                                start_time, g_get_monotonic_time ());
                 }
             }
           /* fallthrough */
@@ -435,7 +475,10 @@ gdk_frame_clock_paint_idle (void *data)
           if (priv->freeze_count == 0)
             {
               priv->requested &= ~GDK_FRAME_CLOCK_PHASE_AFTER_PAINT;
+              start_time = g_get_monotonic_time ();
               g_signal_emit_by_name (G_OBJECT (clock), "after-paint");
+              record_phase (timings, GDK_FRAME_CLOCK_PHASE_AFTER_PAINT,
+                            start_time, g_get_monotonic_time ());
               /* the ::after-paint phase doesn't get repeated on freeze/thaw,
                */
               priv->phase = GDK_FRAME_CLOCK_PHASE_NONE;
@@ -462,7 +505,11 @@ gdk_frame_clock_paint_idle (void *data)
   if (priv->requested & GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS)
     {
       priv->requested &= ~GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS;
+      start_time = g_get_monotonic_time ();
       g_signal_emit_by_name (G_OBJECT (clock), "resume-events");
+      if (timings)
+        record_phase (timings, GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS,
+                      start_time, g_get_monotonic_time ());
     }
 
   if (priv->freeze_count == 0)
@@ -94,6 +94,11 @@ struct _GdkFrameTimings
   gint64 refresh_interval;
   gint64 predicted_presentation_time;
 
+  /* Indexed by the bit number of the GdkFrameClockPhase,
+   * 0 if the phase didn't run in this frame */
+  gint64 phase_start_time[7];
+  gint64 phase_end_time[7];
+
 #ifdef G_ENABLE_DEBUG
   gint64 layout_start_time;
   gint64 paint_start_time;
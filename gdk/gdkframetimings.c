@@ -217,3 +217,57 @@ gdk_frame_timings_get_refresh_interval (GdkFrameTimings *timings)
 
   return timings->refresh_interval;
 }
+
+/**
+ * gdk_frame_timings_get_phase_start_time:
+ * @timings: a #GdkFrameTimings
+ * @phase: a single phase of the frame clock
+ *
+ * Gets the time when the frame clock started to emit the
+ * signal for @phase in this frame. The ::flush-events phase
+ * is the last one that ran before the frame started.
+ *
+ * Returns: the start time of @phase, in the timescale of
+ *  g_get_monotonic_time(), or 0 if @phase did not run
+ * Since: 3.16
+ */
+gint64
+gdk_frame_timings_get_phase_start_time (GdkFrameTimings    *timings,
+                                        GdkFrameClockPhase  phase)
+{
+  gint i;
+
+  g_return_val_if_fail (timings != NULL, 0);
+
+  i = g_bit_nth_lsf (phase, -1);
+  g_return_val_if_fail (i >= 0 && i < (gint) G_N_ELEMENTS (timings->phase_start_time), 0);
+
+  return timings->phase_start_time[i];
+}
+
+/**
+ * gdk_frame_timings_get_phase_duration:
+ * @timings: a #GdkFrameTimings
+ * @phase: a single phase of the frame clock
+ *
+ * Gets how long the handlers of @phase took in this frame.
+ * This tells, for example, whether a slow frame was spent
+ * on layout or on painting.
+ *
+ * Returns: the duration of @phase in microseconds, or 0 if
+ *  @phase did not run
+ * Since: 3.16
+ */
+gint64
+gdk_frame_timings_get_phase_duration (GdkFrameTimings    *timings,
+                                      GdkFrameClockPhase  phase)
+{
+  gint i;
+
+  g_return_val_if_fail (timings != NULL, 0);
+
+  i = g_bit_nth_lsf (phase, -1);
+  g_return_val_if_fail (i >= 0 && i < (gint) G_N_ELEMENTS (timings->phase_start_time), 0);
+
+  return timings->phase_end_time[i] - timings->phase_start_time[i];
+}
@@ -0,0 +1,127 @@
+/* compilecss.c
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <gtk/gtk.h>
+#include <errno.h>
+#include <locale.h>
+
+#include "gtkcssproviderprivate.h"
+
+static gboolean quiet = FALSE;
+static gboolean remove_caches = FALSE;
+
+static GOptionEntry args[] = {
+  { "quiet", 'q', 0, G_OPTION_ARG_NONE, &quiet, N_("Turn off verbose output"), NULL },
+  { "remove", 'r', 0, G_OPTION_ARG_NONE, &remove_caches, N_("Remove the caches instead of creating them"), NULL },
+  { NULL }
+};
+
+static gboolean
+compile_file (const char *path)
+{
+  GError *error = NULL;
+  GBytes *bytes;
+  GFile *file;
+  char *cache_path;
+  gboolean success;
+
+  cache_path = g_strconcat (path, ".cache", NULL);
+
+  if (remove_caches)
+    {
+      if (g_unlink (cache_path) != 0 && errno != ENOENT)
+        {
+          g_printerr (_("Failed to remove %s: %s\n"), cache_path, g_strerror (errno));
+          g_free (cache_path);
+          return FALSE;
+        }
+      g_free (cache_path);
+      return TRUE;
+    }
+
+  file = g_file_new_for_commandline_arg (path);
+  bytes = _gtk_css_provider_compile (file, &error);
+  g_object_unref (file);
+
+  if (bytes == NULL)
+    {
+      g_printerr (_("Failed to compile %s: %s\n"), path, error->message);
+      g_error_free (error);
+      g_free (cache_path);
+      return FALSE;
+    }
+
+  success = g_file_set_contents (cache_path,
+                                 g_bytes_get_data (bytes, NULL),
+                                 g_bytes_get_size (bytes),
+                                 &error);
+  if (!success)
+    {
+      g_printerr (_("Failed to write %s: %s\n"), cache_path, error->message);
+      g_error_free (error);
+    }
+  else if (!quiet)
+    g_printerr (_("Compiled %s.\n"), cache_path);
+
+  g_bytes_unref (bytes);
+  g_free (cache_path);
+
+  return success;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  gboolean success;
+  int i;
+
+  setlocale (LC_ALL, "");
+
+#ifdef ENABLE_NLS
+  bindtextdomain (GETTEXT_PACKAGE, GTK_LOCALEDIR);
+#ifdef HAVE_BIND_TEXTDOMAIN_CODESET
+  bind_textdomain_codeset (GETTEXT_PACKAGE, "UTF-8");
+#endif
+#endif
+
+  g_set_prgname ("gtk-compile-css");
+
+  context = g_option_context_new ("FILE...");
+  g_option_context_add_main_entries (context, args, GETTEXT_PACKAGE);
+
+  g_option_context_parse (context, &argc, &argv, NULL);
+
+  if (argc < 2)
+    {
+      g_printerr ("%s\n", g_option_context_get_help (context, FALSE, NULL));
+      return 1;
+    }
+
+  success = TRUE;
+  for (i = 1; i < argc; i++)
+    success &= compile_file (argv[i]);
+
+  g_option_context_free (context);
+
+  return success ? 0 : 1;
+}
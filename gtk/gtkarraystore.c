@@ -0,0 +1,2057 @@
+/* gtkarraystore.c
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <string.h>
+#include <gobject/gvaluecollector.h>
+#include "gtktreemodel.h"
+#include "gtkarraystore.h"
+#include "gtktreedatalist.h"
+#include "gtktreeprivate.h"
+
+
+/**
+ * SECTION:gtkarraystore
+ * @Short_description: A list model that keeps its columns in arrays
+ * @Title: GtkArrayStore
+ * @See_also: #GtkListStore, #GtkTreeModel
+ *
+ * The #GtkArrayStore object is a list model for use with a #GtkTreeView
+ * widget, meant for lists with a very large number of rows.  Where a
+ * #GtkListStore allocates every row separately, a #GtkArrayStore keeps
+ * each column in one contiguous array of the column’s C type.  Finding
+ * a row by its position takes constant time, and a row made of a few
+ * numbers takes only a few bytes.  Like #GtkListStore, it implements the
+ * #GtkTreeModel and #GtkTreeSortable interfaces.
+ *
+ * Strings are interned: a string that appears in many rows is only
+ * stored once.  The memory of strings that are not used by any row
+ * anymore is only given back when the store is cleared with
+ * gtk_array_store_clear().
+ *
+ * Rows are best added and changed many at a time, with
+ * gtk_array_store_append_rows() and gtk_array_store_set_rows(), which
+ * take an array of values per column.  Inserting or removing a single
+ * row moves all rows after it, so it is slower than with a
+ * #GtkListStore for rows in the middle of a large store.  Also unlike
+ * #GtkListStore, iters are not persistent: they become invalid when
+ * rows are inserted, removed or reordered.
+ *
+ * An example for filling an array store:
+ * |[<!-- language="C" -->
+ * enum {
+ *   COLUMN_ID,
+ *   COLUMN_NAME,
+ *   COLUMN_SIZE,
+ *   N_COLUMNS
+ * };
+ *
+ * {
+ *   GtkArrayStore *store;
+ *   gint ids[N_ROWS];
+ *   const gchar *names[N_ROWS];
+ *   gdouble sizes[N_ROWS];
+ *
+ *   store = gtk_array_store_new (N_COLUMNS,
+ *                                G_TYPE_INT,
+ *                                G_TYPE_STRING,
+ *                                G_TYPE_DOUBLE);
+ *
+ *   fill_in_rows (ids, names, sizes);
+ *
+ *   gtk_array_store_append_rows (store, N_ROWS,
+ *                                COLUMN_ID, ids,
+ *                                COLUMN_NAME, names,
+ *                                COLUMN_SIZE, sizes,
+ *                                -1);
+ * }
+ * ]|
+ */
+
+typedef struct
+{
+  GType type;
+  GType fundamental;
+  guint element_size;
+  GArray *data;
+} GtkArrayStoreColumn;
+
+struct _GtkArrayStorePrivate
+{
+  GtkTreeIterCompareFunc default_sort_func;
+
+  GDestroyNotify default_sort_destroy;
+  GList *sort_list;
+  GtkArrayStoreColumn *columns;
+  GStringChunk *strings;
+
+  gint stamp;
+  gint n_columns;
+  /* The column arrays are only longer than this while
+   * gtk_array_store_append_rowsv() announces new rows */
+  gint n_rows;
+  gint sort_column_id;
+
+  GtkSortType order;
+
+  gpointer default_sort_data;
+};
+
+typedef struct
+{
+  GtkArrayStore *array_store;
+  GtkTreeIterCompareFunc func;
+  gpointer data;
+  /* Set if the rows are compared by their values in this column,
+   * without going through the tree model interface */
+  GtkArrayStoreColumn *column;
+  /* Interned string -> collation key */
+  GHashTable *collate_keys;
+  gboolean descending;
+} SortData;
+
+#define GTK_ARRAY_STORE_IS_SORTED(store) (((GtkArrayStore*)(store))->priv->sort_column_id != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID)
+#define ITER_ROW(iter) GPOINTER_TO_INT ((iter)->user_data)
+
+static void         gtk_array_store_tree_model_init (GtkTreeModelIface *iface);
+static void         gtk_array_store_sortable_init   (GtkTreeSortableIface *iface);
+static void         gtk_array_store_finalize        (GObject           *object);
+static GtkTreeModelFlags gtk_array_store_get_flags  (GtkTreeModel      *tree_model);
+static gint         gtk_array_store_get_n_columns   (GtkTreeModel      *tree_model);
+static GType        gtk_array_store_get_column_type (GtkTreeModel      *tree_model,
+						     gint               index);
+static gboolean     gtk_array_store_get_iter        (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter,
+						     GtkTreePath       *path);
+static GtkTreePath *gtk_array_store_get_path        (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter);
+static void         gtk_array_store_get_value       (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter,
+						     gint               column,
+						     GValue            *value);
+static gboolean     gtk_array_store_iter_next       (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter);
+static gboolean     gtk_array_store_iter_previous   (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter);
+static gboolean     gtk_array_store_iter_children   (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter,
+						     GtkTreeIter       *parent);
+static gboolean     gtk_array_store_iter_has_child  (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter);
+static gint         gtk_array_store_iter_n_children (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter);
+static gboolean     gtk_array_store_iter_nth_child  (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter,
+						     GtkTreeIter       *parent,
+						     gint               n);
+static gboolean     gtk_array_store_iter_parent     (GtkTreeModel      *tree_model,
+						     GtkTreeIter       *iter,
+						     GtkTreeIter       *child);
+
+static void     gtk_array_store_sort                  (GtkArrayStore          *array_store);
+static void     gtk_array_store_sort_iter_changed     (GtkArrayStore          *array_store,
+						       GtkTreeIter            *iter);
+static gboolean gtk_array_store_get_sort_column_id    (GtkTreeSortable        *sortable,
+						       gint                   *sort_column_id,
+						       GtkSortType            *order);
+static void     gtk_array_store_set_sort_column_id    (GtkTreeSortable        *sortable,
+						       gint                    sort_column_id,
+						       GtkSortType             order);
+static void     gtk_array_store_set_sort_func         (GtkTreeSortable        *sortable,
+						       gint                    sort_column_id,
+						       GtkTreeIterCompareFunc  func,
+						       gpointer                data,
+						       GDestroyNotify          destroy);
+static void     gtk_array_store_set_default_sort_func (GtkTreeSortable        *sortable,
+						       GtkTreeIterCompareFunc  func,
+						       gpointer                data,
+						       GDestroyNotify          destroy);
+static gboolean gtk_array_store_has_default_sort_func (GtkTreeSortable        *sortable);
+
+
+G_DEFINE_TYPE_WITH_CODE (GtkArrayStore, gtk_array_store, G_TYPE_OBJECT,
+                         G_ADD_PRIVATE (GtkArrayStore)
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						gtk_array_store_tree_model_init)
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE,
+						gtk_array_store_sortable_init))
+
+
+static void
+gtk_array_store_class_init (GtkArrayStoreClass *class)
+{
+  GObjectClass *object_class;
+
+  object_class = (GObjectClass*) class;
+
+  object_class->finalize = gtk_array_store_finalize;
+}
+
+static void
+gtk_array_store_tree_model_init (GtkTreeModelIface *iface)
+{
+  iface->get_flags = gtk_array_store_get_flags;
+  iface->get_n_columns = gtk_array_store_get_n_columns;
+  iface->get_column_type = gtk_array_store_get_column_type;
+  iface->get_iter = gtk_array_store_get_iter;
+  iface->get_path = gtk_array_store_get_path;
+  iface->get_value = gtk_array_store_get_value;
+  iface->iter_next = gtk_array_store_iter_next;
+  iface->iter_previous = gtk_array_store_iter_previous;
+  iface->iter_children = gtk_array_store_iter_children;
+  iface->iter_has_child = gtk_array_store_iter_has_child;
+  iface->iter_n_children = gtk_array_store_iter_n_children;
+  iface->iter_nth_child = gtk_array_store_iter_nth_child;
+  iface->iter_parent = gtk_array_store_iter_parent;
+}
+
+static void
+gtk_array_store_sortable_init (GtkTreeSortableIface *iface)
+{
+  iface->get_sort_column_id = gtk_array_store_get_sort_column_id;
+  iface->set_sort_column_id = gtk_array_store_set_sort_column_id;
+  iface->set_sort_func = gtk_array_store_set_sort_func;
+  iface->set_default_sort_func = gtk_array_store_set_default_sort_func;
+  iface->has_default_sort_func = gtk_array_store_has_default_sort_func;
+}
+
+static void
+gtk_array_store_init (GtkArrayStore *array_store)
+{
+  GtkArrayStorePrivate *priv;
+
+  array_store->priv = gtk_array_store_get_instance_private (array_store);
+  priv = array_store->priv;
+
+  priv->strings = g_string_chunk_new (4096);
+  priv->stamp = g_random_int ();
+  priv->sort_column_id = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+  priv->order = GTK_SORT_ASCENDING;
+}
+
+static inline gboolean
+iter_is_valid (GtkTreeIter   *iter,
+               GtkArrayStore *array_store)
+{
+  return iter != NULL &&
+         iter->stamp == array_store->priv->stamp &&
+         ITER_ROW (iter) >= 0 &&
+         ITER_ROW (iter) < array_store->priv->n_rows;
+}
+
+static void
+gtk_array_store_increment_stamp (GtkArrayStore *array_store)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  do
+    {
+      priv->stamp++;
+    }
+  while (priv->stamp == 0);
+}
+
+/* Column storage */
+
+static inline GType
+get_fundamental_type (GType type)
+{
+  GType result;
+
+  result = G_TYPE_FUNDAMENTAL (type);
+
+  if (result == G_TYPE_INTERFACE)
+    {
+      if (g_type_is_a (type, G_TYPE_OBJECT))
+	result = G_TYPE_OBJECT;
+    }
+
+  return result;
+}
+
+static guint
+get_element_size (GType fundamental)
+{
+  switch (fundamental)
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+      return sizeof (gint8);
+    case G_TYPE_BOOLEAN:
+      return sizeof (gboolean);
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+      return sizeof (gint);
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+      return sizeof (glong);
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+      return sizeof (gint64);
+    case G_TYPE_FLOAT:
+      return sizeof (gfloat);
+    case G_TYPE_DOUBLE:
+      return sizeof (gdouble);
+    default:
+      /* strings, pointers, objects, boxed types and variants */
+      return sizeof (gpointer);
+    }
+}
+
+static inline gpointer
+column_element (GtkArrayStoreColumn *column,
+                gint                 row)
+{
+  return column->data->data + (gsize) row * column->element_size;
+}
+
+/* Drops the references the rows hold, but leaves the rows in place */
+static void
+column_clear_rows (GtkArrayStoreColumn *column,
+                   gint                 first_row,
+                   gint                 n_rows)
+{
+  gpointer *elements;
+  gint i;
+
+  if (column->fundamental != G_TYPE_OBJECT &&
+      column->fundamental != G_TYPE_BOXED &&
+      column->fundamental != G_TYPE_VARIANT)
+    return;
+
+  elements = column_element (column, first_row);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      if (elements[i] == NULL)
+        continue;
+
+      switch (column->fundamental)
+        {
+        case G_TYPE_OBJECT:
+          g_object_unref (elements[i]);
+          break;
+        case G_TYPE_BOXED:
+          g_boxed_free (column->type, elements[i]);
+          break;
+        case G_TYPE_VARIANT:
+          g_variant_unref (elements[i]);
+          break;
+        default:
+          g_assert_not_reached ();
+        }
+
+      elements[i] = NULL;
+    }
+}
+
+/* Copies @n_rows values from @data into rows that have been cleared */
+static void
+column_copy_rows (GtkArrayStore       *array_store,
+                  GtkArrayStoreColumn *column,
+                  gint                 first_row,
+                  gconstpointer        data,
+                  gint                 n_rows)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gpointer dest = column_element (column, first_row);
+  gint i;
+
+  switch (column->fundamental)
+    {
+    case G_TYPE_BOOLEAN:
+      for (i = 0; i < n_rows; i++)
+        ((gboolean *) dest)[i] = ((const gboolean *) data)[i] != FALSE;
+      break;
+    case G_TYPE_STRING:
+      for (i = 0; i < n_rows; i++)
+        {
+          const gchar *str = ((const gchar * const *) data)[i];
+
+          ((const gchar **) dest)[i] = str ? g_string_chunk_insert_const (priv->strings, str) : NULL;
+        }
+      break;
+    case G_TYPE_OBJECT:
+      for (i = 0; i < n_rows; i++)
+        {
+          gpointer object = ((const gpointer *) data)[i];
+
+          ((gpointer *) dest)[i] = object ? g_object_ref (object) : NULL;
+        }
+      break;
+    case G_TYPE_BOXED:
+      for (i = 0; i < n_rows; i++)
+        {
+          gconstpointer boxed = ((const gpointer *) data)[i];
+
+          ((gpointer *) dest)[i] = boxed ? g_boxed_copy (column->type, boxed) : NULL;
+        }
+      break;
+    case G_TYPE_VARIANT:
+      for (i = 0; i < n_rows; i++)
+        {
+          GVariant *variant = ((GVariant * const *) data)[i];
+
+          ((gpointer *) dest)[i] = variant ? g_variant_ref_sink (variant) : NULL;
+        }
+      break;
+    default:
+      memcpy (dest, data, (gsize) n_rows * column->element_size);
+      break;
+    }
+}
+
+/* Sets a cleared row from a value of the column’s type */
+static void
+column_set_row (GtkArrayStore       *array_store,
+                GtkArrayStoreColumn *column,
+                gint                 row,
+                GValue              *value)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gpointer element = column_element (column, row);
+
+  switch (column->fundamental)
+    {
+    case G_TYPE_CHAR:
+      *(gint8 *) element = g_value_get_schar (value);
+      break;
+    case G_TYPE_UCHAR:
+      *(guint8 *) element = g_value_get_uchar (value);
+      break;
+    case G_TYPE_BOOLEAN:
+      *(gboolean *) element = g_value_get_boolean (value);
+      break;
+    case G_TYPE_INT:
+      *(gint *) element = g_value_get_int (value);
+      break;
+    case G_TYPE_UINT:
+      *(guint *) element = g_value_get_uint (value);
+      break;
+    case G_TYPE_LONG:
+      *(glong *) element = g_value_get_long (value);
+      break;
+    case G_TYPE_ULONG:
+      *(gulong *) element = g_value_get_ulong (value);
+      break;
+    case G_TYPE_INT64:
+      *(gint64 *) element = g_value_get_int64 (value);
+      break;
+    case G_TYPE_UINT64:
+      *(guint64 *) element = g_value_get_uint64 (value);
+      break;
+    case G_TYPE_ENUM:
+      *(gint *) element = g_value_get_enum (value);
+      break;
+    case G_TYPE_FLAGS:
+      *(guint *) element = g_value_get_flags (value);
+      break;
+    case G_TYPE_FLOAT:
+      *(gfloat *) element = g_value_get_float (value);
+      break;
+    case G_TYPE_DOUBLE:
+      *(gdouble *) element = g_value_get_double (value);
+      break;
+    case G_TYPE_STRING:
+      {
+        const gchar *str = g_value_get_string (value);
+
+        *(const gchar **) element = str ? g_string_chunk_insert_const (priv->strings, str) : NULL;
+      }
+      break;
+    case G_TYPE_POINTER:
+      *(gpointer *) element = g_value_get_pointer (value);
+      break;
+    case G_TYPE_OBJECT:
+      *(gpointer *) element = g_value_dup_object (value);
+      break;
+    case G_TYPE_BOXED:
+      *(gpointer *) element = g_value_dup_boxed (value);
+      break;
+    case G_TYPE_VARIANT:
+      *(gpointer *) element = g_value_dup_variant (value);
+      break;
+    default:
+      g_warning ("%s: Unsupported type (%s) stored.", G_STRLOC, g_type_name (column->type));
+      break;
+    }
+}
+
+static void
+column_get_row (GtkArrayStoreColumn *column,
+                gint                 row,
+                GValue              *value)
+{
+  gpointer element = column_element (column, row);
+
+  g_value_init (value, column->type);
+
+  switch (column->fundamental)
+    {
+    case G_TYPE_CHAR:
+      g_value_set_schar (value, *(gint8 *) element);
+      break;
+    case G_TYPE_UCHAR:
+      g_value_set_uchar (value, *(guint8 *) element);
+      break;
+    case G_TYPE_BOOLEAN:
+      g_value_set_boolean (value, *(gboolean *) element);
+      break;
+    case G_TYPE_INT:
+      g_value_set_int (value, *(gint *) element);
+      break;
+    case G_TYPE_UINT:
+      g_value_set_uint (value, *(guint *) element);
+      break;
+    case G_TYPE_LONG:
+      g_value_set_long (value, *(glong *) element);
+      break;
+    case G_TYPE_ULONG:
+      g_value_set_ulong (value, *(gulong *) element);
+      break;
+    case G_TYPE_INT64:
+      g_value_set_int64 (value, *(gint64 *) element);
+      break;
+    case G_TYPE_UINT64:
+      g_value_set_uint64 (value, *(guint64 *) element);
+      break;
+    case G_TYPE_ENUM:
+      g_value_set_enum (value, *(gint *) element);
+      break;
+    case G_TYPE_FLAGS:
+      g_value_set_flags (value, *(guint *) element);
+      break;
+    case G_TYPE_FLOAT:
+      g_value_set_float (value, *(gfloat *) element);
+      break;
+    case G_TYPE_DOUBLE:
+      g_value_set_double (value, *(gdouble *) element);
+      break;
+    case G_TYPE_STRING:
+      g_value_set_string (value, *(const gchar **) element);
+      break;
+    case G_TYPE_POINTER:
+      g_value_set_pointer (value, *(gpointer *) element);
+      break;
+    case G_TYPE_OBJECT:
+      g_value_set_object (value, *(gpointer *) element);
+      break;
+    case G_TYPE_BOXED:
+      g_value_set_boxed (value, *(gpointer *) element);
+      break;
+    case G_TYPE_VARIANT:
+      g_value_set_variant (value, *(gpointer *) element);
+      break;
+    default:
+      g_warning ("%s: Unsupported type (%s) retrieved.", G_STRLOC, g_type_name (value->g_type));
+      break;
+    }
+}
+
+/* Inserts @n_rows zeroed rows at @position in all columns */
+static void
+gtk_array_store_insert_rows (GtkArrayStore *array_store,
+                             gint           position,
+                             gint           n_rows)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint i;
+
+  for (i = 0; i < priv->n_columns; i++)
+    {
+      GtkArrayStoreColumn *column = &priv->columns[i];
+      gint old_length = column->data->len;
+
+      g_array_set_size (column->data, old_length + n_rows);
+
+      if (position < old_length)
+        {
+          memmove (column_element (column, position + n_rows),
+                   column_element (column, position),
+                   (gsize) (old_length - position) * column->element_size);
+          memset (column_element (column, position), 0,
+                  (gsize) n_rows * column->element_size);
+        }
+    }
+}
+
+static void
+gtk_array_store_finalize (GObject *object)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (object);
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint i;
+
+  for (i = 0; i < priv->n_columns; i++)
+    {
+      column_clear_rows (&priv->columns[i], 0, priv->columns[i].data->len);
+      g_array_free (priv->columns[i].data, TRUE);
+    }
+  g_free (priv->columns);
+  g_string_chunk_free (priv->strings);
+
+  _gtk_tree_data_list_header_free (priv->sort_list);
+
+  if (priv->default_sort_destroy)
+    {
+      GDestroyNotify d = priv->default_sort_destroy;
+
+      priv->default_sort_destroy = NULL;
+      d (priv->default_sort_data);
+      priv->default_sort_data = NULL;
+    }
+
+  G_OBJECT_CLASS (gtk_array_store_parent_class)->finalize (object);
+}
+
+/**
+ * gtk_array_store_new:
+ * @n_columns: number of columns in the array store
+ * @...: all #GType types for the columns, from first to last
+ *
+ * Creates a new array store with @n_columns columns each of the types
+ * passed in.  Column types are restricted to the ones a #GtkListStore
+ * accepts.
+ *
+ * As an example, `gtk_array_store_new (3, G_TYPE_INT, G_TYPE_STRING,
+ * G_TYPE_DOUBLE);` will create a new #GtkArrayStore with three columns,
+ * of type int, string and double, respectively.
+ *
+ * Returns: a new #GtkArrayStore
+ *
+ * Since: 3.16
+ */
+GtkArrayStore *
+gtk_array_store_new (gint n_columns,
+                     ...)
+{
+  GtkArrayStore *retval;
+  GType *types;
+  va_list args;
+  gint i;
+
+  g_return_val_if_fail (n_columns > 0, NULL);
+
+  types = g_new (GType, n_columns);
+
+  va_start (args, n_columns);
+  for (i = 0; i < n_columns; i++)
+    types[i] = va_arg (args, GType);
+  va_end (args);
+
+  retval = gtk_array_store_newv (n_columns, types);
+
+  g_free (types);
+
+  return retval;
+}
+
+/**
+ * gtk_array_store_newv:
+ * @n_columns: number of columns in the array store
+ * @types: (array length=n_columns): an array of #GType types for the columns, from first to last
+ *
+ * Non-vararg creation function.  Used primarily by language bindings.
+ *
+ * Returns: (transfer full): a new #GtkArrayStore
+ *
+ * Since: 3.16
+ **/
+GtkArrayStore *
+gtk_array_store_newv (gint   n_columns,
+                      GType *types)
+{
+  GtkArrayStore *retval;
+  GtkArrayStorePrivate *priv;
+  gint i;
+
+  g_return_val_if_fail (n_columns > 0, NULL);
+
+  for (i = 0; i < n_columns; i++)
+    {
+      if (! _gtk_tree_data_list_check_type (types[i]))
+	{
+	  g_warning ("%s: Invalid type %s\n", G_STRLOC, g_type_name (types[i]));
+	  return NULL;
+	}
+    }
+
+  retval = g_object_new (GTK_TYPE_ARRAY_STORE, NULL);
+  priv = retval->priv;
+
+  priv->n_columns = n_columns;
+  priv->columns = g_new0 (GtkArrayStoreColumn, n_columns);
+
+  for (i = 0; i < n_columns; i++)
+    {
+      GtkArrayStoreColumn *column = &priv->columns[i];
+
+      column->type = types[i];
+      column->fundamental = get_fundamental_type (types[i]);
+      column->element_size = get_element_size (column->fundamental);
+      column->data = g_array_new (FALSE, TRUE, column->element_size);
+    }
+
+  priv->sort_list = _gtk_tree_data_list_header_new (n_columns, types);
+
+  return retval;
+}
+
+/* Fulfill the GtkTreeModel requirements */
+static GtkTreeModelFlags
+gtk_array_store_get_flags (GtkTreeModel *tree_model)
+{
+  return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+gtk_array_store_get_n_columns (GtkTreeModel *tree_model)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+
+  return array_store->priv->n_columns;
+}
+
+static GType
+gtk_array_store_get_column_type (GtkTreeModel *tree_model,
+				 gint          index)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  g_return_val_if_fail (index < priv->n_columns, G_TYPE_INVALID);
+
+  return priv->columns[index].type;
+}
+
+static gboolean
+gtk_array_store_get_iter (GtkTreeModel *tree_model,
+			  GtkTreeIter  *iter,
+			  GtkTreePath  *path)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint i;
+
+  g_return_val_if_fail (gtk_tree_path_get_depth (path) > 0, FALSE);
+
+  i = gtk_tree_path_get_indices (path)[0];
+
+  if (i < 0 || i >= priv->n_rows)
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  iter->stamp = priv->stamp;
+  iter->user_data = GINT_TO_POINTER (i);
+
+  return TRUE;
+}
+
+static GtkTreePath *
+gtk_array_store_get_path (GtkTreeModel *tree_model,
+			  GtkTreeIter  *iter)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+
+  g_return_val_if_fail (iter->stamp == array_store->priv->stamp, NULL);
+
+  return gtk_tree_path_new_from_indices (ITER_ROW (iter), -1);
+}
+
+static void
+gtk_array_store_get_value (GtkTreeModel *tree_model,
+			   GtkTreeIter  *iter,
+			   gint          column,
+			   GValue       *value)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  g_return_if_fail (column < priv->n_columns);
+  g_return_if_fail (iter_is_valid (iter, array_store));
+
+  column_get_row (&priv->columns[column], ITER_ROW (iter), value);
+}
+
+static gboolean
+gtk_array_store_iter_next (GtkTreeModel *tree_model,
+			   GtkTreeIter  *iter)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint row;
+
+  g_return_val_if_fail (priv->stamp == iter->stamp, FALSE);
+
+  row = ITER_ROW (iter) + 1;
+  if (row >= priv->n_rows)
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  iter->user_data = GINT_TO_POINTER (row);
+
+  return TRUE;
+}
+
+static gboolean
+gtk_array_store_iter_previous (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint row;
+
+  g_return_val_if_fail (priv->stamp == iter->stamp, FALSE);
+
+  row = ITER_ROW (iter) - 1;
+  if (row < 0)
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  iter->user_data = GINT_TO_POINTER (row);
+
+  return TRUE;
+}
+
+static gboolean
+gtk_array_store_iter_children (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter,
+			       GtkTreeIter  *parent)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  /* this is a list, nodes have no children */
+  if (parent || priv->n_rows == 0)
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  iter->stamp = priv->stamp;
+  iter->user_data = GINT_TO_POINTER (0);
+
+  return TRUE;
+}
+
+static gboolean
+gtk_array_store_iter_has_child (GtkTreeModel *tree_model,
+				GtkTreeIter  *iter)
+{
+  return FALSE;
+}
+
+static gint
+gtk_array_store_iter_n_children (GtkTreeModel *tree_model,
+				 GtkTreeIter  *iter)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  if (iter == NULL)
+    return priv->n_rows;
+
+  g_return_val_if_fail (priv->stamp == iter->stamp, -1);
+
+  return 0;
+}
+
+static gboolean
+gtk_array_store_iter_nth_child (GtkTreeModel *tree_model,
+				GtkTreeIter  *iter,
+				GtkTreeIter  *parent,
+				gint          n)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (tree_model);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  if (parent || n < 0 || n >= priv->n_rows)
+    {
+      iter->stamp = 0;
+      return FALSE;
+    }
+
+  iter->stamp = priv->stamp;
+  iter->user_data = GINT_TO_POINTER (n);
+
+  return TRUE;
+}
+
+static gboolean
+gtk_array_store_iter_parent (GtkTreeModel *tree_model,
+			     GtkTreeIter  *iter,
+			     GtkTreeIter  *child)
+{
+  iter->stamp = 0;
+  return FALSE;
+}
+
+/* Sorting */
+
+static void
+sort_data_init (SortData      *sort_data,
+                GtkArrayStore *array_store)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  sort_data->array_store = array_store;
+  sort_data->column = NULL;
+  sort_data->collate_keys = NULL;
+  sort_data->descending = priv->order == GTK_SORT_DESCENDING;
+
+  if (priv->sort_column_id != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+    {
+      GtkTreeDataSortHeader *header;
+
+      header = _gtk_tree_data_list_get_header (priv->sort_list,
+					       priv->sort_column_id);
+      g_assert (header != NULL && header->func != NULL);
+
+      sort_data->func = header->func;
+      sort_data->data = header->data;
+    }
+  else
+    {
+      g_assert (priv->default_sort_func != NULL);
+
+      sort_data->func = priv->default_sort_func;
+      sort_data->data = priv->default_sort_data;
+    }
+
+  /* The default sort functions of the columns only compare the
+   * values, we can do that on the arrays directly */
+  if (sort_data->func == _gtk_tree_data_list_compare_func)
+    {
+      GtkArrayStoreColumn *column;
+
+      column = &priv->columns[GPOINTER_TO_INT (sort_data->data)];
+      switch (column->fundamental)
+        {
+        case G_TYPE_STRING:
+          sort_data->collate_keys = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+          /* fall through */
+        case G_TYPE_BOOLEAN:
+        case G_TYPE_CHAR:
+        case G_TYPE_UCHAR:
+        case G_TYPE_INT:
+        case G_TYPE_UINT:
+        case G_TYPE_LONG:
+        case G_TYPE_ULONG:
+        case G_TYPE_INT64:
+        case G_TYPE_UINT64:
+        case G_TYPE_ENUM:
+        case G_TYPE_FLAGS:
+        case G_TYPE_FLOAT:
+        case G_TYPE_DOUBLE:
+          sort_data->column = column;
+          break;
+        default:
+          /* let _gtk_tree_data_list_compare_func() complain */
+          break;
+        }
+    }
+}
+
+static void
+sort_data_clear (SortData *sort_data)
+{
+  if (sort_data->collate_keys)
+    g_hash_table_destroy (sort_data->collate_keys);
+}
+
+static const gchar *
+sort_data_get_collate_key (SortData    *sort_data,
+                           const gchar *str)
+{
+  gchar *key;
+
+  if (str == NULL)
+    str = "";
+
+  /* Strings are interned, so the pointer identifies the string */
+  key = g_hash_table_lookup (sort_data->collate_keys, str);
+  if (key == NULL)
+    {
+      key = g_utf8_collate_key (str, -1);
+      g_hash_table_insert (sort_data->collate_keys, (gpointer) str, key);
+    }
+
+  return key;
+}
+
+#define COMPARE_ELEMENTS(type) G_STMT_START {                   \
+  type value_a = *(type *) column_element (column, a);          \
+  type value_b = *(type *) column_element (column, b);          \
+  retval = value_a < value_b ? -1 : (value_a == value_b ? 0 : 1); \
+} G_STMT_END
+
+static gint
+gtk_array_store_compare_rows (SortData *sort_data,
+                              gint      a,
+                              gint      b)
+{
+  GtkArrayStoreColumn *column = sort_data->column;
+  gint retval;
+
+  if (column == NULL)
+    {
+      GtkTreeIter iter_a;
+      GtkTreeIter iter_b;
+
+      iter_a.stamp = sort_data->array_store->priv->stamp;
+      iter_a.user_data = GINT_TO_POINTER (a);
+      iter_b.stamp = sort_data->array_store->priv->stamp;
+      iter_b.user_data = GINT_TO_POINTER (b);
+
+      retval = (* sort_data->func) (GTK_TREE_MODEL (sort_data->array_store),
+                                    &iter_a, &iter_b, sort_data->data);
+    }
+  else
+    {
+      switch (column->fundamental)
+        {
+        case G_TYPE_BOOLEAN:
+          COMPARE_ELEMENTS (gboolean);
+          break;
+        case G_TYPE_CHAR:
+          COMPARE_ELEMENTS (gint8);
+          break;
+        case G_TYPE_UCHAR:
+          COMPARE_ELEMENTS (guint8);
+          break;
+        case G_TYPE_INT:
+        case G_TYPE_ENUM:
+          COMPARE_ELEMENTS (gint);
+          break;
+        case G_TYPE_UINT:
+        case G_TYPE_FLAGS:
+          COMPARE_ELEMENTS (guint);
+          break;
+        case G_TYPE_LONG:
+          COMPARE_ELEMENTS (glong);
+          break;
+        case G_TYPE_ULONG:
+          COMPARE_ELEMENTS (gulong);
+          break;
+        case G_TYPE_INT64:
+          COMPARE_ELEMENTS (gint64);
+          break;
+        case G_TYPE_UINT64:
+          COMPARE_ELEMENTS (guint64);
+          break;
+        case G_TYPE_FLOAT:
+          COMPARE_ELEMENTS (gfloat);
+          break;
+        case G_TYPE_DOUBLE:
+          COMPARE_ELEMENTS (gdouble);
+          break;
+        case G_TYPE_STRING:
+          retval = strcmp (sort_data_get_collate_key (sort_data, *(const gchar **) column_element (column, a)),
+                           sort_data_get_collate_key (sort_data, *(const gchar **) column_element (column, b)));
+          break;
+        default:
+          g_assert_not_reached ();
+          retval = 0;
+          break;
+        }
+    }
+
+  if (sort_data->descending)
+    {
+      if (retval > 0)
+        retval = -1;
+      else if (retval < 0)
+        retval = 1;
+    }
+
+  return retval;
+}
+
+#undef COMPARE_ELEMENTS
+
+static gint
+gtk_array_store_compare_func (gconstpointer a,
+                              gconstpointer b,
+                              gpointer      user_data)
+{
+  return gtk_array_store_compare_rows (user_data, *(const gint *) a, *(const gint *) b);
+}
+
+/* Moves the rows so that the row at position @new_order[i] ends up
+ * at position i, and tells the world */
+static void
+gtk_array_store_reorder_rows (GtkArrayStore *array_store,
+                              gint          *new_order)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  GtkTreePath *path;
+  guint8 *buffer;
+  gint i, j;
+
+  buffer = g_malloc ((gsize) priv->n_rows * sizeof (gint64));
+
+  for (i = 0; i < priv->n_columns; i++)
+    {
+      GtkArrayStoreColumn *column = &priv->columns[i];
+      guint size = column->element_size;
+
+      for (j = 0; j < priv->n_rows; j++)
+        memcpy (buffer + (gsize) j * size, column_element (column, new_order[j]), size);
+
+      memcpy (column_element (column, 0), buffer, (gsize) priv->n_rows * size);
+    }
+
+  g_free (buffer);
+
+  gtk_array_store_increment_stamp (array_store);
+
+  path = gtk_tree_path_new ();
+  gtk_tree_model_rows_reordered (GTK_TREE_MODEL (array_store),
+				 path, NULL, new_order);
+  gtk_tree_path_free (path);
+}
+
+static void
+gtk_array_store_sort (GtkArrayStore *array_store)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  SortData sort_data;
+  gint *new_order;
+  gint i;
+
+  if (!GTK_ARRAY_STORE_IS_SORTED (array_store) ||
+      priv->n_rows <= 1)
+    return;
+
+  /* Sort the positions of the rows, and only move the rows
+   * themselves once the new order is known */
+  new_order = g_new (gint, priv->n_rows);
+  for (i = 0; i < priv->n_rows; i++)
+    new_order[i] = i;
+
+  sort_data_init (&sort_data, array_store);
+  g_qsort_with_data (new_order, priv->n_rows, sizeof (gint),
+                     gtk_array_store_compare_func, &sort_data);
+  sort_data_clear (&sort_data);
+
+  gtk_array_store_reorder_rows (array_store, new_order);
+
+  g_free (new_order);
+}
+
+static void
+gtk_array_store_sort_iter_changed (GtkArrayStore *array_store,
+				   GtkTreeIter   *iter)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  SortData sort_data;
+  gint row = ITER_ROW (iter);
+  gint *new_order;
+  gint low, high, new_row;
+  gint i, j;
+
+  sort_data_init (&sort_data, array_store);
+
+  if ((row == 0 ||
+       gtk_array_store_compare_rows (&sort_data, row - 1, row) <= 0) &&
+      (row == priv->n_rows - 1 ||
+       gtk_array_store_compare_rows (&sort_data, row, row + 1) <= 0))
+    {
+      sort_data_clear (&sort_data);
+      return;
+    }
+
+  /* The other rows are still sorted, find the row’s new
+   * position among them */
+  low = 0;
+  high = priv->n_rows - 1;
+  while (low < high)
+    {
+      gint mid = (low + high) / 2;
+      gint other = mid < row ? mid : mid + 1;
+
+      if (gtk_array_store_compare_rows (&sort_data, other, row) <= 0)
+        low = mid + 1;
+      else
+        high = mid;
+    }
+  new_row = low;
+
+  sort_data_clear (&sort_data);
+
+  new_order = g_new (gint, priv->n_rows);
+  for (i = 0, j = 0; i < priv->n_rows; i++)
+    {
+      if (i == new_row)
+        new_order[i] = row;
+      else
+        {
+          if (j == row)
+            j++;
+          new_order[i] = j++;
+        }
+    }
+
+  gtk_array_store_reorder_rows (array_store, new_order);
+
+  g_free (new_order);
+
+  iter->stamp = priv->stamp;
+  iter->user_data = GINT_TO_POINTER (new_row);
+}
+
+/* Whether changing @column can change the order of a sorted store */
+static gboolean
+gtk_array_store_column_affects_sort (GtkArrayStore *array_store,
+                                     gint           column)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  GtkTreeDataSortHeader *header;
+
+  if (!GTK_ARRAY_STORE_IS_SORTED (array_store))
+    return FALSE;
+
+  if (priv->sort_column_id == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+    return TRUE;
+
+  header = _gtk_tree_data_list_get_header (priv->sort_list,
+                                           priv->sort_column_id);
+  if (header->func != _gtk_tree_data_list_compare_func)
+    return TRUE;
+
+  return GPOINTER_TO_INT (header->data) == column;
+}
+
+static gboolean
+gtk_array_store_get_sort_column_id (GtkTreeSortable  *sortable,
+				    gint             *sort_column_id,
+				    GtkSortType      *order)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (sortable);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  if (sort_column_id)
+    * sort_column_id = priv->sort_column_id;
+  if (order)
+    * order = priv->order;
+
+  if (priv->sort_column_id == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID ||
+      priv->sort_column_id == GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID)
+    return FALSE;
+
+  return TRUE;
+}
+
+static void
+gtk_array_store_set_sort_column_id (GtkTreeSortable  *sortable,
+				    gint              sort_column_id,
+				    GtkSortType       order)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (sortable);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  if ((priv->sort_column_id == sort_column_id) &&
+      (priv->order == order))
+    return;
+
+  if (sort_column_id != GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID)
+    {
+      if (sort_column_id != GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+	{
+	  GtkTreeDataSortHeader *header = NULL;
+
+	  header = _gtk_tree_data_list_get_header (priv->sort_list,
+						   sort_column_id);
+
+	  /* We want to make sure that we have a function */
+	  g_return_if_fail (header != NULL);
+	  g_return_if_fail (header->func != NULL);
+	}
+      else
+	{
+	  g_return_if_fail (priv->default_sort_func != NULL);
+	}
+    }
+
+  priv->sort_column_id = sort_column_id;
+  priv->order = order;
+
+  gtk_tree_sortable_sort_column_changed (sortable);
+
+  gtk_array_store_sort (array_store);
+}
+
+static void
+gtk_array_store_set_sort_func (GtkTreeSortable        *sortable,
+			       gint                    sort_column_id,
+			       GtkTreeIterCompareFunc  func,
+			       gpointer                data,
+			       GDestroyNotify          destroy)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (sortable);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  priv->sort_list = _gtk_tree_data_list_set_header (priv->sort_list,
+						    sort_column_id,
+						    func, data, destroy);
+
+  if (priv->sort_column_id == sort_column_id)
+    gtk_array_store_sort (array_store);
+}
+
+static void
+gtk_array_store_set_default_sort_func (GtkTreeSortable        *sortable,
+				       GtkTreeIterCompareFunc  func,
+				       gpointer                data,
+				       GDestroyNotify          destroy)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (sortable);
+  GtkArrayStorePrivate *priv = array_store->priv;
+
+  if (priv->default_sort_destroy)
+    {
+      GDestroyNotify d = priv->default_sort_destroy;
+
+      priv->default_sort_destroy = NULL;
+      d (priv->default_sort_data);
+    }
+
+  priv->default_sort_func = func;
+  priv->default_sort_data = data;
+  priv->default_sort_destroy = destroy;
+
+  if (priv->sort_column_id == GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID)
+    gtk_array_store_sort (array_store);
+}
+
+static gboolean
+gtk_array_store_has_default_sort_func (GtkTreeSortable *sortable)
+{
+  GtkArrayStore *array_store = GTK_ARRAY_STORE (sortable);
+
+  return (array_store->priv->default_sort_func != NULL);
+}
+
+/* Changing rows */
+
+static gboolean
+gtk_array_store_real_set_value (GtkArrayStore *array_store,
+				gint           row,
+				gint           column,
+				GValue        *value)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  GtkArrayStoreColumn *store_column = &priv->columns[column];
+  GValue real_value = G_VALUE_INIT;
+  gboolean converted = FALSE;
+
+  if (! g_type_is_a (G_VALUE_TYPE (value), store_column->type))
+    {
+      if (! (g_value_type_transformable (G_VALUE_TYPE (value), store_column->type)))
+	{
+	  g_warning ("%s: Unable to convert from %s to %s\n",
+		     G_STRLOC,
+		     g_type_name (G_VALUE_TYPE (value)),
+		     g_type_name (store_column->type));
+	  return FALSE;
+	}
+
+      g_value_init (&real_value, store_column->type);
+      if (!g_value_transform (value, &real_value))
+	{
+	  g_warning ("%s: Unable to make conversion from %s to %s\n",
+		     G_STRLOC,
+		     g_type_name (G_VALUE_TYPE (value)),
+		     g_type_name (store_column->type));
+	  g_value_unset (&real_value);
+	  return FALSE;
+	}
+      converted = TRUE;
+    }
+
+  column_clear_rows (store_column, row, 1);
+  column_set_row (array_store, store_column, row,
+                  converted ? &real_value : value);
+
+  if (converted)
+    g_value_unset (&real_value);
+
+  return TRUE;
+}
+
+static void
+gtk_array_store_row_changed (GtkArrayStore *array_store,
+                             GtkTreeIter   *iter,
+                             gboolean       maybe_need_sort)
+{
+  GtkTreePath *path;
+
+  path = gtk_array_store_get_path (GTK_TREE_MODEL (array_store), iter);
+  gtk_tree_model_row_changed (GTK_TREE_MODEL (array_store), path, iter);
+  gtk_tree_path_free (path);
+
+  if (maybe_need_sort)
+    gtk_array_store_sort_iter_changed (array_store, iter);
+}
+
+/**
+ * gtk_array_store_set_value:
+ * @array_store: A #GtkArrayStore
+ * @iter: A valid #GtkTreeIter for the row being modified
+ * @column: column number to modify
+ * @value: new value for the cell
+ *
+ * Sets the data in the cell specified by @iter and @column.
+ * The type of @value must be convertible to the type of the
+ * column.
+ *
+ * If the store is sorted and the row moves because of the new
+ * value, @iter is updated to point to the row at its new position.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_set_value (GtkArrayStore *array_store,
+			   GtkTreeIter   *iter,
+			   gint           column,
+			   GValue        *value)
+{
+  GtkArrayStorePrivate *priv;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+  g_return_if_fail (iter_is_valid (iter, array_store));
+  g_return_if_fail (G_IS_VALUE (value));
+  priv = array_store->priv;
+  g_return_if_fail (column >= 0 && column < priv->n_columns);
+
+  if (gtk_array_store_real_set_value (array_store, ITER_ROW (iter), column, value))
+    gtk_array_store_row_changed (array_store, iter,
+                                 gtk_array_store_column_affects_sort (array_store, column));
+}
+
+/**
+ * gtk_array_store_set_valist:
+ * @array_store: A #GtkArrayStore
+ * @iter: A valid #GtkTreeIter for the row being modified
+ * @var_args: va_list of column/value pairs
+ *
+ * See gtk_array_store_set(); this version takes a va_list for use by
+ * language bindings.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_set_valist (GtkArrayStore *array_store,
+			    GtkTreeIter   *iter,
+			    va_list        var_args)
+{
+  GtkArrayStorePrivate *priv;
+  gboolean emit_signal = FALSE;
+  gboolean maybe_need_sort = FALSE;
+  gint column;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+  g_return_if_fail (iter_is_valid (iter, array_store));
+
+  priv = array_store->priv;
+
+  column = va_arg (var_args, gint);
+
+  while (column != -1)
+    {
+      GValue value = G_VALUE_INIT;
+      gchar *error = NULL;
+
+      if (column < 0 || column >= priv->n_columns)
+	{
+	  g_warning ("%s: Invalid column number %d added to iter (remember to end your list of columns with a -1)", G_STRLOC, column);
+	  break;
+	}
+
+      G_VALUE_COLLECT_INIT (&value, priv->columns[column].type,
+                            var_args, 0, &error);
+      if (error)
+	{
+	  g_warning ("%s: %s", G_STRLOC, error);
+	  g_free (error);
+
+	  /* we purposely leak the value here, it might not be
+	   * in a sane state if an error condition occoured
+	   */
+	  break;
+	}
+
+      if (gtk_array_store_real_set_value (array_store, ITER_ROW (iter), column, &value))
+        {
+          emit_signal = TRUE;
+          maybe_need_sort |= gtk_array_store_column_affects_sort (array_store, column);
+        }
+
+      g_value_unset (&value);
+
+      column = va_arg (var_args, gint);
+    }
+
+  if (emit_signal)
+    gtk_array_store_row_changed (array_store, iter, maybe_need_sort);
+}
+
+/**
+ * gtk_array_store_set:
+ * @array_store: a #GtkArrayStore
+ * @iter: row iterator
+ * @...: pairs of column number and value, terminated with -1
+ *
+ * Sets the value of one or more cells in the row referenced by @iter.
+ * The variable argument list should contain integer column numbers,
+ * each column number followed by the value to be set.
+ * The list is terminated by a -1.  For example, to set column 0 with type
+ * %G_TYPE_STRING to “Foo”, you would write
+ * `gtk_array_store_set (store, iter, 0, "Foo", -1)`.
+ *
+ * The value will be referenced by the store if it is a %G_TYPE_OBJECT,
+ * and it will be copied if it is a %G_TYPE_STRING or %G_TYPE_BOXED.
+ *
+ * To change many rows, gtk_array_store_set_rows() is a lot faster.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_set (GtkArrayStore *array_store,
+		     GtkTreeIter   *iter,
+		     ...)
+{
+  va_list var_args;
+
+  va_start (var_args, iter);
+  gtk_array_store_set_valist (array_store, iter, var_args);
+  va_end (var_args);
+}
+
+/**
+ * gtk_array_store_remove:
+ * @array_store: A #GtkArrayStore
+ * @iter: A valid #GtkTreeIter
+ *
+ * Removes the given row from the array store.  After being removed,
+ * @iter is set to be the next valid row, or invalidated if it pointed
+ * to the last row in @array_store.
+ *
+ * Returns: %TRUE if @iter is valid, %FALSE if not.
+ *
+ * Since: 3.16
+ **/
+gboolean
+gtk_array_store_remove (GtkArrayStore *array_store,
+			GtkTreeIter   *iter)
+{
+  GtkArrayStorePrivate *priv;
+  GtkTreePath *path;
+  gint row, i;
+
+  g_return_val_if_fail (GTK_IS_ARRAY_STORE (array_store), FALSE);
+  g_return_val_if_fail (iter_is_valid (iter, array_store), FALSE);
+
+  priv = array_store->priv;
+  row = ITER_ROW (iter);
+
+  for (i = 0; i < priv->n_columns; i++)
+    {
+      column_clear_rows (&priv->columns[i], row, 1);
+      g_array_remove_index (priv->columns[i].data, row);
+    }
+  priv->n_rows--;
+
+  gtk_array_store_increment_stamp (array_store);
+
+  path = gtk_tree_path_new_from_indices (row, -1);
+  gtk_tree_model_row_deleted (GTK_TREE_MODEL (array_store), path);
+  gtk_tree_path_free (path);
+
+  if (row < priv->n_rows)
+    {
+      iter->stamp = priv->stamp;
+      return TRUE;
+    }
+
+  iter->stamp = 0;
+  return FALSE;
+}
+
+/**
+ * gtk_array_store_insert:
+ * @array_store: A #GtkArrayStore
+ * @iter: (out): An unset #GtkTreeIter to set to the new row
+ * @position: position to insert the new row, or -1 for last
+ *
+ * Creates a new row at @position.  @iter will be changed to point to this
+ * new row.  If @position is -1 or is larger than the number of rows on the
+ * list, then the new row will be appended to the list.  The row will be
+ * empty after this function is called.  To fill in values, you need to
+ * call gtk_array_store_set() or gtk_array_store_set_value().
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_insert (GtkArrayStore *array_store,
+			GtkTreeIter   *iter,
+			gint           position)
+{
+  GtkArrayStorePrivate *priv;
+  GtkTreePath *path;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+  g_return_if_fail (iter != NULL);
+
+  priv = array_store->priv;
+
+  if (position < 0 || position > priv->n_rows)
+    position = priv->n_rows;
+
+  gtk_array_store_insert_rows (array_store, position, 1);
+  priv->n_rows++;
+
+  gtk_array_store_increment_stamp (array_store);
+
+  iter->stamp = priv->stamp;
+  iter->user_data = GINT_TO_POINTER (position);
+
+  path = gtk_tree_path_new_from_indices (position, -1);
+  gtk_tree_model_row_inserted (GTK_TREE_MODEL (array_store), path, iter);
+  gtk_tree_path_free (path);
+}
+
+/**
+ * gtk_array_store_append:
+ * @array_store: A #GtkArrayStore
+ * @iter: (out): An unset #GtkTreeIter to set to the appended row
+ *
+ * Appends a new row to @array_store.  @iter will be changed to point to
+ * this new row.  The row will be empty after this function is called.
+ * To fill in values, you need to call gtk_array_store_set() or
+ * gtk_array_store_set_value().
+ *
+ * To add many rows, gtk_array_store_append_rows() is a lot faster.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_append (GtkArrayStore *array_store,
+			GtkTreeIter   *iter)
+{
+  gtk_array_store_insert (array_store, iter, -1);
+}
+
+/**
+ * gtk_array_store_clear:
+ * @array_store: a #GtkArrayStore.
+ *
+ * Removes all rows from the array store, and releases the memory
+ * of all strings it stored.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_clear (GtkArrayStore *array_store)
+{
+  GtkArrayStorePrivate *priv;
+  GtkTreePath *path;
+  gint i;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+
+  priv = array_store->priv;
+
+  if (priv->n_rows > 0 &&
+      !gtk_tree_model_needs_row_deleted (GTK_TREE_MODEL (array_store)))
+    {
+      gint n_rows = priv->n_rows;
+
+      priv->n_rows = 0;
+      gtk_array_store_increment_stamp (array_store);
+      path = gtk_tree_path_new_first ();
+      gtk_tree_model_rows_deleted (GTK_TREE_MODEL (array_store), path, n_rows);
+      gtk_tree_path_free (path);
+    }
+  else
+    {
+      /* Remove the rows from the end, so nothing needs to be moved */
+      path = gtk_tree_path_new_from_indices (priv->n_rows, -1);
+      while (priv->n_rows > 0)
+        {
+          priv->n_rows--;
+          gtk_array_store_increment_stamp (array_store);
+          gtk_tree_path_prev (path);
+          gtk_tree_model_row_deleted (GTK_TREE_MODEL (array_store), path);
+        }
+      gtk_tree_path_free (path);
+    }
+
+  for (i = 0; i < priv->n_columns; i++)
+    {
+      column_clear_rows (&priv->columns[i], 0, priv->columns[i].data->len);
+      g_array_set_size (priv->columns[i].data, 0);
+    }
+
+  g_string_chunk_clear (priv->strings);
+
+  gtk_array_store_increment_stamp (array_store);
+}
+
+/**
+ * gtk_array_store_iter_is_valid:
+ * @array_store: A #GtkArrayStore.
+ * @iter: A #GtkTreeIter.
+ *
+ * Checks if the given iter is a valid iter for this #GtkArrayStore.
+ * Unlike gtk_list_store_iter_is_valid(), this is cheap.
+ *
+ * Returns: %TRUE if the iter is valid, %FALSE if the iter is invalid.
+ *
+ * Since: 3.16
+ **/
+gboolean
+gtk_array_store_iter_is_valid (GtkArrayStore *array_store,
+			       GtkTreeIter   *iter)
+{
+  g_return_val_if_fail (GTK_IS_ARRAY_STORE (array_store), FALSE);
+  g_return_val_if_fail (iter != NULL, FALSE);
+
+  return iter_is_valid (iter, array_store);
+}
+
+/* Bulk changes */
+
+static gboolean
+collect_column_data (GtkArrayStore *array_store,
+                     va_list        var_args,
+                     GArray        *columns,
+                     GArray        *data)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint column;
+
+  column = va_arg (var_args, gint);
+
+  while (column != -1)
+    {
+      gconstpointer column_data;
+
+      if (column < 0 || column >= priv->n_columns)
+	{
+	  g_warning ("%s: Invalid column number %d (remember to end your list of columns with a -1)", G_STRLOC, column);
+	  return FALSE;
+	}
+
+      column_data = va_arg (var_args, gconstpointer);
+
+      g_array_append_val (columns, column);
+      g_array_append_val (data, column_data);
+
+      column = va_arg (var_args, gint);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+check_column_data (GtkArrayStore *array_store,
+                   gint          *columns,
+                   gconstpointer *data,
+                   gint           n_columns)
+{
+  GtkArrayStorePrivate *priv = array_store->priv;
+  gint i;
+
+  for (i = 0; i < n_columns; i++)
+    {
+      if (columns[i] < 0 || columns[i] >= priv->n_columns)
+	{
+	  g_warning ("%s: Invalid column number %d", G_STRLOC, columns[i]);
+	  return FALSE;
+	}
+      if (data[i] == NULL)
+	{
+	  g_warning ("%s: No data given for column %d", G_STRLOC, columns[i]);
+	  return FALSE;
+	}
+    }
+
+  return TRUE;
+}
+
+/**
+ * gtk_array_store_append_rowsv:
+ * @array_store: A #GtkArrayStore
+ * @n_rows: the number of rows to append
+ * @columns: (array length=n_columns): an array of column numbers
+ * @data: (array length=n_columns): an array of pointers to the values
+ *     for each column in @columns
+ * @n_columns: the length of the @columns and @data arrays
+ *
+ * A variant of gtk_array_store_append_rows() which takes the columns
+ * and their values as two arrays, instead of varargs.  This function
+ * is mainly intended for language bindings.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_append_rowsv (GtkArrayStore *array_store,
+                              gint           n_rows,
+                              gint          *columns,
+                              gconstpointer *data,
+                              gint           n_columns)
+{
+  GtkArrayStorePrivate *priv;
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gint first_row, i;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+  g_return_if_fail (n_rows >= 0);
+  g_return_if_fail (n_columns == 0 || (columns != NULL && data != NULL));
+
+  priv = array_store->priv;
+
+  if (n_rows == 0 || !check_column_data (array_store, columns, data, n_columns))
+    return;
+
+  first_row = priv->n_rows;
+  gtk_array_store_insert_rows (array_store, first_row, n_rows);
+
+  for (i = 0; i < n_columns; i++)
+    {
+      GtkArrayStoreColumn *column = &priv->columns[columns[i]];
+
+      /* A column may be given twice */
+      column_clear_rows (column, first_row, n_rows);
+      column_copy_rows (array_store, column, first_row, data[i], n_rows);
+    }
+
+  gtk_array_store_increment_stamp (array_store);
+
+  iter.stamp = priv->stamp;
+  path = gtk_tree_path_new_from_indices (first_row, -1);
+  if (!gtk_tree_model_needs_row_inserted (GTK_TREE_MODEL (array_store)))
+    {
+      iter.user_data = GINT_TO_POINTER (first_row);
+      priv->n_rows += n_rows;
+      gtk_tree_model_rows_inserted (GTK_TREE_MODEL (array_store), path, &iter, n_rows);
+    }
+  else
+    {
+      gint n_pending = n_rows;
+
+      /* The rows are only made visible one by one, so that
+       * every row-inserted handler sees a consistent model.
+       *
+       * A handler may change the store while we are announcing.
+       * The rows that are not visible yet always stay at the end
+       * of the column arrays (inserting or removing visible rows
+       * moves them, clearing the store drops them), so the
+       * position and the number of rows left are derived again
+       * after every emission.
+       */
+      while (n_pending > 0)
+        {
+          gint row = priv->n_rows;
+
+          iter.stamp = priv->stamp;
+          iter.user_data = GINT_TO_POINTER (row);
+          priv->n_rows++;
+          n_pending--;
+
+          gtk_tree_path_free (path);
+          path = gtk_tree_path_new_from_indices (row, -1);
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (array_store), path, &iter);
+
+          n_pending = MIN (n_pending,
+                           (gint) priv->columns[0].data->len - priv->n_rows);
+        }
+    }
+  gtk_tree_path_free (path);
+
+  gtk_array_store_sort (array_store);
+}
+
+/**
+ * gtk_array_store_append_rows:
+ * @array_store: A #GtkArrayStore
+ * @n_rows: the number of rows to append
+ * @...: pairs of column number and a pointer to @n_rows values, terminated
+ *     with -1
+ *
+ * Appends @n_rows rows to @array_store, taking their values from
+ * one C array per column.  For each column number, pass a pointer to
+ * @n_rows values of the type gtk_tree_model_get() would return for
+ * the column: #gint values for a %G_TYPE_INT column, #gdouble values
+ * for a %G_TYPE_DOUBLE column, string pointers for a %G_TYPE_STRING
+ * column and so on.  Strings and boxed values are copied, and objects
+ * are referenced.  Columns that are not given are left empty.
+ *
+ * This is much faster than adding the rows one at a time.  If the
+ * store is sorted, the rows are sorted into place once, after all of
+ * them have been added.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_append_rows (GtkArrayStore *array_store,
+                             gint           n_rows,
+                             ...)
+{
+  GArray *columns, *data;
+  va_list var_args;
+  gboolean valid;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+
+  columns = g_array_new (FALSE, FALSE, sizeof (gint));
+  data = g_array_new (FALSE, FALSE, sizeof (gconstpointer));
+
+  va_start (var_args, n_rows);
+  valid = collect_column_data (array_store, var_args, columns, data);
+  va_end (var_args);
+
+  if (valid)
+    gtk_array_store_append_rowsv (array_store, n_rows,
+                                  (gint *) columns->data,
+                                  (gconstpointer *) data->data,
+                                  columns->len);
+
+  g_array_free (columns, TRUE);
+  g_array_free (data, TRUE);
+}
+
+/**
+ * gtk_array_store_set_rowsv:
+ * @array_store: A #GtkArrayStore
+ * @first_row: the position of the first row to change
+ * @n_rows: the number of rows to change
+ * @columns: (array length=n_columns): an array of column numbers
+ * @data: (array length=n_columns): an array of pointers to the values
+ *     for each column in @columns
+ * @n_columns: the length of the @columns and @data arrays
+ *
+ * A variant of gtk_array_store_set_rows() which takes the columns
+ * and their values as two arrays, instead of varargs.  This function
+ * is mainly intended for language bindings.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_set_rowsv (GtkArrayStore *array_store,
+                           gint           first_row,
+                           gint           n_rows,
+                           gint          *columns,
+                           gconstpointer *data,
+                           gint           n_columns)
+{
+  GtkArrayStorePrivate *priv;
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gboolean need_sort = FALSE;
+  gint i;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+  g_return_if_fail (first_row >= 0 && n_rows >= 0);
+  g_return_if_fail (first_row + n_rows <= array_store->priv->n_rows);
+  g_return_if_fail (n_columns == 0 || (columns != NULL && data != NULL));
+
+  priv = array_store->priv;
+
+  if (n_rows == 0 || n_columns == 0 ||
+      !check_column_data (array_store, columns, data, n_columns))
+    return;
+
+  for (i = 0; i < n_columns; i++)
+    {
+      GtkArrayStoreColumn *column = &priv->columns[columns[i]];
+
+      column_clear_rows (column, first_row, n_rows);
+      column_copy_rows (array_store, column, first_row, data[i], n_rows);
+
+      need_sort |= gtk_array_store_column_affects_sort (array_store, columns[i]);
+    }
+
+  iter.stamp = priv->stamp;
+  path = gtk_tree_path_new_from_indices (first_row, -1);
+  for (i = first_row; i < first_row + n_rows; i++)
+    {
+      iter.user_data = GINT_TO_POINTER (i);
+      gtk_tree_model_row_changed (GTK_TREE_MODEL (array_store), path, &iter);
+      gtk_tree_path_next (path);
+    }
+  gtk_tree_path_free (path);
+
+  if (need_sort)
+    gtk_array_store_sort (array_store);
+}
+
+/**
+ * gtk_array_store_set_rows:
+ * @array_store: A #GtkArrayStore
+ * @first_row: the position of the first row to change
+ * @n_rows: the number of rows to change
+ * @...: pairs of column number and a pointer to @n_rows values, terminated
+ *     with -1
+ *
+ * Replaces the values of @n_rows rows starting at @first_row in the
+ * given columns.  The values are passed the same way as for
+ * gtk_array_store_append_rows().
+ *
+ * If the store is sorted, the rows are sorted into place once, after
+ * all of them have been changed.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_array_store_set_rows (GtkArrayStore *array_store,
+                          gint           first_row,
+                          gint           n_rows,
+                          ...)
+{
+  GArray *columns, *data;
+  va_list var_args;
+  gboolean valid;
+
+  g_return_if_fail (GTK_IS_ARRAY_STORE (array_store));
+
+  columns = g_array_new (FALSE, FALSE, sizeof (gint));
+  data = g_array_new (FALSE, FALSE, sizeof (gconstpointer));
+
+  va_start (var_args, n_rows);
+  valid = collect_column_data (array_store, var_args, columns, data);
+  va_end (var_args);
+
+  if (valid)
+    gtk_array_store_set_rowsv (array_store, first_row, n_rows,
+                               (gint *) columns->data,
+                               (gconstpointer *) data->data,
+                               columns->len);
+
+  g_array_free (columns, TRUE);
+  g_array_free (data, TRUE);
+}
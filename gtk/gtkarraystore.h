@@ -0,0 +1,128 @@
+/* gtkarraystore.h
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_ARRAY_STORE_H__
+#define __GTK_ARRAY_STORE_H__
+
+#if !defined (__GTK_H_INSIDE__) && !defined (GTK_COMPILATION)
+#error "Only <gtk/gtk.h> can be included directly."
+#endif
+
+#include <gdk/gdk.h>
+#include <gtk/gtktreemodel.h>
+#include <gtk/gtktreesortable.h>
+
+
+G_BEGIN_DECLS
+
+
+#define GTK_TYPE_ARRAY_STORE	       (gtk_array_store_get_type ())
+#define GTK_ARRAY_STORE(obj)	       (G_TYPE_CHECK_INSTANCE_CAST ((obj), GTK_TYPE_ARRAY_STORE, GtkArrayStore))
+#define GTK_ARRAY_STORE_CLASS(klass)   (G_TYPE_CHECK_CLASS_CAST ((klass), GTK_TYPE_ARRAY_STORE, GtkArrayStoreClass))
+#define GTK_IS_ARRAY_STORE(obj)	       (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GTK_TYPE_ARRAY_STORE))
+#define GTK_IS_ARRAY_STORE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GTK_TYPE_ARRAY_STORE))
+#define GTK_ARRAY_STORE_GET_CLASS(obj) (G_TYPE_INSTANCE_GET_CLASS ((obj), GTK_TYPE_ARRAY_STORE, GtkArrayStoreClass))
+
+typedef struct _GtkArrayStore              GtkArrayStore;
+typedef struct _GtkArrayStorePrivate       GtkArrayStorePrivate;
+typedef struct _GtkArrayStoreClass         GtkArrayStoreClass;
+
+struct _GtkArrayStore
+{
+  GObject parent;
+
+  /*< private >*/
+  GtkArrayStorePrivate *priv;
+};
+
+struct _GtkArrayStoreClass
+{
+  GObjectClass parent_class;
+
+  /* Padding for future expansion */
+  void (*_gtk_reserved1) (void);
+  void (*_gtk_reserved2) (void);
+  void (*_gtk_reserved3) (void);
+  void (*_gtk_reserved4) (void);
+};
+
+
+GDK_AVAILABLE_IN_ALL
+GType          gtk_array_store_get_type      (void) G_GNUC_CONST;
+GDK_AVAILABLE_IN_ALL
+GtkArrayStore *gtk_array_store_new           (gint           n_columns,
+                                              ...);
+GDK_AVAILABLE_IN_ALL
+GtkArrayStore *gtk_array_store_newv          (gint           n_columns,
+                                              GType         *types);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_set_value     (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter,
+                                              gint           column,
+                                              GValue        *value);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_set           (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter,
+                                              ...);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_set_valist    (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter,
+                                              va_list        var_args);
+GDK_AVAILABLE_IN_ALL
+gboolean       gtk_array_store_remove        (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_insert        (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter,
+                                              gint           position);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_append        (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_clear         (GtkArrayStore *array_store);
+GDK_AVAILABLE_IN_ALL
+gboolean       gtk_array_store_iter_is_valid (GtkArrayStore *array_store,
+                                              GtkTreeIter   *iter);
+
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_append_rows   (GtkArrayStore *array_store,
+                                              gint           n_rows,
+                                              ...);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_append_rowsv  (GtkArrayStore *array_store,
+                                              gint           n_rows,
+                                              gint          *columns,
+                                              gconstpointer *data,
+                                              gint           n_columns);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_set_rows      (GtkArrayStore *array_store,
+                                              gint           first_row,
+                                              gint           n_rows,
+                                              ...);
+GDK_AVAILABLE_IN_ALL
+void           gtk_array_store_set_rowsv     (GtkArrayStore *array_store,
+                                              gint           first_row,
+                                              gint           n_rows,
+                                              gint          *columns,
+                                              gconstpointer *data,
+                                              gint           n_columns);
+
+
+G_END_DECLS
+
+
+#endif /* __GTK_ARRAY_STORE_H__ */
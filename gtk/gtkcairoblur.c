@@ -25,6 +25,28 @@
 #include <math.h>
 #include <string.h>
 
+/* Surfaces with more pixels than this get split into bands
+ * that are blurred by a pool of worker threads. */
+#define BLUR_THREAD_THRESHOLD (256 * 256)
+
+/* Above this filter width the fixed point division below is no
+ * longer exact. */
+#define BLUR_MAX_D 4095
+
+/* Dividing by the filter width is the most expensive part of the
+ * blur; we replace it with a multiplication by the fixed point
+ * reciprocal of d. For the sums that can occur here (less than
+ * 256 * d) this gives exactly the same result as the division
+ * as long as d is at most BLUR_MAX_D.
+ */
+static inline guint64
+blur_reciprocal (int d)
+{
+  return ((G_GUINT64_CONSTANT (1) << 32) + d - 1) / d;
+}
+
+#define BLUR_DIVIDE(sum,d,reciprocal) ((guchar) ((((guint64) (sum) + (d) / 2) * (reciprocal)) >> 32))
+
 /* This applies a single box blur pass to a horizontal range of pixels;
  * since the box blur has the same weight for all pixels, we can
  * implement an efficient sliding window algorithm where we add
@@ -42,6 +64,7 @@ blur_xspan (guchar *row,
             int     d,
             int     shift)
 {
+  guint64 reciprocal;
   int offset;
   int sum = 0;
   int i;
@@ -51,14 +74,12 @@ blur_xspan (guchar *row,
   else
     offset = (d - shift) / 2;
 
+  reciprocal = blur_reciprocal (d);
+
   /* All the conditionals in here look slow, but the branches will
    * be well predicted and there are enough different possibilities
    * that trying to write this as a series of unconditional loops
-   * is hard and not an obvious win. The main slow down here seems
-   * to be the integer division per pixel; one possible optimization
-   * would be to accumulate into two 16-bit integer buffers and
-   * only divide down after all three passes. (SSE parallel implementation
-   * of the divide step is possible.)
+   * is hard and not an obvious win.
    */
   for (i = -d + offset; i < row_width + offset; i++)
     {
@@ -70,7 +91,7 @@ blur_xspan (guchar *row,
           if (i >= d)
             sum -= row[i - d];
 
-          tmp_buffer[i - offset] = (sum + d / 2) / d;
+          tmp_buffer[i - offset] = BLUR_DIVIDE (sum, d, reciprocal);
         }
     }
 
@@ -111,33 +132,197 @@ blur_rows (guchar *dst_buffer,
     }
 }
 
-/* Swaps width and height.
+/* The vertical version of blur_xspan(). Instead of transposing the
+ * buffer, this keeps one running sum per column and walks the rows
+ * from top to bottom, so that all memory accesses are sequential and
+ * the inner loops over the columns can be vectorized by the compiler.
+ * Only the columns from x0 to x1 are blurred.
  */
 static void
-flip_buffer (guchar *dst_buffer,
-             guchar *src_buffer,
-             int     width,
-             int     height)
+blur_yspan (guchar       *dst_buffer,
+            const guchar *src_buffer,
+            guint        *sums,
+            int           buffer_width,
+            int           buffer_height,
+            int           x0,
+            int           x1,
+            int           d,
+            int           shift)
 {
-  /* Working in blocks increases cache efficiency, compared to reading
-   * or writing an entire column at once
-   */
-#define BLOCK_SIZE 16
-
-  int i0, j0;
-
-  for (i0 = 0; i0 < width; i0 += BLOCK_SIZE)
-    for (j0 = 0; j0 < height; j0 += BLOCK_SIZE)
-      {
-        int max_j = MIN(j0 + BLOCK_SIZE, height);
-        int max_i = MIN(i0 + BLOCK_SIZE, width);
-        int i, j;
-
-        for (i = i0; i < max_i; i++)
-          for (j = j0; j < max_j; j++)
-            dst_buffer[i * height + j] = src_buffer[j * width + i];
-      }
-#undef BLOCK_SIZE
+  guint64 reciprocal;
+  int offset;
+  int i, x;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  reciprocal = blur_reciprocal (d);
+
+  memset (sums + x0, 0, (x1 - x0) * sizeof (guint));
+
+  for (i = -d + offset; i < buffer_height + offset; i++)
+    {
+      if (i >= 0 && i < buffer_height)
+        {
+          const guchar *row = src_buffer + i * buffer_width;
+
+          for (x = x0; x < x1; x++)
+            sums[x] += row[x];
+        }
+
+      if (i >= offset)
+        {
+          guchar *dst_row = dst_buffer + (i - offset) * buffer_width;
+
+          if (i >= d)
+            {
+              const guchar *row = src_buffer + (i - d) * buffer_width;
+
+              for (x = x0; x < x1; x++)
+                sums[x] -= row[x];
+            }
+
+          for (x = x0; x < x1; x++)
+            dst_row[x] = BLUR_DIVIDE (sums[x], d, reciprocal);
+        }
+    }
+}
+
+static void
+blur_columns (guchar *buffer,
+              guchar *tmp_buffer,
+              int     buffer_width,
+              int     buffer_height,
+              int     x0,
+              int     x1,
+              int     d)
+{
+  guint *sums;
+  int i;
+
+  sums = g_new (guint, buffer_width);
+
+  /* See blur_rows() for the choice of filter widths */
+  if (d % 2 == 1)
+    {
+      blur_yspan (tmp_buffer, buffer, sums, buffer_width, buffer_height, x0, x1, d, 0);
+      blur_yspan (buffer, tmp_buffer, sums, buffer_width, buffer_height, x0, x1, d, 0);
+      blur_yspan (tmp_buffer, buffer, sums, buffer_width, buffer_height, x0, x1, d, 0);
+    }
+  else
+    {
+      blur_yspan (tmp_buffer, buffer, sums, buffer_width, buffer_height, x0, x1, d, 1);
+      blur_yspan (buffer, tmp_buffer, sums, buffer_width, buffer_height, x0, x1, d, -1);
+      blur_yspan (tmp_buffer, buffer, sums, buffer_width, buffer_height, x0, x1, d + 1, 0);
+    }
+
+  for (i = 0; i < buffer_height; i++)
+    memcpy (buffer + i * buffer_width + x0,
+            tmp_buffer + i * buffer_width + x0,
+            x1 - x0);
+
+  g_free (sums);
+}
+
+typedef struct {
+  GMutex mutex;
+  GCond  cond;
+  guint  pending;
+} BlurBarrier;
+
+typedef struct {
+  BlurBarrier *barrier;
+  guchar      *buffer;
+  guchar      *tmp_buffer;
+  int          width;
+  int          height;
+  int          radius;
+  gboolean     vertical;
+  /* columns for the vertical pass, rows for the horizontal one */
+  int          start;
+  int          end;
+} BlurBand;
+
+static void
+blur_band (BlurBand *band)
+{
+  if (band->vertical)
+    blur_columns (band->buffer, band->tmp_buffer,
+                  band->width, band->height,
+                  band->start, band->end,
+                  band->radius);
+  else
+    blur_rows (band->buffer + band->start * band->width,
+               band->tmp_buffer + band->start * band->width,
+               band->width, band->end - band->start,
+               band->radius);
+}
+
+static void
+blur_band_thread_func (gpointer data,
+                       gpointer user_data)
+{
+  BlurBand *band = data;
+  BlurBarrier *barrier = band->barrier;
+
+  blur_band (band);
+
+  g_mutex_lock (&barrier->mutex);
+  barrier->pending--;
+  if (barrier->pending == 0)
+    g_cond_signal (&barrier->cond);
+  g_mutex_unlock (&barrier->mutex);
+}
+
+static GThreadPool *
+get_blur_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint n_threads = MIN (g_get_num_processors (), 4);
+
+      /* The calling thread blurs one of the bands itself */
+      if (n_threads > 1)
+        pool = g_thread_pool_new (blur_band_thread_func, NULL,
+                                  n_threads - 1, FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+static void
+blur_bands (BlurBand *bands,
+            guint     n_bands)
+{
+  BlurBarrier *barrier = bands[0].barrier;
+  GThreadPool *pool;
+  guint i;
+
+  pool = get_blur_thread_pool ();
+  if (pool == NULL)
+    {
+      for (i = 0; i < n_bands; i++)
+        blur_band (&bands[i]);
+      return;
+    }
+
+  barrier->pending = n_bands - 1;
+  for (i = 1; i < n_bands; i++)
+    g_thread_pool_push (pool, &bands[i], NULL);
+
+  blur_band (&bands[0]);
+
+  g_mutex_lock (&barrier->mutex);
+  while (barrier->pending > 0)
+    g_cond_wait (&barrier->cond, &barrier->mutex);
+  g_mutex_unlock (&barrier->mutex);
 }
 
 static void
@@ -146,23 +331,61 @@ _boxblur (guchar  *buffer,
           int      height,
           int      radius)
 {
-  guchar *flipped_buffer;
+  guchar *tmp_buffer;
+  guint n_bands, i;
 
-  flipped_buffer = g_malloc (width * height);
+  tmp_buffer = g_malloc (width * height);
 
-  /* Step 1: swap rows and columns */
-  flip_buffer (flipped_buffer, buffer, width, height);
+  if (width * height < BLUR_THREAD_THRESHOLD ||
+      get_blur_thread_pool () == NULL)
+    {
+      /* Step 1: blur columns */
+      blur_columns (buffer, tmp_buffer, width, height, 0, width, radius);
 
-  /* Step 2: blur rows (really columns) */
-  blur_rows (flipped_buffer, buffer, height, width, radius);
+      /* Step 2: blur rows */
+      blur_rows (buffer, tmp_buffer, width, height, radius);
+    }
+  else
+    {
+      BlurBarrier barrier;
+      BlurBand *bands;
+
+      n_bands = MIN (g_get_num_processors (), 4);
+      bands = g_newa (BlurBand, n_bands);
 
-  /* Step 3: swap rows and columns */
-  flip_buffer (buffer, flipped_buffer, height, width);
+      g_mutex_init (&barrier.mutex);
+      g_cond_init (&barrier.cond);
 
-  /* Step 4: blur rows */
-  blur_rows (buffer, flipped_buffer, width, height, radius);
+      /* Columns and rows are blurred independently of each other,
+       * so we can split the work into bands; the row pass has to
+       * wait for all columns to be done though. */
+      for (i = 0; i < n_bands; i++)
+        {
+          bands[i].barrier = &barrier;
+          bands[i].buffer = buffer;
+          bands[i].tmp_buffer = tmp_buffer;
+          bands[i].width = width;
+          bands[i].height = height;
+          bands[i].radius = radius;
+          bands[i].vertical = TRUE;
+          bands[i].start = width * i / n_bands;
+          bands[i].end = width * (i + 1) / n_bands;
+        }
+      blur_bands (bands, n_bands);
 
-  g_free (flipped_buffer);
+      for (i = 0; i < n_bands; i++)
+        {
+          bands[i].vertical = FALSE;
+          bands[i].start = height * i / n_bands;
+          bands[i].end = height * (i + 1) / n_bands;
+        }
+      blur_bands (bands, n_bands);
+
+      g_cond_clear (&barrier.cond);
+      g_mutex_clear (&barrier.mutex);
+    }
+
+  g_free (tmp_buffer);
 }
 
 /*
@@ -188,6 +411,9 @@ _gtk_cairo_blur_surface (cairo_surface_t* surface,
   if (radius == 0)
     return;
 
+  /* The blur is indistinguishable from a flat fill long before this */
+  radius = MIN (radius, BLUR_MAX_D - 1);
+
   /* Before we mess with the surface, execute any pending drawing. */
   cairo_surface_flush (surface);
 
@@ -239,10 +239,52 @@
  */
 
 
+/* Containers with many children keep the clips of their children in
+ * a grid, so that drawing only needs to look at the children that
+ * intersect the area that is being drawn. The index is built on the
+ * first draw, follows the allocations of the children, and is dropped
+ * when children are added or removed. Children that overlap are drawn
+ * in the order gtk_container_forall() had when the index was built.
+ */
+#define DRAW_INDEX_MIN_CHILDREN 64
+#define DRAW_INDEX_CELL_SIZE    256
+/* Children covering more cells are checked on every draw */
+#define DRAW_INDEX_MAX_CELLS    16
+
+typedef struct
+{
+  GtkWidget *child;
+  GdkRectangle clip;
+  guint stamp;
+  guint big : 1;
+} DrawIndexChild;
+
+typedef struct
+{
+  /* the window that the indexed children draw on */
+  GdkWindow *window;
+
+  /* DrawIndexChild, in the order of gtk_container_forall() */
+  GArray *children;
+  /* child -> position in children + 1 */
+  GHashTable *positions;
+  /* cell -> GArray of positions */
+  GHashTable *cells;
+  /* positions of children that are too big for cells */
+  GArray *big;
+  /* children that have their own windows, or draw on another
+   * window, they are drawn like without the index */
+  GPtrArray *others;
+
+  guint stamp;
+} DrawIndex;
+
 struct _GtkContainerPrivate
 {
   GtkWidget *focus_child;
 
+  DrawIndex *draw_index;
+
   GdkFrameClock *resize_clock;
   guint resize_handler;
 
@@ -255,6 +297,7 @@ struct _GtkContainerPrivate
   guint restyle_pending    : 1;
   guint resize_mode        : 2;
   guint request_mode       : 2;
+  guint draw_index_unneeded : 1;
 };
 
 enum {
@@ -1400,6 +1443,8 @@ gtk_container_destroy (GtkWidget *widget)
 
   g_clear_object (&priv->focus_child);
 
+  _gtk_container_invalidate_draw_index (container);
+
   /* do this before walking child widgets, to avoid
    * removing children from focus chain one by one.
    */
@@ -3353,6 +3398,25 @@ typedef struct {
   int window_depth;
 } ChildOrderInfo;
 
+static void
+add_child_order_info (GArray    *child_infos,
+                      GtkWidget *child)
+{
+  ChildOrderInfo info;
+  GList *siblings;
+  GdkWindow *window;
+
+  info.child = child;
+  info.window_depth = G_MAXINT;
+  if (gtk_widget_get_has_window (child))
+    {
+      window = gtk_widget_get_window (child);
+      siblings = gdk_window_peek_children (gdk_window_get_parent (window));
+      info.window_depth = g_list_index (siblings, window);
+    }
+  g_array_append_val (child_infos, info);
+}
+
 static void
 gtk_container_draw_forall (GtkWidget *widget,
                            gpointer   client_data)
@@ -3362,22 +3426,9 @@ gtk_container_draw_forall (GtkWidget *widget,
     GArray *child_infos;
     cairo_t *cr;
   } *data = client_data;
-  ChildOrderInfo info;
-  GList *siblings;
-  GdkWindow *window;
 
   if (gtk_container_should_propagate_draw (data->container, widget, data->cr))
-    {
-      info.child = widget;
-      info.window_depth = G_MAXINT;
-      if (gtk_widget_get_has_window (widget))
-        {
-          window = gtk_widget_get_window (widget);
-          siblings = gdk_window_peek_children (gdk_window_get_parent (window));
-          info.window_depth = g_list_index (siblings, window);
-        }
-      g_array_append_val (data->child_infos, info);
-    }
+    add_child_order_info (data->child_infos, widget);
 }
 
 static gint
@@ -3390,11 +3441,410 @@ compare_children_for_draw (gconstpointer  _a,
   return b->window_depth - a->window_depth;
 }
 
+static inline gint
+draw_index_cell (gint coord)
+{
+  /* Round towards minus infinity */
+  if (coord >= 0)
+    return coord / DRAW_INDEX_CELL_SIZE;
+  else
+    return -((-coord - 1) / DRAW_INDEX_CELL_SIZE) - 1;
+}
+
+static inline gpointer
+draw_index_cell_key (gint cx,
+                     gint cy)
+{
+  /* Cells that are 64k cells apart share a key. That only
+   * adds candidates, which are checked anyway. */
+  return GUINT_TO_POINTER ((((guint) cx & 0xffff) << 16) | ((guint) cy & 0xffff));
+}
+
+static gboolean
+draw_index_get_cells (const GdkRectangle *rect,
+                      gint               *cx0,
+                      gint               *cy0,
+                      gint               *cx1,
+                      gint               *cy1)
+{
+  if (rect->width <= 0 || rect->height <= 0)
+    return FALSE;
+
+  *cx0 = draw_index_cell (rect->x);
+  *cy0 = draw_index_cell (rect->y);
+  *cx1 = draw_index_cell (rect->x + rect->width - 1);
+  *cy1 = draw_index_cell (rect->y + rect->height - 1);
+
+  return TRUE;
+}
+
+static void
+draw_index_insert (DrawIndex *index,
+                   guint      pos)
+{
+  DrawIndexChild *entry = &g_array_index (index->children, DrawIndexChild, pos);
+  gint cx, cy, cx0, cy0, cx1, cy1;
+  GArray *cell;
+
+  if (!draw_index_get_cells (&entry->clip, &cx0, &cy0, &cx1, &cy1))
+    return;
+
+  if ((gint64) (cx1 - cx0 + 1) * (cy1 - cy0 + 1) > DRAW_INDEX_MAX_CELLS)
+    {
+      entry->big = TRUE;
+      g_array_append_val (index->big, pos);
+      return;
+    }
+
+  for (cy = cy0; cy <= cy1; cy++)
+    for (cx = cx0; cx <= cx1; cx++)
+      {
+        cell = g_hash_table_lookup (index->cells, draw_index_cell_key (cx, cy));
+        if (cell == NULL)
+          {
+            cell = g_array_new (FALSE, FALSE, sizeof (guint));
+            g_hash_table_insert (index->cells, draw_index_cell_key (cx, cy), cell);
+          }
+        g_array_append_val (cell, pos);
+      }
+}
+
+static void
+remove_position (GArray *array,
+                 guint   pos)
+{
+  guint i;
+
+  for (i = 0; i < array->len; i++)
+    {
+      if (g_array_index (array, guint, i) == pos)
+        {
+          g_array_remove_index_fast (array, i);
+          return;
+        }
+    }
+}
+
+static void
+draw_index_remove (DrawIndex *index,
+                   guint      pos)
+{
+  DrawIndexChild *entry = &g_array_index (index->children, DrawIndexChild, pos);
+  gint cx, cy, cx0, cy0, cx1, cy1;
+  GArray *cell;
+
+  if (entry->big)
+    {
+      entry->big = FALSE;
+      remove_position (index->big, pos);
+      return;
+    }
+
+  if (!draw_index_get_cells (&entry->clip, &cx0, &cy0, &cx1, &cy1))
+    return;
+
+  for (cy = cy0; cy <= cy1; cy++)
+    for (cx = cx0; cx <= cx1; cx++)
+      {
+        cell = g_hash_table_lookup (index->cells, draw_index_cell_key (cx, cy));
+        if (cell)
+          remove_position (cell, pos);
+      }
+}
+
+static void
+draw_index_free (DrawIndex *index)
+{
+  g_array_unref (index->children);
+  g_hash_table_unref (index->positions);
+  g_hash_table_unref (index->cells);
+  g_array_unref (index->big);
+  g_ptr_array_unref (index->others);
+  g_slice_free (DrawIndex, index);
+}
+
+static void
+collect_child (GtkWidget *child,
+               gpointer   data)
+{
+  g_ptr_array_add (data, child);
+}
+
+static void
+gtk_container_build_draw_index (GtkContainer *container)
+{
+  GtkContainerPrivate *priv = container->priv;
+  GPtrArray *children;
+  GdkWindow *window = NULL;
+  DrawIndex *index;
+  guint i;
+
+  children = g_ptr_array_new ();
+  gtk_container_forall (container, collect_child, children);
+
+  if (children->len < DRAW_INDEX_MIN_CHILDREN)
+    {
+      priv->draw_index_unneeded = TRUE;
+      g_ptr_array_unref (children);
+      return;
+    }
+
+  for (i = 0; i < children->len && window == NULL; i++)
+    {
+      GtkWidget *child = g_ptr_array_index (children, i);
+
+      if (!gtk_widget_get_has_window (child))
+        window = gtk_widget_get_window (child);
+    }
+
+  /* Try again when the children are realized */
+  if (window == NULL)
+    {
+      g_ptr_array_unref (children);
+      return;
+    }
+
+  index = g_slice_new0 (DrawIndex);
+  index->window = window;
+  index->children = g_array_sized_new (FALSE, FALSE, sizeof (DrawIndexChild), children->len);
+  index->positions = g_hash_table_new (NULL, NULL);
+  index->cells = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+  index->big = g_array_new (FALSE, FALSE, sizeof (guint));
+  index->others = g_ptr_array_new ();
+
+  for (i = 0; i < children->len; i++)
+    {
+      GtkWidget *child = g_ptr_array_index (children, i);
+      DrawIndexChild entry = { 0, };
+      GdkWindow *child_window;
+
+      child_window = gtk_widget_get_window (child);
+      if (gtk_widget_get_has_window (child) ||
+          (child_window != NULL && child_window != window))
+        {
+          g_ptr_array_add (index->others, child);
+          continue;
+        }
+
+      entry.child = child;
+      gtk_widget_get_clip (child, &entry.clip);
+      g_array_append_val (index->children, entry);
+      g_hash_table_insert (index->positions, child, GUINT_TO_POINTER (index->children->len));
+      draw_index_insert (index, index->children->len - 1);
+    }
+
+  g_ptr_array_unref (children);
+
+  priv->draw_index = index;
+}
+
+/**
+ * _gtk_container_invalidate_draw_index:
+ * @container: a #GtkContainer
+ *
+ * Drops the index of the children of @container that is used for
+ * drawing, because children were added or removed, or the windows
+ * they draw on went away.
+ */
+void
+_gtk_container_invalidate_draw_index (GtkContainer *container)
+{
+  GtkContainerPrivate *priv = container->priv;
+
+  priv->draw_index_unneeded = FALSE;
+
+  if (priv->draw_index)
+    {
+      draw_index_free (priv->draw_index);
+      priv->draw_index = NULL;
+    }
+}
+
+/**
+ * _gtk_container_child_allocated:
+ * @container: a #GtkContainer
+ * @child: a child of @container
+ *
+ * Updates the index of the children of @container that is used for
+ * drawing after @child was allocated.
+ */
+void
+_gtk_container_child_allocated (GtkContainer *container,
+                                GtkWidget    *child)
+{
+  DrawIndex *index = container->priv->draw_index;
+  DrawIndexChild *entry;
+  GdkRectangle clip;
+  guint pos;
+
+  if (index == NULL)
+    return;
+
+  pos = GPOINTER_TO_UINT (g_hash_table_lookup (index->positions, child));
+  if (pos == 0)
+    return;
+  pos--;
+
+  entry = &g_array_index (index->children, DrawIndexChild, pos);
+  gtk_widget_get_clip (child, &clip);
+
+  if (clip.x == entry->clip.x && clip.y == entry->clip.y &&
+      clip.width == entry->clip.width && clip.height == entry->clip.height)
+    return;
+
+  draw_index_remove (index, pos);
+  entry->clip = clip;
+  draw_index_insert (index, pos);
+}
+
+static gint
+compare_positions (gconstpointer a,
+                   gconstpointer b)
+{
+  guint pa = *(const guint *) a;
+  guint pb = *(const guint *) b;
+
+  return pa < pb ? -1 : pa > pb;
+}
+
+static void
+add_candidates (DrawIndex *index,
+                GArray    *candidates,
+                GArray    *positions)
+{
+  DrawIndexChild *entry;
+  guint i, pos;
+
+  for (i = 0; i < positions->len; i++)
+    {
+      pos = g_array_index (positions, guint, i);
+      entry = &g_array_index (index->children, DrawIndexChild, pos);
+
+      if (entry->stamp != index->stamp)
+        {
+          entry->stamp = index->stamp;
+          g_array_append_val (candidates, pos);
+        }
+    }
+}
+
+static void
+gtk_container_draw_indexed (GtkContainer *container,
+                            cairo_t      *cr)
+{
+  GtkWidget *widget = GTK_WIDGET (container);
+  DrawIndex *index = container->priv->draw_index;
+  GdkRectangle clip;
+  GArray *candidates, *child_infos;
+  GdkWindow *window, *w;
+  gint x, y, cx, cy, cx0, cy0, cx1, cy1;
+  guint i, pos;
+
+  /* Find the origin of the index window in @cr,
+   * like gtk_container_propagate_draw() does */
+  if (!gtk_widget_get_has_window (widget))
+    {
+      GtkAllocation allocation;
+
+      gtk_widget_get_allocation (widget, &allocation);
+      x = -allocation.x;
+      y = -allocation.y;
+    }
+  else
+    {
+      x = 0;
+      y = 0;
+    }
+
+  window = gtk_widget_get_window (widget);
+  for (w = index->window; w && w != window; w = gdk_window_get_parent (w))
+    {
+      gint wx, wy;
+
+      gdk_window_get_position (w, &wx, &wy);
+      x += wx;
+      y += wy;
+    }
+  if (w == NULL)
+    {
+      x = 0;
+      y = 0;
+    }
+
+  candidates = g_array_new (FALSE, FALSE, sizeof (guint));
+
+  if (gdk_cairo_get_clip_rectangle (cr, &clip))
+    {
+      clip.x -= x;
+      clip.y -= y;
+
+      draw_index_get_cells (&clip, &cx0, &cy0, &cx1, &cy1);
+
+      index->stamp++;
+
+      if ((gint64) (cx1 - cx0 + 1) * (cy1 - cy0 + 1) > index->children->len / 4)
+        {
+          /* Most of the area is drawn */
+          for (pos = 0; pos < index->children->len; pos++)
+            g_array_append_val (candidates, pos);
+        }
+      else
+        {
+          for (cy = cy0; cy <= cy1; cy++)
+            for (cx = cx0; cx <= cx1; cx++)
+              {
+                GArray *cell;
+
+                cell = g_hash_table_lookup (index->cells, draw_index_cell_key (cx, cy));
+                if (cell)
+                  add_candidates (index, candidates, cell);
+              }
+          add_candidates (index, candidates, index->big);
+
+          g_array_sort (candidates, compare_positions);
+        }
+
+      for (i = 0; i < candidates->len; i++)
+        {
+          DrawIndexChild *entry;
+
+          pos = g_array_index (candidates, guint, i);
+          entry = &g_array_index (index->children, DrawIndexChild, pos);
+
+          if (gdk_rectangle_intersect (&entry->clip, &clip, NULL))
+            gtk_container_propagate_draw (container, entry->child, cr);
+        }
+    }
+
+  g_array_free (candidates, TRUE);
+
+  /* The rest is drawn the old way */
+  child_infos = g_array_new (FALSE, TRUE, sizeof (ChildOrderInfo));
+
+  for (i = 0; i < index->others->len; i++)
+    {
+      GtkWidget *child = g_ptr_array_index (index->others, i);
+
+      if (gtk_container_should_propagate_draw (container, child, cr))
+        add_child_order_info (child_infos, child);
+    }
+
+  g_array_sort (child_infos, compare_children_for_draw);
+
+  for (i = 0; i < child_infos->len; i++)
+    gtk_container_propagate_draw (container,
+                                  g_array_index (child_infos, ChildOrderInfo, i).child,
+                                  cr);
+
+  g_array_free (child_infos, TRUE);
+}
+
 static gint
 gtk_container_draw (GtkWidget *widget,
                     cairo_t   *cr)
 {
   GtkContainer *container = GTK_CONTAINER (widget);
+  GtkContainerPrivate *priv = container->priv;
   GArray *child_infos;
   int i;
   ChildOrderInfo *child_info;
@@ -3404,6 +3854,15 @@ gtk_container_draw (GtkWidget *widget,
     cairo_t *cr;
   } data;
 
+  if (priv->draw_index == NULL && !priv->draw_index_unneeded)
+    gtk_container_build_draw_index (container);
+
+  if (priv->draw_index)
+    {
+      gtk_container_draw_indexed (container, cr);
+      return FALSE;
+    }
+
   child_infos = g_array_new (FALSE, TRUE, sizeof (ChildOrderInfo));
 
   data.container = container;
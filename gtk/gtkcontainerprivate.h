@@ -44,6 +44,9 @@ void      _gtk_container_maybe_start_idle_sizer (GtkContainer *container);
 gboolean  _gtk_container_get_border_width_set   (GtkContainer *container);
 void      _gtk_container_set_border_width_set   (GtkContainer *container,
                                                  gboolean      border_width_set);
+void      _gtk_container_invalidate_draw_index  (GtkContainer *container);
+void      _gtk_container_child_allocated        (GtkContainer *container,
+                                                 GtkWidget    *child);
 
 G_END_DECLS
 
@@ -28,6 +28,7 @@
 #include "gtkcssinheritvalueprivate.h"
 #include "gtkcssinitialvalueprivate.h"
 #include "gtkcssnumbervalueprivate.h"
+#include "gtkcssproviderprivate.h"
 #include "gtkcssshorthandpropertyprivate.h"
 #include "gtkcssstringvalueprivate.h"
 #include "gtkcssstylepropertyprivate.h"
@@ -39,24 +40,171 @@
 
 G_DEFINE_TYPE (GtkCssComputedValues, _gtk_css_computed_values, G_TYPE_OBJECT)
 
+/* GROUPS
+ *
+ * The intrinsic values are stored in groups of related properties.
+ * Most widgets only set a few properties themselves and take the rest
+ * from their parent or the initial values, so after the values are
+ * computed, every group that is equal to the one of the parent is
+ * replaced with a reference to that. A group that is shared is copied
+ * before it is modified.
+ */
+
+struct _GtkCssValuesGroup
+{
+  gint ref_count;
+  GtkCssValue *values[1]; /* actually the number of properties in the group */
+};
+
+/* The first property of every group */
+static const guint group_starts[GTK_CSS_VALUES_N_GROUPS + 1] = {
+  GTK_CSS_PROPERTY_COLOR,               /* color, font and icon */
+  GTK_CSS_PROPERTY_BOX_SHADOW,          /* box shadow, margin and padding */
+  GTK_CSS_PROPERTY_BORDER_TOP_STYLE,    /* border */
+  GTK_CSS_PROPERTY_OUTLINE_STYLE,       /* outline */
+  GTK_CSS_PROPERTY_BACKGROUND_CLIP,     /* background, border colors */
+  GTK_CSS_PROPERTY_BORDER_IMAGE_SOURCE, /* border image */
+  GTK_CSS_PROPERTY_TRANSITION_PROPERTY, /* transitions and animations */
+  GTK_CSS_PROPERTY_OPACITY,             /* everything else */
+  GTK_CSS_PROPERTY_N_PROPERTIES
+};
+
+static guint8 property_groups[GTK_CSS_PROPERTY_N_PROPERTIES];
+
+#define GROUP_N_VALUES(group_id) (group_starts[(group_id) + 1] - group_starts[group_id])
+
+static GtkCssValuesGroup *
+gtk_css_values_group_new (guint group_id)
+{
+  GtkCssValuesGroup *group;
+
+  group = g_malloc0 (G_STRUCT_OFFSET (GtkCssValuesGroup, values) +
+                     GROUP_N_VALUES (group_id) * sizeof (GtkCssValue *));
+  group->ref_count = 1;
+
+  return group;
+}
+
+static GtkCssValuesGroup *
+gtk_css_values_group_ref (GtkCssValuesGroup *group)
+{
+  group->ref_count++;
+
+  return group;
+}
+
+static void
+gtk_css_values_group_unref (GtkCssValuesGroup *group,
+                            guint              group_id)
+{
+  guint i;
+
+  group->ref_count--;
+  if (group->ref_count > 0)
+    return;
+
+  for (i = 0; i < GROUP_N_VALUES (group_id); i++)
+    {
+      if (group->values[i])
+        _gtk_css_value_unref (group->values[i]);
+    }
+
+  g_free (group);
+}
+
+static gboolean
+gtk_css_values_group_equal (GtkCssValuesGroup *group1,
+                            GtkCssValuesGroup *group2,
+                            guint              group_id)
+{
+  guint i;
+
+  if (group1 == group2)
+    return TRUE;
+
+  for (i = 0; i < GROUP_N_VALUES (group_id); i++)
+    {
+      if (!_gtk_css_value_equal0 (group1->values[i], group2->values[i]))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Returns the group of @id, making sure only @values uses it */
+static GtkCssValuesGroup *
+gtk_css_computed_values_get_writable_group (GtkCssComputedValues *values,
+                                            guint                 id)
+{
+  GtkCssValuesGroup *group, *copy;
+  guint group_id, i;
+
+  group_id = property_groups[id];
+  group = values->groups[group_id];
+
+  if (group == NULL)
+    {
+      group = gtk_css_values_group_new (group_id);
+      values->groups[group_id] = group;
+    }
+  else if (group->ref_count > 1)
+    {
+      copy = gtk_css_values_group_new (group_id);
+      for (i = 0; i < GROUP_N_VALUES (group_id); i++)
+        {
+          if (group->values[i])
+            copy->values[i] = _gtk_css_value_ref (group->values[i]);
+        }
+
+      gtk_css_values_group_unref (group, group_id);
+      group = copy;
+      values->groups[group_id] = group;
+    }
+
+  return group;
+}
+
+static void
+gtk_css_computed_values_free_value_array (GtkCssValue **array)
+{
+  guint i;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if (array[i])
+        _gtk_css_value_unref (array[i]);
+    }
+
+  g_free (array);
+}
+
 static void
 gtk_css_computed_values_dispose (GObject *object)
 {
   GtkCssComputedValues *values = GTK_CSS_COMPUTED_VALUES (object);
+  guint i;
 
-  if (values->values)
+  for (i = 0; i < GTK_CSS_VALUES_N_GROUPS; i++)
     {
-      g_ptr_array_unref (values->values);
-      values->values = NULL;
+      if (values->groups[i])
+        {
+          gtk_css_values_group_unref (values->groups[i], i);
+          values->groups[i] = NULL;
+        }
     }
   if (values->sections)
     {
-      g_ptr_array_unref (values->sections);
+      for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+        {
+          if (values->sections[i])
+            gtk_css_section_unref (values->sections[i]);
+        }
+      g_free (values->sections);
       values->sections = NULL;
     }
   if (values->animated_values)
     {
-      g_ptr_array_unref (values->animated_values);
+      gtk_css_computed_values_free_value_array (values->animated_values);
       values->animated_values = NULL;
     }
 
@@ -66,35 +214,26 @@ gtk_css_computed_values_dispose (GObject *object)
   G_OBJECT_CLASS (_gtk_css_computed_values_parent_class)->dispose (object);
 }
 
-static void
-gtk_css_computed_values_finalize (GObject *object)
-{
-  GtkCssComputedValues *values = GTK_CSS_COMPUTED_VALUES (object);
-
-  _gtk_bitmask_free (values->depends_on_parent);
-  _gtk_bitmask_free (values->equals_parent);
-  _gtk_bitmask_free (values->depends_on_color);
-  _gtk_bitmask_free (values->depends_on_font_size);
-
-  G_OBJECT_CLASS (_gtk_css_computed_values_parent_class)->finalize (object);
-}
-
 static void
 _gtk_css_computed_values_class_init (GtkCssComputedValuesClass *klass)
 {
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
+  guint i, id;
 
   object_class->dispose = gtk_css_computed_values_dispose;
-  object_class->finalize = gtk_css_computed_values_finalize;
+
+  for (i = 0; i < GTK_CSS_VALUES_N_GROUPS; i++)
+    {
+      g_assert (group_starts[i] < group_starts[i + 1]);
+
+      for (id = group_starts[i]; id < group_starts[i + 1]; id++)
+        property_groups[id] = i;
+    }
 }
 
 static void
 _gtk_css_computed_values_init (GtkCssComputedValues *values)
 {
-  values->depends_on_parent = _gtk_bitmask_new ();
-  values->equals_parent = _gtk_bitmask_new ();
-  values->depends_on_color = _gtk_bitmask_new ();
-  values->depends_on_font_size = _gtk_bitmask_new ();
 }
 
 GtkCssComputedValues *
@@ -103,13 +242,6 @@ _gtk_css_computed_values_new (void)
   return g_object_new (GTK_TYPE_CSS_COMPUTED_VALUES, NULL);
 }
 
-static void
-maybe_unref_section (gpointer section)
-{
-  if (section)
-    gtk_css_section_unref (section);
-}
-
 void
 _gtk_css_computed_values_compute_value (GtkCssComputedValues    *values,
                                         GtkStyleProviderPrivate *provider,
@@ -158,16 +290,14 @@ _gtk_css_computed_values_set_animated_value (GtkCssComputedValues *values,
 {
   gtk_internal_return_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values));
   gtk_internal_return_if_fail (value != NULL);
+  gtk_internal_return_if_fail (id < GTK_CSS_PROPERTY_N_PROPERTIES);
 
   if (values->animated_values == NULL)
-    values->animated_values = g_ptr_array_new_with_free_func ((GDestroyNotify)_gtk_css_value_unref);
-  if (id >= values->animated_values->len)
-   g_ptr_array_set_size (values->animated_values, id + 1);
-
-  if (g_ptr_array_index (values->animated_values, id))
-    _gtk_css_value_unref (g_ptr_array_index (values->animated_values, id));
-  g_ptr_array_index (values->animated_values, id) = _gtk_css_value_ref (value);
+    values->animated_values = g_new0 (GtkCssValue *, GTK_CSS_PROPERTY_N_PROPERTIES);
 
+  if (values->animated_values[id])
+    _gtk_css_value_unref (values->animated_values[id]);
+  values->animated_values[id] = _gtk_css_value_ref (value);
 }
 
 void
@@ -177,41 +307,37 @@ _gtk_css_computed_values_set_value (GtkCssComputedValues *values,
                                     GtkCssDependencies    dependencies,
                                     GtkCssSection        *section)
 {
+  GtkCssValuesGroup *group;
+  guint i;
+
   gtk_internal_return_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values));
+  gtk_internal_return_if_fail (id < GTK_CSS_PROPERTY_N_PROPERTIES);
+
+  group = gtk_css_computed_values_get_writable_group (values, id);
+  i = id - group_starts[property_groups[id]];
+
+  if (group->values[i])
+    _gtk_css_value_unref (group->values[i]);
+  group->values[i] = _gtk_css_value_ref (value);
+
+  if (dependencies & GTK_CSS_EQUALS_PARENT)
+    dependencies |= GTK_CSS_DEPENDS_ON_PARENT;
+  values->dependencies[id] |= dependencies;
 
-  if (values->values == NULL)
-    values->values = g_ptr_array_new_full (_gtk_css_style_property_get_n_properties (),
-					   (GDestroyNotify)_gtk_css_value_unref);
-  if (id >= values->values->len)
-   g_ptr_array_set_size (values->values, id + 1);
-
-  if (g_ptr_array_index (values->values, id))
-    _gtk_css_value_unref (g_ptr_array_index (values->values, id));
-  g_ptr_array_index (values->values, id) = _gtk_css_value_ref (value);
-
-  if (dependencies & (GTK_CSS_DEPENDS_ON_PARENT | GTK_CSS_EQUALS_PARENT))
-    values->depends_on_parent = _gtk_bitmask_set (values->depends_on_parent, id, TRUE);
-  if (dependencies & (GTK_CSS_EQUALS_PARENT))
-    values->equals_parent = _gtk_bitmask_set (values->equals_parent, id, TRUE);
-  if (dependencies & (GTK_CSS_DEPENDS_ON_COLOR))
-    values->depends_on_color = _gtk_bitmask_set (values->depends_on_color, id, TRUE);
-  if (dependencies & (GTK_CSS_DEPENDS_ON_FONT_SIZE))
-    values->depends_on_font_size = _gtk_bitmask_set (values->depends_on_font_size, id, TRUE);
-
-  if (values->sections && values->sections->len > id && g_ptr_array_index (values->sections, id))
+  if (values->sections && values->sections[id])
     {
-      gtk_css_section_unref (g_ptr_array_index (values->sections, id));
-      g_ptr_array_index (values->sections, id) = NULL;
+      gtk_css_section_unref (values->sections[id]);
+      values->sections[id] = NULL;
     }
 
-  if (section)
+  /* Sections are only needed for debugging, so we only keep
+   * them when somebody asked for it. */
+  if (section && gtk_css_provider_get_keep_css_sections ())
     {
       if (values->sections == NULL)
-        values->sections = g_ptr_array_new_with_free_func (maybe_unref_section);
-      if (values->sections->len <= id)
-        g_ptr_array_set_size (values->sections, id + 1);
+        values->sections = g_new0 (GtkCssSection *, GTK_CSS_PROPERTY_N_PROPERTIES);
 
-      g_ptr_array_index (values->sections, id) = gtk_css_section_ref (section);
+      values->sections[id] = gtk_css_section_ref (section);
     }
 }
 
@@ -222,9 +348,9 @@ _gtk_css_computed_values_get_value (GtkCssComputedValues *values,
   gtk_internal_return_val_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values), NULL);
 
   if (values->animated_values &&
-      id < values->animated_values->len &&
-      g_ptr_array_index (values->animated_values, id))
-    return g_ptr_array_index (values->animated_values, id);
+      id < GTK_CSS_PROPERTY_N_PROPERTIES &&
+      values->animated_values[id])
+    return values->animated_values[id];
 
   return _gtk_css_computed_values_get_intrinsic_value (values, id);
 }
@@ -233,13 +359,18 @@ GtkCssValue *
 _gtk_css_computed_values_get_intrinsic_value (GtkCssComputedValues *values,
                                               guint                 id)
 {
+  GtkCssValuesGroup *group;
+
   gtk_internal_return_val_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values), NULL);
 
-  if (values->values == NULL ||
-      id >= values->values->len)
+  if (id >= GTK_CSS_PROPERTY_N_PROPERTIES)
+    return NULL;
+
+  group = values->groups[property_groups[id]];
+  if (group == NULL)
     return NULL;
 
-  return g_ptr_array_index (values->values, id);
+  return group->values[id - group_starts[property_groups[id]]];
 }
 
 GtkCssSection *
@@ -249,10 +380,10 @@ _gtk_css_computed_values_get_section (GtkCssComputedValues *values,
   gtk_internal_return_val_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values), NULL);
 
   if (values->sections == NULL ||
-      id >= values->sections->len)
+      id >= GTK_CSS_PROPERTY_N_PROPERTIES)
     return NULL;
 
-  return g_ptr_array_index (values->sections, id);
+  return values->sections[id];
 }
 
 GtkBitmask *
@@ -260,23 +391,62 @@ _gtk_css_computed_values_get_difference (GtkCssComputedValues *values,
                                          GtkCssComputedValues *other)
 {
   GtkBitmask *result;
-  guint i, len;
+  guint group_id, i;
 
-  len = MIN (values->values->len, other->values->len);
   result = _gtk_bitmask_new ();
-  if (values->values->len != other->values->len)
-    result = _gtk_bitmask_invert_range (result, len, MAX (values->values->len, other->values->len));
-  
-  for (i = 0; i < len; i++)
+
+  for (group_id = 0; group_id < GTK_CSS_VALUES_N_GROUPS; group_id++)
     {
-      if (!_gtk_css_value_equal (g_ptr_array_index (values->values, i),
-                                 g_ptr_array_index (other->values, i)))
-        result = _gtk_bitmask_set (result, i, TRUE);
+      /* Shared groups are the same */
+      if (values->groups[group_id] == other->groups[group_id])
+        continue;
+
+      for (i = group_starts[group_id]; i < group_starts[group_id + 1]; i++)
+        {
+          if (!_gtk_css_value_equal0 (_gtk_css_computed_values_get_intrinsic_value (values, i),
+                                      _gtk_css_computed_values_get_intrinsic_value (other, i)))
+            result = _gtk_bitmask_set (result, i, TRUE);
+        }
     }
 
   return result;
 }
 
+/*
+ * _gtk_css_computed_values_share_groups:
+ * @values: the values that were just computed
+ * @parent_values: (allow-none): the values of the parent
+ *
+ * Replaces the groups of @values that are equal to the ones of
+ * @parent_values with references to those.
+ */
+void
+_gtk_css_computed_values_share_groups (GtkCssComputedValues *values,
+                                       GtkCssComputedValues *parent_values)
+{
+  guint i;
+
+  gtk_internal_return_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values));
+  gtk_internal_return_if_fail (parent_values == NULL || GTK_IS_CSS_COMPUTED_VALUES (parent_values));
+
+  if (parent_values == NULL)
+    return;
+
+  for (i = 0; i < GTK_CSS_VALUES_N_GROUPS; i++)
+    {
+      if (values->groups[i] == NULL ||
+          parent_values->groups[i] == NULL ||
+          values->groups[i] == parent_values->groups[i])
+        continue;
+
+      if (gtk_css_values_group_equal (values->groups[i], parent_values->groups[i], i))
+        {
+          gtk_css_values_group_unref (values->groups[i], i);
+          values->groups[i] = gtk_css_values_group_ref (parent_values->groups[i]);
+        }
+    }
+}
+
 /* TRANSITIONS */
 
 typedef struct _TransitionInfo TransitionInfo;
@@ -529,7 +699,7 @@ _gtk_css_computed_values_advance (GtkCssComputedValues *values,
                                   gint64                timestamp)
 {
   GtkBitmask *changed;
-  GPtrArray *old_computed_values;
+  GtkCssValue **old_computed_values;
   GSList *list;
   guint i;
 
@@ -565,15 +735,15 @@ _gtk_css_computed_values_advance (GtkCssComputedValues *values,
     {
       GtkCssValue *old_animated, *new_animated;
 
-      old_animated = old_computed_values && i < old_computed_values->len ? g_ptr_array_index (old_computed_values, i) : NULL;
-      new_animated = values->animated_values && i < values->animated_values->len ? g_ptr_array_index (values->animated_values, i) : NULL;
+      old_animated = old_computed_values ? old_computed_values[i] : NULL;
+      new_animated = values->animated_values ? values->animated_values[i] : NULL;
 
       if (!_gtk_css_value_equal0 (old_animated, new_animated))
         changed = _gtk_bitmask_set (changed, i, TRUE);
     }
 
   if (old_computed_values)
-    g_ptr_array_unref (old_computed_values);
+    gtk_css_computed_values_free_value_array (old_computed_values);
 
   return changed;
 }
@@ -601,7 +771,7 @@ _gtk_css_computed_values_cancel_animations (GtkCssComputedValues *values)
 
   if (values->animated_values)
     {
-      g_ptr_array_unref (values->animated_values);
+      gtk_css_computed_values_free_value_array (values->animated_values);
       values->animated_values = NULL;
     }
 
@@ -614,16 +784,37 @@ _gtk_css_computed_values_compute_dependencies (GtkCssComputedValues *values,
                                                const GtkBitmask     *parent_changes)
 {
   GtkBitmask *changes;
+  gboolean color_changed, font_size_changed;
+  guint i;
 
   gtk_internal_return_val_if_fail (GTK_IS_CSS_COMPUTED_VALUES (values), _gtk_bitmask_new ());
 
-  changes = _gtk_bitmask_copy (parent_changes);
-  changes = _gtk_bitmask_intersect (changes, values->depends_on_parent);
-  if (_gtk_bitmask_get (changes, GTK_CSS_PROPERTY_COLOR))
-    changes = _gtk_bitmask_union (changes, values->depends_on_color);
-  if (_gtk_bitmask_get (changes, GTK_CSS_PROPERTY_FONT_SIZE))
-    changes = _gtk_bitmask_union (changes, values->depends_on_font_size);
+  changes = _gtk_bitmask_new ();
+  color_changed = FALSE;
+  font_size_changed = FALSE;
+
+  for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+    {
+      if ((values->dependencies[i] & GTK_CSS_DEPENDS_ON_PARENT) &&
+          _gtk_bitmask_get (parent_changes, i))
+        {
+          changes = _gtk_bitmask_set (changes, i, TRUE);
+          if (i == GTK_CSS_PROPERTY_COLOR)
+            color_changed = TRUE;
+          else if (i == GTK_CSS_PROPERTY_FONT_SIZE)
+            font_size_changed = TRUE;
+        }
+    }
+
+  if (color_changed || font_size_changed)
+    {
+      for (i = 0; i < GTK_CSS_PROPERTY_N_PROPERTIES; i++)
+        {
+          if ((color_changed && (values->dependencies[i] & GTK_CSS_DEPENDS_ON_COLOR)) ||
+              (font_size_changed && (values->dependencies[i] & GTK_CSS_DEPENDS_ON_FONT_SIZE)))
+            changes = _gtk_bitmask_set (changes, i, TRUE);
+        }
+    }
 
   return changes;
 }
-
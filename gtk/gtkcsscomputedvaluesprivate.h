@@ -37,22 +37,24 @@ G_BEGIN_DECLS
 
 /* typedef struct _GtkCssComputedValues           GtkCssComputedValues; */
 typedef struct _GtkCssComputedValuesClass      GtkCssComputedValuesClass;
+typedef struct _GtkCssValuesGroup              GtkCssValuesGroup;
+
+/* The number of groups the properties are split into, see
+ * gtkcsscomputedvalues.c */
+#define GTK_CSS_VALUES_N_GROUPS 8
 
 struct _GtkCssComputedValues
 {
   GObject parent;
 
-  GPtrArray             *values;               /* the unanimated (aka intrinsic) values */
-  GPtrArray             *sections;             /* sections the values are defined in */
+  GtkCssValue          **animated_values;      /* NULL or array of animated values/NULL if not animated */
+  GtkCssSection        **sections;             /* NULL or sections the values are defined in, see gtk_css_provider_set_keep_css_sections() */
 
-  GPtrArray             *animated_values;      /* NULL or array of animated values/NULL if not animated */
   gint64                 current_time;         /* the current time in our world */
   GSList                *animations;           /* the running animations, least important one first */
 
-  GtkBitmask            *depends_on_parent;    /* for intrinsic values */
-  GtkBitmask            *equals_parent;        /* dito */
-  GtkBitmask            *depends_on_color;     /* dito */
-  GtkBitmask            *depends_on_font_size; /* dito */
+  guint8                 dependencies[GTK_CSS_PROPERTY_N_PROPERTIES]; /* GtkCssDependencies of the intrinsic values */
+  GtkCssValuesGroup     *groups[GTK_CSS_VALUES_N_GROUPS];           /* the unanimated (aka intrinsic) values, possibly shared */
 };
 
 struct _GtkCssComputedValuesClass
@@ -102,6 +104,9 @@ GtkBitmask *            _gtk_css_computed_values_advance              (GtkCssCom
 void                    _gtk_css_computed_values_cancel_animations    (GtkCssComputedValues     *values);
 gboolean                _gtk_css_computed_values_is_static            (GtkCssComputedValues     *values);
 
+void                    _gtk_css_computed_values_share_groups         (GtkCssComputedValues     *values,
+                                                                       GtkCssComputedValues     *parent_values);
+
 G_END_DECLS
 
 #endif /* __GTK_CSS_COMPUTED_VALUES_PRIVATE_H__ */
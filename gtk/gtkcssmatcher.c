@@ -19,7 +19,92 @@
 
 #include "gtkcssmatcherprivate.h"
 
-#include "gtkwidgetpath.h"
+#include <string.h>
+
+#include "gtkwidgetpathprivate.h"
+
+/* ANCESTOR FILTER */
+
+enum {
+  FILTER_TYPE = 0x7f4a7c15,
+  FILTER_CLASS = 0x5bd1e995,
+  FILTER_ID = 0x27d4eb2f
+};
+
+static inline guint32
+gtk_css_ancestor_filter_hash (guint32 value,
+                              guint32 salt)
+{
+  guint32 h = value ^ salt;
+
+  h ^= h >> 16;
+  h *= 0x85ebca6b;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35;
+  h ^= h >> 16;
+
+  return h;
+}
+
+static inline guint32
+gtk_css_ancestor_filter_hash_type (GType type)
+{
+  guint64 value = type;
+
+  return gtk_css_ancestor_filter_hash ((guint32) value ^ (guint32) (value >> 32), FILTER_TYPE);
+}
+
+static inline void
+gtk_css_ancestor_filter_add (GtkCssAncestorFilter *filter,
+                             guint32               hash)
+{
+  guint a = hash % GTK_CSS_ANCESTOR_FILTER_BITS;
+  guint b = (hash >> 16) % GTK_CSS_ANCESTOR_FILTER_BITS;
+
+  filter->bits[a / 32] |= 1u << (a % 32);
+  filter->bits[b / 32] |= 1u << (b % 32);
+}
+
+static inline gboolean
+gtk_css_ancestor_filter_contains (const GtkCssAncestorFilter *filter,
+                                  guint32                     hash)
+{
+  guint a = hash % GTK_CSS_ANCESTOR_FILTER_BITS;
+  guint b = (hash >> 16) % GTK_CSS_ANCESTOR_FILTER_BITS;
+
+  return (filter->bits[a / 32] & (1u << (a % 32))) &&
+         (filter->bits[b / 32] & (1u << (b % 32)));
+}
+
+static void
+gtk_css_ancestor_filter_init (GtkCssAncestorFilter *filter,
+                              const GtkWidgetPath  *path,
+                              guint                 length)
+{
+  const GQuark *classes;
+  const char *name;
+  guint i, j, n_classes;
+  GType type;
+
+  memset (filter, 0, sizeof (GtkCssAncestorFilter));
+
+  for (i = 0; i < length; i++)
+    {
+      /* Name selectors match subtypes, so add the whole hierarchy */
+      for (type = gtk_widget_path_iter_get_object_type (path, i);
+           type != G_TYPE_INVALID;
+           type = g_type_parent (type))
+        gtk_css_ancestor_filter_add (filter, gtk_css_ancestor_filter_hash_type (type));
+
+      classes = _gtk_widget_path_iter_get_qclasses (path, i, &n_classes);
+      for (j = 0; j < n_classes; j++)
+        gtk_css_ancestor_filter_add (filter, gtk_css_ancestor_filter_hash (classes[j], FILTER_CLASS));
+
+      name = gtk_widget_path_iter_get_name (path, i);
+      if (name)
+        gtk_css_ancestor_filter_add (filter, gtk_css_ancestor_filter_hash (g_str_hash (name), FILTER_ID));
+    }
+}
 
 /* GTK_CSS_MATCHER_WIDGET_PATH */
 
@@ -34,6 +119,8 @@ gtk_css_matcher_widget_path_get_parent (GtkCssMatcher       *matcher,
   matcher->path.path = child->path.path;
   matcher->path.index = child->path.index - 1;
   matcher->path.sibling_index = gtk_widget_path_iter_get_sibling_index (matcher->path.path, matcher->path.index);
+  /* The filter can't forget the child's parent, so don't use it */
+  matcher->path.has_filter = FALSE;
 
   return TRUE;
 }
@@ -49,6 +136,10 @@ gtk_css_matcher_widget_path_get_previous (GtkCssMatcher       *matcher,
   matcher->path.path = next->path.path;
   matcher->path.index = next->path.index;
   matcher->path.sibling_index = next->path.sibling_index - 1;
+  /* Siblings share their ancestors */
+  matcher->path.has_filter = next->path.has_filter;
+  if (next->path.has_filter && matcher != next)
+    matcher->path.filter = next->path.filter;
 
   return TRUE;
 }
@@ -205,10 +296,53 @@ _gtk_css_matcher_init (GtkCssMatcher       *matcher,
   matcher->path.path = path;
   matcher->path.index = gtk_widget_path_length (path) - 1;
   matcher->path.sibling_index = gtk_widget_path_iter_get_sibling_index (path, matcher->path.index);
+  matcher->path.has_filter = TRUE;
+  gtk_css_ancestor_filter_init (&matcher->path.filter, path, matcher->path.index);
 
   return TRUE;
 }
 
+/* Whether an ancestor of @matcher might match the given type, class or
+ * id. A %FALSE return is definite, %TRUE may be a false positive.
+ * Matchers other than widget path matchers always return %TRUE.
+ */
+gboolean
+_gtk_css_matcher_may_have_ancestor_type (const GtkCssMatcher *matcher,
+                                         GType                type)
+{
+  if (matcher->klass != &GTK_CSS_MATCHER_WIDGET_PATH || !matcher->path.has_filter)
+    return TRUE;
+
+  /* g_type_is_a() also matches interfaces, which aren't in the filter */
+  if (!G_TYPE_IS_CLASSED (type))
+    return TRUE;
+
+  return gtk_css_ancestor_filter_contains (&matcher->path.filter,
+                                           gtk_css_ancestor_filter_hash_type (type));
+}
+
+gboolean
+_gtk_css_matcher_may_have_ancestor_class (const GtkCssMatcher *matcher,
+                                          GQuark               class_name)
+{
+  if (matcher->klass != &GTK_CSS_MATCHER_WIDGET_PATH || !matcher->path.has_filter)
+    return TRUE;
+
+  return gtk_css_ancestor_filter_contains (&matcher->path.filter,
+                                           gtk_css_ancestor_filter_hash (class_name, FILTER_CLASS));
+}
+
+gboolean
+_gtk_css_matcher_may_have_ancestor_id (const GtkCssMatcher *matcher,
+                                       const char          *id)
+{
+  if (matcher->klass != &GTK_CSS_MATCHER_WIDGET_PATH || !matcher->path.has_filter)
+    return TRUE;
+
+  return gtk_css_ancestor_filter_contains (&matcher->path.filter,
+                                           gtk_css_ancestor_filter_hash (g_str_hash (id), FILTER_ID));
+}
+
 /* GTK_CSS_MATCHER_WIDGET_ANY */
 
 static gboolean
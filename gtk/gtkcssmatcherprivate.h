@@ -28,6 +28,7 @@ typedef union _GtkCssMatcher GtkCssMatcher;
 typedef struct _GtkCssMatcherSuperset GtkCssMatcherSuperset;
 typedef struct _GtkCssMatcherWidgetPath GtkCssMatcherWidgetPath;
 typedef struct _GtkCssMatcherClass GtkCssMatcherClass;
+typedef struct _GtkCssAncestorFilter GtkCssAncestorFilter;
 
 struct _GtkCssMatcherClass {
   gboolean        (* get_parent)                  (GtkCssMatcher          *matcher,
@@ -53,11 +54,22 @@ struct _GtkCssMatcherClass {
   gboolean is_any;
 };
 
+/* A bloom filter over the types, classes and names of all ancestors
+ * of an element. It allows descendant selectors to give up early when
+ * the ancestor they look for cannot be in the path. */
+#define GTK_CSS_ANCESTOR_FILTER_BITS 256
+
+struct _GtkCssAncestorFilter {
+  guint32 bits[GTK_CSS_ANCESTOR_FILTER_BITS / 32];
+};
+
 struct _GtkCssMatcherWidgetPath {
   const GtkCssMatcherClass *klass;
   const GtkWidgetPath      *path;
   guint                     index;
   guint                     sibling_index;
+  guint                     has_filter :1;
+  GtkCssAncestorFilter      filter;
 };
 
 struct _GtkCssMatcherSuperset {
@@ -79,6 +91,13 @@ void              _gtk_css_matcher_superset_init  (GtkCssMatcher          *match
                                                    const GtkCssMatcher    *subset,
                                                    GtkCssChange            relevant);
 
+gboolean          _gtk_css_matcher_may_have_ancestor_type  (const GtkCssMatcher *matcher,
+                                                            GType                type);
+gboolean          _gtk_css_matcher_may_have_ancestor_class (const GtkCssMatcher *matcher,
+                                                            GQuark               class_name);
+gboolean          _gtk_css_matcher_may_have_ancestor_id    (const GtkCssMatcher *matcher,
+                                                            const char          *id);
+
 
 static inline gboolean
 _gtk_css_matcher_get_parent (GtkCssMatcher       *matcher,
@@ -45,6 +45,7 @@
 #include "gtkmarshalers.h"
 #include "gtkprivate.h"
 #include "gtkintl.h"
+#include "gtkversion.h"
 
 /**
  * SECTION:gtkcssprovider
@@ -1151,6 +1152,9 @@ typedef struct GtkCssRuleset GtkCssRuleset;
 typedef struct _GtkCssScanner GtkCssScanner;
 typedef struct _PropertyValue PropertyValue;
 typedef struct _WidgetPropertyValue WidgetPropertyValue;
+typedef struct _GtkCssRecording GtkCssRecording;
+typedef struct _GtkCssRecordedText GtkCssRecordedText;
+typedef struct _GtkCssCachedBlock GtkCssCachedBlock;
 typedef enum ParserScope ParserScope;
 typedef enum ParserSymbol ParserSymbol;
 
@@ -1176,10 +1180,38 @@ struct GtkCssRuleset
   PropertyValue *styles;
   GtkBitmask *set_styles;
   guint n_styles;
+  guint block; /* index + 1 of the declaration block when recording or
+                  not yet parsed from a cache, 0 otherwise */
   guint owns_styles : 1;
   guint owns_widget_style : 1;
 };
 
+/* While compiling a cache, the provider records the source text of
+ * everything it parses, so it can be parsed again on demand */
+struct _GtkCssRecording
+{
+  GPtrArray *files;
+  GPtrArray *colors;
+  GPtrArray *keyframes;
+  GPtrArray *bindings;
+  GPtrArray *blocks;
+};
+
+struct _GtkCssRecordedText
+{
+  char *name;
+  char *text;
+  char *base;
+};
+
+struct _GtkCssCachedBlock
+{
+  const char *text;
+  const char *base;
+  GtkCssRuleset ruleset;
+  guint parsed : 1;
+};
+
 struct _GtkCssScanner
 {
   GtkCssProvider *provider;
@@ -1199,6 +1231,10 @@ struct _GtkCssProviderPrivate
   GArray *rulesets;
   GtkCssSelectorTree *tree;
   GResource *resource;
+
+  GtkCssRecording *recording;
+  GVariant *cache;
+  GArray *cached_blocks;
 };
 
 enum {
@@ -1214,6 +1250,9 @@ static void gtk_css_provider_finalize (GObject *object);
 static void gtk_css_style_provider_iface_init (GtkStyleProviderIface *iface);
 static void gtk_css_style_provider_private_iface_init (GtkStyleProviderPrivateInterface *iface);
 static void widget_property_value_list_free (WidgetPropertyValue *head);
+static void gtk_css_provider_clear_cache (GtkCssProvider *css_provider);
+static void gtk_css_provider_realize_ruleset (GtkCssProvider *css_provider,
+                                              GtkCssRuleset  *ruleset);
 
 static gboolean
 gtk_css_provider_load_internal (GtkCssProvider *css_provider,
@@ -1263,6 +1302,8 @@ gtk_css_provider_parsing_error (GtkCssProvider  *provider,
 
 /* This is exported privately for use in GtkInspector.
  * It is the callers responsibility to reparse the current theme.
+ * Computed values only remember their sections after this was
+ * called, and style sheets are no longer loaded from caches.
  */
 void
 gtk_css_provider_set_keep_css_sections (void)
@@ -1270,6 +1311,12 @@ gtk_css_provider_set_keep_css_sections (void)
   gtk_keep_css_sections = TRUE;
 }
 
+gboolean
+gtk_css_provider_get_keep_css_sections (void)
+{
+  return gtk_keep_css_sections;
+}
+
 static void
 gtk_css_provider_class_init (GtkCssProviderClass *klass)
 {
@@ -1466,6 +1513,64 @@ gtk_css_ruleset_add (GtkCssRuleset       *ruleset,
     ruleset->styles[i].section = NULL;
 }
 
+static void
+gtk_css_recorded_text_free (GtkCssRecordedText *text)
+{
+  g_free (text->name);
+  g_free (text->text);
+  g_free (text->base);
+
+  g_slice_free (GtkCssRecordedText, text);
+}
+
+static GtkCssRecording *
+gtk_css_recording_new (void)
+{
+  GtkCssRecording *recording;
+
+  recording = g_slice_new (GtkCssRecording);
+
+  recording->files = g_ptr_array_new_with_free_func (g_object_unref);
+  recording->colors = g_ptr_array_new_with_free_func ((GDestroyNotify) gtk_css_recorded_text_free);
+  recording->keyframes = g_ptr_array_new_with_free_func ((GDestroyNotify) gtk_css_recorded_text_free);
+  recording->bindings = g_ptr_array_new_with_free_func ((GDestroyNotify) gtk_css_recorded_text_free);
+  recording->blocks = g_ptr_array_new_with_free_func ((GDestroyNotify) gtk_css_recorded_text_free);
+
+  return recording;
+}
+
+static void
+gtk_css_recording_free (GtkCssRecording *recording)
+{
+  g_ptr_array_unref (recording->files);
+  g_ptr_array_unref (recording->colors);
+  g_ptr_array_unref (recording->keyframes);
+  g_ptr_array_unref (recording->bindings);
+  g_ptr_array_unref (recording->blocks);
+
+  g_slice_free (GtkCssRecording, recording);
+}
+
+static void
+gtk_css_recording_add (GPtrArray    *array,
+                       const char   *name,
+                       const char   *start,
+                       const char   *end,
+                       GtkCssParser *parser)
+{
+  GtkCssRecordedText *text;
+  GFile *file;
+
+  text = g_slice_new (GtkCssRecordedText);
+
+  text->name = g_strdup (name ? name : "");
+  text->text = g_strndup (start, end - start);
+  file = _gtk_css_parser_get_file (parser);
+  text->base = file ? g_file_get_uri (file) : g_strdup ("");
+
+  g_ptr_array_add (array, text);
+}
+
 static void
 gtk_css_scanner_destroy (GtkCssScanner *scanner)
 {
@@ -1712,6 +1817,8 @@ gtk_css_provider_get_style_property (GtkStyleProvider *provider,
     {
       GtkCssRuleset *ruleset = tree_rules->pdata[i];
 
+      gtk_css_provider_realize_ruleset (css_provider, ruleset);
+
       if (ruleset->widget_style == NULL)
         continue;
 
@@ -1793,6 +1900,8 @@ gtk_css_style_provider_lookup (GtkStyleProviderPrivate *provider,
     {
       ruleset = tree_rules->pdata[i];
 
+      gtk_css_provider_realize_ruleset (css_provider, ruleset);
+
       if (ruleset->styles == NULL)
         continue;
 
@@ -1864,6 +1973,10 @@ gtk_css_provider_finalize (GObject *object)
   g_array_free (priv->rulesets, TRUE);
   _gtk_css_selector_tree_free (priv->tree);
 
+  gtk_css_provider_clear_cache (css_provider);
+  if (priv->recording)
+    gtk_css_recording_free (priv->recording);
+
   g_hash_table_destroy (priv->symbolic_colors);
   g_hash_table_destroy (priv->keyframes);
 
@@ -2003,6 +2116,7 @@ gtk_css_provider_reset (GtkCssProvider *css_provider)
   _gtk_css_selector_tree_free (priv->tree);
   priv->tree = NULL;
 
+  gtk_css_provider_clear_cache (css_provider);
 }
 
 static void
@@ -2106,6 +2220,7 @@ static gboolean
 parse_color_definition (GtkCssScanner *scanner)
 {
   GtkCssValue *color;
+  const char *start;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_COLOR_DEFINITION);
@@ -2129,6 +2244,7 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   color = _gtk_css_color_value_parse (scanner->parser);
   if (color == NULL)
     {
@@ -2138,6 +2254,11 @@ parse_color_definition (GtkCssScanner *scanner)
       return TRUE;
     }
 
+  if (scanner->provider->priv->recording)
+    gtk_css_recording_add (scanner->provider->priv->recording->colors,
+                           name, start, _gtk_css_parser_get_data (scanner->parser),
+                           scanner->parser);
+
   if (!_gtk_css_parser_try (scanner->parser, ";", TRUE))
     {
       g_free (name);
@@ -2222,6 +2343,12 @@ parse_binding_set (GtkCssScanner *scanner)
                                           GTK_CSS_PROVIDER_ERROR_SYNTAX,
                                           "Failed to parse binding set.");
         }
+      else if (scanner->provider->priv->recording)
+        {
+          gtk_css_recording_add (scanner->provider->priv->recording->bindings,
+                                 binding_set->set_name, name, name + strlen (name),
+                                 scanner->parser);
+        }
 
       g_free (name);
 
@@ -2271,6 +2398,7 @@ static gboolean
 parse_keyframes (GtkCssScanner *scanner)
 {
   GtkCssKeyframes *keyframes;
+  const char *start;
   char *name;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_KEYFRAMES);
@@ -2305,6 +2433,7 @@ parse_keyframes (GtkCssScanner *scanner)
       goto exit;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   keyframes = _gtk_css_keyframes_parse (scanner->parser);
   if (keyframes == NULL)
     {
@@ -2325,6 +2454,13 @@ parse_keyframes (GtkCssScanner *scanner)
       if (!_gtk_css_parser_is_eof (scanner->parser))
         _gtk_css_parser_resync (scanner->parser, FALSE, 0);
     }
+  else if (scanner->provider->priv->recording)
+    {
+      /* keep the closing brace, _gtk_css_keyframes_parse() needs it */
+      gtk_css_recording_add (scanner->provider->priv->recording->keyframes,
+                             name, start, _gtk_css_parser_get_data (scanner->parser),
+                             scanner->parser);
+    }
 
 exit:
   gtk_css_scanner_pop_section (scanner, GTK_CSS_SECTION_KEYFRAMES);
@@ -2556,6 +2692,7 @@ parse_ruleset (GtkCssScanner *scanner)
 {
   GSList *selectors;
   GtkCssRuleset ruleset = { 0, };
+  const char *start;
 
   gtk_css_scanner_push_section (scanner, GTK_CSS_SECTION_RULESET);
 
@@ -2579,8 +2716,18 @@ parse_ruleset (GtkCssScanner *scanner)
       return;
     }
 
+  start = _gtk_css_parser_get_data (scanner->parser);
   parse_declarations (scanner, &ruleset);
 
+  if (scanner->provider->priv->recording)
+    {
+      GPtrArray *blocks = scanner->provider->priv->recording->blocks;
+
+      gtk_css_recording_add (blocks, NULL, start, _gtk_css_parser_get_data (scanner->parser),
+                             scanner->parser);
+      ruleset.block = blocks->len;
+    }
+
   if (!_gtk_css_parser_try (scanner->parser, "}", TRUE))
     {
       gtk_css_provider_error_literal (scanner->provider,
@@ -2711,6 +2858,9 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
                                 NULL, &load_error))
         {
           text = free_data;
+
+          if (css_provider->priv->recording)
+            g_ptr_array_add (css_provider->priv->recording->files, g_object_ref (file));
         }
       else
         {
@@ -2765,6 +2915,592 @@ gtk_css_provider_load_internal (GtkCssProvider *css_provider,
   return TRUE;
 }
 
+/* CACHE
+ *
+ * A compiled stylesheet is stored next to the CSS file it was created
+ * from, with ".cache" appended to the name. It contains the selector
+ * tree with the rulesets in their final order, and the source text of
+ * every declaration block, color definition, keyframes and binding.
+ * Loading it skips tokenizing the stylesheet and its imports, parsing
+ * selectors and building the tree. Declaration blocks are only parsed
+ * the first time one of their rulesets matches.
+ *
+ * The cache is only used if all files it was created from still have
+ * the same contents. Modification times only have a resolution of a
+ * second here, which is not enough to notice an edit right after the
+ * cache was written, so we compare checksums. That is still much
+ * cheaper than parsing.
+ */
+
+#define GTK_CSS_CACHE_VERSION 2
+#define GTK_CSS_CACHE_TYPE "(uuua(sts)a(sss)a(sss)a(ss)a(ss)auasay)"
+#define GTK_CSS_CACHE_CHECKSUM G_CHECKSUM_SHA1
+
+static guint32
+gtk_css_cache_get_gtk_version (void)
+{
+  return (GTK_MAJOR_VERSION << 16) | (GTK_MINOR_VERSION << 8) | GTK_MICRO_VERSION;
+}
+
+static void
+gtk_css_provider_clear_cache (GtkCssProvider *css_provider)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  guint i;
+
+  if (priv->cached_blocks)
+    {
+      for (i = 0; i < priv->cached_blocks->len; i++)
+        gtk_css_ruleset_clear (&g_array_index (priv->cached_blocks, GtkCssCachedBlock, i).ruleset);
+      g_array_free (priv->cached_blocks, TRUE);
+      priv->cached_blocks = NULL;
+    }
+
+  if (priv->cache)
+    {
+      g_variant_unref (priv->cache);
+      priv->cache = NULL;
+    }
+}
+
+static const GtkCssRuleset *
+gtk_css_provider_get_cached_block (GtkCssProvider *css_provider,
+                                   guint           i)
+{
+  GtkCssCachedBlock *block;
+
+  block = &g_array_index (css_provider->priv->cached_blocks, GtkCssCachedBlock, i);
+
+  if (!block->parsed)
+    {
+      GtkCssScanner *scanner;
+      GFile *base;
+
+      base = block->base[0] ? g_file_new_for_uri (block->base) : NULL;
+      scanner = gtk_css_scanner_new (css_provider, NULL, NULL, base, block->text);
+
+      parse_declarations (scanner, &block->ruleset);
+
+      gtk_css_scanner_destroy (scanner);
+      if (base)
+        g_object_unref (base);
+
+      block->parsed = TRUE;
+    }
+
+  return &block->ruleset;
+}
+
+static void
+gtk_css_provider_realize_ruleset (GtkCssProvider *css_provider,
+                                  GtkCssRuleset  *ruleset)
+{
+  const GtkCssRuleset *block;
+
+  if (ruleset->block == 0 || css_provider->priv->cached_blocks == NULL)
+    return;
+
+  /* The block keeps ownership, like the first copy in css_provider_commit() */
+  block = gtk_css_provider_get_cached_block (css_provider, ruleset->block - 1);
+
+  ruleset->styles = block->styles;
+  ruleset->n_styles = block->n_styles;
+  ruleset->set_styles = block->set_styles ? _gtk_bitmask_copy (block->set_styles) : NULL;
+  ruleset->widget_style = block->widget_style;
+  ruleset->block = 0;
+}
+
+/* Returns the checksum of the contents of @file */
+static char *
+gtk_css_cache_checksum_file (GFile   *file,
+                             guint64 *size,
+                             GError **error)
+{
+  char *contents, *checksum;
+  gsize length;
+
+  if (!g_file_load_contents (file, NULL, &contents, &length, NULL, error))
+    return NULL;
+
+  checksum = g_compute_checksum_for_data (GTK_CSS_CACHE_CHECKSUM, (guchar *) contents, length);
+  *size = length;
+  g_free (contents);
+
+  return checksum;
+}
+
+static void
+gtk_css_cache_add_texts (GVariantBuilder *builder,
+                         GPtrArray       *texts,
+                         gboolean         with_name)
+{
+  guint i;
+
+  g_variant_builder_open (builder, G_VARIANT_TYPE (with_name ? "a(sss)" : "a(ss)"));
+  for (i = 0; i < texts->len; i++)
+    {
+      GtkCssRecordedText *text = g_ptr_array_index (texts, i);
+
+      if (with_name)
+        g_variant_builder_add (builder, "(sss)", text->name, text->text, text->base);
+      else
+        g_variant_builder_add (builder, "(ss)", text->text, text->base);
+    }
+  g_variant_builder_close (builder);
+}
+
+static GBytes *
+gtk_css_provider_serialize (GtkCssProvider  *css_provider,
+                            GError         **error)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GtkCssRecording *recording = priv->recording;
+  GVariantBuilder builder;
+  GVariant *variant;
+  GPtrArray *strings;
+  gpointer *matches;
+  GBytes *tree, *bytes;
+  guint i;
+
+  matches = g_new (gpointer, priv->rulesets->len);
+  for (i = 0; i < priv->rulesets->len; i++)
+    matches[i] = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+  strings = g_ptr_array_new ();
+
+  tree = _gtk_css_selector_tree_serialize (priv->tree, matches, priv->rulesets->len, strings);
+  g_free (matches);
+  if (tree == NULL)
+    {
+      g_set_error_literal (error, GTK_CSS_PROVIDER_ERROR, GTK_CSS_PROVIDER_ERROR_FAILED,
+                           "Failed to serialize selectors");
+      g_ptr_array_unref (strings);
+      return NULL;
+    }
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (GTK_CSS_CACHE_TYPE));
+  g_variant_builder_add (&builder, "u", GTK_CSS_CACHE_VERSION);
+  g_variant_builder_add (&builder, "u", gtk_css_cache_get_gtk_version ());
+  g_variant_builder_add (&builder, "u", (guint32) sizeof (gpointer));
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(sts)"));
+  for (i = 0; i < recording->files->len; i++)
+    {
+      GFile *file = g_ptr_array_index (recording->files, i);
+      char *uri, *checksum;
+      guint64 size;
+
+      checksum = gtk_css_cache_checksum_file (file, &size, error);
+      if (checksum == NULL)
+        {
+          g_variant_builder_clear (&builder);
+          g_ptr_array_unref (strings);
+          g_bytes_unref (tree);
+          return NULL;
+        }
+
+      uri = g_file_get_uri (file);
+      g_variant_builder_add (&builder, "(sts)", uri, size, checksum);
+      g_free (uri);
+      g_free (checksum);
+    }
+  g_variant_builder_close (&builder);
+
+  gtk_css_cache_add_texts (&builder, recording->colors, TRUE);
+  gtk_css_cache_add_texts (&builder, recording->keyframes, TRUE);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("a(ss)"));
+  for (i = 0; i < recording->bindings->len; i++)
+    {
+      GtkCssRecordedText *text = g_ptr_array_index (recording->bindings, i);
+
+      g_variant_builder_add (&builder, "(ss)", text->name, text->text);
+    }
+  g_variant_builder_close (&builder);
+
+  gtk_css_cache_add_texts (&builder, recording->blocks, FALSE);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("au"));
+  for (i = 0; i < priv->rulesets->len; i++)
+    {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      g_assert (ruleset->block > 0);
+      g_variant_builder_add (&builder, "u", ruleset->block - 1);
+    }
+  g_variant_builder_close (&builder);
+
+  g_variant_builder_open (&builder, G_VARIANT_TYPE ("as"));
+  for (i = 0; i < strings->len; i++)
+    g_variant_builder_add (&builder, "s", g_ptr_array_index (strings, i));
+  g_variant_builder_close (&builder);
+
+  g_variant_builder_add_value (&builder,
+                               g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                                          g_bytes_get_data (tree, NULL),
+                                                          g_bytes_get_size (tree),
+                                                          1));
+
+  variant = g_variant_ref_sink (g_variant_builder_end (&builder));
+  bytes = g_variant_get_data_as_bytes (variant);
+
+  g_variant_unref (variant);
+  g_ptr_array_unref (strings);
+  g_bytes_unref (tree);
+
+  return bytes;
+}
+
+/*
+ * _gtk_css_provider_compile:
+ * @file: the CSS file to compile
+ * @error: return location for a #GError, or %NULL
+ *
+ * Loads @file and everything it imports and returns the compiled form
+ * that GtkCssProvider loads instead of @file if it is saved next to
+ * it with ".cache" appended to the file name. The stylesheet must not
+ * contain errors.
+ *
+ * Returns: the contents of the cache file, or %NULL on error
+ */
+GBytes *
+_gtk_css_provider_compile (GFile   *file,
+                           GError **error)
+{
+  GtkCssProvider *css_provider;
+  GError *load_error = NULL;
+  GBytes *bytes;
+
+  g_return_val_if_fail (G_IS_FILE (file), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  css_provider = gtk_css_provider_new ();
+  css_provider->priv->recording = gtk_css_recording_new ();
+
+  if (!gtk_css_provider_load_internal (css_provider, NULL, file, NULL, &load_error))
+    {
+      g_propagate_error (error, load_error);
+      g_object_unref (css_provider);
+      return NULL;
+    }
+
+  bytes = gtk_css_provider_serialize (css_provider, error);
+
+  g_object_unref (css_provider);
+
+  return bytes;
+}
+
+static GBytes *
+gtk_css_cache_load_bytes (GFile *file)
+{
+  GBytes *bytes = NULL;
+  char *uri, *cache_uri;
+
+  uri = g_file_get_uri (file);
+  cache_uri = g_strconcat (uri, ".cache", NULL);
+
+  if (g_str_has_prefix (cache_uri, "resource://"))
+    {
+      char *path;
+
+      path = g_uri_unescape_string (cache_uri + strlen ("resource://"), NULL);
+      if (path)
+        bytes = g_resources_lookup_data (path, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+      g_free (path);
+    }
+  else
+    {
+      GFile *cache;
+      char *path;
+
+      cache = g_file_new_for_uri (cache_uri);
+      path = g_file_get_path (cache);
+      if (path)
+        {
+          GMappedFile *mapped;
+
+          mapped = g_mapped_file_new (path, FALSE, NULL);
+          if (mapped)
+            {
+              bytes = g_mapped_file_get_bytes (mapped);
+              g_mapped_file_unref (mapped);
+            }
+          g_free (path);
+        }
+      g_object_unref (cache);
+    }
+
+  g_free (cache_uri);
+  g_free (uri);
+
+  return bytes;
+}
+
+static gboolean
+gtk_css_cache_check_files (GVariant *files,
+                           GFile    *file)
+{
+  char *uri;
+  gsize i, n;
+
+  n = g_variant_n_children (files);
+  if (n == 0)
+    return FALSE;
+
+  for (i = 0; i < n; i++)
+    {
+      const char *file_uri, *file_checksum;
+      guint64 size, file_size;
+      GFile *dependency;
+      char *checksum;
+      gboolean valid;
+
+      g_variant_get_child (files, i, "(&st&s)", &file_uri, &file_size, &file_checksum);
+
+      /* The first file is the one the cache was created from */
+      if (i == 0)
+        {
+          uri = g_file_get_uri (file);
+          valid = g_str_equal (uri, file_uri);
+          g_free (uri);
+          if (!valid)
+            return FALSE;
+        }
+
+      dependency = g_file_new_for_uri (file_uri);
+      checksum = gtk_css_cache_checksum_file (dependency, &size, NULL);
+      g_object_unref (dependency);
+      if (checksum == NULL)
+        return FALSE;
+
+      valid = size == file_size && g_str_equal (checksum, file_checksum);
+      g_free (checksum);
+      if (!valid)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_cache_load_colors (GtkCssProvider *css_provider,
+                           GVariant       *colors)
+{
+  gsize i, n;
+
+  n = g_variant_n_children (colors);
+  for (i = 0; i < n; i++)
+    {
+      const char *name, *text, *base_uri;
+      GtkCssScanner *scanner;
+      GtkCssValue *color;
+      GFile *base;
+
+      g_variant_get_child (colors, i, "(&s&s&s)", &name, &text, &base_uri);
+
+      base = base_uri[0] ? g_file_new_for_uri (base_uri) : NULL;
+      scanner = gtk_css_scanner_new (css_provider, NULL, NULL, base, text);
+      color = _gtk_css_color_value_parse (scanner->parser);
+      gtk_css_scanner_destroy (scanner);
+      if (base)
+        g_object_unref (base);
+
+      if (color == NULL)
+        return FALSE;
+
+      g_hash_table_insert (css_provider->priv->symbolic_colors, g_strdup (name), color);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_cache_load_keyframes (GtkCssProvider *css_provider,
+                              GVariant       *keyframes)
+{
+  gsize i, n;
+
+  n = g_variant_n_children (keyframes);
+  for (i = 0; i < n; i++)
+    {
+      const char *name, *text, *base_uri;
+      GtkCssKeyframes *parsed;
+      GtkCssScanner *scanner;
+      GFile *base;
+
+      g_variant_get_child (keyframes, i, "(&s&s&s)", &name, &text, &base_uri);
+
+      base = base_uri[0] ? g_file_new_for_uri (base_uri) : NULL;
+      scanner = gtk_css_scanner_new (css_provider, NULL, NULL, base, text);
+      parsed = _gtk_css_keyframes_parse (scanner->parser);
+      gtk_css_scanner_destroy (scanner);
+      if (base)
+        g_object_unref (base);
+
+      if (parsed == NULL)
+        return FALSE;
+
+      g_hash_table_insert (css_provider->priv->keyframes, g_strdup (name), parsed);
+    }
+
+  return TRUE;
+}
+
+static void
+gtk_css_cache_load_bindings (GVariant *bindings)
+{
+  gsize i, n;
+
+  n = g_variant_n_children (bindings);
+  for (i = 0; i < n; i++)
+    {
+      GtkBindingSet *binding_set;
+      const char *name, *signal;
+
+      g_variant_get_child (bindings, i, "(&s&s)", &name, &signal);
+
+      binding_set = gtk_binding_set_find (name);
+      if (!binding_set)
+        {
+          binding_set = gtk_binding_set_new (name);
+          binding_set->parsed = TRUE;
+        }
+
+      gtk_binding_entry_add_signal_from_string (binding_set, signal);
+    }
+}
+
+static gboolean
+gtk_css_cache_load_rulesets (GtkCssProvider *css_provider,
+                             GVariant       *blocks,
+                             GVariant       *rulesets,
+                             GVariant       *strings,
+                             GVariant       *tree)
+{
+  GtkCssProviderPrivate *priv = css_provider->priv;
+  GtkCssSelectorTree **match_trees;
+  const guint32 *ruleset_blocks;
+  const char **string_table;
+  gconstpointer tree_data;
+  gpointer *matches;
+  gsize i, n_blocks, n_rulesets, n_strings, tree_size;
+  gboolean success;
+
+  n_blocks = g_variant_n_children (blocks);
+  ruleset_blocks = g_variant_get_fixed_array (rulesets, &n_rulesets, sizeof (guint32));
+  for (i = 0; i < n_rulesets; i++)
+    {
+      if (ruleset_blocks[i] >= n_blocks)
+        return FALSE;
+    }
+
+  g_array_set_size (priv->rulesets, n_rulesets);
+  memset (priv->rulesets->data, 0, n_rulesets * sizeof (GtkCssRuleset));
+
+  matches = g_new (gpointer, n_rulesets);
+  match_trees = g_new0 (GtkCssSelectorTree *, n_rulesets);
+  for (i = 0; i < n_rulesets; i++)
+    matches[i] = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+  string_table = g_variant_get_strv (strings, &n_strings);
+  tree_data = g_variant_get_fixed_array (tree, &tree_size, 1);
+
+  success = _gtk_css_selector_tree_deserialize (tree_data, tree_size,
+                                                string_table, n_strings,
+                                                matches, n_rulesets,
+                                                match_trees,
+                                                &priv->tree);
+
+  for (i = 0; success && i < n_rulesets; i++)
+    {
+      GtkCssRuleset *ruleset = matches[i];
+
+      /* every ruleset must be reachable from the tree */
+      if (match_trees[i] == NULL)
+        success = FALSE;
+
+      ruleset->selector_match = match_trees[i];
+      ruleset->block = ruleset_blocks[i] + 1;
+    }
+
+  g_free (string_table);
+  g_free (match_trees);
+  g_free (matches);
+
+  if (!success)
+    return FALSE;
+
+  priv->cached_blocks = g_array_sized_new (FALSE, TRUE, sizeof (GtkCssCachedBlock), n_blocks);
+  g_array_set_size (priv->cached_blocks, n_blocks);
+  for (i = 0; i < n_blocks; i++)
+    {
+      GtkCssCachedBlock *block = &g_array_index (priv->cached_blocks, GtkCssCachedBlock, i);
+
+      g_variant_get_child (blocks, i, "(&s&s)", &block->text, &block->base);
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_css_provider_load_cache (GtkCssProvider *css_provider,
+                             GFile          *file)
+{
+  GVariant *cache, *files, *colors, *keyframes, *bindings, *blocks, *rulesets, *strings, *tree;
+  guint32 version, gtk_version, pointer_size;
+  GBytes *bytes;
+  gboolean success;
+
+#ifdef VERIFY_TREE
+  /* verifying needs the selectors */
+  return FALSE;
+#endif
+
+  /* sections point into the source */
+  if (gtk_keep_css_sections)
+    return FALSE;
+
+  bytes = gtk_css_cache_load_bytes (file);
+  if (bytes == NULL)
+    return FALSE;
+
+  cache = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (GTK_CSS_CACHE_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (cache, "(uuu@a(sts)@a(sss)@a(sss)@a(ss)@a(ss)@au@as@ay)",
+                 &version, &gtk_version, &pointer_size,
+                 &files, &colors, &keyframes, &bindings, &blocks, &rulesets, &strings, &tree);
+
+  success = version == GTK_CSS_CACHE_VERSION &&
+            gtk_version == gtk_css_cache_get_gtk_version () &&
+            pointer_size == sizeof (gpointer) &&
+            gtk_css_cache_check_files (files, file) &&
+            gtk_css_cache_load_colors (css_provider, colors) &&
+            gtk_css_cache_load_keyframes (css_provider, keyframes) &&
+            gtk_css_cache_load_rulesets (css_provider, blocks, rulesets, strings, tree);
+
+  if (success)
+    {
+      gtk_css_cache_load_bindings (bindings);
+      /* the cached blocks point into the cache */
+      css_provider->priv->cache = g_variant_ref (cache);
+    }
+  else
+    gtk_css_provider_reset (css_provider);
+
+  g_variant_unref (files);
+  g_variant_unref (colors);
+  g_variant_unref (keyframes);
+  g_variant_unref (bindings);
+  g_variant_unref (blocks);
+  g_variant_unref (rulesets);
+  g_variant_unref (strings);
+  g_variant_unref (tree);
+  g_variant_unref (cache);
+
+  return success;
+}
+
 /**
  * gtk_css_provider_load_from_data:
  * @css_provider: a #GtkCssProvider
@@ -2842,7 +3578,10 @@ gtk_css_provider_load_from_file (GtkCssProvider  *css_provider,
 
   gtk_css_provider_reset (css_provider);
 
-  success = gtk_css_provider_load_internal (css_provider, NULL, file, NULL, error);
+  if (gtk_css_provider_load_cache (css_provider, file))
+    success = TRUE;
+  else
+    success = gtk_css_provider_load_internal (css_provider, NULL, file, NULL, error);
 
   _gtk_style_provider_private_changed (GTK_STYLE_PROVIDER_PRIVATE (css_provider));
 
@@ -3268,9 +4007,13 @@ gtk_css_provider_to_string (GtkCssProvider *provider)
 
   for (i = 0; i < priv->rulesets->len; i++)
     {
+      GtkCssRuleset *ruleset = &g_array_index (priv->rulesets, GtkCssRuleset, i);
+
+      gtk_css_provider_realize_ruleset (provider, ruleset);
+
       if (str->len != 0)
         g_string_append (str, "\n");
-      gtk_css_ruleset_print (&g_array_index (priv->rulesets, GtkCssRuleset, i), str);
+      gtk_css_ruleset_print (ruleset, str);
     }
 
   return g_string_free (str, FALSE);
@@ -29,6 +29,12 @@ void   _gtk_css_provider_load_named    (GtkCssProvider *provider,
                                         const gchar    *variant);
 
 void   gtk_css_provider_set_keep_css_sections (void);
+gboolean gtk_css_provider_get_keep_css_sections (void);
+
+/* Used by gtk-compile-css */
+GDK_AVAILABLE_IN_ALL
+GBytes *_gtk_css_provider_compile      (GFile          *file,
+                                        GError        **error);
 
 G_END_DECLS
 
@@ -232,12 +232,18 @@ gtk_css_selector_descendant_print (const GtkCssSelector *selector,
   g_string_append_c (string, ' ');
 }
 
+static gboolean gtk_css_selector_may_match_ancestor (const GtkCssSelector *selector,
+                                                     const GtkCssMatcher  *matcher);
+
 static gboolean
 gtk_css_selector_descendant_match (const GtkCssSelector *selector,
                                    const GtkCssMatcher  *matcher)
 {
   GtkCssMatcher ancestor;
 
+  if (!gtk_css_selector_may_match_ancestor (gtk_css_selector_previous (selector), matcher))
+    return FALSE;
+
   while (_gtk_css_matcher_get_parent (&ancestor, matcher))
     {
       matcher = &ancestor;
@@ -254,13 +260,36 @@ gtk_css_selector_descendant_tree_match (const GtkCssSelectorTree *tree,
 					const GtkCssMatcher  *matcher,
 					GHashTable *res)
 {
+  const GtkCssSelectorTree *prev;
+  const GtkCssMatcher *element;
   GtkCssMatcher ancestor;
 
+  /* Check the ancestor filter first, most descendant rules are about
+   * classes or types that aren't anywhere in the path */
+  for (prev = gtk_css_selector_tree_get_previous (tree);
+       prev != NULL;
+       prev = gtk_css_selector_tree_get_sibling (prev))
+    {
+      if (gtk_css_selector_may_match_ancestor (&prev->selector, matcher))
+        break;
+    }
+
+  if (prev == NULL)
+    return;
+
+  element = matcher;
+
   while (_gtk_css_matcher_get_parent (&ancestor, matcher))
     {
       matcher = &ancestor;
 
-      gtk_css_selector_tree_match_previous (tree, matcher, res);
+      for (prev = gtk_css_selector_tree_get_previous (tree);
+           prev != NULL;
+           prev = gtk_css_selector_tree_get_sibling (prev))
+        {
+          if (gtk_css_selector_may_match_ancestor (&prev->selector, element))
+            gtk_css_selector_tree_match (prev, matcher, res);
+        }
 
       /* any matchers are dangerous here, as we may loop forever, but
 	 we can terminate now as all possible matches have already been added */
@@ -1094,6 +1123,23 @@ static const GtkCssSelectorClass GTK_CSS_SELECTOR_ID = {
   TRUE, FALSE, FALSE, TRUE, FALSE
 };
 
+/* Whether @selector might match any of the ancestors of @matcher.
+ * This only consults the matcher's ancestor filter, so it can only
+ * rule out selectors looking for a type, class or id. */
+static gboolean
+gtk_css_selector_may_match_ancestor (const GtkCssSelector *selector,
+                                     const GtkCssMatcher  *matcher)
+{
+  if (selector->class == &GTK_CSS_SELECTOR_NAME)
+    return _gtk_css_matcher_may_have_ancestor_type (matcher, ((TypeReference *)selector->data)->type);
+  else if (selector->class == &GTK_CSS_SELECTOR_CLASS)
+    return _gtk_css_matcher_may_have_ancestor_class (matcher, GPOINTER_TO_UINT (selector->data));
+  else if (selector->class == &GTK_CSS_SELECTOR_ID)
+    return _gtk_css_matcher_may_have_ancestor_id (matcher, selector->data);
+  else
+    return TRUE;
+}
+
 /* PSEUDOCLASS FOR STATE */
 
 static void
@@ -2498,3 +2544,376 @@ _gtk_css_selector_tree_builder_build (GtkCssSelectorTreeBuilder *builder)
 
   return tree;
 }
+
+/* SERIALIZATION
+ *
+ * The tree is a single block of memory using relative offsets, so it can
+ * be written out nearly as is. Only the pointers need replacing: the
+ * selector class becomes an index into the table below, names become
+ * indexes into a string table and matches become indexes into the array
+ * of matches passed in.
+ * Changing the table requires bumping the version of the cache format.
+ */
+
+static const GtkCssSelectorClass *serialized_classes[] = {
+  &GTK_CSS_SELECTOR_DESCENDANT,
+  &GTK_CSS_SELECTOR_CHILD,
+  &GTK_CSS_SELECTOR_SIBLING,
+  &GTK_CSS_SELECTOR_ADJACENT,
+  &GTK_CSS_SELECTOR_ANY,
+  &GTK_CSS_SELECTOR_NAME,
+  &GTK_CSS_SELECTOR_REGION,
+  &GTK_CSS_SELECTOR_CLASS,
+  &GTK_CSS_SELECTOR_ID,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_STATE,
+  &GTK_CSS_SELECTOR_PSEUDOCLASS_POSITION
+};
+
+static gboolean
+gtk_css_selector_class_has_string (const GtkCssSelectorClass *class)
+{
+  return class == &GTK_CSS_SELECTOR_NAME ||
+         class == &GTK_CSS_SELECTOR_REGION ||
+         class == &GTK_CSS_SELECTOR_CLASS ||
+         class == &GTK_CSS_SELECTOR_ID;
+}
+
+static const char *
+gtk_css_selector_get_string (const GtkCssSelector *selector)
+{
+  if (selector->class == &GTK_CSS_SELECTOR_NAME)
+    return ((TypeReference *)selector->data)->name;
+  else if (selector->class == &GTK_CSS_SELECTOR_CLASS)
+    return g_quark_to_string (GPOINTER_TO_UINT (selector->data));
+  else
+    return selector->data;
+}
+
+static gconstpointer
+gtk_css_selector_data_from_string (const GtkCssSelectorClass *class,
+                                   const char                *string)
+{
+  if (class == &GTK_CSS_SELECTOR_NAME)
+    return get_type_reference (string);
+  else if (class == &GTK_CSS_SELECTOR_CLASS)
+    return GUINT_TO_POINTER (g_quark_from_string (string));
+  else
+    return g_intern_string (string);
+}
+
+static gsize
+gtk_css_selector_tree_get_size (const GtkCssSelectorTree *tree,
+                                const guint8             *data)
+{
+  gsize size = 0;
+
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    {
+      gpointer *matches;
+      gsize end;
+
+      end = (const guint8 *) (tree + 1) - data;
+      size = MAX (size, end);
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          while (*matches)
+            matches++;
+          end = (const guint8 *) (matches + 1) - data;
+          size = MAX (size, end);
+        }
+
+      end = gtk_css_selector_tree_get_size (gtk_css_selector_tree_get_previous (tree), data);
+      size = MAX (size, end);
+    }
+
+  return size;
+}
+
+static gboolean
+gtk_css_selector_tree_encode (GtkCssSelectorTree *tree,
+                              GHashTable         *match_ids,
+                              GHashTable         *string_ids,
+                              GPtrArray          *strings)
+{
+  for (; tree != NULL; tree = (GtkCssSelectorTree *) gtk_css_selector_tree_get_sibling (tree))
+    {
+      gpointer *matches;
+      guint i;
+
+      for (i = 0; i < G_N_ELEMENTS (serialized_classes); i++)
+        {
+          if (serialized_classes[i] == tree->selector.class)
+            break;
+        }
+      if (i == G_N_ELEMENTS (serialized_classes))
+        return FALSE;
+
+      if (gtk_css_selector_class_has_string (tree->selector.class))
+        {
+          const char *string = gtk_css_selector_get_string (&tree->selector);
+          gpointer id;
+
+          if (!g_hash_table_lookup_extended (string_ids, string, NULL, &id))
+            {
+              id = GUINT_TO_POINTER (strings->len);
+              g_hash_table_insert (string_ids, (gpointer) string, id);
+              g_ptr_array_add (strings, (gpointer) string);
+            }
+          tree->selector.data = id;
+        }
+      tree->selector.class = GUINT_TO_POINTER (i);
+
+      matches = gtk_css_selector_tree_get_matches (tree);
+      if (matches)
+        {
+          for (; *matches; matches++)
+            {
+              *matches = g_hash_table_lookup (match_ids, *matches);
+              if (*matches == NULL)
+                return FALSE;
+            }
+        }
+
+      if (!gtk_css_selector_tree_encode ((GtkCssSelectorTree *) gtk_css_selector_tree_get_previous (tree),
+                                         match_ids, string_ids, strings))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * _gtk_css_selector_tree_serialize:
+ * @tree: (allow-none): the tree to serialize
+ * @matches: the array of all match pointers used when building @tree
+ * @n_matches: the number of elements in @matches
+ * @strings: a #GPtrArray the names used by the tree are appended to
+ *
+ * Serializes @tree into a form that can be loaded again with
+ * _gtk_css_selector_tree_deserialize() by a process with the same
+ * GTK+ version and architecture.
+ *
+ * Returns: the serialized tree, or %NULL if the tree contains
+ *     matches not in @matches
+ */
+GBytes *
+_gtk_css_selector_tree_serialize (const GtkCssSelectorTree *tree,
+                                  gpointer                 *matches,
+                                  guint                     n_matches,
+                                  GPtrArray                *strings)
+{
+  GHashTable *match_ids, *string_ids;
+  GtkCssSelectorTree *copy;
+  gboolean success;
+  gsize size;
+  guint i;
+
+  if (tree == NULL)
+    return g_bytes_new (NULL, 0);
+
+  match_ids = g_hash_table_new (NULL, NULL);
+  for (i = 0; i < n_matches; i++)
+    g_hash_table_insert (match_ids, matches[i], GUINT_TO_POINTER (i + 1));
+  string_ids = g_hash_table_new (g_str_hash, g_str_equal);
+
+  size = gtk_css_selector_tree_get_size (tree, (const guint8 *) tree);
+  copy = g_memdup (tree, size);
+
+  success = gtk_css_selector_tree_encode (copy, match_ids, string_ids, strings);
+
+  g_hash_table_unref (string_ids);
+  g_hash_table_unref (match_ids);
+
+  if (!success)
+    {
+      g_free (copy);
+      return NULL;
+    }
+
+  return g_bytes_new_take (copy, size);
+}
+
+typedef struct {
+  guint8 *data;
+  gsize size;
+  guint8 *nodes;
+  const char * const *strings;
+  guint n_strings;
+  gpointer *matches;
+  guint n_matches;
+  GtkCssSelectorTree **match_trees;
+} TreeDecoder;
+
+static gboolean
+tree_decoder_check_offset (TreeDecoder *decoder,
+                           gsize        offset,
+                           gsize        size)
+{
+  return offset % sizeof (gpointer) == 0 &&
+         offset < decoder->size &&
+         size <= decoder->size - offset;
+}
+
+/* previous, sibling and matches offsets always point forward, so the
+ * walk can't loop even on corrupted data */
+static gboolean
+gtk_css_selector_tree_decode (TreeDecoder *decoder,
+                              gsize        offset)
+{
+  while (TRUE)
+    {
+      GtkCssSelectorTree *tree;
+      const GtkCssSelectorClass *class;
+      gsize index;
+
+      if (!tree_decoder_check_offset (decoder, offset, sizeof (GtkCssSelectorTree)))
+        return FALSE;
+
+      tree = (GtkCssSelectorTree *) (decoder->data + offset);
+      decoder->nodes[offset / sizeof (gpointer)] = TRUE;
+
+      index = GPOINTER_TO_SIZE (tree->selector.class);
+      if (index >= G_N_ELEMENTS (serialized_classes))
+        return FALSE;
+      class = serialized_classes[index];
+      tree->selector.class = class;
+
+      if (gtk_css_selector_class_has_string (class))
+        {
+          index = GPOINTER_TO_SIZE (tree->selector.data);
+          if (index >= decoder->n_strings)
+            return FALSE;
+          tree->selector.data = gtk_css_selector_data_from_string (class, decoder->strings[index]);
+        }
+
+      if (tree->matches_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          gsize match_offset;
+          gpointer *matches;
+
+          if (tree->matches_offset <= 0)
+            return FALSE;
+
+          match_offset = offset + tree->matches_offset;
+          do
+            {
+              if (!tree_decoder_check_offset (decoder, match_offset, sizeof (gpointer)))
+                return FALSE;
+
+              matches = (gpointer *) (decoder->data + match_offset);
+              if (*matches)
+                {
+                  index = GPOINTER_TO_SIZE (*matches) - 1;
+                  if (index >= decoder->n_matches)
+                    return FALSE;
+                  *matches = decoder->matches[index];
+                  if (decoder->match_trees)
+                    decoder->match_trees[index] = tree;
+                }
+              match_offset += sizeof (gpointer);
+            }
+          while (*matches);
+        }
+
+      if (tree->previous_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          if (tree->previous_offset <= 0 ||
+              !gtk_css_selector_tree_decode (decoder, offset + tree->previous_offset))
+            return FALSE;
+        }
+
+      if (tree->sibling_offset == GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        return TRUE;
+
+      if (tree->sibling_offset <= 0)
+        return FALSE;
+
+      offset += tree->sibling_offset;
+    }
+}
+
+static gboolean
+gtk_css_selector_tree_check_parents (TreeDecoder              *decoder,
+                                     const GtkCssSelectorTree *tree)
+{
+  for (; tree != NULL; tree = gtk_css_selector_tree_get_sibling (tree))
+    {
+      if (tree->parent_offset != GTK_CSS_SELECTOR_TREE_EMPTY_OFFSET)
+        {
+          gssize parent = ((const guint8 *) tree - decoder->data) + (gssize) tree->parent_offset;
+
+          if (parent < 0 || (gsize) parent >= decoder->size ||
+              parent % sizeof (gpointer) != 0 ||
+              !decoder->nodes[parent / sizeof (gpointer)])
+            return FALSE;
+        }
+
+      if (!gtk_css_selector_tree_check_parents (decoder, gtk_css_selector_tree_get_previous (tree)))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/*
+ * _gtk_css_selector_tree_deserialize:
+ * @data: data from _gtk_css_selector_tree_serialize()
+ * @size: size of @data
+ * @strings: the string table passed to _gtk_css_selector_tree_serialize()
+ * @n_strings: number of elements in @strings
+ * @matches: the pointers to use for the serialized matches
+ * @n_matches: number of elements in @matches
+ * @match_trees: (allow-none): array of size @n_matches to store the
+ *     tree node matching each element of @matches in
+ * @tree: (out): return location for the tree
+ *
+ * Loads a tree serialized with _gtk_css_selector_tree_serialize(). The
+ * data is checked to be consistent, so it's safe to use on corrupted
+ * files.
+ *
+ * Returns: %TRUE if the tree could be loaded
+ */
+gboolean
+_gtk_css_selector_tree_deserialize (gconstpointer         data,
+                                    gsize                 size,
+                                    const char * const   *strings,
+                                    guint                 n_strings,
+                                    gpointer             *matches,
+                                    guint                 n_matches,
+                                    GtkCssSelectorTree  **match_trees,
+                                    GtkCssSelectorTree  **tree)
+{
+  TreeDecoder decoder;
+  gboolean success;
+
+  if (size == 0)
+    {
+      *tree = NULL;
+      return TRUE;
+    }
+
+  decoder.data = g_memdup (data, size);
+  decoder.size = size;
+  decoder.nodes = g_malloc0 (size / sizeof (gpointer) + 1);
+  decoder.strings = strings;
+  decoder.n_strings = n_strings;
+  decoder.matches = matches;
+  decoder.n_matches = n_matches;
+  decoder.match_trees = match_trees;
+
+  success = gtk_css_selector_tree_decode (&decoder, 0) &&
+            gtk_css_selector_tree_check_parents (&decoder, (GtkCssSelectorTree *) decoder.data);
+
+  g_free (decoder.nodes);
+
+  if (!success)
+    {
+      g_free (decoder.data);
+      return FALSE;
+    }
+
+  *tree = (GtkCssSelectorTree *) decoder.data;
+  return TRUE;
+}
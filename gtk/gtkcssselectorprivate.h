@@ -48,6 +48,19 @@ void         _gtk_css_selector_tree_match_print      (const GtkCssSelectorTree *
 						      GString                  *str);
 GtkCssChange _gtk_css_selector_tree_match_get_change (const GtkCssSelectorTree *tree);
 
+GBytes *     _gtk_css_selector_tree_serialize        (const GtkCssSelectorTree *tree,
+                                                      gpointer                 *matches,
+                                                      guint                     n_matches,
+                                                      GPtrArray                *strings);
+gboolean     _gtk_css_selector_tree_deserialize      (gconstpointer             data,
+                                                      gsize                     size,
+                                                      const char * const       *strings,
+                                                      guint                     n_strings,
+                                                      gpointer                 *matches,
+                                                      guint                     n_matches,
+                                                      GtkCssSelectorTree      **match_trees,
+                                                      GtkCssSelectorTree      **tree);
+
 
 GtkCssSelectorTreeBuilder *_gtk_css_selector_tree_builder_new   (void);
 void                       _gtk_css_selector_tree_builder_add   (GtkCssSelectorTreeBuilder *builder,
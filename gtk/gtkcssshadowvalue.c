@@ -25,6 +25,7 @@
 #include "gtkcsscolorvalueprivate.h"
 #include "gtkcssnumbervalueprivate.h"
 #include "gtkcssrgbavalueprivate.h"
+#include "gtkdebug.h"
 #include "gtkstylecontextprivate.h"
 #include "gtkpango.h"
 
@@ -520,6 +521,407 @@ draw_shadow (const GtkCssValue   *shadow,
     gtk_css_shadow_value_finish_drawing (shadow, shadow_cr);
 }
 
+/* Blurred outset shadows are rendered in 9 parts (see
+ * _gtk_css_shadow_value_paint_box()). The 4 corners and 4 sides only
+ * depend on the blur radius and the corner radii, so we render them
+ * once into an A8 mask and keep that around. The color is applied when
+ * compositing the mask, so it is not part of the key.
+ */
+#define SHADOW_MASK_CACHE_SIZE 64
+
+typedef struct {
+  double radius;
+  GtkRoundedBoxCorner corner;
+  guint side : 1;
+} ShadowMaskKey;
+
+typedef struct {
+  ShadowMaskKey key;
+  cairo_surface_t *mask;
+  GList link;
+} ShadowMask;
+
+static GHashTable *shadow_mask_cache = NULL;
+static GQueue shadow_mask_lru = G_QUEUE_INIT;
+static guint shadow_mask_hits = 0;
+static guint shadow_mask_misses = 0;
+
+static guint
+shadow_mask_key_hash (gconstpointer data)
+{
+  const ShadowMaskKey *key = data;
+
+  return ((guint) (key->radius * 64))
+       ^ ((guint) (key->corner.horizontal * 64) << 10)
+       ^ ((guint) (key->corner.vertical * 64) << 20)
+       ^ key->side;
+}
+
+static gboolean
+shadow_mask_key_equal (gconstpointer data1,
+                       gconstpointer data2)
+{
+  const ShadowMaskKey *key1 = data1;
+  const ShadowMaskKey *key2 = data2;
+
+  return key1->radius == key2->radius
+      && key1->corner.horizontal == key2->corner.horizontal
+      && key1->corner.vertical == key2->corner.vertical
+      && key1->side == key2->side;
+}
+
+static void
+shadow_mask_free (gpointer data)
+{
+  ShadowMask *entry = data;
+
+  cairo_surface_destroy (entry->mask);
+  g_slice_free (ShadowMask, entry);
+}
+
+static cairo_surface_t *
+shadow_mask_cache_lookup (const ShadowMaskKey *key)
+{
+  ShadowMask *entry;
+
+  if (shadow_mask_cache == NULL)
+    return NULL;
+
+  entry = g_hash_table_lookup (shadow_mask_cache, key);
+  if (entry == NULL)
+    return NULL;
+
+  /* Move to the front of the LRU list */
+  g_queue_unlink (&shadow_mask_lru, &entry->link);
+  g_queue_push_head_link (&shadow_mask_lru, &entry->link);
+  shadow_mask_hits++;
+
+  return entry->mask;
+}
+
+static void
+shadow_mask_cache_insert (const ShadowMaskKey *key,
+                          cairo_surface_t     *mask)
+{
+  ShadowMask *entry;
+
+  if (shadow_mask_cache == NULL)
+    shadow_mask_cache = g_hash_table_new_full (shadow_mask_key_hash,
+                                               shadow_mask_key_equal,
+                                               NULL,
+                                               shadow_mask_free);
+
+  while (shadow_mask_lru.length >= SHADOW_MASK_CACHE_SIZE)
+    {
+      GList *last = g_queue_pop_tail_link (&shadow_mask_lru);
+      ShadowMask *evicted = last->data;
+
+      g_hash_table_remove (shadow_mask_cache, &evicted->key);
+    }
+
+  entry = g_slice_new0 (ShadowMask);
+  entry->key = *key;
+  entry->mask = mask;
+  entry->link.data = entry;
+  g_queue_push_head_link (&shadow_mask_lru, &entry->link);
+  g_hash_table_insert (shadow_mask_cache, &entry->key, entry);
+
+  shadow_mask_misses++;
+
+  GTK_NOTE (MISC,
+            g_message ("shadow mask cache miss (radius %g, corner %gx%g%s): %u hits, %u misses",
+                       key->radius, key->corner.horizontal, key->corner.vertical,
+                       key->side ? ", side" : "",
+                       shadow_mask_hits, shadow_mask_misses));
+}
+
+/* Draws the corner of an outset shadow from the cached mask. The mask
+ * is rendered for the top left corner with the box edges at clip_radius,
+ * other corners are drawn by mirroring it.
+ */
+static void
+draw_shadow_corner (const GtkCssValue     *shadow,
+                    cairo_t               *cr,
+                    GtkRoundedBox         *box,
+                    GtkRoundedBox         *clip_box,
+                    GtkCssCorner           corner,
+                    cairo_rectangle_int_t *drawn_rect)
+{
+  gdouble radius, clip_radius;
+  int x1, x2, x3, y1, y2, y3;
+  double sx, sy, x0, y0, max_other;
+  gboolean overlapped;
+  GtkRoundedBox corner_box;
+  ShadowMaskKey key;
+  cairo_surface_t *mask;
+  cairo_pattern_t *pattern;
+  cairo_matrix_t matrix;
+  cairo_t *mask_cr;
+
+  radius = _gtk_css_number_value_get (shadow->radius, 0);
+  clip_radius = _gtk_cairo_blur_compute_pixels (radius);
+
+  overlapped = FALSE;
+  if (corner == GTK_CSS_TOP_LEFT || corner == GTK_CSS_BOTTOM_LEFT)
+    {
+      x1 = floor (box->box.x - clip_radius);
+      x2 = ceil (box->box.x + box->corner[corner].horizontal + clip_radius);
+      sx = 1;
+      x0 = - (box->box.x - clip_radius);
+      max_other = MAX (box->corner[GTK_CSS_TOP_RIGHT].horizontal, box->corner[GTK_CSS_BOTTOM_RIGHT].horizontal);
+      x3 = floor (box->box.x + box->box.width - max_other - clip_radius);
+      if (x2 > x3)
+        overlapped = TRUE;
+    }
+  else
+    {
+      x1 = floor (box->box.x + box->box.width - box->corner[corner].horizontal - clip_radius);
+      x2 = ceil (box->box.x + box->box.width + clip_radius);
+      sx = -1;
+      x0 = box->box.x + box->box.width + clip_radius;
+      max_other = MAX (box->corner[GTK_CSS_TOP_LEFT].horizontal, box->corner[GTK_CSS_BOTTOM_LEFT].horizontal);
+      x3 = ceil (box->box.x + max_other + clip_radius);
+      if (x3 > x1)
+        overlapped = TRUE;
+    }
+
+  if (corner == GTK_CSS_TOP_LEFT || corner == GTK_CSS_TOP_RIGHT)
+    {
+      y1 = floor (box->box.y - clip_radius);
+      y2 = ceil (box->box.y + box->corner[corner].vertical + clip_radius);
+      sy = 1;
+      y0 = - (box->box.y - clip_radius);
+      max_other = MAX (box->corner[GTK_CSS_BOTTOM_LEFT].vertical, box->corner[GTK_CSS_BOTTOM_RIGHT].vertical);
+      y3 = floor (box->box.y + box->box.height - max_other - clip_radius);
+      if (y2 > y3)
+        overlapped = TRUE;
+    }
+  else
+    {
+      y1 = floor (box->box.y + box->box.height - box->corner[corner].vertical - clip_radius);
+      y2 = ceil (box->box.y + box->box.height + clip_radius);
+      sy = -1;
+      y0 = box->box.y + box->box.height + clip_radius;
+      max_other = MAX (box->corner[GTK_CSS_TOP_LEFT].vertical, box->corner[GTK_CSS_TOP_RIGHT].vertical);
+      y3 = ceil (box->box.y + max_other + clip_radius);
+      if (y3 > y1)
+        overlapped = TRUE;
+    }
+
+  drawn_rect->x = x1;
+  drawn_rect->y = y1;
+  drawn_rect->width = x2 - x1;
+  drawn_rect->height = y2 - y1;
+
+  cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
+  cairo_clip (cr);
+
+  if (shadow->inset || overlapped || clip_radius < 1)
+    {
+      /* Fall back to the generic path if the blur of this corner
+       * reaches the other corners */
+      draw_shadow (shadow, cr, box, clip_box, TRUE);
+      return;
+    }
+
+  if (has_empty_clip (cr))
+    return;
+
+  key.radius = radius;
+  key.corner = box->corner[corner];
+  key.side = FALSE;
+
+  mask = shadow_mask_cache_lookup (&key);
+  if (mask == NULL)
+    {
+      int width, height;
+
+      /* Large enough for any pixel alignment of the corner, plus
+       * clip_radius so the edge of the surface does not show in the blur */
+      width = ceil (key.corner.horizontal) + 3 * clip_radius + 2;
+      height = ceil (key.corner.vertical) + 3 * clip_radius + 2;
+
+      mask = cairo_surface_create_similar_image (cairo_get_target (cr),
+                                                 CAIRO_FORMAT_A8,
+                                                 width, height);
+      mask_cr = cairo_create (mask);
+      _gtk_rounded_box_init_rect (&corner_box, clip_radius, clip_radius, 2 * width, 2 * height);
+      corner_box.corner[GTK_CSS_TOP_LEFT] = key.corner;
+      _gtk_rounded_box_path (&corner_box, mask_cr);
+      cairo_fill (mask_cr);
+      cairo_destroy (mask_cr);
+
+      _gtk_cairo_blur_surface (mask, radius);
+
+      shadow_mask_cache_insert (&key, mask);
+    }
+
+  gdk_cairo_set_source_rgba (cr, _gtk_css_rgba_value_get_rgba (shadow->color));
+  pattern = cairo_pattern_create_for_surface (mask);
+  cairo_matrix_init (&matrix, sx, 0, 0, sy, x0, y0);
+  cairo_pattern_set_matrix (pattern, &matrix);
+  cairo_mask (cr, pattern);
+  cairo_pattern_destroy (pattern);
+}
+
+/* Draws the straight part of a side of an outset shadow. The blur only
+ * varies perpendicular to the edge there, so we cache a single column
+ * of the blurred edge and stretch it along the side.
+ */
+static void
+draw_shadow_side (const GtkCssValue     *shadow,
+                  cairo_t               *cr,
+                  GtkRoundedBox         *box,
+                  GtkRoundedBox         *clip_box,
+                  GtkCssSide             side,
+                  cairo_rectangle_int_t *drawn_rect)
+{
+  gdouble radius, clip_radius;
+  int x1, x2, y1, y2;
+  double max_other;
+  gboolean overlapped;
+  ShadowMaskKey key;
+  cairo_surface_t *mask;
+  cairo_pattern_t *pattern;
+  cairo_matrix_t matrix;
+  cairo_t *mask_cr;
+  guint i;
+
+  radius = _gtk_css_number_value_get (shadow->radius, 0);
+  clip_radius = _gtk_cairo_blur_compute_pixels (radius);
+
+  if (side == GTK_CSS_TOP || side == GTK_CSS_BOTTOM)
+    {
+      x1 = floor (box->box.x - clip_radius);
+      x2 = ceil (box->box.x + box->box.width + clip_radius);
+    }
+  else if (side == GTK_CSS_LEFT)
+    {
+      x1 = floor (box->box.x - clip_radius);
+      x2 = ceil (box->box.x + clip_radius);
+    }
+  else
+    {
+      x1 = floor (box->box.x + box->box.width - clip_radius);
+      x2 = ceil (box->box.x + box->box.width + clip_radius);
+    }
+
+  if (side == GTK_CSS_LEFT || side == GTK_CSS_RIGHT)
+    {
+      y1 = floor (box->box.y - clip_radius);
+      y2 = ceil (box->box.y + box->box.height + clip_radius);
+    }
+  else if (side == GTK_CSS_TOP)
+    {
+      y1 = floor (box->box.y - clip_radius);
+      y2 = ceil (box->box.y + clip_radius);
+    }
+  else
+    {
+      y1 = floor (box->box.y + box->box.height - clip_radius);
+      y2 = ceil (box->box.y + box->box.height + clip_radius);
+    }
+
+  drawn_rect->x = x1;
+  drawn_rect->y = y1;
+  drawn_rect->width = x2 - x1;
+  drawn_rect->height = y2 - y1;
+
+  cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
+  cairo_clip (cr);
+
+  /* The strip must not be reached by the blur of the opposite side */
+  max_other = 0;
+  for (i = 0; i < 4; i++)
+    {
+      if (side == GTK_CSS_TOP || side == GTK_CSS_BOTTOM)
+        max_other = MAX (max_other, box->corner[i].vertical);
+      else
+        max_other = MAX (max_other, box->corner[i].horizontal);
+    }
+
+  if (side == GTK_CSS_TOP || side == GTK_CSS_BOTTOM)
+    overlapped = box->box.height - max_other < 2 * clip_radius + 2;
+  else
+    overlapped = box->box.width - max_other < 2 * clip_radius + 2;
+
+  if (shadow->inset || overlapped || clip_radius < 1)
+    {
+      draw_shadow (shadow, cr, box, clip_box, TRUE);
+      return;
+    }
+
+  if (has_empty_clip (cr))
+    return;
+
+  key.radius = radius;
+  key.corner.horizontal = 0;
+  key.corner.vertical = 0;
+  key.side = TRUE;
+
+  mask = shadow_mask_cache_lookup (&key);
+  if (mask == NULL)
+    {
+      cairo_surface_t *edge;
+      int width, height;
+
+      /* Render a blurred horizontal edge at y = clip_radius that is wide
+       * enough for its middle column to be unaffected by the surface
+       * boundaries, then keep only that column. */
+      width = 4 * clip_radius + 1;
+      height = 3 * clip_radius + 2;
+
+      edge = cairo_surface_create_similar_image (cairo_get_target (cr),
+                                                 CAIRO_FORMAT_A8,
+                                                 width, height);
+      mask_cr = cairo_create (edge);
+      cairo_rectangle (mask_cr, 0, clip_radius, width, height);
+      cairo_fill (mask_cr);
+      cairo_destroy (mask_cr);
+
+      _gtk_cairo_blur_surface (edge, radius);
+
+      mask = cairo_surface_create_similar_image (cairo_get_target (cr),
+                                                 CAIRO_FORMAT_A8,
+                                                 1, 2 * clip_radius + 2);
+      mask_cr = cairo_create (mask);
+      cairo_set_operator (mask_cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (mask_cr, edge, - 2 * clip_radius, 0);
+      cairo_paint (mask_cr);
+      cairo_destroy (mask_cr);
+      cairo_surface_destroy (edge);
+
+      shadow_mask_cache_insert (&key, mask);
+    }
+
+  /* Map the distance from the outer edge of the strip onto y of the
+   * mask, and stretch the single column along the side */
+  switch (side)
+    {
+    case GTK_CSS_TOP:
+      cairo_matrix_init (&matrix, 1, 0, 0, 1, 0, - (box->box.y - clip_radius));
+      break;
+    case GTK_CSS_BOTTOM:
+      cairo_matrix_init (&matrix, 1, 0, 0, -1, 0, box->box.y + box->box.height + clip_radius);
+      break;
+    case GTK_CSS_LEFT:
+      cairo_matrix_init (&matrix, 0, 1, 1, 0, 0, - (box->box.x - clip_radius));
+      break;
+    case GTK_CSS_RIGHT:
+      cairo_matrix_init (&matrix, 0, -1, 1, 0, 0, box->box.x + box->box.width + clip_radius);
+      break;
+    default:
+      g_assert_not_reached ();
+    }
+
+  gdk_cairo_set_source_rgba (cr, _gtk_css_rgba_value_get_rgba (shadow->color));
+  pattern = cairo_pattern_create_for_surface (mask);
+  cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
+  cairo_pattern_set_matrix (pattern, &matrix);
+  cairo_mask (cr, pattern);
+  cairo_pattern_destroy (pattern);
+}
+
 void
 _gtk_css_shadow_value_paint_box (const GtkCssValue   *shadow,
                                  cairo_t             *cr,
@@ -577,7 +979,7 @@ _gtk_css_shadow_value_paint_box (const GtkCssValue   *shadow,
     draw_shadow (shadow, cr, &box, &clip_box, FALSE);
   else
     {
-      int i, x1, x2, y1, y2;
+      int i;
       cairo_region_t *remaining;
       cairo_rectangle_int_t r;
 
@@ -615,95 +1017,28 @@ _gtk_css_shadow_value_paint_box (const GtkCssValue   *shadow,
       /* First do the corners of box */
       for (i = 0; i < 4; i++)
 	{
-	  if (i == GTK_CSS_TOP_LEFT || i == GTK_CSS_BOTTOM_LEFT)
-	    {
-	      x1 = floor (box.box.x - clip_radius);
-	      x2 = ceil (box.box.x + box.corner[i].horizontal + clip_radius);
-	    }
-	  else
-	    {
-	      x1 = floor (box.box.x + box.box.width - box.corner[i].horizontal - clip_radius);
-	      x2 = ceil (box.box.x + box.box.width + clip_radius);
-	    }
-
-	  if (i == GTK_CSS_TOP_LEFT || i == GTK_CSS_TOP_RIGHT)
-	    {
-	      y1 = floor (box.box.y - clip_radius);
-	      y2 = ceil (box.box.y + box.corner[i].vertical + clip_radius);
-	    }
-	  else
-	    {
-	      y1 = floor (box.box.y + box.box.height - box.corner[i].vertical - clip_radius);
-	      y2 = ceil (box.box.y + box.box.height + clip_radius);
-	    }
-
-
 	  cairo_save (cr);
-	  cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
-	  cairo_clip (cr);
-	  /* Also clip with remaining to ensure we never draw any area twice */
+	  /* Always clip with remaining to ensure we never draw any area twice */
 	  gdk_cairo_region (cr, remaining);
 	  cairo_clip (cr);
-	  draw_shadow (shadow, cr, &box, &clip_box, TRUE);
+	  draw_shadow_corner (shadow, cr, &box, &clip_box, i, &r);
 	  cairo_restore (cr);
 
 	  /* We drew the region, remove it from remaining */
-	  r.x = x1;
-	  r.y = y1;
-	  r.width = x2 - x1;
-	  r.height = y2 - y1;
 	  cairo_region_subtract_rectangle (remaining, &r);
 	}
 
       /* Then the sides */
       for (i = 0; i < 4; i++)
 	{
-	  if (i == GTK_CSS_TOP || i == GTK_CSS_BOTTOM)
-	    {
-	      x1 = floor (box.box.x - clip_radius);
-	      x2 = ceil (box.box.x + box.box.width + clip_radius);
-	    }
-	  else if (i == GTK_CSS_LEFT)
-	    {
-	      x1 = floor (box.box.x -clip_radius);
-	      x2 = ceil (box.box.x + clip_radius);
-	    }
-	  else
-	    {
-	      x1 = floor (box.box.x + box.box.width -clip_radius);
-	      x2 = ceil (box.box.x + box.box.width + clip_radius);
-	    }
-
-	  if (i == GTK_CSS_LEFT || i == GTK_CSS_RIGHT)
-	    {
-	      y1 = floor (box.box.y - clip_radius);
-	      y2 = ceil (box.box.y + box.box.height + clip_radius);
-	    }
-	  else if (i == GTK_CSS_TOP)
-	    {
-	      y1 = floor (box.box.y -clip_radius);
-	      y2 = ceil (box.box.y + clip_radius);
-	    }
-	  else
-	    {
-	      y1 = floor (box.box.y + box.box.height -clip_radius);
-	      y2 = ceil (box.box.y + box.box.height + clip_radius);
-	    }
-
 	  cairo_save (cr);
-	  cairo_rectangle (cr, x1, y1, x2 - x1, y2 - y1);
-	  cairo_clip (cr);
-	  /* Also clip with remaining to ensure we never draw any area twice */
+	  /* Always clip with remaining to ensure we never draw any area twice */
 	  gdk_cairo_region (cr, remaining);
 	  cairo_clip (cr);
-	  draw_shadow (shadow, cr, &box, &clip_box, TRUE);
+	  draw_shadow_side (shadow, cr, &box, &clip_box, i, &r);
 	  cairo_restore (cr);
 
 	  /* We drew the region, remove it from remaining */
-	  r.x = x1;
-	  r.y = y1;
-	  r.width = x2 - x1;
-	  r.height = y2 - y1;
 	  cairo_region_subtract_rectangle (remaining, &r);
 	}
 
@@ -86,6 +86,7 @@
 
 #include "gtkprivate.h"
 #include "gtkwindowprivate.h"
+#include "gtktreeprivate.h"
 
 #include <string.h>
 
@@ -133,6 +134,8 @@ static void     gtk_entry_completion_get_property        (GObject      *object,
                                                           GParamSpec   *pspec);
 static void     gtk_entry_completion_finalize            (GObject      *object);
 static void     gtk_entry_completion_dispose             (GObject      *object);
+static void     gtk_entry_completion_clear_index         (GtkEntryCompletion *completion);
+static void     gtk_entry_completion_unwatch_model       (GtkEntryCompletion *completion);
 
 static gboolean gtk_entry_completion_visible_func        (GtkTreeModel       *model,
                                                           GtkTreeIter        *iter,
@@ -669,6 +672,7 @@ gtk_entry_completion_set_property (GObject      *object,
 
       case PROP_TEXT_COLUMN:
         priv->text_column = g_value_get_int (value);
+        gtk_entry_completion_clear_index (completion);
         break;
 
       case PROP_INLINE_COMPLETION:
@@ -777,6 +781,7 @@ gtk_entry_completion_finalize (GObject *object)
   GtkEntryCompletion *completion = GTK_ENTRY_COMPLETION (object);
   GtkEntryCompletionPrivate *priv = completion->priv;
 
+  gtk_entry_completion_clear_index (completion);
   g_free (priv->case_normalized_key);
   g_free (priv->completion_prefix);
 
@@ -794,6 +799,8 @@ gtk_entry_completion_dispose (GObject *object)
 
   if (priv->tree_view)
     {
+      if (priv->filter_model)
+        gtk_entry_completion_unwatch_model (completion);
       gtk_widget_destroy (priv->tree_view);
       priv->tree_view = NULL;
     }
@@ -845,6 +852,209 @@ gtk_entry_completion_get_area (GtkCellLayout *cell_layout)
   return priv->cell_area;
 }
 
+static gchar *
+gtk_entry_completion_normalize (const gchar *text)
+{
+  gchar *normalized_string;
+  gchar *case_normalized_string = NULL;
+
+  normalized_string = g_utf8_normalize (text, -1, G_NORMALIZE_ALL);
+
+  if (normalized_string != NULL)
+    case_normalized_string = g_utf8_casefold (normalized_string, -1);
+
+  g_free (normalized_string);
+
+  return case_normalized_string;
+}
+
+/* The default match function compares the case normalized key with the
+ * start of the case normalized text of each row. For lists, the
+ * normalized texts are kept in an array sorted by text, and the rows
+ * that match are found with a binary search. When the key grows, the
+ * search only needs to look at the rows that matched before. The
+ * index is dropped when the model changes, and rebuilt on the next
+ * completion.
+ */
+static void
+gtk_entry_completion_clear_index (GtkEntryCompletion *completion)
+{
+  GtkEntryCompletionPrivate *priv = completion->priv;
+  gint i;
+
+  if (priv->row_keys)
+    {
+      for (i = 0; i < priv->n_rows; i++)
+        g_free (priv->row_keys[i]);
+      g_free (priv->row_keys);
+      priv->row_keys = NULL;
+    }
+
+  g_clear_pointer (&priv->sorted_rows, g_free);
+  g_clear_pointer (&priv->row_matches, g_free);
+  g_clear_pointer (&priv->index_key, g_free);
+
+  priv->n_rows = 0;
+  priv->n_sorted = 0;
+  priv->match_start = 0;
+  priv->match_end = 0;
+}
+
+static void
+gtk_entry_completion_watch_model (GtkEntryCompletion *completion,
+                                  GtkTreeModel       *model)
+{
+  /* These need to run before the handlers of the filter model,
+   * which asks for the visibility of changed rows.
+   */
+  g_signal_connect_swapped (model, "row-changed",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+  g_signal_connect_swapped (model, "row-inserted",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+  g_signal_connect_swapped (model, "row-deleted",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+  g_signal_connect_swapped (model, "rows-reordered",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+  g_signal_connect_swapped (model, "rows-inserted",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+  g_signal_connect_swapped (model, "rows-deleted",
+                            G_CALLBACK (gtk_entry_completion_clear_index), completion);
+}
+
+static void
+gtk_entry_completion_unwatch_model (GtkEntryCompletion *completion)
+{
+  GtkTreeModel *model;
+
+  model = gtk_tree_model_filter_get_model (completion->priv->filter_model);
+  g_signal_handlers_disconnect_by_func (model, gtk_entry_completion_clear_index, completion);
+
+  gtk_entry_completion_clear_index (completion);
+}
+
+static gboolean
+gtk_entry_completion_can_use_index (GtkEntryCompletion *completion)
+{
+  GtkEntryCompletionPrivate *priv = completion->priv;
+  GtkTreeModel *model;
+
+  if (priv->match_func || priv->text_column < 0)
+    return FALSE;
+
+  model = gtk_tree_model_filter_get_model (priv->filter_model);
+
+  return (gtk_tree_model_get_flags (model) & GTK_TREE_MODEL_LIST_ONLY) &&
+         priv->text_column < gtk_tree_model_get_n_columns (model) &&
+         gtk_tree_model_get_column_type (model, priv->text_column) == G_TYPE_STRING;
+}
+
+static gint
+compare_rows (gconstpointer a,
+              gconstpointer b,
+              gpointer      data)
+{
+  gchar **row_keys = data;
+
+  return strcmp (row_keys[*(const guint *) a], row_keys[*(const guint *) b]);
+}
+
+static void
+gtk_entry_completion_build_index (GtkEntryCompletion *completion)
+{
+  GtkEntryCompletionPrivate *priv = completion->priv;
+  GtkTreeModel *model;
+  GtkTreeIter iter;
+  gboolean valid;
+  gchar *item;
+  gint i;
+
+  model = gtk_tree_model_filter_get_model (priv->filter_model);
+
+  priv->n_rows = gtk_tree_model_iter_n_children (model, NULL);
+  priv->row_keys = g_new0 (gchar *, priv->n_rows);
+  priv->sorted_rows = g_new (guint, priv->n_rows);
+  priv->row_matches = g_new0 (guint8, priv->n_rows);
+  priv->n_sorted = 0;
+
+  valid = gtk_tree_model_get_iter_first (model, &iter);
+  for (i = 0; valid && i < priv->n_rows; i++)
+    {
+      gtk_tree_model_get (model, &iter, priv->text_column, &item, -1);
+
+      /* Rows without text never match */
+      if (item != NULL)
+        {
+          priv->row_keys[i] = gtk_entry_completion_normalize (item);
+          if (priv->row_keys[i] != NULL)
+            priv->sorted_rows[priv->n_sorted++] = i;
+          g_free (item);
+        }
+
+      valid = gtk_tree_model_iter_next (model, &iter);
+    }
+
+  g_qsort_with_data (priv->sorted_rows, priv->n_sorted, sizeof (guint),
+                     compare_rows, priv->row_keys);
+}
+
+/* Sets row_matches for the rows whose text starts with @key */
+static void
+gtk_entry_completion_update_index (GtkEntryCompletion *completion,
+                                   const gchar        *key)
+{
+  GtkEntryCompletionPrivate *priv = completion->priv;
+  gint start, end, last, mid, i;
+  gsize len;
+
+  if (priv->row_keys == NULL)
+    gtk_entry_completion_build_index (completion);
+
+  /* The rows starting with a longer key are
+   * among those starting with the shorter one */
+  if (priv->index_key && g_str_has_prefix (key, priv->index_key))
+    {
+      start = priv->match_start;
+      last = priv->match_end;
+    }
+  else
+    {
+      start = 0;
+      last = priv->n_sorted;
+    }
+
+  for (i = priv->match_start; i < priv->match_end; i++)
+    priv->row_matches[priv->sorted_rows[i]] = FALSE;
+
+  /* The first row that sorts after @key... */
+  len = strlen (key);
+  end = last;
+  for (mid = (start + end) / 2; start < end; mid = (start + end) / 2)
+    {
+      if (strcmp (priv->row_keys[priv->sorted_rows[mid]], key) < 0)
+        start = mid + 1;
+      else
+        end = mid;
+    }
+  priv->match_start = start;
+
+  /* ...and the first one after it that doesn't start with @key */
+  end = last;
+  for (mid = (start + end) / 2; start < end; mid = (start + end) / 2)
+    {
+      if (strncmp (priv->row_keys[priv->sorted_rows[mid]], key, len) <= 0)
+        start = mid + 1;
+      else
+        end = mid;
+    }
+  priv->match_end = start;
+
+  for (i = priv->match_start; i < priv->match_end; i++)
+    priv->row_matches[priv->sorted_rows[i]] = TRUE;
+
+  g_free (priv->index_key);
+  priv->index_key = g_strdup (key);
+}
+
 /* all those callbacks */
 static gboolean
 gtk_entry_completion_default_completion_func (GtkEntryCompletion *completion,
@@ -853,7 +1063,6 @@ gtk_entry_completion_default_completion_func (GtkEntryCompletion *completion,
                                               gpointer            user_data)
 {
   gchar *item = NULL;
-  gchar *normalized_string;
   gchar *case_normalized_string;
 
   gboolean ret = FALSE;
@@ -865,24 +1074,31 @@ gtk_entry_completion_default_completion_func (GtkEntryCompletion *completion,
   g_return_val_if_fail (gtk_tree_model_get_column_type (model, completion->priv->text_column) == G_TYPE_STRING,
                         FALSE);
 
+  if (completion->priv->row_matches)
+    {
+      GtkTreePath *path;
+      gint row;
+
+      path = gtk_tree_model_get_path (model, iter);
+      row = gtk_tree_path_get_indices (path)[0];
+      gtk_tree_path_free (path);
+
+      return row < completion->priv->n_rows && completion->priv->row_matches[row];
+    }
+
   gtk_tree_model_get (model, iter,
                       completion->priv->text_column, &item,
                       -1);
 
   if (item != NULL)
     {
-      normalized_string = g_utf8_normalize (item, -1, G_NORMALIZE_ALL);
+      case_normalized_string = gtk_entry_completion_normalize (item);
 
-      if (normalized_string != NULL)
-        {
-          case_normalized_string = g_utf8_casefold (normalized_string, -1);
+      if (case_normalized_string != NULL &&
+          !strncmp (key, case_normalized_string, strlen (key)))
+        ret = TRUE;
 
-          if (!strncmp (key, case_normalized_string, strlen (key)))
-            ret = TRUE;
-
-          g_free (case_normalized_string);
-        }
-      g_free (normalized_string);
+      g_free (case_normalized_string);
     }
   g_free (item);
 
@@ -1143,6 +1359,9 @@ gtk_entry_completion_set_model (GtkEntryCompletion *completion,
   g_return_if_fail (GTK_IS_ENTRY_COMPLETION (completion));
   g_return_if_fail (model == NULL || GTK_IS_TREE_MODEL (model));
 
+  if (completion->priv->filter_model)
+    gtk_entry_completion_unwatch_model (completion);
+
   if (!model)
     {
       gtk_tree_view_set_model (GTK_TREE_VIEW (completion->priv->tree_view),
@@ -1152,6 +1371,8 @@ gtk_entry_completion_set_model (GtkEntryCompletion *completion,
       return;
     }
 
+  gtk_entry_completion_watch_model (completion, model);
+
   /* code will unref the old filter model (if any) */
   completion->priv->filter_model =
     GTK_TREE_MODEL_FILTER (gtk_tree_model_filter_new (model, NULL));
@@ -1220,6 +1441,8 @@ gtk_entry_completion_set_match_func (GtkEntryCompletion          *completion,
   completion->priv->match_func = func;
   completion->priv->match_data = func_data;
   completion->priv->match_notify = func_notify;
+
+  gtk_entry_completion_clear_index (completion);
 }
 
 /**
@@ -1296,7 +1519,17 @@ gtk_entry_completion_complete (GtkEntryCompletion *completion)
   completion->priv->case_normalized_key = g_utf8_casefold (tmp, -1);
   g_free (tmp);
 
-  gtk_tree_model_filter_refilter (completion->priv->filter_model);
+  if (!gtk_entry_completion_can_use_index (completion))
+    gtk_tree_model_filter_refilter (completion->priv->filter_model);
+  else
+    {
+      gtk_entry_completion_update_index (completion, completion->priv->case_normalized_key);
+
+      if (!_gtk_tree_model_filter_refilter_rows (completion->priv->filter_model,
+                                                 completion->priv->row_matches,
+                                                 completion->priv->n_rows))
+        gtk_tree_model_filter_refilter (completion->priv->filter_model);
+    }
 
   if (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (completion->priv->filter_model), &iter))
     g_signal_emit (completion, entry_completion_signals[NO_MATCHES], 0);
@@ -1431,6 +1664,7 @@ gtk_entry_completion_set_text_column (GtkEntryCompletion *completion,
     return;
 
   completion->priv->text_column = column;
+  gtk_entry_completion_clear_index (completion);
 
   cell = gtk_cell_renderer_text_new ();
   gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (completion),
@@ -45,6 +45,17 @@ struct _GtkEntryCompletionPrivate
 
   gchar *case_normalized_key;
 
+  /* prefix index for the default match function, see
+   * gtk_entry_completion_update_index() */
+  gchar **row_keys;
+  guint *sorted_rows;
+  guint8 *row_matches;
+  gchar *index_key;
+  gint n_rows;
+  gint n_sorted;
+  gint match_start;
+  gint match_end;
+
   /* only used by GtkEntry when attached: */
   GtkWidget *popup_window;
   GtkWidget *vbox;
@@ -33,6 +33,7 @@
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -42,6 +43,15 @@
 
 #define MAJOR_VERSION 1
 #define MINOR_VERSION 0
+#define HASH_OFFSET 12
+
+#define HAS_SUFFIX_XPM (1 << 0)
+#define HAS_SUFFIX_SVG (1 << 1)
+#define HAS_SUFFIX_PNG (1 << 2)
+#define HAS_ICON_FILE  (1 << 3)
+
+#define ALIGN_VALUE(this, boundary) \
+  (( ((unsigned long)(this)) + (((unsigned long)(boundary)) -1)) & (~(((unsigned long)(boundary))-1)))
 
 #define GET_UINT16(cache, offset) (GUINT16_FROM_BE (*(guint16 *)((cache) + (offset))))
 #define GET_UINT32(cache, offset) (GUINT32_FROM_BE (*(guint32 *)((cache) + (offset))))
@@ -79,6 +89,19 @@ _gtk_icon_cache_unref (GtkIconCache *cache)
     }
 }
 
+static GtkIconCache *
+gtk_icon_cache_new_for_map (GMappedFile *map)
+{
+  GtkIconCache *cache;
+
+  cache = g_new0 (GtkIconCache, 1);
+  cache->ref_count = 1;
+  cache->map = map;
+  cache->buffer = g_mapped_file_get_contents (map);
+
+  return cache;
+}
+
 GtkIconCache *
 _gtk_icon_cache_new_for_path (const gchar *path)
 {
@@ -154,10 +177,7 @@ _gtk_icon_cache_new_for_path (const gchar *path)
 
   GTK_NOTE (ICONTHEME, g_print ("found cache for %s\n", path));
 
-  cache = g_new0 (GtkIconCache, 1);
-  cache->ref_count = 1;
-  cache->map = map;
-  cache->buffer = g_mapped_file_get_contents (map);
+  cache = gtk_icon_cache_new_for_map (map);
 
  done:
   g_free (cache_filename);  
@@ -622,3 +642,539 @@ _gtk_icon_cache_get_icon_data  (GtkIconCache *cache,
   return data;
 }
 
+/* Themes that are installed without an icon-theme.cache get one
+ * generated in the user cache directory the first time they are
+ * used, so that we don't have to read all of their directories in
+ * every process. It has the format that gtk-update-icon-cache writes,
+ * without pixel data. Its directory list contains every directory
+ * below the theme, with or without icons, which lets us tell whether
+ * the cache is outdated from their modification times.
+ */
+
+#define MAX_USER_CACHE_DEPTH 8
+
+typedef struct {
+  guint16 dir_index;
+  guint16 flags;
+  gchar *icon_file;     /* the .icon file, if there is one */
+} UserCacheImage;
+
+typedef struct {
+  GHashTable *icons;    /* icon name -> GArray of UserCacheImage */
+  GPtrArray *dirs;
+} UserCacheBuilder;
+
+static gchar *
+get_user_cache_file (const gchar *path)
+{
+  gchar *checksum, *filename;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, path, -1);
+  filename = g_build_filename (g_get_user_cache_dir (), "gtk-3.0", "icon-cache",
+                               checksum, NULL);
+  g_free (checksum);
+
+  return filename;
+}
+
+static void
+user_cache_image_clear (gpointer data)
+{
+  UserCacheImage *image = data;
+
+  g_free (image->icon_file);
+}
+
+static void
+user_cache_add_image (UserCacheBuilder *builder,
+                      const gchar      *file_path,
+                      const gchar      *name,
+                      guint16           dir_index)
+{
+  UserCacheImage image, *other;
+  GArray *images;
+  gchar *icon_name;
+  guint i;
+
+  if (g_str_has_suffix (name, ".png"))
+    image.flags = HAS_SUFFIX_PNG;
+  else if (g_str_has_suffix (name, ".svg"))
+    image.flags = HAS_SUFFIX_SVG;
+  else if (g_str_has_suffix (name, ".xpm"))
+    image.flags = HAS_SUFFIX_XPM;
+  else if (g_str_has_suffix (name, ".icon"))
+    image.flags = HAS_ICON_FILE;
+  else
+    return;
+
+  image.dir_index = dir_index;
+  image.icon_file = NULL;
+
+  icon_name = g_strndup (name, strrchr (name, '.') - name);
+  images = g_hash_table_lookup (builder->icons, icon_name);
+  if (images == NULL)
+    {
+      images = g_array_new (FALSE, FALSE, sizeof (UserCacheImage));
+      g_array_set_clear_func (images, user_cache_image_clear);
+      g_hash_table_insert (builder->icons, icon_name, images);
+    }
+  else
+    g_free (icon_name);
+
+  for (i = 0; i < images->len; i++)
+    {
+      other = &g_array_index (images, UserCacheImage, i);
+      if (other->dir_index == dir_index)
+        break;
+    }
+
+  if (i == images->len)
+    {
+      g_array_append_val (images, image);
+      other = &g_array_index (images, UserCacheImage, i);
+    }
+  else
+    other->flags |= image.flags;
+
+  if (image.flags == HAS_ICON_FILE && other->icon_file == NULL)
+    other->icon_file = g_strdup (file_path);
+}
+
+static gboolean
+user_cache_scan_directory (UserCacheBuilder *builder,
+                           const gchar      *path,
+                           const gchar      *subdir,
+                           gint              depth)
+{
+  GDir *dir;
+  const gchar *name;
+  gchar *dir_path, *file_path, *child;
+  guint16 dir_index = 0;
+  gboolean retval = TRUE;
+
+  dir_path = subdir ? g_build_filename (path, subdir, NULL) : g_strdup (path);
+  dir = g_dir_open (dir_path, 0, NULL);
+  g_free (dir_path);
+
+  if (dir == NULL)
+    return subdir != NULL;
+
+  if (subdir != NULL)
+    {
+      /* 0xffff is reserved for the toplevel directory */
+      if (builder->dirs->len >= 0xffff)
+        {
+          g_dir_close (dir);
+          return FALSE;
+        }
+
+      dir_index = builder->dirs->len;
+      g_ptr_array_add (builder->dirs, g_strdup (subdir));
+    }
+
+  while (retval && (name = g_dir_read_name (dir)))
+    {
+      if (subdir)
+        {
+          child = g_strconcat (subdir, "/", name, NULL);
+          file_path = g_build_filename (path, child, NULL);
+        }
+      else
+        {
+          child = g_strdup (name);
+          file_path = g_build_filename (path, name, NULL);
+        }
+
+      if (g_file_test (file_path, G_FILE_TEST_IS_DIR))
+        {
+          if (depth < MAX_USER_CACHE_DEPTH)
+            retval = user_cache_scan_directory (builder, path, child, depth + 1);
+        }
+      else if (subdir != NULL) /* images in the toplevel directory are ignored */
+        user_cache_add_image (builder, file_path, name, dir_index);
+
+      g_free (file_path);
+      g_free (child);
+    }
+
+  g_dir_close (dir);
+
+  return retval;
+}
+
+static void
+append_uint16 (GByteArray *bytes,
+               guint16     value)
+{
+  value = GUINT16_TO_BE (value);
+  g_byte_array_append (bytes, (guint8 *) &value, sizeof (value));
+}
+
+static void
+append_uint32 (GByteArray *bytes,
+               guint32     value)
+{
+  value = GUINT32_TO_BE (value);
+  g_byte_array_append (bytes, (guint8 *) &value, sizeof (value));
+}
+
+static void
+set_uint32 (GByteArray *bytes,
+            guint32     offset,
+            guint32     value)
+{
+  value = GUINT32_TO_BE (value);
+  memcpy (bytes->data + offset, &value, sizeof (value));
+}
+
+static void
+append_string (GByteArray  *bytes,
+               const gchar *string)
+{
+  static const guint8 padding[4] = { 0, };
+  gsize len;
+
+  len = strlen (string) + 1;
+  g_byte_array_append (bytes, (guint8 *) string, len);
+  g_byte_array_append (bytes, padding, ALIGN_VALUE (len, 4) - len);
+}
+
+/* Appends image data without pixel data, pointing to the meta data
+ * from @icon_file, in the layout gtk-update-icon-cache uses.
+ */
+static gboolean
+user_cache_append_icon_data (GByteArray  *bytes,
+                             const gchar *icon_file)
+{
+  GKeyFile *key_file;
+  gint *rect;
+  gsize n_rect;
+  gchar *str, **attach_points, **keys, *open, *close, *comma;
+  GPtrArray *display_names;
+  guint32 n_attach_points, meta_data_offset, offset, list_offset;
+  guint i;
+
+  key_file = g_key_file_new ();
+  g_key_file_set_list_separator (key_file, ',');
+  if (!g_key_file_load_from_file (key_file, icon_file,
+                                  G_KEY_FILE_KEEP_TRANSLATIONS, NULL))
+    {
+      g_key_file_free (key_file);
+      return FALSE;
+    }
+
+  rect = g_key_file_get_integer_list (key_file, "Icon Data",
+                                      "EmbeddedTextRectangle", &n_rect, NULL);
+  if (rect != NULL && n_rect != 4)
+    g_clear_pointer (&rect, g_free);
+
+  str = g_key_file_get_string (key_file, "Icon Data", "AttachPoints", NULL);
+  attach_points = str ? g_strsplit (str, "|", -1) : NULL;
+  n_attach_points = attach_points ? g_strv_length (attach_points) : 0;
+  g_free (str);
+
+  /* language, name pairs */
+  display_names = g_ptr_array_new_with_free_func (g_free);
+  keys = g_key_file_get_keys (key_file, "Icon Data", NULL, NULL);
+  for (i = 0; keys && keys[i]; i++)
+    {
+      if (!g_str_has_prefix (keys[i], "DisplayName"))
+        continue;
+
+      open = strchr (keys[i], '[');
+      close = open ? strchr (open, ']') : NULL;
+
+      if (open && close)
+        {
+          str = g_key_file_get_locale_string (key_file, "Icon Data", "DisplayName",
+                                              open + 1, NULL);
+          if (str)
+            g_ptr_array_add (display_names, g_strndup (open + 1, close - open - 1));
+        }
+      else
+        {
+          str = g_key_file_get_string (key_file, "Icon Data", "DisplayName", NULL);
+          if (str)
+            g_ptr_array_add (display_names, g_strdup ("C"));
+        }
+
+      if (str)
+        g_ptr_array_add (display_names, str);
+    }
+  g_strfreev (keys);
+  g_key_file_free (key_file);
+
+  /* No pixel data, the meta data follows directly */
+  append_uint32 (bytes, 0);
+  append_uint32 (bytes, bytes->len + 4);
+
+  meta_data_offset = bytes->len;
+  offset = meta_data_offset + 12;
+
+  append_uint32 (bytes, rect ? offset : 0);
+  if (rect)
+    offset += 8;
+  append_uint32 (bytes, n_attach_points > 0 ? offset : 0);
+  offset += n_attach_points > 0 ? 4 + 4 * n_attach_points : 0;
+  append_uint32 (bytes, display_names->len > 0 ? offset : 0);
+
+  if (rect)
+    {
+      for (i = 0; i < 4; i++)
+        append_uint16 (bytes, rect[i]);
+    }
+
+  if (n_attach_points > 0)
+    {
+      append_uint32 (bytes, n_attach_points);
+      for (i = 0; i < n_attach_points; i++)
+        {
+          comma = strchr (attach_points[i], ',');
+          append_uint16 (bytes, atoi (attach_points[i]));
+          append_uint16 (bytes, comma ? atoi (comma + 1) : 0);
+        }
+    }
+
+  if (display_names->len > 0)
+    {
+      append_uint32 (bytes, display_names->len / 2);
+      list_offset = bytes->len;
+      for (i = 0; i < display_names->len; i++)
+        append_uint32 (bytes, 0);
+
+      for (i = 0; i < display_names->len; i++)
+        {
+          set_uint32 (bytes, list_offset + 4 * i, bytes->len);
+          append_string (bytes, g_ptr_array_index (display_names, i));
+        }
+    }
+
+  g_free (rect);
+  g_strfreev (attach_points);
+  g_ptr_array_unref (display_names);
+
+  return TRUE;
+}
+
+/* Like gtk-update-icon-cache, we drop .icon files without an image */
+static void
+user_cache_remove_icon_files (UserCacheBuilder *builder)
+{
+  GHashTableIter iter;
+  gpointer value;
+  GArray *images;
+  guint i;
+
+  g_hash_table_iter_init (&iter, builder->icons);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      images = value;
+
+      for (i = images->len; i > 0; i--)
+        {
+          if (g_array_index (images, UserCacheImage, i - 1).flags == HAS_ICON_FILE)
+            g_array_remove_index (images, i - 1);
+        }
+
+      if (images->len == 0)
+        g_hash_table_iter_remove (&iter);
+    }
+}
+
+static GBytes *
+user_cache_build (UserCacheBuilder *builder)
+{
+  GByteArray *bytes;
+  GHashTableIter iter;
+  gpointer key, value;
+  UserCacheImage *image;
+  GArray *images;
+  const gchar *name;
+  guint32 n_buckets, bucket_offset, offset, image_list_offset, dir_list_offset;
+  guint i;
+
+  user_cache_remove_icon_files (builder);
+
+  bytes = g_byte_array_new ();
+
+  append_uint16 (bytes, MAJOR_VERSION);
+  append_uint16 (bytes, MINOR_VERSION);
+  append_uint32 (bytes, HASH_OFFSET);
+  append_uint32 (bytes, 0); /* directory list offset, set below */
+
+  n_buckets = g_spaced_primes_closest (g_hash_table_size (builder->icons) / 3);
+  append_uint32 (bytes, n_buckets);
+  for (i = 0; i < n_buckets; i++)
+    append_uint32 (bytes, 0xffffffff);
+
+  g_hash_table_iter_init (&iter, builder->icons);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      name = key;
+      images = value;
+
+      /* Prepend the icon to the chain of its bucket */
+      bucket_offset = HASH_OFFSET + 4 + 4 * (icon_name_hash (name) % n_buckets);
+      offset = bytes->len;
+
+      append_uint32 (bytes, GET_UINT32 (bytes->data, bucket_offset));
+      append_uint32 (bytes, offset + 12);
+      append_uint32 (bytes, offset + 12 + ALIGN_VALUE (strlen (name) + 1, 4));
+      append_string (bytes, name);
+      set_uint32 (bytes, bucket_offset, offset);
+
+      image_list_offset = bytes->len;
+      append_uint32 (bytes, images->len);
+      for (i = 0; i < images->len; i++)
+        {
+          image = &g_array_index (images, UserCacheImage, i);
+          append_uint16 (bytes, image->dir_index);
+          append_uint16 (bytes, image->flags);
+          append_uint32 (bytes, 0); /* image data, set below */
+        }
+
+      for (i = 0; i < images->len; i++)
+        {
+          image = &g_array_index (images, UserCacheImage, i);
+          offset = bytes->len;
+
+          if (image->icon_file &&
+              user_cache_append_icon_data (bytes, image->icon_file))
+            set_uint32 (bytes, image_list_offset + 4 + 8 * i + 4, offset);
+        }
+    }
+
+  dir_list_offset = bytes->len;
+  set_uint32 (bytes, 8, dir_list_offset);
+
+  append_uint32 (bytes, builder->dirs->len);
+  for (i = 0; i < builder->dirs->len; i++)
+    append_uint32 (bytes, 0);
+
+  for (i = 0; i < builder->dirs->len; i++)
+    {
+      set_uint32 (bytes, dir_list_offset + 4 + 4 * i, bytes->len);
+      append_string (bytes, g_ptr_array_index (builder->dirs, i));
+    }
+
+  return g_byte_array_free_to_bytes (bytes);
+}
+
+/* A directory that changed in the same second as the cache
+ * was written may have changed after we read it, so the cache
+ * has to be strictly newer than all of them.
+ */
+static gboolean
+user_cache_is_current (const gchar *buffer,
+                       const gchar *path,
+                       time_t       mtime)
+{
+  guint32 dir_list_offset, n_dirs, i;
+  gchar *dir_path;
+  GStatBuf st;
+  gboolean current;
+
+  if (g_stat (path, &st) < 0 || st.st_mtime >= mtime)
+    return FALSE;
+
+  dir_list_offset = GET_UINT32 (buffer, 8);
+  n_dirs = GET_UINT32 (buffer, dir_list_offset);
+
+  for (i = 0; i < n_dirs; i++)
+    {
+      dir_path = g_build_filename (path,
+                                   buffer + GET_UINT32 (buffer, dir_list_offset + 4 + 4 * i),
+                                   NULL);
+      current = g_stat (dir_path, &st) == 0 && st.st_mtime < mtime;
+      g_free (dir_path);
+
+      if (!current)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Returns a cache for @path from the user cache directory,
+ * generating it if it doesn't exist or is outdated.
+ */
+GtkIconCache *
+_gtk_icon_cache_new_for_user (const gchar *path)
+{
+  GtkIconCache *cache = NULL;
+  UserCacheBuilder builder;
+  GMappedFile *map;
+  GBytes *bytes;
+  gchar *cache_filename, *dirname = NULL;
+  GStatBuf st;
+  CacheInfo info;
+
+  cache_filename = get_user_cache_file (path);
+
+  if (g_stat (cache_filename, &st) == 0 && st.st_size >= 16 &&
+      (map = g_mapped_file_new (cache_filename, FALSE, NULL)) != NULL)
+    {
+      /* The cache is in a place any program of the user can write
+       * to, so we don't trust it as much as the system ones.
+       */
+      info.cache = g_mapped_file_get_contents (map);
+      info.cache_size = g_mapped_file_get_length (map);
+      info.n_directories = 0;
+      info.flags = CHECK_OFFSETS|CHECK_STRINGS;
+
+      if (_gtk_icon_cache_validate (&info) &&
+          user_cache_is_current (info.cache, path, st.st_mtime))
+        {
+          GTK_NOTE (ICONTHEME, g_print ("found user cache for %s\n", path));
+
+          cache = gtk_icon_cache_new_for_map (map);
+          goto done;
+        }
+
+      GTK_NOTE (ICONTHEME, g_print ("user cache for %s outdated\n", path));
+      g_mapped_file_unref (map);
+    }
+
+  /* If we can't keep the cache, scanning every directory below
+   * the theme in each process costs more than it saves
+   */
+  dirname = g_path_get_dirname (cache_filename);
+  if (g_mkdir_with_parents (dirname, 0700) != 0)
+    {
+      GTK_NOTE (ICONTHEME, g_print ("can't write user cache for %s\n", path));
+      goto done;
+    }
+
+  GTK_NOTE (ICONTHEME, g_print ("generating user cache for %s\n", path));
+
+  builder.icons = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                         g_free, (GDestroyNotify) g_array_unref);
+  builder.dirs = g_ptr_array_new_with_free_func (g_free);
+
+  if (user_cache_scan_directory (&builder, path, NULL, 0))
+    {
+      bytes = user_cache_build (&builder);
+
+      /* g_file_set_contents() replaces the file atomically, so
+       * other processes never see a partially written cache.
+       * If it fails, the caller reads the theme without a cache.
+       */
+      if (g_file_set_contents (cache_filename,
+                               g_bytes_get_data (bytes, NULL),
+                               g_bytes_get_size (bytes),
+                               NULL) &&
+          (map = g_mapped_file_new (cache_filename, FALSE, NULL)) != NULL)
+        cache = gtk_icon_cache_new_for_map (map);
+
+      g_bytes_unref (bytes);
+    }
+
+  g_hash_table_unref (builder.icons);
+  g_ptr_array_unref (builder.dirs);
+
+ done:
+  g_free (dirname);
+  g_free (cache_filename);
+
+  return cache;
+}
@@ -37,6 +37,7 @@ struct _GtkIconData
 
 GtkIconCache *_gtk_icon_cache_new            (const gchar  *data);
 GtkIconCache *_gtk_icon_cache_new_for_path   (const gchar  *path);
+GtkIconCache *_gtk_icon_cache_new_for_user   (const gchar  *path);
 gint          _gtk_icon_cache_get_directory_index  (GtkIconCache *cache,
 					            const gchar  *directory);
 gboolean      _gtk_icon_cache_has_icon       (GtkIconCache *cache,
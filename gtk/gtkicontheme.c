@@ -317,6 +317,7 @@ typedef struct
   gchar *dir;
   time_t mtime; /* 0 == not existing or not a dir */
   GtkIconCache *cache;
+  gboolean no_cache; /* no cache could be found or written */
 } IconThemeDirMtime;
 
 static void         gtk_icon_theme_finalize   (GObject          *object);
@@ -1132,6 +1133,7 @@ insert_theme (GtkIconTheme *icon_theme,
                                NULL);
       dir_mtime = g_slice_new (IconThemeDirMtime);
       dir_mtime->cache = NULL;
+      dir_mtime->no_cache = FALSE;
       dir_mtime->dir = path;
       if (g_stat (path, &stat_buf) == 0 && S_ISDIR (stat_buf.st_mode))
         dir_mtime->mtime = stat_buf.st_mtime;
@@ -1371,6 +1373,7 @@ load_themes (GtkIconTheme *icon_theme)
       dir_mtime->dir = g_strdup (dir);
       dir_mtime->mtime = 0;
       dir_mtime->cache = NULL;
+      dir_mtime->no_cache = FALSE;
 
       if (g_stat (dir, &stat_buf) != 0 || !S_ISDIR (stat_buf.st_mode))
         continue;
@@ -3317,10 +3320,20 @@ theme_subdir_load (GtkIconTheme *icon_theme,
       /* First, see if we have a cache for the directory */
       if (dir_mtime->cache != NULL || g_file_test (full_dir, G_FILE_TEST_IS_DIR))
         {
-          if (dir_mtime->cache == NULL)
+          if (dir_mtime->cache == NULL && !dir_mtime->no_cache)
             {
               /* This will return NULL if the cache doesn't exist or is outdated */
               dir_mtime->cache = _gtk_icon_cache_new_for_path (dir_mtime->dir);
+
+              /* Without an up-to-date cache in the theme itself, use one
+               * from the user cache directory rather than reading every
+               * directory of the theme in every process.
+               */
+              if (dir_mtime->cache == NULL)
+                dir_mtime->cache = _gtk_icon_cache_new_for_user (dir_mtime->dir);
+
+              /* Don't try again for each of its subdirectories */
+              dir_mtime->no_cache = dir_mtime->cache == NULL;
             }
 
           dir = g_new0 (IconThemeDir, 1);
@@ -27,6 +27,7 @@
 #include "gtkintl.h"
 #include "gtkbuildable.h"
 #include "gtkbuilderprivate.h"
+#include "gtktreeprivate.h"
 
 
 /**
@@ -1424,6 +1425,23 @@ gtk_list_store_clear (GtkListStore *list_store)
 
   priv = list_store->priv;
 
+  if (priv->length > 0 &&
+      !gtk_tree_model_needs_row_deleted (GTK_TREE_MODEL (list_store)))
+    {
+      GtkTreePath *path;
+      gint n_rows = priv->length;
+
+      g_sequence_foreach (priv->seq,
+                          (GFunc) _gtk_tree_data_list_free, priv->column_headers);
+      g_sequence_remove_range (g_sequence_get_begin_iter (priv->seq),
+                               g_sequence_get_end_iter (priv->seq));
+      priv->length = 0;
+
+      path = gtk_tree_path_new_first ();
+      gtk_tree_model_rows_deleted (GTK_TREE_MODEL (list_store), path, n_rows);
+      gtk_tree_path_free (path);
+    }
+
   while (g_sequence_get_length (priv->seq) > 0)
     {
       iter.stamp = priv->stamp;
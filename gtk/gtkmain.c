@@ -180,6 +180,8 @@ static const GDebugKey gtk_debug_keys[] = {
   {"interactive", GTK_DEBUG_INTERACTIVE},
   {"touchscreen", GTK_DEBUG_TOUCHSCREEN},
   {"actions", GTK_DEBUG_ACTIONS},
+  {"css-cache", GTK_DEBUG_CSS_CACHE},
+  {"size-cache", GTK_DEBUG_SIZE_CACHE},
 };
 #endif /* G_ENABLE_DEBUG */
 
@@ -20,6 +20,8 @@
 #include "gtkdebug.h"
 #include "gtkpixelcacheprivate.h"
 
+#include <string.h>
+
 #define BLOW_CACHE_TIMEOUT_SEC 20
 
 /* The extra size of the offscreen surface we allocate
@@ -31,6 +33,24 @@
 #define ALLOW_SMALLER_SIZE 32
 #define ALLOW_LARGER_SIZE 32
 
+/* Caches that always keep a surface, like the render caches of
+   widgets, share this much memory. The least recently drawn
+   ones lose their surface first. */
+#define MAX_RETAINED_SIZE (64 * 1024 * 1024)
+
+/* While scrolling, the surface grows so that it covers this much
+   of the movement ahead of the view, in steps of PREFETCH_STEP
+   and up to MAX_PREFETCH_SIZE. The part ahead of the view is
+   rendered when idle between frames. */
+#define PREFETCH_TIME_MSEC 250
+#define PREFETCH_STEP 128
+#define MAX_PREFETCH_SIZE 1024
+
+/* Slower views (in pixels per second) are not considered scrolling,
+   and a view that didn't move for VELOCITY_RESET_MSEC starts over */
+#define MIN_SCROLL_VELOCITY 50
+#define VELOCITY_RESET_MSEC 150
+
 struct _GtkPixelCache {
   cairo_surface_t *surface;
   cairo_content_t content;
@@ -49,8 +69,46 @@ struct _GtkPixelCache {
 
   guint extra_width;
   guint extra_height;
+
+  /* Movement of the view inside the canvas, in pixels per second */
+  gint64 view_time;
+  int view_x, view_y;
+  double velocity_x;
+  double velocity_y;
+
+  /* Extra size the surface grew to while scrolling */
+  guint prefetch_width;
+  guint prefetch_height;
+
+  /* Set if prefetching is allowed; the last draw is repeated in idle */
+  guint prefetch_id;
+  GtkPixelCacheDrawFunc prefetch_draw;
+  gpointer prefetch_data;
+  cairo_rectangle_int_t prefetch_view_rect;
+  cairo_rectangle_int_t prefetch_canvas_rect;
+
+  /* Link in retained_caches, if always_cache and surface != NULL */
+  GList retained_link;
+  gsize retained_size;
+
+  guint always_cache : 1;
+  guint prefetch : 1;
 };
 
+static GQueue retained_caches = G_QUEUE_INIT;
+static gsize retained_size = 0;
+
+#ifdef G_ENABLE_DEBUG
+/* Areas in pixels, accumulated over all caches for one frame */
+static struct {
+  gint64 frame_counter;
+  guint64 view_area;
+  guint64 view_rendered_area;
+  guint64 rendered_area;
+  guint64 prefetched_area;
+} frame_stats;
+#endif
+
 GtkPixelCache *
 _gtk_pixel_cache_new ()
 {
@@ -59,10 +117,54 @@ _gtk_pixel_cache_new ()
   cache = g_new0 (GtkPixelCache, 1);
   cache->extra_width = DEFAULT_EXTRA_SIZE;
   cache->extra_height = DEFAULT_EXTRA_SIZE;
+  cache->retained_link.data = cache;
 
   return cache;
 }
 
+static void
+gtk_pixel_cache_destroy_surface (GtkPixelCache *cache)
+{
+  if (cache->surface == NULL)
+    return;
+
+  if (cache->retained_size)
+    {
+      g_queue_unlink (&retained_caches, &cache->retained_link);
+      retained_size -= cache->retained_size;
+      cache->retained_size = 0;
+    }
+
+  cairo_surface_destroy (cache->surface);
+  cache->surface = NULL;
+  if (cache->surface_dirty)
+    cairo_region_destroy (cache->surface_dirty);
+  cache->surface_dirty = NULL;
+}
+
+static void gtk_pixel_cache_blow_cache (GtkPixelCache *cache);
+
+/* Makes room for the surface of @cache */
+static void
+gtk_pixel_cache_retain_surface (GtkPixelCache *cache)
+{
+  GtkPixelCache *last;
+
+  cache->retained_size = (gsize) cache->surface_w * cache->surface_h * 4 *
+                         cache->surface_scale * cache->surface_scale;
+  retained_size += cache->retained_size;
+  g_queue_push_head_link (&retained_caches, &cache->retained_link);
+
+  while (retained_size > MAX_RETAINED_SIZE)
+    {
+      last = g_queue_peek_tail (&retained_caches);
+      if (last == cache)
+        break;
+
+      gtk_pixel_cache_blow_cache (last);
+    }
+}
+
 void
 _gtk_pixel_cache_free (GtkPixelCache *cache)
 {
@@ -80,8 +182,10 @@ _gtk_pixel_cache_free (GtkPixelCache *cache)
   if (cache->timeout_tag)
     g_source_remove (cache->timeout_tag);
 
-  if (cache->surface != NULL)
-    cairo_surface_destroy (cache->surface);
+  if (cache->prefetch_id)
+    g_source_remove (cache->prefetch_id);
+
+  gtk_pixel_cache_destroy_surface (cache);
 
   if (cache->surface_dirty != NULL)
     cairo_region_destroy (cache->surface_dirty);
@@ -110,6 +214,53 @@ _gtk_pixel_cache_get_extra_size (GtkPixelCache *cache,
     *extra_height = cache->extra_height;
 }
 
+/* Keep a surface even if the view shows the whole canvas, so that
+ * unchanged content is never drawn again. Used for widgets that
+ * cache their rendering, see gtk_widget_set_render_cache().
+ */
+void
+_gtk_pixel_cache_set_always_cache (GtkPixelCache *cache,
+                                   gboolean       always_cache)
+{
+  cache->always_cache = always_cache;
+}
+
+static void
+gtk_pixel_cache_stop_prefetch (GtkPixelCache *cache)
+{
+  if (cache->prefetch_id)
+    {
+      g_source_remove (cache->prefetch_id);
+      cache->prefetch_id = 0;
+    }
+}
+
+/* Allow rendering the part of the canvas the view is scrolling
+ * towards when idle. The draw function and data passed to
+ * _gtk_pixel_cache_draw() must then stay valid until the cache
+ * is unmapped, and not depend on the context they are called in.
+ */
+void
+_gtk_pixel_cache_set_prefetch (GtkPixelCache *cache,
+                               gboolean       prefetch)
+{
+  cache->prefetch = prefetch;
+
+  if (!prefetch)
+    gtk_pixel_cache_stop_prefetch (cache);
+}
+
+/* Has to be called when the view moves inside the canvas. The
+ * draw function then renders at the new position, so the position
+ * saved at the last draw can't be used to prefetch any more until
+ * the next draw saves the new one.
+ */
+void
+_gtk_pixel_cache_view_moved (GtkPixelCache *cache)
+{
+  gtk_pixel_cache_stop_prefetch (cache);
+}
+
 void
 _gtk_pixel_cache_set_content (GtkPixelCache   *cache,
                               cairo_content_t  content)
@@ -126,6 +277,10 @@ _gtk_pixel_cache_invalidate (GtkPixelCache  *cache,
   cairo_rectangle_int_t r;
   cairo_region_t *free_region = NULL;
 
+  /* Whatever changed might be drawn at the new position of the
+   * view already, so wait for the next draw to prefetch again */
+  gtk_pixel_cache_stop_prefetch (cache);
+
   if (cache->surface == NULL ||
       (region != NULL && cairo_region_is_empty (region)))
     return;
@@ -176,11 +331,14 @@ _gtk_pixel_cache_create_surface_if_needed (GtkPixelCache         *cache,
                                            cairo_rectangle_int_t *view_rect,
                                            cairo_rectangle_int_t *canvas_rect)
 {
-  cairo_rectangle_int_t rect;
+  cairo_rectangle_int_t rect, old_rect;
+  cairo_surface_t *old_surface;
+  cairo_region_t *old_dirty;
   int surface_w, surface_h;
   cairo_content_t content;
   cairo_pattern_t *bg;
   double red, green, blue, alpha;
+  cairo_t *backing_cr;
 
 #ifdef G_ENABLE_DEBUG
   if (gtk_get_debug_flags () & GTK_DEBUG_NO_PIXEL_CACHE)
@@ -201,11 +359,16 @@ _gtk_pixel_cache_create_surface_if_needed (GtkPixelCache         *cache,
 
   surface_w = view_rect->width;
   if (canvas_rect->width > surface_w)
-    surface_w = MIN (surface_w + cache->extra_width, canvas_rect->width);
+    surface_w = MIN (surface_w + MAX (cache->extra_width, cache->prefetch_width),
+                     canvas_rect->width);
 
   surface_h = view_rect->height;
   if (canvas_rect->height > surface_h)
-    surface_h = MIN (surface_h + cache->extra_height, canvas_rect->height);
+    surface_h = MIN (surface_h + MAX (cache->extra_height, cache->prefetch_height),
+                     canvas_rect->height);
+
+  old_surface = NULL;
+  old_dirty = NULL;
 
   /* If current surface can't fit view_rect or is too large, kill it */
   if (cache->surface != NULL &&
@@ -216,21 +379,37 @@ _gtk_pixel_cache_create_surface_if_needed (GtkPixelCache         *cache,
        cache->surface_h > surface_h + ALLOW_LARGER_SIZE ||
        cache->surface_scale != gdk_window_get_scale_factor (window)))
     {
-      cairo_surface_destroy (cache->surface);
-      cache->surface = NULL;
-      if (cache->surface_dirty)
-        cairo_region_destroy (cache->surface_dirty);
-      cache->surface_dirty = NULL;
+      /* Keep what we can when the surface only changes size,
+         like when it grows while scrolling */
+      if (cairo_surface_get_content (cache->surface) == content &&
+          cache->surface_scale == gdk_window_get_scale_factor (window))
+        {
+          old_surface = cairo_surface_reference (cache->surface);
+          old_rect.x = cache->surface_x;
+          old_rect.y = cache->surface_y;
+          old_rect.width = cache->surface_w;
+          old_rect.height = cache->surface_h;
+          if (cache->surface_dirty)
+            old_dirty = cairo_region_copy (cache->surface_dirty);
+        }
+
+      gtk_pixel_cache_destroy_surface (cache);
     }
 
   /* Don't allocate a surface if view >= canvas, as we won't
      be scrolling then anyway */
   if (cache->surface == NULL &&
-      (view_rect->width < canvas_rect->width ||
+      (cache->always_cache ||
+       view_rect->width < canvas_rect->width ||
        view_rect->height < canvas_rect->height))
     {
+      /* Put the extra size where the view is going */
       cache->surface_x = -canvas_rect->x;
+      if (cache->velocity_x < 0)
+        cache->surface_x = MAX (cache->surface_x + view_rect->width - surface_w, 0);
       cache->surface_y = -canvas_rect->y;
+      if (cache->velocity_y < 0)
+        cache->surface_y = MAX (cache->surface_y + view_rect->height - surface_h, 0);
       cache->surface_w = surface_w;
       cache->surface_h = surface_h;
       cache->surface_scale = gdk_window_get_scale_factor (window);
@@ -244,7 +423,40 @@ _gtk_pixel_cache_create_surface_if_needed (GtkPixelCache         *cache,
       rect.height = surface_h;
       cache->surface_dirty =
         cairo_region_create_rectangle (&rect);
+
+      if (old_surface)
+        {
+          cairo_rectangle_int_t r;
+
+          r.x = old_rect.x - cache->surface_x;
+          r.y = old_rect.y - cache->surface_y;
+          r.width = old_rect.width;
+          r.height = old_rect.height;
+
+          backing_cr = cairo_create (cache->surface);
+          cairo_set_operator (backing_cr, CAIRO_OPERATOR_SOURCE);
+          cairo_set_source_surface (backing_cr, old_surface, r.x, r.y);
+          cairo_rectangle (backing_cr, r.x, r.y, r.width, r.height);
+          cairo_fill (backing_cr);
+          cairo_destroy (backing_cr);
+
+          cairo_region_subtract_rectangle (cache->surface_dirty, &r);
+          if (old_dirty)
+            {
+              cairo_region_translate (old_dirty, r.x, r.y);
+              cairo_region_union (cache->surface_dirty, old_dirty);
+              cairo_region_intersect_rectangle (cache->surface_dirty, &rect);
+            }
+        }
+
+      if (cache->always_cache)
+        gtk_pixel_cache_retain_surface (cache);
     }
+
+  if (old_surface)
+    cairo_surface_destroy (old_surface);
+  if (old_dirty)
+    cairo_region_destroy (old_dirty);
 }
 
 static void
@@ -325,6 +537,105 @@ _gtk_pixel_cache_set_position (GtkPixelCache         *cache,
     }
 }
 
+/* Renders @region, in surface coordinates, into the surface */
+static void
+gtk_pixel_cache_paint_region (GtkPixelCache         *cache,
+                              cairo_region_t        *region,
+                              GtkPixelCacheDrawFunc  draw,
+                              cairo_rectangle_int_t *view_rect,
+                              cairo_rectangle_int_t *canvas_rect,
+                              gpointer               user_data)
+{
+  cairo_t *backing_cr;
+
+  backing_cr = cairo_create (cache->surface);
+  gdk_cairo_region (backing_cr, region);
+  cairo_clip (backing_cr);
+  cairo_translate (backing_cr,
+                   -cache->surface_x - canvas_rect->x - view_rect->x,
+                   -cache->surface_y - canvas_rect->y - view_rect->y);
+
+  cairo_save (backing_cr);
+  cairo_set_source_rgba (backing_cr,
+                         0.0, 0, 0, 0.0);
+  cairo_set_operator (backing_cr, CAIRO_OPERATOR_SOURCE);
+  cairo_paint (backing_cr);
+  cairo_restore (backing_cr);
+
+  cairo_save (backing_cr);
+  draw (backing_cr, user_data);
+  cairo_restore (backing_cr);
+
+#ifdef G_ENABLE_DEBUG
+  if (gtk_get_debug_flags () & GTK_DEBUG_PIXEL_CACHE)
+    {
+      GdkRGBA colors[] = {
+        { 1, 0, 0, 0.08},
+        { 0, 1, 0, 0.08},
+        { 0, 0, 1, 0.08},
+        { 1, 0, 1, 0.08},
+        { 1, 1, 0, 0.08},
+        { 0, 1, 1, 0.08},
+      };
+      static int current_color = 0;
+
+      gdk_cairo_set_source_rgba (backing_cr, &colors[(current_color++) % G_N_ELEMENTS (colors)]);
+      cairo_paint (backing_cr);
+    }
+#endif
+
+  cairo_destroy (backing_cr);
+}
+
+#ifdef G_ENABLE_DEBUG
+static guint64
+region_area (cairo_region_t *region)
+{
+  cairo_rectangle_int_t r;
+  guint64 area;
+  int i;
+
+  area = 0;
+  for (i = 0; i < cairo_region_num_rectangles (region); i++)
+    {
+      cairo_region_get_rectangle (region, i, &r);
+      area += (guint64) r.width * r.height;
+    }
+
+  return area;
+}
+
+/* Prints the totals of the previous frame once a new one starts,
+ * prefixed with the frame counter like the frame timings that
+ * GDK_DEBUG=frames prints.
+ */
+static void
+gtk_pixel_cache_stats_begin_frame (GdkWindow *window)
+{
+  GdkFrameClock *clock;
+  gint64 frame_counter;
+
+  clock = gdk_window_get_frame_clock (window);
+  frame_counter = clock ? gdk_frame_clock_get_frame_counter (clock) : 0;
+
+  if (frame_counter == frame_stats.frame_counter)
+    return;
+
+  if (frame_stats.view_area != 0 || frame_stats.prefetched_area != 0)
+    g_print ("%5" G_GINT64_FORMAT ": pixel cache hits=%.1f%% rendered=%" G_GUINT64_FORMAT
+             " (visible=%" G_GUINT64_FORMAT ") prefetched=%" G_GUINT64_FORMAT "\n",
+             frame_stats.frame_counter,
+             frame_stats.view_area ?
+               100. * (frame_stats.view_area - frame_stats.view_rendered_area) / frame_stats.view_area : 100.,
+             frame_stats.rendered_area,
+             frame_stats.view_rendered_area,
+             frame_stats.prefetched_area);
+
+  memset (&frame_stats, 0, sizeof (frame_stats));
+  frame_stats.frame_counter = frame_counter;
+}
+#endif
+
 static void
 _gtk_pixel_cache_repaint (GtkPixelCache         *cache,
                           GtkPixelCacheDrawFunc  draw,
@@ -332,7 +643,6 @@ _gtk_pixel_cache_repaint (GtkPixelCache         *cache,
                           cairo_rectangle_int_t *canvas_rect,
                           gpointer               user_data)
 {
-  cairo_t *backing_cr;
   cairo_region_t *region_dirty = cache->surface_dirty;
   cache->surface_dirty = NULL;
 
@@ -340,49 +650,185 @@ _gtk_pixel_cache_repaint (GtkPixelCache         *cache,
       region_dirty &&
       !cairo_region_is_empty (region_dirty))
     {
-      backing_cr = cairo_create (cache->surface);
-      gdk_cairo_region (backing_cr, region_dirty);
-      cairo_clip (backing_cr);
-      cairo_translate (backing_cr,
-                       -cache->surface_x - canvas_rect->x - view_rect->x,
-                       -cache->surface_y - canvas_rect->y - view_rect->y);
-
-      cairo_save (backing_cr);
-      cairo_set_source_rgba (backing_cr,
-                             0.0, 0, 0, 0.0);
-      cairo_set_operator (backing_cr, CAIRO_OPERATOR_SOURCE);
-      cairo_paint (backing_cr);
-      cairo_restore (backing_cr);
-
-      cairo_save (backing_cr);
-      draw (backing_cr, user_data);
-      cairo_restore (backing_cr);
-
 #ifdef G_ENABLE_DEBUG
       if (gtk_get_debug_flags () & GTK_DEBUG_PIXEL_CACHE)
         {
-          GdkRGBA colors[] = {
-            { 1, 0, 0, 0.08},
-            { 0, 1, 0, 0.08},
-            { 0, 0, 1, 0.08},
-            { 1, 0, 1, 0.08},
-            { 1, 1, 0, 0.08},
-            { 0, 1, 1, 0.08},
-          };
-          static int current_color = 0;
-
-          gdk_cairo_set_source_rgba (backing_cr, &colors[(current_color++) % G_N_ELEMENTS (colors)]);
-          cairo_paint (backing_cr);
+          cairo_rectangle_int_t r;
+          cairo_region_t *visible;
+
+          r.x = -canvas_rect->x - cache->surface_x;
+          r.y = -canvas_rect->y - cache->surface_y;
+          r.width = view_rect->width;
+          r.height = view_rect->height;
+
+          visible = cairo_region_copy (region_dirty);
+          cairo_region_intersect_rectangle (visible, &r);
+          frame_stats.view_rendered_area += region_area (visible);
+          frame_stats.rendered_area += region_area (region_dirty);
+          cairo_region_destroy (visible);
         }
 #endif
 
-      cairo_destroy (backing_cr);
+      gtk_pixel_cache_paint_region (cache, region_dirty, draw,
+                                    view_rect, canvas_rect, user_data);
     }
 
   if (region_dirty)
     cairo_region_destroy (region_dirty);
 }
 
+/* Returns the part of the surface the view is moving towards,
+ * at most @size pixels deep on each axis, in surface coordinates.
+ */
+static cairo_region_t *
+gtk_pixel_cache_get_ahead_region (GtkPixelCache *cache,
+                                  int            size)
+{
+  cairo_rectangle_int_t view, r;
+  cairo_region_t *region;
+
+  view.x = -cache->prefetch_canvas_rect.x - cache->surface_x;
+  view.y = -cache->prefetch_canvas_rect.y - cache->surface_y;
+  view.width = cache->prefetch_view_rect.width;
+  view.height = cache->prefetch_view_rect.height;
+
+  region = cairo_region_create ();
+
+  if (ABS (cache->velocity_x) >= MIN_SCROLL_VELOCITY)
+    {
+      r.y = 0;
+      r.height = cache->surface_h;
+      if (cache->velocity_x > 0)
+        {
+          r.x = view.x + view.width;
+          r.width = MIN (size, cache->surface_w - r.x);
+        }
+      else
+        {
+          r.x = MAX (view.x - size, 0);
+          r.width = view.x - r.x;
+        }
+      if (r.width > 0)
+        cairo_region_union_rectangle (region, &r);
+    }
+
+  if (ABS (cache->velocity_y) >= MIN_SCROLL_VELOCITY)
+    {
+      r.x = 0;
+      r.width = cache->surface_w;
+      if (cache->velocity_y > 0)
+        {
+          r.y = view.y + view.height;
+          r.height = MIN (size, cache->surface_h - r.y);
+        }
+      else
+        {
+          r.y = MAX (view.y - size, 0);
+          r.height = view.y - r.y;
+        }
+      if (r.height > 0)
+        cairo_region_union_rectangle (region, &r);
+    }
+
+  return region;
+}
+
+/* Renders the next strip ahead of the view. A strip covers about
+   two frames worth of movement, so each call stays short */
+static gboolean
+prefetch_cb (gpointer user_data)
+{
+  GtkPixelCache *cache = user_data;
+  cairo_region_t *region;
+  double velocity;
+  gboolean more;
+
+  if (cache->surface == NULL || cache->surface_dirty == NULL)
+    {
+      cache->prefetch_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  velocity = MAX (ABS (cache->velocity_x), ABS (cache->velocity_y));
+  region = gtk_pixel_cache_get_ahead_region (cache, MAX (PREFETCH_STEP, velocity / 30));
+  cairo_region_intersect (region, cache->surface_dirty);
+
+  if (!cairo_region_is_empty (region))
+    {
+#ifdef G_ENABLE_DEBUG
+      if (gtk_get_debug_flags () & GTK_DEBUG_PIXEL_CACHE)
+        frame_stats.prefetched_area += region_area (region);
+#endif
+
+      cairo_region_subtract (cache->surface_dirty, region);
+      gtk_pixel_cache_paint_region (cache, region, cache->prefetch_draw,
+                                    &cache->prefetch_view_rect,
+                                    &cache->prefetch_canvas_rect,
+                                    cache->prefetch_data);
+    }
+  cairo_region_destroy (region);
+
+  region = gtk_pixel_cache_get_ahead_region (cache, G_MAXINT);
+  cairo_region_intersect (region, cache->surface_dirty);
+  more = !cairo_region_is_empty (region);
+  cairo_region_destroy (region);
+
+  if (!more)
+    {
+      cache->prefetch_id = 0;
+      return G_SOURCE_REMOVE;
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Tracks how fast the view moves inside the canvas, and grows
+ * the prefetch size to match.
+ */
+static void
+gtk_pixel_cache_update_velocity (GtkPixelCache         *cache,
+                                 GdkWindow             *window,
+                                 cairo_rectangle_int_t *canvas_rect)
+{
+  GdkFrameClock *clock;
+  gint64 now;
+  double dt;
+  guint size;
+
+  clock = gdk_window_get_frame_clock (window);
+  now = clock ? gdk_frame_clock_get_frame_time (clock) : g_get_monotonic_time ();
+
+  /* Several draws in the same frame */
+  if (now == cache->view_time)
+    return;
+
+  if (cache->view_time != 0 &&
+      now - cache->view_time < VELOCITY_RESET_MSEC * 1000)
+    {
+      dt = (now - cache->view_time) / (double) G_USEC_PER_SEC;
+      cache->velocity_x = (cache->velocity_x + (-canvas_rect->x - cache->view_x) / dt) / 2;
+      cache->velocity_y = (cache->velocity_y + (-canvas_rect->y - cache->view_y) / dt) / 2;
+    }
+  else
+    {
+      cache->velocity_x = 0;
+      cache->velocity_y = 0;
+    }
+
+  cache->view_time = now;
+  cache->view_x = -canvas_rect->x;
+  cache->view_y = -canvas_rect->y;
+
+  /* Only ever grow here; the surface shrinks back when blown */
+  size = (guint) MIN (ABS (cache->velocity_x) * PREFETCH_TIME_MSEC / 1000, MAX_PREFETCH_SIZE);
+  size = (size + PREFETCH_STEP - 1) / PREFETCH_STEP * PREFETCH_STEP;
+  cache->prefetch_width = MAX (cache->prefetch_width, size);
+
+  size = (guint) MIN (ABS (cache->velocity_y) * PREFETCH_TIME_MSEC / 1000, MAX_PREFETCH_SIZE);
+  size = (size + PREFETCH_STEP - 1) / PREFETCH_STEP * PREFETCH_STEP;
+  cache->prefetch_height = MAX (cache->prefetch_height, size);
+}
+
 static void
 gtk_pixel_cache_blow_cache (GtkPixelCache *cache)
 {
@@ -392,14 +838,15 @@ gtk_pixel_cache_blow_cache (GtkPixelCache *cache)
       cache->timeout_tag = 0;
     }
 
-  if (cache->surface)
-    {
-      cairo_surface_destroy (cache->surface);
-      cache->surface = NULL;
-      if (cache->surface_dirty)
-        cairo_region_destroy (cache->surface_dirty);
-      cache->surface_dirty = NULL;
-    }
+  gtk_pixel_cache_stop_prefetch (cache);
+
+  cache->view_time = 0;
+  cache->velocity_x = 0;
+  cache->velocity_y = 0;
+  cache->prefetch_width = 0;
+  cache->prefetch_height = 0;
+
+  gtk_pixel_cache_destroy_surface (cache);
 }
 
 static gboolean
@@ -444,8 +891,27 @@ _gtk_pixel_cache_draw (GtkPixelCache         *cache,
                                               blow_cache_cb, cache);
   g_source_set_name_by_id (cache->timeout_tag, "[gtk+] blow_cache_cb");
 
+#ifdef G_ENABLE_DEBUG
+  if (gtk_get_debug_flags () & GTK_DEBUG_PIXEL_CACHE)
+    {
+      gtk_pixel_cache_stats_begin_frame (window);
+      frame_stats.view_area += (guint64) view_rect->width * view_rect->height;
+    }
+#endif
+
+  if (cache->prefetch)
+    gtk_pixel_cache_update_velocity (cache, window, canvas_rect);
+
   _gtk_pixel_cache_create_surface_if_needed (cache, window,
                                              view_rect, canvas_rect);
+
+  /* Most recently drawn caches go first */
+  if (cache->retained_size && retained_caches.head != &cache->retained_link)
+    {
+      g_queue_unlink (&retained_caches, &cache->retained_link);
+      g_queue_push_head_link (&retained_caches, &cache->retained_link);
+    }
+
   _gtk_pixel_cache_set_position (cache, view_rect, canvas_rect);
   _gtk_pixel_cache_repaint (cache, draw, view_rect, canvas_rect, user_data);
 
@@ -469,6 +935,30 @@ _gtk_pixel_cache_draw (GtkPixelCache         *cache,
                        view_rect->width, view_rect->height);
       cairo_clip (cr);
       draw (cr, user_data);
+
+#ifdef G_ENABLE_DEBUG
+      if (gtk_get_debug_flags () & GTK_DEBUG_PIXEL_CACHE)
+        {
+          frame_stats.view_rendered_area += (guint64) view_rect->width * view_rect->height;
+          frame_stats.rendered_area += (guint64) view_rect->width * view_rect->height;
+        }
+#endif
+    }
+
+  if (cache->prefetch && cache->surface &&
+      (ABS (cache->velocity_x) >= MIN_SCROLL_VELOCITY ||
+       ABS (cache->velocity_y) >= MIN_SCROLL_VELOCITY))
+    {
+      cache->prefetch_draw = draw;
+      cache->prefetch_data = user_data;
+      cache->prefetch_view_rect = *view_rect;
+      cache->prefetch_canvas_rect = *canvas_rect;
+
+      if (cache->prefetch_id == 0)
+        {
+          cache->prefetch_id = gdk_threads_add_idle (prefetch_cb, cache);
+          g_source_set_name_by_id (cache->prefetch_id, "[gtk+] prefetch_cb");
+        }
     }
 }
 
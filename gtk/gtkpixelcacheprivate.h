@@ -51,6 +51,11 @@ void           _gtk_pixel_cache_set_extra_size (GtkPixelCache         *cache,
                                                 guint                  extra_height);
 void           _gtk_pixel_cache_set_content    (GtkPixelCache         *cache,
                                                 cairo_content_t        content);
+void           _gtk_pixel_cache_set_always_cache (GtkPixelCache       *cache,
+                                                  gboolean             always_cache);
+void           _gtk_pixel_cache_set_prefetch   (GtkPixelCache         *cache,
+                                                gboolean               prefetch);
+void           _gtk_pixel_cache_view_moved     (GtkPixelCache         *cache);
 
 
 G_END_DECLS
@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gtkprofilerprivate.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <glib/gstdio.h>
+
+/* If GTK_PROFILE is set to a file name, we record the phases of every
+ * frame and the style, size request and draw work done for every
+ * widget. The last RING_SIZE records and the totals of every widget
+ * are written to that file when the application exits, in the trace
+ * event format that chrome://tracing reads.
+ */
+
+#define RING_SIZE 65536
+
+typedef struct {
+  const gchar *name;
+  const gchar *type_name;  /* NULL for frame phases */
+  gconstpointer object;
+  gint64 start_time;
+  gint64 duration;
+} Record;
+
+typedef struct {
+  const gchar *type_name;
+  gconstpointer widget;
+  guint count[GTK_PROFILER_N_COUNTERS];
+  gint64 time[GTK_PROFILER_N_COUNTERS];
+} WidgetCounters;
+
+static const gchar *counter_names[GTK_PROFILER_N_COUNTERS] = {
+  "style",
+  "size-request",
+  "draw"
+};
+
+static const struct {
+  GdkFrameClockPhase phase;
+  const gchar *name;
+} phases[] = {
+  { GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS, "flush-events" },
+  { GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT, "before-paint" },
+  { GDK_FRAME_CLOCK_PHASE_UPDATE, "update" },
+  { GDK_FRAME_CLOCK_PHASE_LAYOUT, "layout" },
+  { GDK_FRAME_CLOCK_PHASE_PAINT, "paint" },
+  { GDK_FRAME_CLOCK_PHASE_AFTER_PAINT, "after-paint" },
+  { GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS, "resume-events" }
+};
+
+static gint running = -1;
+static gchar *profile_file;
+static Record *records;
+static guint64 n_records;
+static GHashTable *widgets;         /* GtkWidget -> WidgetCounters */
+static GPtrArray *finalized_widgets;
+
+static void gtk_profiler_dump (void);
+
+gboolean
+_gtk_profiler_is_running (void)
+{
+  const gchar *env;
+
+  if (G_LIKELY (running >= 0))
+    return running;
+
+  env = g_getenv ("GTK_PROFILE");
+  running = env != NULL && env[0] != '\0';
+
+  if (running)
+    {
+      profile_file = g_strdup (env);
+      records = g_new0 (Record, RING_SIZE);
+      widgets = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+      finalized_widgets = g_ptr_array_new_with_free_func (g_free);
+      atexit (gtk_profiler_dump);
+    }
+
+  return running;
+}
+
+static void
+add_record (const gchar   *name,
+            const gchar   *type_name,
+            gconstpointer  object,
+            gint64         start_time,
+            gint64         duration)
+{
+  Record *record;
+
+  record = &records[n_records % RING_SIZE];
+  n_records++;
+
+  record->name = name;
+  record->type_name = type_name;
+  record->object = object;
+  record->start_time = start_time;
+  record->duration = duration;
+}
+
+/* Returns the time to pass to _gtk_profiler_end(), 0 if we're
+ * not profiling
+ */
+gint64
+_gtk_profiler_begin (void)
+{
+  if (!_gtk_profiler_is_running ())
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+void
+_gtk_profiler_end (GtkProfilerCounter  counter,
+                   GtkWidget          *widget,
+                   gint64              start_time)
+{
+  WidgetCounters *counters;
+  gint64 duration;
+
+  if (start_time == 0)
+    return;
+
+  duration = g_get_monotonic_time () - start_time;
+
+  add_record (counter_names[counter],
+              widget ? G_OBJECT_TYPE_NAME (widget) : "",
+              widget, start_time, duration);
+
+  if (widget == NULL)
+    return;
+
+  counters = g_hash_table_lookup (widgets, widget);
+  if (counters == NULL)
+    {
+      counters = g_new0 (WidgetCounters, 1);
+      counters->type_name = G_OBJECT_TYPE_NAME (widget);
+      counters->widget = widget;
+      g_hash_table_insert (widgets, widget, counters);
+    }
+
+  counters->count[counter]++;
+  counters->time[counter] += duration;
+}
+
+/* Keeps the totals of @widget, but stops looking them up by
+ * address, as a new widget may get the same one.
+ */
+void
+_gtk_profiler_forget_widget (GtkWidget *widget)
+{
+  gpointer counters;
+
+  if (!_gtk_profiler_is_running ())
+    return;
+
+  counters = g_hash_table_lookup (widgets, widget);
+  if (counters)
+    {
+      g_hash_table_steal (widgets, widget);
+      g_ptr_array_add (finalized_widgets, counters);
+    }
+}
+
+/* The phases of a frame are complete once the next frame is
+ * painted, so we record them one frame late.
+ */
+static void
+after_paint (GdkFrameClock *clock,
+             gpointer       data)
+{
+  GdkFrameTimings *timings;
+  gint64 start, end, phase_start;
+  guint i;
+
+  timings = gdk_frame_clock_get_timings (clock, gdk_frame_clock_get_frame_counter (clock) - 1);
+  if (timings == NULL)
+    return;
+
+  start = end = 0;
+
+  for (i = 0; i < G_N_ELEMENTS (phases); i++)
+    {
+      phase_start = gdk_frame_timings_get_phase_start_time (timings, phases[i].phase);
+      if (phase_start == 0)
+        continue;
+
+      add_record (phases[i].name, NULL, clock, phase_start,
+                  gdk_frame_timings_get_phase_duration (timings, phases[i].phase));
+
+      if (start == 0 || phase_start < start)
+        start = phase_start;
+      end = MAX (end, phase_start + gdk_frame_timings_get_phase_duration (timings, phases[i].phase));
+    }
+
+  if (start != 0)
+    add_record ("frame", NULL, clock, start, end - start);
+}
+
+void
+_gtk_profiler_add_frame_clock (GdkFrameClock *clock)
+{
+  if (!_gtk_profiler_is_running ())
+    return;
+
+  if (g_object_get_data (G_OBJECT (clock), "gtk-profiler"))
+    return;
+
+  g_object_set_data (G_OBJECT (clock), "gtk-profiler", GINT_TO_POINTER (TRUE));
+  g_signal_connect (clock, "after-paint", G_CALLBACK (after_paint), NULL);
+}
+
+static void
+dump_counters (FILE           *file,
+               WidgetCounters *counters,
+               gboolean        first)
+{
+  guint i;
+
+  fprintf (file, "%s\n    { \"widget\": \"%s\", \"id\": \"%p\"",
+           first ? "" : ",", counters->type_name, counters->widget);
+
+  for (i = 0; i < GTK_PROFILER_N_COUNTERS; i++)
+    fprintf (file, ", \"%s\": { \"count\": %u, \"time\": %" G_GINT64_FORMAT " }",
+             counter_names[i], counters->count[i], counters->time[i]);
+
+  fprintf (file, " }");
+}
+
+static void
+gtk_profiler_dump (void)
+{
+  GHashTableIter iter;
+  gpointer value;
+  Record *record;
+  guint64 i, first;
+  gboolean first_counters;
+  FILE *file;
+
+  file = g_fopen (profile_file, "w");
+  if (file == NULL)
+    {
+      g_warning ("Could not write profile to %s: %s",
+                 profile_file, g_strerror (errno));
+      return;
+    }
+
+  fprintf (file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [");
+
+  first = n_records > RING_SIZE ? n_records - RING_SIZE : 0;
+  for (i = first; i < n_records; i++)
+    {
+      record = &records[i % RING_SIZE];
+
+      fprintf (file, "%s\n    { \"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\", "
+               "\"ts\": %" G_GINT64_FORMAT ", \"dur\": %" G_GINT64_FORMAT ", "
+               "\"pid\": 0, \"tid\": 0",
+               i == first ? "" : ",",
+               record->name,
+               record->type_name ? "widget" : "frame",
+               record->start_time, record->duration);
+
+      if (record->type_name)
+        fprintf (file, ", \"args\": { \"widget\": \"%s\", \"id\": \"%p\" }",
+                 record->type_name, record->object);
+
+      fprintf (file, " }");
+    }
+
+  fprintf (file, "\n  ],\n  \"widgetCounters\": [");
+
+  first_counters = TRUE;
+  for (i = 0; i < finalized_widgets->len; i++)
+    {
+      dump_counters (file, g_ptr_array_index (finalized_widgets, i), first_counters);
+      first_counters = FALSE;
+    }
+
+  g_hash_table_iter_init (&iter, widgets);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      dump_counters (file, value, first_counters);
+      first_counters = FALSE;
+    }
+
+  fprintf (file, "\n  ]\n}\n");
+  fclose (file);
+}
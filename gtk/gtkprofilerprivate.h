@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_PROFILER_PRIVATE_H__
+#define __GTK_PROFILER_PRIVATE_H__
+
+#include <gtk/gtkwidget.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  GTK_PROFILER_STYLE,
+  GTK_PROFILER_SIZE_REQUEST,
+  GTK_PROFILER_DRAW,
+  GTK_PROFILER_N_COUNTERS
+} GtkProfilerCounter;
+
+gboolean _gtk_profiler_is_running       (void);
+
+gint64   _gtk_profiler_begin            (void);
+void     _gtk_profiler_end              (GtkProfilerCounter  counter,
+                                         GtkWidget          *widget,
+                                         gint64              start_time);
+
+void     _gtk_profiler_add_frame_clock  (GdkFrameClock      *clock);
+void     _gtk_profiler_forget_widget    (GtkWidget          *widget);
+
+G_END_DECLS
+
+#endif /* __GTK_PROFILER_PRIVATE_H__ */
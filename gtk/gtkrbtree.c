@@ -556,6 +556,81 @@ _gtk_rbtree_insert_before (GtkRBTree *tree,
   return node;
 }
 
+static GtkRBNode *
+gtk_rbtree_fill_helper (GtkRBTree *tree,
+                        GtkRBNode *parent,
+                        guint      n_nodes,
+                        guint      depth,
+                        guint      n_full_levels,
+                        gint       height,
+                        gboolean   valid)
+{
+  GtkRBNode *node;
+  guint n_left;
+
+  if (n_nodes == 0)
+    return (GtkRBNode *) &nil;
+
+  node = _gtk_rbnode_new (tree, height);
+  node->parent = parent;
+
+  /* Nodes below the full levels are leaves whose parents are
+   * black, so making them red keeps the black height the same
+   * on all paths */
+  if (depth <= n_full_levels)
+    GTK_RBNODE_SET_COLOR (node, GTK_RBNODE_BLACK);
+  if (!valid)
+    GTK_RBNODE_SET_FLAG (node, GTK_RBNODE_INVALID | GTK_RBNODE_DESCENDANTS_INVALID);
+
+  n_left = (n_nodes - 1) / 2;
+  node->left = gtk_rbtree_fill_helper (tree, node, n_left, depth + 1,
+                                       n_full_levels, height, valid);
+  node->right = gtk_rbtree_fill_helper (tree, node, n_nodes - 1 - n_left, depth + 1,
+                                        n_full_levels, height, valid);
+
+  node->count = n_nodes;
+  node->total_count = n_nodes;
+  node->offset = height + node->left->offset + node->right->offset;
+
+  return node;
+}
+
+/* Fills the empty tree with n_nodes nodes of the given height at
+ * once. Splitting the nodes evenly gives a tree where all levels
+ * but the last one are full, so it is built in O(n) without any
+ * rotations.
+ */
+void
+_gtk_rbtree_fill (GtkRBTree *tree,
+                  guint      n_nodes,
+                  gint       height,
+                  gboolean   valid)
+{
+  guint n_full_levels;
+
+  g_return_if_fail (tree != NULL);
+  g_return_if_fail (_gtk_rbtree_is_nil (tree->root));
+
+  if (n_nodes == 0)
+    return;
+
+  for (n_full_levels = 0;
+       ((guint64) 2 << n_full_levels) - 1 <= n_nodes;
+       n_full_levels++)
+    ;
+
+  tree->root = gtk_rbtree_fill_helper (tree, (GtkRBNode *) &nil, n_nodes, 1,
+                                       n_full_levels, height, valid);
+
+  gtk_rbnode_adjust (tree->parent_tree, tree->parent_node,
+                     0, n_nodes, tree->root->offset);
+
+#ifdef G_ENABLE_DEBUG  
+  if (gtk_get_debug_flags () & GTK_DEBUG_TREE)
+    _gtk_rbtree_test (G_STRLOC, tree);
+#endif
+}
+
 GtkRBNode *
 _gtk_rbtree_find_count (GtkRBTree *tree,
 			gint       count)
@@ -738,31 +813,62 @@ _gtk_rbtree_mark_invalid (GtkRBTree *tree)
   while ((node = _gtk_rbtree_next (tree, node)) != NULL);
 }
 
+static void
+gtk_rbnode_set_fixed_height (GtkRBTree *tree,
+                             GtkRBNode *node,
+                             gint       height,
+                             gboolean   mark_valid)
+{
+  gint node_height;
+
+  if (_gtk_rbtree_is_nil (node))
+    return;
+
+  node_height = GTK_RBNODE_GET_HEIGHT (node);
+  if (GTK_RBNODE_FLAG_SET (node, GTK_RBNODE_INVALID))
+    {
+      node_height = height;
+      if (mark_valid)
+        {
+          GTK_RBNODE_UNSET_FLAG (node, GTK_RBNODE_INVALID);
+          GTK_RBNODE_UNSET_FLAG (node, GTK_RBNODE_COLUMN_INVALID);
+        }
+    }
+
+  gtk_rbnode_set_fixed_height (tree, node->left, height, mark_valid);
+  gtk_rbnode_set_fixed_height (tree, node->right, height, mark_valid);
+  if (node->children)
+    gtk_rbnode_set_fixed_height (node->children, node->children->root, height, mark_valid);
+
+  node->offset = node_height + node->left->offset + node->right->offset +
+                 (node->children ? node->children->root->offset : 0);
+  _fixup_validation (tree, node);
+}
+
+/* Sets the height of all invalid nodes in one pass over the tree,
+ * instead of walking up to the root for every node.
+ */
 void
 _gtk_rbtree_set_fixed_height (GtkRBTree *tree,
 			      gint       height,
 			      gboolean   mark_valid)
 {
-  GtkRBNode *node;
+  gint old_offset;
 
-  if (tree == NULL)
+  if (tree == NULL || _gtk_rbtree_is_nil (tree->root))
     return;
 
-  node = _gtk_rbtree_first (tree);
+  old_offset = tree->root->offset;
 
-  do
-    {
-      if (GTK_RBNODE_FLAG_SET (node, GTK_RBNODE_INVALID))
-        {
-	  _gtk_rbtree_node_set_height (tree, node, height);
-	  if (mark_valid)
-	    _gtk_rbtree_node_mark_valid (tree, node);
-	}
+  gtk_rbnode_set_fixed_height (tree, tree->root, height, mark_valid);
 
-      if (node->children)
-	_gtk_rbtree_set_fixed_height (node->children, height, mark_valid);
-    }
-  while ((node = _gtk_rbtree_next (tree, node)) != NULL);
+  gtk_rbnode_adjust (tree->parent_tree, tree->parent_node,
+                     0, 0, tree->root->offset - old_offset);
+
+#ifdef G_ENABLE_DEBUG  
+  if (gtk_get_debug_flags () & GTK_DEBUG_TREE)
+    _gtk_rbtree_test (G_STRLOC, tree);
+#endif
 }
 
 static void
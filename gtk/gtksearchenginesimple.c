@@ -21,19 +21,20 @@
 
 #include "config.h"
 
-#ifdef HAVE_FTW_H
-#include <ftw.h>
-#endif
-
 #include <gdk/gdk.h>
 
 #include "gtksearchenginesimple.h"
+#include "gtksearchindex.h"
 #include "gtkprivate.h"
 
 #include <string.h>
 
 #define BATCH_SIZE 500
 
+/* Upper bound for the crawler threads, disks
+ * don't get faster with more of them */
+#define MAX_CRAWL_THREADS 8
+
 typedef struct 
 {
   GtkSearchEngineSimple *engine;
@@ -42,9 +43,6 @@ typedef struct
   gchar **words;
   GList *found_list;
   
-  gint n_processed_files;
-  GList *uri_hits;
-  
   /* accessed on both threads: */
   volatile gboolean cancelled;
 } SearchThreadData;
@@ -114,7 +112,7 @@ search_thread_data_new (GtkSearchEngineSimple *engine,
   return data;
 }
 
-#ifdef HAVE_FTW_H
+#ifdef G_OS_UNIX
 static void 
 search_thread_data_free (SearchThreadData *data)
 {
@@ -165,123 +163,335 @@ search_thread_add_hits_idle (gpointer user_data)
   return FALSE;
 }
 
+typedef struct
+{
+  gchar *path;
+  guint32 index_id;
+} CrawlDir;
+
+/* State shared by the threads crawling a directory tree */
+typedef struct
+{
+  SearchThreadData *data;
+
+  GMutex lock;
+  GCond cond;
+
+  /* directories that haven't been read yet */
+  GQueue dirs;
+  /* number of threads that are reading a directory */
+  guint n_busy;
+
+  /* the index being built, or %NULL */
+  GtkSearchIndex *index;
+} Crawl;
+
+/* Hits are collected per thread and sent in batches */
+typedef struct
+{
+  SearchThreadData *data;
+  Crawl *crawl;
+
+  gint n_processed_files;
+  GList *uri_hits;
+} SearchWorker;
+
 static void
-send_batch (SearchThreadData *data)
+send_batch (SearchWorker *worker)
 {
   SearchHits *hits;
   
-  data->n_processed_files = 0;
+  worker->n_processed_files = 0;
   
-  if (data->uri_hits) 
+  if (worker->uri_hits) 
     {
       guint id;
 
       hits = g_new (SearchHits, 1);
-      hits->uris = data->uri_hits;
-      hits->thread_data = data;
+      hits->uris = worker->uri_hits;
+      hits->thread_data = worker->data;
       
       id = gdk_threads_add_idle (search_thread_add_hits_idle, hits);
       g_source_set_name_by_id (id, "[gtk+] search_thread_add_hits_idle");
     }
 
-  data->uri_hits = NULL;
+  worker->uri_hits = NULL;
 }
 
-static GPrivate search_thread_data;
+static void
+add_hit (SearchWorker *worker,
+         const gchar  *path)
+{
+  gchar *uri;
+
+  uri = g_filename_to_uri (path, NULL, NULL);
+  if (uri)
+    worker->uri_hits = g_list_prepend (worker->uri_hits, uri);
+}
 
-static int
-search_visit_func (const char        *fpath,
-		   const struct stat *sb,
-		   int                typeflag,
-		   struct FTW        *ftwbuf)
+static gboolean
+is_hit (SearchThreadData *data,
+        const gchar      *name)
 {
-  SearchThreadData *data;
-  gint i;
-  const gchar *name;
   gchar *lower_name;
-  gchar *uri;
   gboolean hit;
-  gboolean is_hidden;
+  gint i;
 
-  data = (SearchThreadData*)g_private_get (&search_thread_data);
+  lower_name = g_ascii_strdown (name, -1);
 
-  if (data->cancelled)
-#ifdef HAVE_GNU_FTW
-    return FTW_STOP;
-#else
-    return 1;
-#endif /* HAVE_GNU_FTW */
+  hit = TRUE;
+  for (i = 0; data->words[i] != NULL; i++) 
+    {
+      if (strstr (lower_name, data->words[i]) == NULL) 
+        {
+          hit = FALSE;
+          break;
+        }
+    }
 
-  name = strrchr (fpath, '/');
-  if (name)
-    name++;
-  else
-    name = fpath;
+  g_free (lower_name);
 
-  is_hidden = *name == '.';
-	
-  hit = FALSE;
-  
-  if (!is_hidden) 
+  return hit;
+}
+
+static CrawlDir *
+crawl_dir_new (gchar   *path,
+               guint32  index_id)
+{
+  CrawlDir *dir;
+
+  dir = g_slice_new (CrawlDir);
+  dir->path = path;
+  dir->index_id = index_id;
+
+  return dir;
+}
+
+static void
+crawl_dir_free (CrawlDir *dir)
+{
+  g_free (dir->path);
+  g_slice_free (CrawlDir, dir);
+}
+
+/* Waits until there is a directory to read, returns %NULL
+ * when the crawl is done or cancelled */
+static CrawlDir *
+crawl_next_dir (Crawl *crawl)
+{
+  CrawlDir *dir = NULL;
+
+  g_mutex_lock (&crawl->lock);
+
+  while (!crawl->data->cancelled)
     {
-      lower_name = g_ascii_strdown (name, -1);
-      
-      hit = TRUE;
-      for (i = 0; data->words[i] != NULL; i++) 
-	{
-	  if (strstr (lower_name, data->words[i]) == NULL) 
-	    {
-	      hit = FALSE;
-	      break;
-	    }
-	}
-      g_free (lower_name);
+      dir = g_queue_pop_head (&crawl->dirs);
+      if (dir)
+        {
+          crawl->n_busy++;
+          break;
+        }
+
+      if (crawl->n_busy == 0)
+        break;
+
+      g_cond_wait (&crawl->cond, &crawl->lock);
     }
 
-  if (hit) 
+  g_mutex_unlock (&crawl->lock);
+
+  return dir;
+}
+
+static void
+crawl_directory (SearchWorker *worker,
+                 CrawlDir     *dir)
+{
+  Crawl *crawl = worker->crawl;
+  GPtrArray *files, *dirs;
+  guint32 *dir_ids;
+  gint64 mtime = 0;
+  gchar *path;
+  guint i;
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  dirs = g_ptr_array_new_with_free_func (g_free);
+
+  _gtk_search_read_directory (dir->path, &mtime, files, dirs);
+
+  for (i = 0; i < files->len + dirs->len; i++)
     {
-      uri = g_filename_to_uri (fpath, NULL, NULL);
-      data->uri_hits = g_list_prepend (data->uri_hits, uri);
+      const gchar *name;
+
+      if (i < files->len)
+        name = g_ptr_array_index (files, i);
+      else
+        name = g_ptr_array_index (dirs, i - files->len);
+
+      if (is_hit (worker->data, name))
+        {
+          path = g_build_filename (dir->path, name, NULL);
+          add_hit (worker, path);
+          g_free (path);
+        }
     }
 
-  data->n_processed_files++;
-  
-  if (data->n_processed_files > BATCH_SIZE)
-    send_batch (data);
-
-#ifdef HAVE_GNU_FTW
-  if (is_hidden)
-    return FTW_SKIP_SUBTREE;
-  else
-    return FTW_CONTINUE;
-#else
-  return 0;
-#endif /* HAVE_GNU_FTW */
+  worker->n_processed_files += files->len + dirs->len;
+  if (worker->n_processed_files > BATCH_SIZE)
+    send_batch (worker);
+
+  dir_ids = g_new0 (guint32, dirs->len);
+
+  g_mutex_lock (&crawl->lock);
+
+  if (crawl->index &&
+      !_gtk_search_index_add_directory (crawl->index, dir->index_id, mtime,
+                                        files, dirs, dir_ids))
+    {
+      _gtk_search_index_unref (crawl->index);
+      crawl->index = NULL;
+    }
+
+  /* Going depth first keeps the queue short */
+  for (i = 0; i < dirs->len; i++)
+    {
+      path = g_build_filename (dir->path, g_ptr_array_index (dirs, i), NULL);
+      g_queue_push_head (&crawl->dirs, crawl_dir_new (path, dir_ids[i]));
+    }
+
+  crawl->n_busy--;
+  g_cond_broadcast (&crawl->cond);
+
+  g_mutex_unlock (&crawl->lock);
+
+  g_free (dir_ids);
+  g_ptr_array_unref (files);
+  g_ptr_array_unref (dirs);
 }
-#endif /* HAVE_FTW_H */
+
+static gpointer
+crawl_thread_func (gpointer user_data)
+{
+  SearchWorker *worker = user_data;
+  CrawlDir *dir;
+
+  while ((dir = crawl_next_dir (worker->crawl)) != NULL)
+    {
+      crawl_directory (worker, dir);
+      crawl_dir_free (dir);
+    }
+
+  send_batch (worker);
+
+  return NULL;
+}
+
+static void
+search_crawl (SearchThreadData *data)
+{
+  Crawl crawl = { 0, };
+  SearchWorker *workers;
+  GThread **threads;
+  CrawlDir *dir;
+  guint i, n_threads;
+
+  crawl.data = data;
+  g_mutex_init (&crawl.lock);
+  g_cond_init (&crawl.cond);
+  g_queue_init (&crawl.dirs);
+
+  if (_gtk_search_index_enabled ())
+    crawl.index = _gtk_search_index_new (data->path);
+
+  g_queue_push_head (&crawl.dirs, crawl_dir_new (g_strdup (data->path), 0));
+
+  n_threads = CLAMP (g_get_num_processors (), 2, MAX_CRAWL_THREADS);
+  workers = g_new0 (SearchWorker, n_threads);
+  threads = g_new0 (GThread *, n_threads);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      workers[i].data = data;
+      workers[i].crawl = &crawl;
+    }
+
+  /* This thread is one of the crawlers */
+  for (i = 1; i < n_threads; i++)
+    threads[i] = g_thread_new ("file-search", crawl_thread_func, &workers[i]);
+  crawl_thread_func (&workers[0]);
+  for (i = 1; i < n_threads; i++)
+    g_thread_join (threads[i]);
+
+  if (crawl.index)
+    {
+      if (!data->cancelled)
+        _gtk_search_index_publish (crawl.index);
+      else
+        _gtk_search_index_unref (crawl.index);
+    }
+
+  while ((dir = g_queue_pop_head (&crawl.dirs)) != NULL)
+    crawl_dir_free (dir);
+
+  g_free (threads);
+  g_free (workers);
+  g_cond_clear (&crawl.cond);
+  g_mutex_clear (&crawl.lock);
+}
+
+static void
+index_hit (const gchar *path,
+           gpointer     user_data)
+{
+  SearchWorker *worker = user_data;
+
+  add_hit (worker, path);
+
+  worker->n_processed_files++;
+  if (worker->n_processed_files > BATCH_SIZE)
+    send_batch (worker);
+}
+
+static gboolean
+search_index (SearchThreadData *data)
+{
+  SearchWorker worker = { 0, };
+  GtkSearchIndex *index;
+  gboolean result;
+
+  if (!_gtk_search_index_enabled ())
+    return FALSE;
+
+  index = _gtk_search_index_lookup (data->path);
+  if (index == NULL)
+    return FALSE;
+
+  worker.data = data;
+  result = _gtk_search_index_search (index, data->path, data->words,
+                                     &data->cancelled, index_hit, &worker);
+  send_batch (&worker);
+
+  _gtk_search_index_unref (index);
+
+  return result;
+}
+#endif /* G_OS_UNIX */
 
 static gpointer 
 search_thread_func (gpointer user_data)
 {
-#ifdef HAVE_FTW_H
+#ifdef G_OS_UNIX
   guint id;
   SearchThreadData *data;
   
   data = user_data;
-  
-  g_private_set (&search_thread_data, data);
-
-  nftw (data->path, search_visit_func, 20,
-#ifdef HAVE_GNU_FTW
-        FTW_ACTIONRETVAL |
-#endif
-        FTW_PHYS);
 
-  send_batch (data);
+  if (!search_index (data))
+    search_crawl (data);
   
   id = gdk_threads_add_idle (search_thread_done_idle, data);
   g_source_set_name_by_id (id, "[gtk+] search_thread_done_idle");
-#endif /* HAVE_FTW_H */
+#endif /* G_OS_UNIX */
   
   return NULL;
 }
@@ -369,7 +579,7 @@ _gtk_search_engine_simple_init (GtkSearchEngineSimple *engine)
 GtkSearchEngine *
 _gtk_search_engine_simple_new (void)
 {
-#ifdef HAVE_FTW_H
+#ifdef G_OS_UNIX
   return g_object_new (GTK_TYPE_SEARCH_ENGINE_SIMPLE, NULL);
 #else
   return NULL;
@@ -0,0 +1,1293 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* An index of the file names below a directory, for the simple search
+ * engine. It maps each trigram of a lowercased name to the sorted list
+ * of entries whose name contains it, so a search only has to look at
+ * the names that contain all trigrams of the search words.
+ *
+ * Indexes are built from the results of a complete crawl, shared by
+ * all searches in the process, and saved in the user's cache
+ * directory. Directories are watched with GFileMonitor, up to a limit;
+ * the other directories are checked for a changed mtime before each
+ * search. Changed directories are read again, entries that went away
+ * are only marked as deleted.
+ */
+
+#include "config.h"
+
+#include "gtksearchindex.h"
+
+#ifdef G_OS_UNIX
+
+#include <gdk/gdk.h>
+#include <glib/gstdio.h>
+
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define INDEX_MAGIC "GtkSIdx1"
+
+#define NO_PARENT G_MAXUINT32
+
+/* Bigger trees are crawled for every search */
+#define MAX_ENTRIES (4 * 1024 * 1024)
+
+/* inotify watches are a limited resource */
+#define MAX_MONITORS 1024
+
+enum {
+  ENTRY_DIR       = 1 << 0,
+  ENTRY_DELETED   = 1 << 1,
+  ENTRY_MONITORED = 1 << 2,
+  ENTRY_DIRTY     = 1 << 3
+};
+
+/* Flags that are saved */
+#define ENTRY_PERSISTENT_FLAGS (ENTRY_DIR | ENTRY_DELETED)
+
+typedef struct
+{
+  guint32 parent;
+  guint32 name;   /* offset into names */
+  guint32 flags;
+  guint32 padding;
+  gint64  mtime;  /* directories only */
+} IndexEntry;
+
+typedef struct
+{
+  gchar   magic[8];
+  guint32 root_len;
+  guint32 n_entries;
+  guint32 names_len;
+  guint32 n_trigrams;
+} IndexHeader;
+
+struct _GtkSearchIndex
+{
+  volatile gint ref_count;
+
+  /* protects everything below, searches hold it while they run */
+  GMutex lock;
+
+  gchar *root;
+  GArray *entries;
+  GString *names;
+  guint n_deleted;
+
+  /* trigram -> GArray of entry ids, built on publishing */
+  GHashTable *trigrams;
+
+  /* entry id -> GFileMonitor, only used on the main thread */
+  GHashTable *monitors;
+
+  /* ids of directories that monitors reported as changed. This
+   * has its own lock, so the main thread never waits for a search */
+  GMutex dirty_lock;
+  GHashTable *dirty;
+
+  guint full           : 1;
+  guint retired        : 1;
+  guint monitors_queued : 1;
+};
+
+G_LOCK_DEFINE_STATIC (indexes);
+static GHashTable *indexes = NULL;
+
+gboolean
+_gtk_search_read_directory (const gchar *path,
+                            gint64      *mtime,
+                            GPtrArray   *files,
+                            GPtrArray   *dirs)
+{
+  struct dirent *dirent;
+  struct stat st;
+  DIR *dir;
+
+  dir = opendir (path);
+  if (dir == NULL)
+    return FALSE;
+
+  if (mtime)
+    *mtime = fstat (dirfd (dir), &st) == 0 ? st.st_mtime : 0;
+
+  while ((dirent = readdir (dir)) != NULL)
+    {
+      const gchar *name = dirent->d_name;
+      gboolean is_dir;
+
+      /* Hidden files aren't searched, this also skips . and .. */
+      if (name[0] == '.')
+        continue;
+
+#ifdef DT_UNKNOWN
+      if (dirent->d_type != DT_UNKNOWN)
+        is_dir = dirent->d_type == DT_DIR;
+      else
+#endif
+        {
+          gchar *child;
+
+          /* Don't follow symlinks */
+          child = g_build_filename (path, name, NULL);
+          is_dir = g_lstat (child, &st) == 0 && S_ISDIR (st.st_mode);
+          g_free (child);
+        }
+
+      g_ptr_array_add (is_dir ? dirs : files, g_strdup (name));
+    }
+
+  closedir (dir);
+
+  return TRUE;
+}
+
+gboolean
+_gtk_search_index_enabled (void)
+{
+  static gsize enabled = 0;
+
+  if (g_once_init_enter (&enabled))
+    g_once_init_leave (&enabled, g_getenv ("GTK_FILE_SEARCH_INDEX") ? 2 : 1);
+
+  return enabled == 2;
+}
+
+static inline IndexEntry *
+get_entry (GtkSearchIndex *index,
+           guint32         id)
+{
+  return &g_array_index (index->entries, IndexEntry, id);
+}
+
+static inline const gchar *
+get_entry_name (GtkSearchIndex *index,
+                guint32         id)
+{
+  return index->names->str + get_entry (index, id)->name;
+}
+
+static void
+append_entry_path (GtkSearchIndex *index,
+                   GString        *path,
+                   guint32         id)
+{
+  IndexEntry *entry = get_entry (index, id);
+
+  if (entry->parent == NO_PARENT)
+    {
+      g_string_append (path, index->root);
+      return;
+    }
+
+  append_entry_path (index, path, entry->parent);
+  if (path->len == 0 || path->str[path->len - 1] != G_DIR_SEPARATOR)
+    g_string_append_c (path, G_DIR_SEPARATOR);
+  g_string_append (path, get_entry_name (index, id));
+}
+
+static gchar *
+get_entry_path (GtkSearchIndex *index,
+                guint32         id)
+{
+  GString *path;
+
+  path = g_string_new (NULL);
+  append_entry_path (index, path, id);
+
+  return g_string_free (path, FALSE);
+}
+
+static guint32
+add_entry (GtkSearchIndex *index,
+           guint32         parent,
+           const gchar    *name,
+           guint32         flags)
+{
+  IndexEntry entry = { 0, };
+
+  entry.parent = parent;
+  entry.name = index->names->len;
+  entry.flags = flags;
+
+  /* Names are kept with their terminating nul */
+  g_string_append_len (index->names, name, strlen (name) + 1);
+  g_array_append_val (index->entries, entry);
+
+  return index->entries->len - 1;
+}
+
+static inline guint32
+make_trigram (const gchar *s)
+{
+  return ((guint32) (guchar) g_ascii_tolower (s[0]) << 16) |
+         ((guint32) (guchar) g_ascii_tolower (s[1]) << 8) |
+         (guint32) (guchar) g_ascii_tolower (s[2]);
+}
+
+/* Entries must be added in the order of their ids,
+ * so that the lists stay sorted */
+static void
+add_trigrams (GtkSearchIndex *index,
+              guint32         id)
+{
+  const gchar *name;
+  gsize i, len;
+
+  name = get_entry_name (index, id);
+  len = strlen (name);
+
+  for (i = 0; i + 2 < len; i++)
+    {
+      gpointer trigram;
+      GArray *ids;
+
+      trigram = GUINT_TO_POINTER (make_trigram (name + i));
+      ids = g_hash_table_lookup (index->trigrams, trigram);
+      if (ids == NULL)
+        {
+          ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+          g_hash_table_insert (index->trigrams, trigram, ids);
+        }
+
+      /* A name can contain a trigram more than once */
+      if (ids->len == 0 || g_array_index (ids, guint32, ids->len - 1) != id)
+        g_array_append_val (ids, id);
+    }
+}
+
+static GtkSearchIndex *
+gtk_search_index_alloc (const gchar *root)
+{
+  GtkSearchIndex *index;
+
+  index = g_slice_new0 (GtkSearchIndex);
+  index->ref_count = 1;
+  g_mutex_init (&index->lock);
+  g_mutex_init (&index->dirty_lock);
+  index->dirty = g_hash_table_new (NULL, NULL);
+  index->root = g_strdup (root);
+  index->entries = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+  index->names = g_string_new (NULL);
+
+  return index;
+}
+
+static GtkSearchIndex *
+gtk_search_index_ref (GtkSearchIndex *index)
+{
+  g_atomic_int_inc (&index->ref_count);
+
+  return index;
+}
+
+void
+_gtk_search_index_unref (GtkSearchIndex *index)
+{
+  if (!g_atomic_int_dec_and_test (&index->ref_count))
+    return;
+
+  g_assert (index->monitors == NULL);
+
+  if (index->trigrams)
+    g_hash_table_unref (index->trigrams);
+  g_string_free (index->names, TRUE);
+  g_array_free (index->entries, TRUE);
+  g_hash_table_unref (index->dirty);
+  g_free (index->root);
+  g_mutex_clear (&index->dirty_lock);
+  g_mutex_clear (&index->lock);
+  g_slice_free (GtkSearchIndex, index);
+}
+
+/* Creates an index for @root that is filled with
+ * _gtk_search_index_add_directory(), @root has the id 0.
+ */
+GtkSearchIndex *
+_gtk_search_index_new (const gchar *root)
+{
+  GtkSearchIndex *index;
+
+  index = gtk_search_index_alloc (root);
+  add_entry (index, NO_PARENT, "", ENTRY_DIR);
+
+  return index;
+}
+
+static gboolean
+add_directory (GtkSearchIndex *index,
+               guint32         dir,
+               gint64          mtime,
+               GPtrArray      *files,
+               GPtrArray      *dirs,
+               guint32        *dir_ids)
+{
+  guint32 id;
+  guint i;
+
+  if (index->entries->len + files->len + dirs->len > MAX_ENTRIES)
+    {
+      index->full = TRUE;
+      return FALSE;
+    }
+
+  get_entry (index, dir)->mtime = mtime;
+
+  for (i = 0; i < files->len; i++)
+    {
+      id = add_entry (index, dir, g_ptr_array_index (files, i), 0);
+      if (index->trigrams)
+        add_trigrams (index, id);
+    }
+
+  for (i = 0; i < dirs->len; i++)
+    {
+      id = add_entry (index, dir, g_ptr_array_index (dirs, i), ENTRY_DIR);
+      if (index->trigrams)
+        add_trigrams (index, id);
+      if (dir_ids)
+        dir_ids[i] = id;
+    }
+
+  return TRUE;
+}
+
+/**
+ * _gtk_search_index_add_directory:
+ * @index: an index that hasn't been published yet
+ * @dir: the id of a directory in @index
+ * @mtime: the modification time of the directory
+ * @files: names of the files in the directory
+ * @dirs: names of the subdirectories
+ * @dir_ids: (out caller-allocates): return location for the ids
+ *   of the subdirectories
+ *
+ * Adds the contents of a directory to an index, as returned
+ * by _gtk_search_read_directory(). Calls for different
+ * directories must be serialized by the caller.
+ *
+ * Returns: %FALSE if the index has become too big to be useful
+ */
+gboolean
+_gtk_search_index_add_directory (GtkSearchIndex *index,
+                                 guint32         dir,
+                                 gint64          mtime,
+                                 GPtrArray      *files,
+                                 GPtrArray      *dirs,
+                                 guint32        *dir_ids)
+{
+  g_return_val_if_fail (dir < index->entries->len, FALSE);
+
+  if (index->full)
+    return FALSE;
+
+  return add_directory (index, dir, mtime, files, dirs, dir_ids);
+}
+
+static gchar *
+get_cache_file (const gchar *root)
+{
+  gchar *checksum, *filename;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, root, -1);
+  filename = g_build_filename (g_get_user_cache_dir (), "gtk-3.0", "search-index",
+                               checksum, NULL);
+  g_free (checksum);
+
+  return filename;
+}
+
+static void
+save_trigram (gpointer key,
+              gpointer value,
+              gpointer data)
+{
+  GArray *ids = value;
+  GByteArray *bytes = data;
+  guint32 header[2];
+
+  header[0] = GPOINTER_TO_UINT (key);
+  header[1] = ids->len;
+  g_byte_array_append (bytes, (guint8 *) header, sizeof (header));
+  g_byte_array_append (bytes, (guint8 *) ids->data, ids->len * sizeof (guint32));
+}
+
+/* The cache is only read on this machine, so it is
+ * written in native byte order */
+static void
+gtk_search_index_save (GtkSearchIndex *index)
+{
+  IndexHeader header;
+  GByteArray *bytes;
+  gchar *filename, *dirname;
+  guint i;
+
+  memcpy (header.magic, INDEX_MAGIC, sizeof (header.magic));
+  header.root_len = strlen (index->root);
+  header.n_entries = index->entries->len;
+  header.names_len = index->names->len;
+  header.n_trigrams = g_hash_table_size (index->trigrams);
+
+  bytes = g_byte_array_new ();
+  g_byte_array_append (bytes, (guint8 *) &header, sizeof (header));
+  g_byte_array_append (bytes, (guint8 *) index->root, header.root_len);
+
+  for (i = 0; i < index->entries->len; i++)
+    {
+      IndexEntry entry = *get_entry (index, i);
+
+      entry.flags &= ENTRY_PERSISTENT_FLAGS;
+      g_byte_array_append (bytes, (guint8 *) &entry, sizeof (IndexEntry));
+    }
+
+  g_byte_array_append (bytes, (guint8 *) index->names->str, index->names->len);
+  g_hash_table_foreach (index->trigrams, save_trigram, bytes);
+
+  filename = get_cache_file (index->root);
+  dirname = g_path_get_dirname (filename);
+
+  if (g_mkdir_with_parents (dirname, 0700) == 0)
+    g_file_set_contents (filename, (gchar *) bytes->data, bytes->len, NULL);
+
+  g_free (dirname);
+  g_free (filename);
+  g_byte_array_unref (bytes);
+}
+
+static GtkSearchIndex *
+gtk_search_index_load (const gchar *root)
+{
+  GtkSearchIndex *index = NULL;
+  IndexHeader header;
+  gchar *filename, *contents;
+  const gchar *p, *end;
+  gsize length;
+  guint i;
+
+  filename = get_cache_file (root);
+  if (!g_file_get_contents (filename, &contents, &length, NULL))
+    {
+      g_free (filename);
+      return NULL;
+    }
+  g_free (filename);
+
+  p = contents;
+  end = contents + length;
+
+#define TAKE(dest, size) G_STMT_START { \
+    if ((gsize) (end - p) < (gsize) (size)) \
+      goto out; \
+    memcpy ((dest), p, (size)); \
+    p += (size); \
+  } G_STMT_END
+
+  TAKE (&header, sizeof (header));
+  if (memcmp (header.magic, INDEX_MAGIC, sizeof (header.magic)) != 0 ||
+      header.root_len != strlen (root) ||
+      (gsize) (end - p) < header.root_len ||
+      memcmp (p, root, header.root_len) != 0 ||
+      header.n_entries == 0 || header.n_entries > MAX_ENTRIES)
+    goto out;
+  p += header.root_len;
+
+  index = gtk_search_index_alloc (root);
+  index->trigrams = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+
+  g_array_set_size (index->entries, header.n_entries);
+  TAKE (index->entries->data, (gsize) header.n_entries * sizeof (IndexEntry));
+
+  g_string_set_size (index->names, header.names_len);
+  TAKE (index->names->str, header.names_len);
+
+  for (i = 0; i < header.n_entries; i++)
+    {
+      IndexEntry *entry = get_entry (index, i);
+
+      entry->flags &= ENTRY_PERSISTENT_FLAGS;
+
+      if (entry->name >= header.names_len ||
+          (entry->parent != NO_PARENT && entry->parent >= i) ||
+          (entry->parent == NO_PARENT) != (i == 0))
+        goto out;
+
+      if (entry->flags & ENTRY_DELETED)
+        index->n_deleted++;
+    }
+
+  if (header.names_len == 0 || index->names->str[header.names_len - 1] != '\0')
+    goto out;
+
+  for (i = 0; i < header.n_trigrams; i++)
+    {
+      guint32 trigram[2];
+      GArray *ids;
+      guint j;
+
+      TAKE (trigram, sizeof (trigram));
+
+      ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), trigram[1]);
+      g_array_set_size (ids, trigram[1]);
+      g_hash_table_insert (index->trigrams, GUINT_TO_POINTER (trigram[0]), ids);
+      TAKE (ids->data, (gsize) trigram[1] * sizeof (guint32));
+
+      for (j = 0; j < trigram[1]; j++)
+        {
+          if (g_array_index (ids, guint32, j) >= header.n_entries)
+            goto out;
+        }
+    }
+
+#undef TAKE
+
+  g_free (contents);
+
+  return index;
+
+out:
+  if (index)
+    _gtk_search_index_unref (index);
+  g_free (contents);
+
+  return NULL;
+}
+
+static void
+directory_changed (GFileMonitor      *monitor,
+                   GFile             *file,
+                   GFile             *other_file,
+                   GFileMonitorEvent  event,
+                   gpointer           data)
+{
+  GtkSearchIndex *index = data;
+  guint32 id;
+
+  id = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (monitor), "gtk-search-index-id"));
+
+  g_mutex_lock (&index->dirty_lock);
+  g_hash_table_add (index->dirty, GUINT_TO_POINTER (id));
+  g_mutex_unlock (&index->dirty_lock);
+}
+
+static void
+drop_monitor (gpointer data)
+{
+  GFileMonitor *monitor = data;
+
+  g_signal_handlers_disconnect_matched (monitor, G_SIGNAL_MATCH_FUNC,
+                                        0, 0, NULL, directory_changed, NULL);
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+static gboolean
+monitor_is_stale (gpointer key,
+                  gpointer value,
+                  gpointer data)
+{
+  GtkSearchIndex *index = data;
+
+  return (get_entry (index, GPOINTER_TO_UINT (key))->flags & ENTRY_DELETED) != 0;
+}
+
+static gboolean
+update_monitors_timeout (gpointer data)
+{
+  GtkSearchIndex *index = data;
+  struct stat st;
+  guint32 id;
+
+  /* Try again later if a search is running */
+  if (!g_mutex_trylock (&index->lock))
+    return G_SOURCE_CONTINUE;
+
+  index->monitors_queued = FALSE;
+
+  if (index->retired)
+    {
+      if (index->monitors)
+        {
+          g_hash_table_unref (index->monitors);
+          index->monitors = NULL;
+        }
+    }
+  else
+    {
+      if (index->monitors == NULL)
+        index->monitors = g_hash_table_new_full (NULL, NULL, NULL, drop_monitor);
+
+      g_hash_table_foreach_remove (index->monitors, monitor_is_stale, index);
+
+      for (id = 0;
+           id < index->entries->len && g_hash_table_size (index->monitors) < MAX_MONITORS;
+           id++)
+        {
+          IndexEntry *entry = get_entry (index, id);
+          GFileMonitor *monitor;
+          GFile *file;
+          gchar *path;
+
+          if ((entry->flags & (ENTRY_DIR | ENTRY_DELETED | ENTRY_MONITORED)) != ENTRY_DIR)
+            continue;
+
+          path = get_entry_path (index, id);
+          file = g_file_new_for_path (path);
+          monitor = g_file_monitor_directory (file, G_FILE_MONITOR_NONE, NULL, NULL);
+          g_object_unref (file);
+
+          if (monitor)
+            {
+              g_object_set_data (G_OBJECT (monitor), "gtk-search-index-id", GUINT_TO_POINTER (id));
+              g_signal_connect (monitor, "changed", G_CALLBACK (directory_changed), index);
+              g_hash_table_insert (index->monitors, GUINT_TO_POINTER (id), monitor);
+              entry->flags |= ENTRY_MONITORED;
+
+              /* Catch changes from before the monitor was there */
+              if (g_stat (path, &st) != 0 || st.st_mtime != entry->mtime)
+                entry->flags |= ENTRY_DIRTY;
+            }
+
+          g_free (path);
+        }
+    }
+
+  g_mutex_unlock (&index->lock);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called with the lock held */
+static void
+queue_update_monitors (GtkSearchIndex *index)
+{
+  guint id;
+
+  if (index->monitors_queued)
+    return;
+
+  index->monitors_queued = TRUE;
+  id = gdk_threads_add_timeout_full (G_PRIORITY_LOW, 100,
+                                     update_monitors_timeout,
+                                     gtk_search_index_ref (index),
+                                     (GDestroyNotify) _gtk_search_index_unref);
+  g_source_set_name_by_id (id, "[gtk+] update_monitors_timeout");
+}
+
+/* Takes over the reference of the caller */
+static void
+register_index (GtkSearchIndex *index)
+{
+  GtkSearchIndex *old;
+
+  if (indexes == NULL)
+    indexes = g_hash_table_new (g_str_hash, g_str_equal);
+
+  old = g_hash_table_lookup (indexes, index->root);
+  g_hash_table_replace (indexes, index->root, index);
+
+  g_mutex_lock (&index->lock);
+  queue_update_monitors (index);
+  g_mutex_unlock (&index->lock);
+
+  if (old)
+    {
+      /* The monitors are dropped on the main thread */
+      g_mutex_lock (&old->lock);
+      old->retired = TRUE;
+      queue_update_monitors (old);
+      g_mutex_unlock (&old->lock);
+
+      _gtk_search_index_unref (old);
+    }
+}
+
+/**
+ * _gtk_search_index_publish:
+ * @index: (transfer full): an index created with _gtk_search_index_new()
+ *
+ * Makes @index available to later searches and saves it, after
+ * all directories have been added.
+ */
+void
+_gtk_search_index_publish (GtkSearchIndex *index)
+{
+  guint32 id;
+
+  if (index->full)
+    {
+      _gtk_search_index_unref (index);
+      return;
+    }
+
+  index->trigrams = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+  for (id = 1; id < index->entries->len; id++)
+    add_trigrams (index, id);
+
+  gtk_search_index_save (index);
+
+  G_LOCK (indexes);
+  register_index (index);
+  G_UNLOCK (indexes);
+}
+
+/**
+ * _gtk_search_index_lookup:
+ * @path: a directory
+ *
+ * Finds an index that covers @path, either in memory or in
+ * the user's cache directory.
+ *
+ * Returns: (transfer full) (nullable): an index for @path or one of
+ *   its parents
+ */
+GtkSearchIndex *
+_gtk_search_index_lookup (const gchar *path)
+{
+  GtkSearchIndex *index = NULL;
+  gchar *dir, *parent;
+
+  G_LOCK (indexes);
+
+  dir = g_strdup (path);
+  while (TRUE)
+    {
+      if (indexes)
+        index = g_hash_table_lookup (indexes, dir);
+
+      if (index == NULL)
+        {
+          index = gtk_search_index_load (dir);
+          if (index)
+            register_index (index);
+        }
+
+      if (index)
+        {
+          gtk_search_index_ref (index);
+          break;
+        }
+
+      parent = g_path_get_dirname (dir);
+      if (strcmp (parent, dir) == 0)
+        {
+          g_free (parent);
+          break;
+        }
+
+      g_free (dir);
+      dir = parent;
+    }
+  g_free (dir);
+
+  G_UNLOCK (indexes);
+
+  return index;
+}
+
+static GHashTable *
+get_children (GtkSearchIndex *index)
+{
+  GHashTable *children;
+  guint32 id;
+
+  children = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify) g_array_unref);
+
+  for (id = 1; id < index->entries->len; id++)
+    {
+      IndexEntry *entry = get_entry (index, id);
+      GArray *ids;
+
+      if (entry->flags & ENTRY_DELETED)
+        continue;
+
+      ids = g_hash_table_lookup (children, GUINT_TO_POINTER (entry->parent));
+      if (ids == NULL)
+        {
+          ids = g_array_new (FALSE, FALSE, sizeof (guint32));
+          g_hash_table_insert (children, GUINT_TO_POINTER (entry->parent), ids);
+        }
+      g_array_append_val (ids, id);
+    }
+
+  return children;
+}
+
+static void
+delete_entry (GtkSearchIndex *index,
+              GHashTable     *children,
+              guint32         id)
+{
+  IndexEntry *entry = get_entry (index, id);
+  GArray *ids;
+  guint i;
+
+  if (entry->flags & ENTRY_DELETED)
+    return;
+
+  entry->flags |= ENTRY_DELETED;
+  index->n_deleted++;
+
+  ids = g_hash_table_lookup (children, GUINT_TO_POINTER (id));
+  if (ids)
+    {
+      for (i = 0; i < ids->len; i++)
+        delete_entry (index, children, g_array_index (ids, guint32, i));
+    }
+}
+
+static gboolean
+take_name (GPtrArray   *names,
+           const gchar *name)
+{
+  guint i;
+
+  for (i = 0; i < names->len; i++)
+    {
+      if (strcmp (g_ptr_array_index (names, i), name) == 0)
+        {
+          g_ptr_array_remove_index_fast (names, i);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+/* Adds @dir and everything below it */
+static gboolean
+crawl_directory (GtkSearchIndex    *index,
+                 guint32            dir,
+                 volatile gboolean *cancelled)
+{
+  GPtrArray *files, *dirs;
+  guint32 *dir_ids;
+  gchar *path;
+  gint64 mtime;
+  gboolean result = TRUE;
+  guint i;
+
+  if (*cancelled)
+    return FALSE;
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  dirs = g_ptr_array_new_with_free_func (g_free);
+  path = get_entry_path (index, dir);
+
+  if (_gtk_search_read_directory (path, &mtime, files, dirs))
+    {
+      dir_ids = g_new (guint32, dirs->len);
+      result = add_directory (index, dir, mtime, files, dirs, dir_ids);
+
+      for (i = 0; result && i < dirs->len; i++)
+        result = crawl_directory (index, dir_ids[i], cancelled);
+
+      g_free (dir_ids);
+    }
+
+  g_free (path);
+  g_ptr_array_unref (files);
+  g_ptr_array_unref (dirs);
+
+  return result;
+}
+
+/* Makes the entries below @dir match the file system */
+static gboolean
+reread_directory (GtkSearchIndex    *index,
+                  GHashTable        *children,
+                  guint32            dir,
+                  volatile gboolean *cancelled)
+{
+  GPtrArray *files, *dirs;
+  GArray *ids;
+  guint32 *dir_ids;
+  gchar *path;
+  gint64 mtime;
+  gboolean result;
+  guint i;
+
+  files = g_ptr_array_new_with_free_func (g_free);
+  dirs = g_ptr_array_new_with_free_func (g_free);
+  path = get_entry_path (index, dir);
+
+  if (!_gtk_search_read_directory (path, &mtime, files, dirs))
+    {
+      /* Its parent has changed too and will drop it */
+      mtime = 0;
+    }
+
+  /* Keep the entries that are still there */
+  ids = g_hash_table_lookup (children, GUINT_TO_POINTER (dir));
+  for (i = 0; ids && i < ids->len; i++)
+    {
+      guint32 id = g_array_index (ids, guint32, i);
+      IndexEntry *entry = get_entry (index, id);
+      const gchar *name = get_entry_name (index, id);
+
+      if (!take_name ((entry->flags & ENTRY_DIR) ? dirs : files, name))
+        delete_entry (index, children, id);
+    }
+
+  dir_ids = g_new (guint32, dirs->len);
+  result = add_directory (index, dir, mtime, files, dirs, dir_ids);
+
+  get_entry (index, dir)->flags &= ~ENTRY_DIRTY;
+
+  for (i = 0; result && i < dirs->len; i++)
+    result = crawl_directory (index, dir_ids[i], cancelled);
+
+  g_free (dir_ids);
+  g_free (path);
+  g_ptr_array_unref (files);
+  g_ptr_array_unref (dirs);
+
+  return result;
+}
+
+/* Called with the lock held. Returns %FALSE if the index
+ * should be rebuilt from scratch.
+ */
+static gboolean
+gtk_search_index_refresh (GtkSearchIndex    *index,
+                          volatile gboolean *cancelled)
+{
+  GHashTable *children = NULL;
+  GHashTableIter iter;
+  gpointer key;
+  GArray *changed;
+  gboolean result = TRUE;
+  struct stat st;
+  guint32 id;
+  guint i;
+
+  changed = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  g_mutex_lock (&index->dirty_lock);
+  g_hash_table_iter_init (&iter, index->dirty);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    get_entry (index, GPOINTER_TO_UINT (key))->flags |= ENTRY_DIRTY;
+  g_hash_table_remove_all (index->dirty);
+  g_mutex_unlock (&index->dirty_lock);
+
+  for (id = 0; id < index->entries->len; id++)
+    {
+      IndexEntry *entry = get_entry (index, id);
+
+      if ((entry->flags & (ENTRY_DIR | ENTRY_DELETED)) != ENTRY_DIR)
+        continue;
+
+      if (entry->flags & ENTRY_MONITORED)
+        {
+          if ((entry->flags & ENTRY_DIRTY) == 0)
+            continue;
+        }
+      else
+        {
+          gchar *path;
+          gboolean unchanged;
+
+          if (*cancelled)
+            break;
+
+          path = get_entry_path (index, id);
+          unchanged = g_stat (path, &st) == 0 && st.st_mtime == entry->mtime;
+          g_free (path);
+
+          if (unchanged)
+            continue;
+        }
+
+      g_array_append_val (changed, id);
+    }
+
+  if (changed->len > 0 && !*cancelled)
+    {
+      guint n_entries = index->entries->len;
+
+      children = get_children (index);
+
+      for (i = 0; result && i < changed->len; i++)
+        {
+          id = g_array_index (changed, guint32, i);
+
+          /* Might have gone with its parent */
+          if (get_entry (index, id)->flags & ENTRY_DELETED)
+            continue;
+
+          result = reread_directory (index, children, id, cancelled);
+        }
+
+      g_hash_table_unref (children);
+
+      /* Dropped entries are only marked, rebuild once
+       * they make up half of the index */
+      if (result && index->n_deleted > index->entries->len / 2)
+        result = FALSE;
+
+      if (result && !*cancelled)
+        {
+          gtk_search_index_save (index);
+
+          if (index->entries->len > n_entries)
+            queue_update_monitors (index);
+        }
+    }
+
+  g_array_free (changed, TRUE);
+
+  return result;
+}
+
+/* Returns the id of the directory at @path, or %NO_PARENT */
+static guint32
+find_directory (GtkSearchIndex *index,
+                const gchar    *path)
+{
+  gchar **components;
+  guint32 dir, id;
+  gsize root_len;
+  guint i;
+
+  root_len = strlen (index->root);
+  if (strncmp (path, index->root, root_len) != 0)
+    return NO_PARENT;
+
+  if (path[root_len] != '\0' && path[root_len] != G_DIR_SEPARATOR &&
+      index->root[root_len - 1] != G_DIR_SEPARATOR)
+    return NO_PARENT;
+
+  components = g_strsplit (path + root_len, G_DIR_SEPARATOR_S, -1);
+  dir = 0;
+
+  for (i = 0; components[i] != NULL && dir != NO_PARENT; i++)
+    {
+      guint32 child = NO_PARENT;
+
+      if (components[i][0] == '\0')
+        continue;
+
+      for (id = dir + 1; id < index->entries->len; id++)
+        {
+          IndexEntry *entry = get_entry (index, id);
+
+          if (entry->parent == dir &&
+              (entry->flags & (ENTRY_DIR | ENTRY_DELETED)) == ENTRY_DIR &&
+              strcmp (get_entry_name (index, id), components[i]) == 0)
+            {
+              child = id;
+              break;
+            }
+        }
+
+      dir = child;
+    }
+
+  g_strfreev (components);
+
+  return dir;
+}
+
+static gboolean
+is_below (GtkSearchIndex *index,
+          guint32         id,
+          guint32         dir)
+{
+  if (dir == 0)
+    return TRUE;
+
+  while (id != NO_PARENT)
+    {
+      id = get_entry (index, id)->parent;
+      if (id == dir)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static GArray *
+intersect_ids (GArray *a,
+               GArray *b)
+{
+  GArray *result;
+  guint i, j;
+
+  result = g_array_new (FALSE, FALSE, sizeof (guint32));
+
+  for (i = 0, j = 0; i < a->len && j < b->len; )
+    {
+      guint32 x = g_array_index (a, guint32, i);
+      guint32 y = g_array_index (b, guint32, j);
+
+      if (x < y)
+        i++;
+      else if (y < x)
+        j++;
+      else
+        {
+          g_array_append_val (result, x);
+          i++;
+          j++;
+        }
+    }
+
+  return result;
+}
+
+/* Returns the entries whose names contain all trigrams of @words,
+ * or %NULL if none of the words is long enough to have one
+ */
+static GArray *
+find_candidates (GtkSearchIndex  *index,
+                 gchar          **words)
+{
+  GArray *candidates = NULL;
+  guint i;
+  gsize j, len;
+
+  for (i = 0; words[i] != NULL; i++)
+    {
+      len = strlen (words[i]);
+
+      for (j = 0; j + 2 < len; j++)
+        {
+          GArray *ids, *tmp;
+
+          ids = g_hash_table_lookup (index->trigrams,
+                                     GUINT_TO_POINTER (make_trigram (words[i] + j)));
+          if (ids == NULL)
+            {
+              if (candidates)
+                g_array_free (candidates, TRUE);
+              return g_array_new (FALSE, FALSE, sizeof (guint32));
+            }
+
+          if (candidates == NULL)
+            {
+              candidates = g_array_sized_new (FALSE, FALSE, sizeof (guint32), ids->len);
+              g_array_append_vals (candidates, ids->data, ids->len);
+            }
+          else
+            {
+              tmp = intersect_ids (candidates, ids);
+              g_array_free (candidates, TRUE);
+              candidates = tmp;
+            }
+        }
+    }
+
+  return candidates;
+}
+
+static gboolean
+name_matches (const gchar  *name,
+              gchar       **words)
+{
+  gchar *lower_name;
+  gboolean hit = TRUE;
+  guint i;
+
+  lower_name = g_ascii_strdown (name, -1);
+
+  for (i = 0; words[i] != NULL; i++)
+    {
+      if (strstr (lower_name, words[i]) == NULL)
+        {
+          hit = FALSE;
+          break;
+        }
+    }
+
+  g_free (lower_name);
+
+  return hit;
+}
+
+/**
+ * _gtk_search_index_search:
+ * @index: an index returned by _gtk_search_index_lookup()
+ * @path: the directory to search in
+ * @words: lowercase words that must all be in a name
+ * @cancelled: a flag that is set when the search should stop
+ * @func: function to call for each hit
+ * @data: data for @func
+ *
+ * Brings @index up to date and calls @func with the paths of the
+ * files and directories below @path whose name contains all @words.
+ *
+ * Returns: %FALSE if @index can't be used, before any hit is
+ *   reported; the directory needs to be crawled then
+ */
+gboolean
+_gtk_search_index_search (GtkSearchIndex         *index,
+                          const gchar            *path,
+                          gchar                 **words,
+                          volatile gboolean      *cancelled,
+                          GtkSearchIndexHitFunc   func,
+                          gpointer                data)
+{
+  GArray *candidates;
+  guint32 dir, id, n_ids;
+  guint i;
+
+  g_mutex_lock (&index->lock);
+
+  if (index->retired || !gtk_search_index_refresh (index, cancelled))
+    {
+      g_mutex_unlock (&index->lock);
+      return FALSE;
+    }
+
+  dir = find_directory (index, path);
+  if (dir == NO_PARENT)
+    {
+      g_mutex_unlock (&index->lock);
+      return FALSE;
+    }
+
+  candidates = find_candidates (index, words);
+  n_ids = candidates ? candidates->len : index->entries->len;
+
+  for (i = 0; i < n_ids && !*cancelled; i++)
+    {
+      IndexEntry *entry;
+      gchar *hit_path;
+
+      id = candidates ? g_array_index (candidates, guint32, i) : i;
+      entry = get_entry (index, id);
+
+      if (id == 0 || (entry->flags & ENTRY_DELETED) ||
+          !name_matches (get_entry_name (index, id), words) ||
+          !is_below (index, id, dir))
+        continue;
+
+      hit_path = get_entry_path (index, id);
+      func (hit_path, data);
+      g_free (hit_path);
+    }
+
+  if (candidates)
+    g_array_free (candidates, TRUE);
+
+  g_mutex_unlock (&index->lock);
+
+  return TRUE;
+}
+
+#endif /* G_OS_UNIX */
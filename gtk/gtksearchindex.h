@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GTK_SEARCH_INDEX_H__
+#define __GTK_SEARCH_INDEX_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GtkSearchIndex GtkSearchIndex;
+
+typedef void (* GtkSearchIndexHitFunc) (const gchar *path,
+                                        gpointer     data);
+
+gboolean        _gtk_search_read_directory      (const gchar           *path,
+                                                 gint64                *mtime,
+                                                 GPtrArray             *files,
+                                                 GPtrArray             *dirs);
+
+gboolean        _gtk_search_index_enabled       (void);
+
+GtkSearchIndex *_gtk_search_index_new           (const gchar           *root);
+gboolean        _gtk_search_index_add_directory (GtkSearchIndex        *index,
+                                                 guint32                dir,
+                                                 gint64                 mtime,
+                                                 GPtrArray             *files,
+                                                 GPtrArray             *dirs,
+                                                 guint32               *dir_ids);
+void            _gtk_search_index_publish       (GtkSearchIndex        *index);
+
+GtkSearchIndex *_gtk_search_index_lookup        (const gchar           *path);
+gboolean        _gtk_search_index_search        (GtkSearchIndex        *index,
+                                                 const gchar           *path,
+                                                 gchar                **words,
+                                                 volatile gboolean     *cancelled,
+                                                 GtkSearchIndexHitFunc  func,
+                                                 gpointer               data);
+void            _gtk_search_index_unref         (GtkSearchIndex        *index);
+
+G_END_DECLS
+
+#endif /* __GTK_SEARCH_INDEX_H__ */
@@ -26,6 +26,7 @@
 #include "gtkdebug.h"
 #include "gtkintl.h"
 #include "gtkprivate.h"
+#include "gtkprofilerprivate.h"
 #include "gtksizegroup-private.h"
 #include "gtksizerequestcacheprivate.h"
 #include "gtkwidgetprivate.h"
@@ -83,6 +84,69 @@ pop_recursion_check (GtkWidget       *widget,
 #endif
 }
 
+#ifdef G_ENABLE_DEBUG
+typedef struct {
+  guint hits;
+  guint misses;
+  guint evictions;
+} SizeCacheStats;
+
+static GHashTable *size_cache_stats = NULL;
+static guint size_cache_lookups = 0;
+
+static void
+print_size_cache_stats (void)
+{
+  GHashTableIter iter;
+  gpointer key, value;
+
+  g_message ("size request cache: %u lookups, %" G_GSIZE_FORMAT " bytes",
+             size_cache_lookups, _gtk_size_request_cache_get_memory_usage ());
+
+  g_hash_table_iter_init (&iter, size_cache_stats);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      SizeCacheStats *stats = value;
+
+      g_message ("  %s: %u hits, %u misses, %u evictions",
+                 g_type_name (GPOINTER_TO_SIZE (key)),
+                 stats->hits, stats->misses, stats->evictions);
+    }
+}
+
+/* Only counts for-size requests, the base requests are
+ * always cached. */
+static void
+count_size_cache_lookup (GtkWidget *widget,
+                         gboolean   hit,
+                         gboolean   evicted)
+{
+  SizeCacheStats *stats;
+  gpointer type;
+
+  if (size_cache_stats == NULL)
+    size_cache_stats = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+  type = GSIZE_TO_POINTER (G_OBJECT_TYPE (widget));
+  stats = g_hash_table_lookup (size_cache_stats, type);
+  if (stats == NULL)
+    {
+      stats = g_new0 (SizeCacheStats, 1);
+      g_hash_table_insert (size_cache_stats, type, stats);
+    }
+
+  if (hit)
+    stats->hits++;
+  else
+    stats->misses++;
+  if (evicted)
+    stats->evictions++;
+
+  if (++size_cache_lookups % 4096 == 0)
+    print_size_cache_stats ();
+}
+#endif /* G_ENABLE_DEBUG */
+
 static const char *
 get_vfunc_name (GtkOrientation orientation,
                 gint           for_size)
@@ -149,6 +213,8 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
   gint min_baseline = -1;
   gint nat_baseline = -1;
   gboolean found_in_cache;
+  gboolean evicted = FALSE;
+  gint64 start_time;
 
   if (gtk_widget_get_request_mode (widget) == GTK_SIZE_REQUEST_CONSTANT_SIZE)
     for_size = -1;
@@ -168,6 +234,8 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
     {
       gint adjusted_min, adjusted_natural, adjusted_for_size = for_size;
 
+      start_time = _gtk_profiler_begin ();
+
       G_GNUC_BEGIN_IGNORE_DEPRECATIONS;
       gtk_widget_ensure_style (widget);
       G_GNUC_END_IGNORE_DEPRECATIONS;
@@ -316,15 +384,22 @@ gtk_widget_query_size_for_orientation (GtkWidget        *widget,
 						   &nat_baseline);
 	}
 
-      _gtk_size_request_cache_commit (cache,
-                                      orientation,
-                                      for_size,
-                                      min_size,
-                                      nat_size,
-				      min_baseline,
-				      nat_baseline);
+      evicted = _gtk_size_request_cache_commit (cache,
+                                                orientation,
+                                                for_size,
+                                                min_size,
+                                                nat_size,
+                                                min_baseline,
+                                                nat_baseline);
+
+      _gtk_profiler_end (GTK_PROFILER_SIZE_REQUEST, widget, start_time);
     }
 
+#ifdef G_ENABLE_DEBUG
+  if (for_size >= 0)
+    GTK_NOTE (SIZE_CACHE, count_size_cache_lookup (widget, found_in_cache, evicted));
+#endif
+
   if (minimum_size)
     *minimum_size = min_size;
 
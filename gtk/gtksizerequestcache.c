@@ -25,51 +25,135 @@
 
 #include <string.h>
 
+/* Bytes used by the requests_x and requests_y arrays of all caches */
+static gsize cache_memory = 0;
+
 void
 _gtk_size_request_cache_init (SizeRequestCache *cache)
 {
   memset (cache, 0, sizeof (SizeRequestCache));
-}
-
-static void
-free_sizes_x (SizeRequestX **sizes)
-{
-  gint i;
 
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestX, sizes[i]);
-
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
+  cache->flags[GTK_ORIENTATION_HORIZONTAL].max_cached_requests = GTK_SIZE_REQUEST_CACHED_SIZES;
+  cache->flags[GTK_ORIENTATION_VERTICAL].max_cached_requests = GTK_SIZE_REQUEST_CACHED_SIZES;
 }
 
-static void
-free_sizes_y (SizeRequestY **sizes)
+static gpointer
+resize_requests (gpointer requests,
+                 gsize    request_size,
+                 guint    old_n_requests,
+                 guint    new_n_requests)
 {
-  gint i;
+  cache_memory -= request_size * old_n_requests;
+  cache_memory += request_size * new_n_requests;
 
-  for (i = 0; i < GTK_SIZE_REQUEST_CACHED_SIZES && sizes[i] != NULL; i++)
-    g_slice_free (SizeRequestY, sizes[i]);
-
-  g_slice_free1 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES, sizes);
+  return g_realloc (requests, request_size * new_n_requests);
 }
 
 void
 _gtk_size_request_cache_free (SizeRequestCache *cache)
 {
   if (cache->requests_x)
-    free_sizes_x (cache->requests_x);
+    cache->requests_x = resize_requests (cache->requests_x, sizeof (SizeRequestX),
+                                         cache->flags[GTK_ORIENTATION_HORIZONTAL].max_cached_requests, 0);
   if (cache->requests_y)
-    free_sizes_y (cache->requests_y);
+    cache->requests_y = resize_requests (cache->requests_y, sizeof (SizeRequestY),
+                                         cache->flags[GTK_ORIENTATION_VERTICAL].max_cached_requests, 0);
 }
 
 void
 _gtk_size_request_cache_clear (SizeRequestCache *cache)
 {
+  guint max_cached_requests[2];
+  guint i;
+
+  /* Keep the size the caches have grown to, so that the next
+   * resize does not have to learn it again, but shrink caches
+   * that were mostly unused since the last clear.
+   */
+  for (i = 0; i < 2; i++)
+    {
+      gpointer requests = i == GTK_ORIENTATION_HORIZONTAL
+                          ? (gpointer) cache->requests_x
+                          : (gpointer) cache->requests_y;
+
+      max_cached_requests[i] = cache->flags[i].max_cached_requests;
+
+      if (requests != NULL &&
+          cache->flags[i].n_cached_requests < max_cached_requests[i] / 4)
+        max_cached_requests[i] = MAX (max_cached_requests[i] / 2, GTK_SIZE_REQUEST_CACHED_SIZES);
+    }
+
   _gtk_size_request_cache_free (cache);
   _gtk_size_request_cache_init (cache);
+
+  for (i = 0; i < 2; i++)
+    cache->flags[i].max_cached_requests = max_cached_requests[i];
 }
 
-void
+gsize
+_gtk_size_request_cache_get_memory_usage (void)
+{
+  return cache_memory;
+}
+
+/* Picks the slot to store a new range in. If the cache is full
+ * and most lookups missed since it was last resized, it is grown
+ * instead of evicting the oldest range. Sets @evicted if a cached
+ * range had to be dropped.
+ */
+static guint
+get_free_request (SizeRequestCache *cache,
+                  GtkOrientation    orientation,
+                  gpointer         *requests,
+                  gsize             request_size,
+                  gboolean         *evicted)
+{
+  guint n_sizes, max_sizes;
+
+  n_sizes = cache->flags[orientation].n_cached_requests;
+  max_sizes = cache->flags[orientation].max_cached_requests;
+
+  if (*requests == NULL)
+    *requests = resize_requests (NULL, request_size, 0, max_sizes);
+
+  if (n_sizes == max_sizes &&
+      max_sizes < GTK_SIZE_REQUEST_MAX_CACHED_SIZES &&
+      cache->flags[orientation].misses > cache->flags[orientation].hits &&
+      cache_memory < GTK_SIZE_REQUEST_CACHE_BUDGET)
+    {
+      guint new_max_sizes = MIN (max_sizes * 2, GTK_SIZE_REQUEST_MAX_CACHED_SIZES);
+
+      *requests = resize_requests (*requests, request_size, max_sizes, new_max_sizes);
+      max_sizes = new_max_sizes;
+
+      cache->flags[orientation].max_cached_requests = max_sizes;
+      cache->flags[orientation].hits = 0;
+      cache->flags[orientation].misses = 0;
+    }
+
+  /* The returned slot will immediately be used to cache the new
+   * computed size so we go ahead and increment the
+   * last_cached_request right away */
+  if (n_sizes < max_sizes)
+    {
+      cache->flags[orientation].n_cached_requests++;
+      cache->flags[orientation].last_cached_request = n_sizes;
+      *evicted = FALSE;
+    }
+  else
+    {
+      if (++cache->flags[orientation].last_cached_request == max_sizes)
+        cache->flags[orientation].last_cached_request = 0;
+      *evicted = TRUE;
+    }
+
+  return cache->flags[orientation].last_cached_request;
+}
+
+/* Returns %TRUE if another cached range had to be evicted to
+ * make room for the new one.
+ */
+gboolean
 _gtk_size_request_cache_commit (SizeRequestCache *cache,
                                 GtkOrientation    orientation,
                                 gint              for_size,
@@ -79,6 +163,7 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 				gint              natural_baseline)
 {
   guint         i, n_sizes;
+  gboolean      evicted;
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
@@ -103,7 +188,7 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 	}
 
       cache->flags[orientation].cached_size_valid = TRUE;
-      return;
+      return FALSE;
     }
 
   /* Check if the minimum_size and natural_size is already
@@ -115,42 +200,27 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
 
   if (orientation == GTK_ORIENTATION_HORIZONTAL)
     {
-      SizeRequestX **cached_sizes;
-      SizeRequestX  *cached_size;
+      SizeRequestX *cached_sizes;
+      SizeRequestX *cached_size;
       cached_sizes = cache->requests_x;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size)
+	  if (cached_sizes[i].cached_size.minimum_size == minimum_size &&
+	      cached_sizes[i].cached_size.natural_size == natural_size)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
-	      return;
+	      cached_sizes[i].lower_for_size = MIN (cached_sizes[i].lower_for_size, for_size);
+	      cached_sizes[i].upper_for_size = MAX (cached_sizes[i].upper_for_size, for_size);
+	      return FALSE;
 	    }
 	}
 
-      /* If not found, pull a new size from the cache, the returned size cache
-       * will immediately be used to cache the new computed size so we go ahead
-       * and increment the last_cached_request right away */
-      if (n_sizes < GTK_SIZE_REQUEST_CACHED_SIZES)
-	{
-	  cache->flags[orientation].n_cached_requests++;
-	  cache->flags[orientation].last_cached_request = cache->flags[orientation].n_cached_requests - 1;
-	}
-      else
-	{
-	  if (++cache->flags[orientation].last_cached_request == GTK_SIZE_REQUEST_CACHED_SIZES)
-	    cache->flags[orientation].last_cached_request = 0;
-	}
+      /* If not found, pull a new size from the cache */
+      i = get_free_request (cache, orientation,
+                            (gpointer *) &cache->requests_x, sizeof (SizeRequestX),
+                            &evicted);
 
-      if (cache->requests_x == NULL)
-	cache->requests_x = g_slice_alloc0 (sizeof (SizeRequestX *) * GTK_SIZE_REQUEST_CACHED_SIZES);
-
-      if (cache->requests_x[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_x[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestX);
-
-      cached_size = cache->requests_x[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_x[i];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -158,44 +228,29 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
     }
   else
     {
-      SizeRequestY **cached_sizes;
-      SizeRequestY  *cached_size;
+      SizeRequestY *cached_sizes;
+      SizeRequestY *cached_size;
       cached_sizes = cache->requests_y;
 
       for (i = 0; i < n_sizes; i++)
 	{
-	  if (cached_sizes[i]->cached_size.minimum_size == minimum_size &&
-	      cached_sizes[i]->cached_size.natural_size == natural_size &&
-	      cached_sizes[i]->cached_size.minimum_baseline == minimum_baseline &&
-	      cached_sizes[i]->cached_size.natural_baseline == natural_baseline)
+	  if (cached_sizes[i].cached_size.minimum_size == minimum_size &&
+	      cached_sizes[i].cached_size.natural_size == natural_size &&
+	      cached_sizes[i].cached_size.minimum_baseline == minimum_baseline &&
+	      cached_sizes[i].cached_size.natural_baseline == natural_baseline)
 	    {
-	      cached_sizes[i]->lower_for_size = MIN (cached_sizes[i]->lower_for_size, for_size);
-	      cached_sizes[i]->upper_for_size = MAX (cached_sizes[i]->upper_for_size, for_size);
-	      return;
+	      cached_sizes[i].lower_for_size = MIN (cached_sizes[i].lower_for_size, for_size);
+	      cached_sizes[i].upper_for_size = MAX (cached_sizes[i].upper_for_size, for_size);
+	      return FALSE;
 	    }
 	}
 
-      /* If not found, pull a new size from the cache, the returned size cache
-       * will immediately be used to cache the new computed size so we go ahead
-       * and increment the last_cached_request right away */
-      if (n_sizes < GTK_SIZE_REQUEST_CACHED_SIZES)
-	{
-	  cache->flags[orientation].n_cached_requests++;
-	  cache->flags[orientation].last_cached_request = cache->flags[orientation].n_cached_requests - 1;
-	}
-      else
-	{
-	  if (++cache->flags[orientation].last_cached_request == GTK_SIZE_REQUEST_CACHED_SIZES)
-	    cache->flags[orientation].last_cached_request = 0;
-	}
-
-      if (cache->requests_y == NULL)
-	cache->requests_y = g_slice_alloc0 (sizeof (SizeRequestY *) * GTK_SIZE_REQUEST_CACHED_SIZES);
+      /* If not found, pull a new size from the cache */
+      i = get_free_request (cache, orientation,
+                            (gpointer *) &cache->requests_y, sizeof (SizeRequestY),
+                            &evicted);
 
-      if (cache->requests_y[cache->flags[orientation].last_cached_request] == NULL)
-	cache->requests_y[cache->flags[orientation].last_cached_request] = g_slice_new (SizeRequestY);
-
-      cached_size = cache->requests_y[cache->flags[orientation].last_cached_request];
+      cached_size = &cache->requests_y[i];
       cached_size->lower_for_size = for_size;
       cached_size->upper_for_size = for_size;
       cached_size->cached_size.minimum_size = minimum_size;
@@ -203,6 +258,26 @@ _gtk_size_request_cache_commit (SizeRequestCache *cache,
       cached_size->cached_size.minimum_baseline = minimum_baseline;
       cached_size->cached_size.natural_baseline = natural_baseline;
     }
+
+  return evicted;
+}
+
+static void
+count_lookup (SizeRequestCache *cache,
+              GtkOrientation    orientation,
+              gboolean          hit)
+{
+  if (cache->flags[orientation].hits == G_MAXUINT16 ||
+      cache->flags[orientation].misses == G_MAXUINT16)
+    {
+      cache->flags[orientation].hits /= 2;
+      cache->flags[orientation].misses /= 2;
+    }
+
+  if (hit)
+    cache->flags[orientation].hits++;
+  else
+    cache->flags[orientation].misses++;
 }
 
 /* looks for a cached size request for this for_size.
@@ -235,7 +310,7 @@ _gtk_size_request_cache_lookup (SizeRequestCache *cache,
 	  /* Search for an already cached size */
 	  for (i = 0; i < cache->flags[orientation].n_cached_requests; i++)
 	    {
-	      SizeRequestX *cur = cache->requests_x[i];
+	      SizeRequestX *cur = &cache->requests_x[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -244,6 +319,8 @@ _gtk_size_request_cache_lookup (SizeRequestCache *cache,
 		  break;
 		}
 	    }
+
+          count_lookup (cache, orientation, result != NULL);
 	}
 
       if (result)
@@ -273,7 +350,7 @@ _gtk_size_request_cache_lookup (SizeRequestCache *cache,
 	  /* Search for an already cached size */
 	  for (i = 0; i < cache->flags[orientation].n_cached_requests; i++)
 	    {
-	      SizeRequestY *cur = cache->requests_y[i];
+	      SizeRequestY *cur = &cache->requests_y[i];
 
 	      if (cur->lower_for_size <= for_size &&
 		  cur->upper_for_size >= for_size)
@@ -282,6 +359,8 @@ _gtk_size_request_cache_lookup (SizeRequestCache *cache,
 		  break;
 		}
 	    }
+
+          count_lookup (cache, orientation, result != NULL);
 	}
 
       if (result)
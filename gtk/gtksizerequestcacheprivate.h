@@ -35,8 +35,17 @@ G_BEGIN_DECLS
  * for a said widget to have, if a label can
  * only wrap to 3 lines, only 3 caches will
  * ever be allocated for it.
+ *
+ * Caches start out with room for
+ * GTK_SIZE_REQUEST_CACHED_SIZES ranges and
+ * grow, up to GTK_SIZE_REQUEST_MAX_CACHED_SIZES,
+ * when most lookups miss. Caches only grow
+ * while all of them together use less than
+ * GTK_SIZE_REQUEST_CACHE_BUDGET bytes.
  */
-#define GTK_SIZE_REQUEST_CACHED_SIZES   (5)
+#define GTK_SIZE_REQUEST_CACHED_SIZES     (5)
+#define GTK_SIZE_REQUEST_MAX_CACHED_SIZES (64)
+#define GTK_SIZE_REQUEST_CACHE_BUDGET     (1024 * 1024)
 
 typedef struct {
   gint minimum_size;
@@ -65,8 +74,8 @@ typedef struct
 } SizeRequestY;
 
 typedef struct {
-  SizeRequestX **requests_x;
-  SizeRequestY **requests_y;
+  SizeRequestX *requests_x;
+  SizeRequestY *requests_y;
 
   CachedSizeX  cached_size_x;
   CachedSizeY  cached_size_y;
@@ -74,9 +83,12 @@ typedef struct {
   GtkSizeRequestMode request_mode   : 3;
   guint       request_mode_valid    : 1;
   struct {
-    guint       n_cached_requests   : 3;
-    guint       last_cached_request : 3;
+    guint       n_cached_requests   : 7;
+    guint       last_cached_request : 7;
+    guint       max_cached_requests : 7;
     guint       cached_size_valid   : 1;
+    guint16     hits;   /* since max_cached_requests last changed */
+    guint16     misses;
   }           flags[2];
 } SizeRequestCache;
 
@@ -84,7 +96,7 @@ void            _gtk_size_request_cache_init                    (SizeRequestCach
 void            _gtk_size_request_cache_free                    (SizeRequestCache       *cache);
 
 void            _gtk_size_request_cache_clear                   (SizeRequestCache       *cache);
-void            _gtk_size_request_cache_commit                  (SizeRequestCache       *cache,
+gboolean        _gtk_size_request_cache_commit                  (SizeRequestCache       *cache,
                                                                  GtkOrientation          orientation,
                                                                  gint                    for_size,
                                                                  gint                    minimum_size,
@@ -98,6 +110,7 @@ gboolean        _gtk_size_request_cache_lookup                  (SizeRequestCach
                                                                  gint                   *natural,
                                                                  gint                   *minimum_baseline,
                                                                  gint                   *natural_baseline);
+gsize           _gtk_size_request_cache_get_memory_usage        (void);
 
 G_END_DECLS
 
@@ -296,11 +296,36 @@ style_provider_data_clear (gpointer data_)
   g_object_unref (data->provider);
 }
 
+/* Serials are unique across all cascades, so that (cascade, serial)
+ * identifies a state of a cascade even if a cascade is freed and a new
+ * one is allocated at the same address. */
+static guint
+gtk_style_cascade_next_serial (void)
+{
+  static guint serial = 0;
+
+  return ++serial;
+}
+
+static void
+gtk_style_cascade_changed (GtkStyleCascade *cascade)
+{
+  cascade->serial = gtk_style_cascade_next_serial ();
+}
+
 static void
 _gtk_style_cascade_init (GtkStyleCascade *cascade)
 {
   cascade->providers = g_array_new (FALSE, FALSE, sizeof (GtkStyleProviderData));
   g_array_set_clear_func (cascade->providers, style_provider_data_clear);
+
+  cascade->serial = gtk_style_cascade_next_serial ();
+  /* connected first, so the serial is updated before anyone else
+   * gets notified */
+  g_signal_connect (cascade,
+                    "-gtk-private-changed",
+                    G_CALLBACK (gtk_style_cascade_changed),
+                    NULL);
 }
 
 GtkStyleCascade *
@@ -396,3 +421,20 @@ _gtk_style_cascade_remove_provider (GtkStyleCascade  *cascade,
     }
 }
 
+/*
+ * _gtk_style_cascade_get_serial:
+ * @cascade: a #GtkStyleCascade
+ *
+ * Returns a number identifying the current state of @cascade. It changes
+ * whenever the cascade emits its changed signal, so it can be used to
+ * check if styles computed from the cascade are still valid.
+ *
+ * Returns: the serial of @cascade
+ */
+guint
+_gtk_style_cascade_get_serial (GtkStyleCascade *cascade)
+{
+  g_return_val_if_fail (GTK_IS_STYLE_CASCADE (cascade), 0);
+
+  return cascade->serial;
+}
@@ -39,6 +39,7 @@ struct _GtkStyleCascade
 
   GtkStyleCascade *parent;
   GArray *providers;
+  guint serial;           /* changes every time the cascade changes */
 };
 
 struct _GtkStyleCascadeClass
@@ -59,6 +60,8 @@ void                  _gtk_style_cascade_add_provider           (GtkStyleCascade
 void                  _gtk_style_cascade_remove_provider        (GtkStyleCascade     *cascade,
                                                                  GtkStyleProvider    *provider);
 
+guint                 _gtk_style_cascade_get_serial             (GtkStyleCascade     *cascade);
+
 
 G_END_DECLS
 
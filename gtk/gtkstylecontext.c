@@ -24,6 +24,7 @@
 
 #include "gtkstylecontextprivate.h"
 #include "gtkcontainerprivate.h"
+#include "gtkcssarrayvalueprivate.h"
 #include "gtkcsscolorvalueprivate.h"
 #include "gtkcsscornervalueprivate.h"
 #include "gtkcssenginevalueprivate.h"
@@ -32,6 +33,7 @@
 #include "gtkcssnumbervalueprivate.h"
 #include "gtkcssrgbavalueprivate.h"
 #include "gtkcssshadowsvalueprivate.h"
+#include "gtkcssstringvalueprivate.h"
 #include "gtkcsstransformvalueprivate.h"
 #include "gtkdebug.h"
 #include "gtkstylepropertiesprivate.h"
@@ -40,6 +42,7 @@
 #include "gtkwidget.h"
 #include "gtkwindow.h"
 #include "gtkprivate.h"
+#include "gtkprofilerprivate.h"
 #include "gtkwidgetpath.h"
 #include "gtkwidgetprivate.h"
 #include "gtkstylecascadeprivate.h"
@@ -753,17 +756,15 @@ G_GNUC_END_IGNORE_DEPRECATIONS
 static void
 build_properties (GtkStyleContext      *context,
                   GtkCssComputedValues *values,
-                  GtkStyleInfo         *info,
+                  GtkWidgetPath        *path,
                   const GtkBitmask     *relevant_changes)
 {
   GtkStyleContextPrivate *priv;
   GtkCssMatcher matcher;
-  GtkWidgetPath *path;
   GtkCssLookup *lookup;
 
   priv = context->priv;
 
-  path = create_query_path (context, info);
   lookup = _gtk_css_lookup_new (relevant_changes);
 
   if (_gtk_css_matcher_init (&matcher, path))
@@ -778,15 +779,236 @@ build_properties (GtkStyleContext      *context,
                            priv->parent ? style_values_lookup (priv->parent) : NULL);
 
   _gtk_css_lookup_free (lookup);
-  gtk_widget_path_free (path);
+}
+
+/* Shared computed values
+ *
+ * The computed values only depend on the cascade, the widget path,
+ * the scale and the parent's computed values. Contexts that agree on
+ * all of those (like the rows of a long list) can use the same
+ * GtkCssComputedValues object instead of each resolving the cascade.
+ *
+ * The shared values of children are kept in a table attached to the
+ * parent's values (or in a global table for toplevels), so that they
+ * go away with their parent. Shared values are never modified, contexts
+ * replace them with a private copy instead. Values that are used as a
+ * parent and get modified drop their table.
+ */
+#define SHARED_VALUES_MAX_PER_PARENT 256
+
+typedef struct {
+  GtkStyleCascade *cascade;
+  guint            serial;
+  int              scale;
+  char            *path;
+} SharedValuesKey;
+
+static GHashTable *toplevel_shared_values = NULL;
+static guint shared_values_lookups = 0;
+static guint shared_values_hits = 0;
+
+static guint
+shared_values_key_hash (gconstpointer data)
+{
+  const SharedValuesKey *key = data;
+
+  return g_str_hash (key->path) ^ key->serial ^ key->scale;
+}
+
+static gboolean
+shared_values_key_equal (gconstpointer data1,
+                         gconstpointer data2)
+{
+  const SharedValuesKey *key1 = data1;
+  const SharedValuesKey *key2 = data2;
+
+  return key1->cascade == key2->cascade
+      && key1->serial == key2->serial
+      && key1->scale == key2->scale
+      && g_str_equal (key1->path, key2->path);
+}
+
+static void
+shared_values_key_free (gpointer data)
+{
+  SharedValuesKey *key = data;
+
+  g_free (key->path);
+  g_slice_free (SharedValuesKey, key);
+}
+
+static GQuark
+shared_values_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("gtk-style-context-shared-values");
+
+  return quark;
+}
+
+static GQuark
+shared_children_quark (void)
+{
+  static GQuark quark = 0;
+
+  if (G_UNLIKELY (quark == 0))
+    quark = g_quark_from_static_string ("gtk-style-context-shared-children");
+
+  return quark;
+}
+
+static GHashTable *
+shared_values_get_table (GtkCssComputedValues *parent_values,
+                         gboolean              create)
+{
+  GHashTable *table;
+
+  if (parent_values)
+    table = g_object_get_qdata (G_OBJECT (parent_values), shared_children_quark ());
+  else
+    table = toplevel_shared_values;
+
+  if (table == NULL && create)
+    {
+      table = g_hash_table_new_full (shared_values_key_hash,
+                                     shared_values_key_equal,
+                                     shared_values_key_free,
+                                     g_object_unref);
+      if (parent_values)
+        g_object_set_qdata_full (G_OBJECT (parent_values),
+                                 shared_children_quark (),
+                                 table,
+                                 (GDestroyNotify) g_hash_table_unref);
+      else
+        toplevel_shared_values = table;
+    }
+
+  return table;
+}
+
+static gboolean
+shared_values_is_shared (GtkCssComputedValues *values)
+{
+  return g_object_get_qdata (G_OBJECT (values), shared_values_quark ()) != NULL;
+}
+
+/* Called when @values are about to change in place: the values of
+ * children that were computed from them are no longer valid.
+ */
+static void
+shared_values_forget_children (GtkCssComputedValues *values)
+{
+  g_object_set_qdata (G_OBJECT (values), shared_children_quark (), NULL);
+}
+
+/* Only values that will never start animations can be shared, as
+ * animations are stored in the computed values.
+ */
+static gboolean
+shared_values_can_share (GtkCssComputedValues *values)
+{
+  GtkCssValue *array;
+  guint i;
+
+  array = _gtk_css_computed_values_get_value (values, GTK_CSS_PROPERTY_ANIMATION_NAME);
+  for (i = 0; i < _gtk_css_array_value_get_n_values (array); i++)
+    {
+      if (g_ascii_strcasecmp (_gtk_css_ident_value_get (_gtk_css_array_value_get_nth (array, i)), "none") != 0)
+        return FALSE;
+    }
+
+  array = _gtk_css_computed_values_get_value (values, GTK_CSS_PROPERTY_TRANSITION_DURATION);
+  for (i = 0; i < _gtk_css_array_value_get_n_values (array); i++)
+    {
+      if (_gtk_css_number_value_get (_gtk_css_array_value_get_nth (array, i), 100) != 0)
+        return FALSE;
+    }
+
+  array = _gtk_css_computed_values_get_value (values, GTK_CSS_PROPERTY_TRANSITION_DELAY);
+  for (i = 0; i < _gtk_css_array_value_get_n_values (array); i++)
+    {
+      if (_gtk_css_number_value_get (_gtk_css_array_value_get_nth (array, i), 100) != 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Sibling selectors can look at the other elements of the path's
+ * sibling lists, which are not part of the path string. */
+static gboolean
+shared_values_path_is_shareable (GtkWidgetPath *path)
+{
+  gint i;
+
+  for (i = 0; i < gtk_widget_path_length (path); i++)
+    {
+      if (gtk_widget_path_iter_get_siblings (path, i) != NULL)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static GtkCssComputedValues *
+shared_values_lookup (GtkCssComputedValues  *parent_values,
+                      const SharedValuesKey *key)
+{
+  GHashTable *table;
+  GtkCssComputedValues *values;
+
+  table = shared_values_get_table (parent_values, FALSE);
+  values = table ? g_hash_table_lookup (table, key) : NULL;
+
+  shared_values_lookups++;
+  if (values)
+    shared_values_hits++;
+
+  GTK_NOTE (CSS_CACHE,
+            if (shared_values_lookups % 1024 == 0)
+              g_message ("shared style cache: %u lookups, %u hits (%.1f%%)",
+                         shared_values_lookups, shared_values_hits,
+                         100.0 * shared_values_hits / shared_values_lookups));
+
+  return values;
+}
+
+static void
+shared_values_insert (GtkCssComputedValues  *parent_values,
+                      const SharedValuesKey *key,
+                      GtkCssComputedValues  *values)
+{
+  SharedValuesKey *copy;
+  GHashTable *table;
+
+  table = shared_values_get_table (parent_values, TRUE);
+
+  /* Entries for old serials of the cascade are never hit again,
+   * so just start over when the table gets too big. */
+  if (g_hash_table_size (table) >= SHARED_VALUES_MAX_PER_PARENT)
+    g_hash_table_remove_all (table);
+
+  copy = g_slice_new (SharedValuesKey);
+  copy->cascade = key->cascade;
+  copy->serial = key->serial;
+  copy->scale = key->scale;
+  copy->path = g_strdup (key->path);
+
+  g_object_set_qdata (G_OBJECT (values), shared_values_quark (), GUINT_TO_POINTER (TRUE));
+  g_hash_table_insert (table, copy, g_object_ref (values));
 }
 
 static GtkCssComputedValues *
 style_values_lookup (GtkStyleContext *context)
 {
   GtkStyleContextPrivate *priv;
-  GtkCssComputedValues *values;
+  GtkCssComputedValues *values, *parent_values;
   GtkStyleInfo *info;
+  GtkWidgetPath *path;
+  SharedValuesKey key;
+  gboolean shareable;
 
   priv = context->priv;
   info = priv->info;
@@ -804,13 +1026,49 @@ style_values_lookup (GtkStyleContext *context)
       return values;
     }
 
+  path = create_query_path (context, info);
+  parent_values = priv->parent ? style_values_lookup (priv->parent) : NULL;
+
+  shareable = shared_values_path_is_shareable (path) &&
+              (parent_values == NULL || _gtk_css_computed_values_is_static (parent_values)) &&
+              !(gtk_get_debug_flags () & GTK_DEBUG_NO_CSS_CACHE);
+
+  if (shareable)
+    {
+      key.cascade = priv->cascade;
+      key.serial = _gtk_style_cascade_get_serial (priv->cascade);
+      key.scale = priv->scale;
+      key.path = gtk_widget_path_to_string (path);
+
+      values = shared_values_lookup (parent_values, &key);
+      if (values)
+        {
+          style_info_set_values (info, values);
+          g_hash_table_insert (priv->style_values,
+                               style_info_copy (info),
+                               g_object_ref (values));
+          g_free (key.path);
+          gtk_widget_path_unref (path);
+          return values;
+        }
+    }
+
   values = _gtk_css_computed_values_new ();
   style_info_set_values (info, values);
   g_hash_table_insert (priv->style_values,
                        style_info_copy (info),
                        values);
 
-  build_properties (context, values, info, NULL);
+  build_properties (context, values, path, NULL);
+
+  if (shareable)
+    {
+      if (shared_values_can_share (values))
+        shared_values_insert (parent_values, &key, values);
+      g_free (key.path);
+    }
+
+  gtk_widget_path_unref (path);
 
   return values;
 }
@@ -2889,7 +3147,33 @@ gtk_style_context_update_cache (GtkStyleContext  *context,
       changes = _gtk_css_computed_values_compute_dependencies (values, parent_changes);
 
       if (!_gtk_bitmask_is_empty (changes))
-	build_properties (context, values, info, changes);
+        {
+          GtkWidgetPath *path = create_query_path (context, info);
+
+          if (shared_values_is_shared (values))
+            {
+              GtkCssComputedValues *copy;
+              GtkStyleInfo *i;
+
+              /* Other contexts use these values, so we make our own */
+              copy = _gtk_css_computed_values_new ();
+              build_properties (context, copy, path, NULL);
+
+              for (i = priv->info; i; i = i->next)
+                {
+                  if (i->values == values)
+                    style_info_set_values (i, copy);
+                }
+              g_hash_table_iter_replace (&iter, copy);
+            }
+          else
+            {
+              shared_values_forget_children (values);
+              build_properties (context, values, path, changes);
+            }
+
+          gtk_widget_path_unref (path);
+        }
 
       _gtk_bitmask_free (changes);
     }
@@ -3007,6 +3291,7 @@ _gtk_style_context_validate (GtkStyleContext  *context,
   GtkCssComputedValues *current;
   GtkBitmask *changes;
   GSList *list;
+  gint64 start_time;
 
   g_return_if_fail (GTK_IS_STYLE_CONTEXT (context));
 
@@ -3032,6 +3317,8 @@ _gtk_style_context_validate (GtkStyleContext  *context,
   if (!priv->invalid && change == 0 && _gtk_bitmask_is_empty (parent_changes))
     return;
 
+  start_time = _gtk_profiler_begin ();
+
   priv->pending_changes = 0;
   gtk_style_context_set_invalid (context, FALSE);
 
@@ -3060,12 +3347,16 @@ _gtk_style_context_validate (GtkStyleContext  *context,
       values = style_values_lookup (context);
 
       if (values != current)
-        _gtk_css_computed_values_create_animations (values,
-                                                    priv->parent ? style_values_lookup (priv->parent) : NULL,
-                                                    timestamp,
-                                                    GTK_STYLE_PROVIDER_PRIVATE (priv->cascade),
-                                                    priv->scale,
-                                                    gtk_style_context_should_create_transitions (context) ? current : NULL);
+        {
+          _gtk_css_computed_values_create_animations (values,
+                                                      priv->parent ? style_values_lookup (priv->parent) : NULL,
+                                                      timestamp,
+                                                      GTK_STYLE_PROVIDER_PRIVATE (priv->cascade),
+                                                      priv->scale,
+                                                      gtk_style_context_should_create_transitions (context) ? current : NULL);
+          /* Children may have been computed from the unanimated values */
+          shared_values_forget_children (values);
+        }
       if (_gtk_css_computed_values_is_static (values))
         change &= ~GTK_CSS_CHANGE_ANIMATE;
       else
@@ -3078,7 +3369,10 @@ _gtk_style_context_validate (GtkStyleContext  *context,
 
           /* In the case where we keep the cache, we want unanimated values */
           if (values != current)
-            _gtk_css_computed_values_cancel_animations (current);
+            {
+              _gtk_css_computed_values_cancel_animations (current);
+              shared_values_forget_children (current);
+            }
         }
       else
         {
@@ -3109,6 +3403,9 @@ _gtk_style_context_validate (GtkStyleContext  *context,
   if (!_gtk_bitmask_is_empty (changes))
     gtk_style_context_do_invalidate (context, changes);
 
+  /* Children are counted on their own */
+  _gtk_profiler_end (GTK_PROFILER_STYLE, priv->widget, start_time);
+
   change = _gtk_css_change_for_child (change);
   for (list = priv->children; list; list = list->next)
     {
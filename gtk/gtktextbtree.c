@@ -141,6 +141,10 @@ struct _GtkTextBTreeNode {
   Summary *summary;             /* First in malloc-ed list of info
                                  * about tags in this subtree (NULL if
                                  * no tag info in the subtree). */
+  guint64 tag_mask;             /* Tags that have a Summary here, by
+                                 * GtkTextTagInfo mask bit. */
+  guint64 tag_parity;           /* Tags whose Summary has an odd
+                                 * toggle_count. */
   int level;                            /* Level of this node in the B-tree.
                                          * 0 refers to the bottom of the tree
                                          * (children are lines, not nodes). */
@@ -186,6 +190,14 @@ struct _GtkTextBTree {
   GSList *tag_infos;
   gulong tag_changed_handler;
 
+  /* Mask bits handed out to tag infos, and the number of tag
+   * infos that didn't get one because all of them were taken.
+   * As long as every tag info has a bit, the node tag masks
+   * can answer questions about tags without walking summaries.
+   */
+  guint64 tag_bits_used;
+  guint n_unmasked_tag_infos;
+
   /* Incremented when a segment with a byte size > 0
    * is added to or removed from the tree (i.e. the
    * length of a line may have changed, and lines may
@@ -216,6 +228,39 @@ struct _GtkTextBTree {
   GHashTable *child_anchor_table;
 };
 
+/*
+ * Collects lines of text in leaf nodes before they are put into
+ * the tree, see _gtk_text_btree_loader_new().
+ */
+
+struct _GtkTextBTreeLoader {
+  GtkTextBTree *tree;
+
+  /* The text up to and including the first paragraph delimiter.
+   * It ends the line that the text is inserted into, so it is kept
+   * as segments.
+   */
+  GtkTextLineSegment *first_segments;
+  gboolean have_first_line;
+
+  /* The segments of the line that is still being read */
+  GtkTextLineSegment *segments;
+  GtkTextLineSegment **segments_tail;
+  int line_bytes;
+  int line_chars;
+
+  /* Leaf nodes filled with the complete lines after the first */
+  GtkTextBTreeNode *first_leaf;
+  GtkTextBTreeNode *last_leaf;
+  GtkTextLine *last_line;
+
+  int num_lines;                        /* Lines in the leaf nodes */
+  int num_chars;                        /* All the characters so far */
+
+  /* A \r at the end of the text may be the start of \r\n */
+  gboolean pending_cr;
+};
+
 
 /*
  * Upper and lower bounds on how many children a node may have:
@@ -244,6 +289,18 @@ struct _GtkTextBTree {
 #define MIN_CHILDREN 3
 #endif
 
+/* Nodes with too many children are split into nodes with about
+ * this many children each, and GtkTextBTreeLoader fills its leaf
+ * nodes up to it. This leaves some room for insertions before
+ * the nodes need to be split again.
+ */
+#define FILL_CHILDREN ((MAX_CHILDREN * 3) / 4)
+
+/* Insertions of at least this many bytes go through a
+ * GtkTextBTreeLoader, as they likely contain many lines.
+ */
+#define LOADER_MIN_BYTES 4096
+
 /*
  * Prototypes
  */
@@ -261,7 +318,7 @@ static void              gtk_text_btree_node_adjust_toggle_count (GtkTextBTreeNo
                                                                   GtkTextTagInfo   *info,
                                                                   gint              adjust);
 static gboolean          gtk_text_btree_node_has_tag             (GtkTextBTreeNode *node,
-                                                                  GtkTextTag       *tag);
+                                                                  GtkTextTagInfo   *info);
 
 static void             segments_changed                (GtkTextBTree     *tree);
 static void             chars_changed                   (GtkTextBTree     *tree);
@@ -1124,6 +1181,16 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   if (len < 0)
     len = strlen (text);
 
+  if (len >= LOADER_MIN_BYTES)
+    {
+      GtkTextBTreeLoader *loader;
+
+      loader = _gtk_text_btree_loader_new (_gtk_text_iter_get_btree (iter));
+      _gtk_text_btree_loader_add (loader, text, len);
+      _gtk_text_btree_loader_finish (loader, iter);
+      return;
+    }
+
   /* extract iterator info */
   tree = _gtk_text_iter_get_btree (iter);
   line = _gtk_text_iter_get_text_line (iter);
@@ -1255,6 +1322,376 @@ _gtk_text_btree_insert (GtkTextIter *iter,
   }
 }
 
+/**
+ * _gtk_text_btree_loader_new:
+ * @tree: a #GtkTextBTree
+ *
+ * Creates a loader for a large amount of text, which may arrive
+ * in several pieces. The loader builds the leaf nodes for the new
+ * lines itself, filling each of them in turn, and
+ * _gtk_text_btree_loader_finish() puts them into @tree all at once.
+ * This is cheaper than adding the lines to a leaf node one at a
+ * time, and @tree is not changed until the text is complete.
+ *
+ * Returns: a new #GtkTextBTreeLoader
+ */
+GtkTextBTreeLoader *
+_gtk_text_btree_loader_new (GtkTextBTree *tree)
+{
+  GtkTextBTreeLoader *loader;
+
+  loader = g_slice_new0 (GtkTextBTreeLoader);
+  loader->tree = tree;
+  loader->segments_tail = &loader->segments;
+
+  return loader;
+}
+
+static void
+loader_append_line (GtkTextBTreeLoader *loader,
+                    GtkTextLine        *line)
+{
+  GtkTextBTreeNode *leaf = loader->last_leaf;
+
+  if (leaf == NULL || leaf->num_children == FILL_CHILDREN)
+    {
+      leaf = gtk_text_btree_node_new ();
+      leaf->parent = NULL;
+      leaf->next = NULL;
+      leaf->summary = NULL;
+      leaf->level = 0;
+      leaf->children.line = line;
+      leaf->num_children = 0;
+      leaf->num_lines = 0;
+      leaf->num_chars = 0;
+
+      if (loader->last_leaf)
+        loader->last_leaf->next = leaf;
+      else
+        loader->first_leaf = leaf;
+      loader->last_leaf = leaf;
+    }
+  else
+    loader->last_line->next = line;
+
+  /* The leaf is new, so no view has data for it yet */
+  line->parent = leaf;
+  line->next = NULL;
+  loader->last_line = line;
+
+  leaf->num_children++;
+  leaf->num_lines++;
+  leaf->num_chars += loader->line_chars;
+  loader->num_lines++;
+}
+
+static void
+loader_end_line (GtkTextBTreeLoader *loader)
+{
+  GtkTextLine *line;
+
+  if (!loader->have_first_line)
+    {
+      loader->first_segments = loader->segments;
+      loader->have_first_line = TRUE;
+    }
+  else
+    {
+      line = gtk_text_line_new ();
+      line->segments = loader->segments;
+
+      /* Join the pieces of a line that was split between two reads */
+      if (line->segments->next)
+        cleanup_line (line);
+
+      loader_append_line (loader, line);
+    }
+
+  loader->segments = NULL;
+  loader->segments_tail = &loader->segments;
+  loader->line_bytes = 0;
+  loader->line_chars = 0;
+}
+
+static void
+loader_add_text (GtkTextBTreeLoader *loader,
+                 const gchar        *text,
+                 gint                len)
+{
+  GtkTextLineSegment *seg;
+  gint sol, eol, delim;
+
+  eol = 0;
+  while (eol < len)
+    {
+      sol = eol;
+
+      pango_find_paragraph_boundary (text + sol,
+                                     len - sol,
+                                     &delim,
+                                     &eol);
+
+      /* make these relative to the start of the text */
+      delim += sol;
+      eol += sol;
+
+      seg = _gtk_char_segment_new (&text[sol], eol - sol);
+
+      *loader->segments_tail = seg;
+      loader->segments_tail = &seg->next;
+      loader->line_bytes += seg->byte_count;
+      loader->line_chars += seg->char_count;
+      loader->num_chars += seg->char_count;
+
+      if (delim == eol)
+        {
+          /* chunk didn't end with a paragraph separator */
+          g_assert (eol == len);
+          break;
+        }
+
+      loader_end_line (loader);
+    }
+}
+
+/**
+ * _gtk_text_btree_loader_add:
+ * @loader: a #GtkTextBTreeLoader
+ * @text: UTF-8 text
+ * @len: length of @text in bytes
+ *
+ * Adds @text to the text collected by @loader. @text must consist
+ * of whole characters, but lines may be split between calls.
+ */
+void
+_gtk_text_btree_loader_add (GtkTextBTreeLoader *loader,
+                            const gchar        *text,
+                            gint                len)
+{
+  g_return_if_fail (loader != NULL);
+  g_return_if_fail (text != NULL);
+
+  if (len < 0)
+    len = strlen (text);
+
+  if (len == 0)
+    return;
+
+  if (loader->pending_cr)
+    {
+      loader->pending_cr = FALSE;
+
+      if (text[0] == '\n')
+        {
+          loader_add_text (loader, "\r\n", 2);
+          text++;
+          len--;
+        }
+      else
+        loader_add_text (loader, "\r", 1);
+    }
+
+  if (len > 0 && text[len - 1] == '\r')
+    {
+      loader->pending_cr = TRUE;
+      len--;
+    }
+
+  loader_add_text (loader, text, len);
+}
+
+static void
+free_segments (GtkTextLineSegment *seg)
+{
+  GtkTextLineSegment *next;
+
+  for (; seg != NULL; seg = next)
+    {
+      next = seg->next;
+      (*seg->type->deleteFunc) (seg, NULL, TRUE);
+    }
+}
+
+/**
+ * _gtk_text_btree_loader_free:
+ * @loader: a #GtkTextBTreeLoader
+ *
+ * Drops the text collected by @loader without inserting it.
+ */
+void
+_gtk_text_btree_loader_free (GtkTextBTreeLoader *loader)
+{
+  GtkTextBTreeNode *leaf, *next;
+
+  g_return_if_fail (loader != NULL);
+
+  free_segments (loader->first_segments);
+  free_segments (loader->segments);
+
+  for (leaf = loader->first_leaf; leaf != NULL; leaf = next)
+    {
+      next = leaf->next;
+      gtk_text_btree_node_destroy (loader->tree, leaf);
+    }
+
+  g_slice_free (GtkTextBTreeLoader, loader);
+}
+
+/**
+ * _gtk_text_btree_loader_finish:
+ * @loader: a #GtkTextBTreeLoader
+ * @iter: where to insert the text
+ *
+ * Inserts the text collected by @loader at @iter, like
+ * _gtk_text_btree_insert(), and frees @loader. @iter is moved to
+ * the end of the inserted text.
+ *
+ * The leaf nodes of the loader go next to the one containing
+ * @iter, and the nodes above are split evenly by rebalancing,
+ * a level at a time.
+ */
+void
+_gtk_text_btree_loader_finish (GtkTextBTreeLoader *loader,
+                               GtkTextIter        *iter)
+{
+  GtkTextBTree *tree;
+  GtkTextLine *start_line, *end_line;
+  GtkTextLineSegment *prev_seg, *tail;
+  GtkTextBTreeNode *start_node, *parent, *node;
+  gint start_byte_index, end_byte_index;
+  GtkTextIter start, end;
+
+  g_return_if_fail (loader != NULL);
+  g_return_if_fail (iter != NULL);
+
+  tree = _gtk_text_iter_get_btree (iter);
+  g_return_if_fail (tree == loader->tree);
+
+  if (loader->pending_cr)
+    {
+      loader->pending_cr = FALSE;
+      loader_add_text (loader, "\r", 1);
+    }
+
+  start_line = _gtk_text_iter_get_text_line (iter);
+  start_byte_index = gtk_text_iter_get_line_index (iter);
+
+  /* See _gtk_text_btree_insert() */
+  g_assert (!_gtk_text_line_is_last (start_line, tree));
+  prev_seg = gtk_text_line_segment_split (iter);
+  tail = prev_seg ? prev_seg->next : start_line->segments;
+
+  /* Invalidate all iterators */
+  chars_changed (tree);
+  segments_changed (tree);
+
+  if (!loader->have_first_line)
+    {
+      /* All of the text goes into the line of @iter */
+      *loader->segments_tail = tail;
+      if (prev_seg)
+        prev_seg->next = loader->segments;
+      else
+        start_line->segments = loader->segments;
+
+      cleanup_line (start_line);
+      post_insert_fixup (tree, start_line, 0, loader->num_chars);
+
+      end_line = start_line;
+      end_byte_index = start_byte_index + loader->line_bytes;
+    }
+  else
+    {
+      GtkTextLineSegment *seg;
+      GtkTextLine *rest;
+
+      if (prev_seg)
+        prev_seg->next = loader->first_segments;
+      else
+        start_line->segments = loader->first_segments;
+
+      /* The rest of the line of @iter goes after the text, and
+       * the lines after it in its leaf node follow along. Tag
+       * toggles are counted again in their new node by
+       * cleanup_line() below.
+       */
+      for (seg = tail; seg != NULL; seg = seg->next)
+        {
+          if (seg->type->lineChangeFunc != NULL)
+            (*seg->type->lineChangeFunc) (seg, start_line);
+        }
+
+      *loader->segments_tail = tail;
+      end_line = gtk_text_line_new ();
+      end_line->segments = loader->segments;
+      end_byte_index = loader->line_bytes;
+      loader_append_line (loader, end_line);
+
+      rest = start_line->next;
+      start_line->next = NULL;
+      end_line->next = rest;
+
+      start_node = start_line->parent;
+      if (start_node->parent == NULL)
+        {
+          node = gtk_text_btree_node_new ();
+          node->parent = NULL;
+          node->next = NULL;
+          node->summary = NULL;
+          node->level = 1;
+          node->children.node = start_node;
+          start_node->parent = node;
+          tree->root_node = node;
+        }
+      parent = start_node->parent;
+
+      for (node = loader->first_leaf; node != NULL; node = node->next)
+        node->parent = parent;
+      loader->last_leaf->next = start_node->next;
+      start_node->next = loader->first_leaf;
+
+      /* Only these two nodes had lines moved around, the other
+       * leaves were counted while they were filled
+       */
+      recompute_node_counts (tree, start_node);
+      recompute_node_counts (tree, loader->last_leaf);
+      recompute_node_counts (tree, parent);
+
+      for (node = parent->parent; node != NULL; node = node->parent)
+        {
+          node->num_lines += loader->num_lines;
+          node->num_chars += loader->num_chars;
+        }
+
+      cleanup_line (start_line);
+      cleanup_line (end_line);
+
+      gtk_text_btree_rebalance (tree, start_node);
+      gtk_text_btree_rebalance (tree, end_line->parent);
+
+      if (gtk_get_debug_flags () & GTK_DEBUG_TEXT)
+        _gtk_text_btree_check (tree);
+    }
+
+  /* The lines and segments belong to the tree now */
+  loader->first_segments = NULL;
+  loader->segments = NULL;
+  loader->first_leaf = NULL;
+  _gtk_text_btree_loader_free (loader);
+
+  /* Invalidate our region, and reset the iterator the user
+     passed in to point to the end of the inserted text. */
+  _gtk_text_btree_get_iter_at_line (tree, &start, start_line, start_byte_index);
+  _gtk_text_btree_get_iter_at_line (tree, &end, end_line, end_byte_index);
+
+  DV (g_print ("invalidating due to loading some text (%s)\n", G_STRLOC));
+  _gtk_text_btree_invalidate_region (tree, &start, &end, FALSE);
+
+  *iter = end;
+
+  gtk_text_btree_resolve_bidi (&start, &end);
+}
+
 static void
 insert_pixbuf_or_widget_segment (GtkTextIter        *iter,
                                  GtkTextLineSegment *seg)
@@ -2199,12 +2636,35 @@ _gtk_text_btree_get_line_at_char (GtkTextBTree      *tree,
   return line;
 }
 
+/* Returns the tags that toggle an odd number of times in the
+ * GtkTextBTreeNodes preceding the ancestors of line, as mask bits.
+ * Tags that didn't get a mask bit are not included.
+ */
+static guint64
+get_preceding_tag_parity (GtkTextLine *line)
+{
+  GtkTextBTreeNode *node;
+  GtkTextBTreeNode *siblingPtr;
+  guint64 parity = 0;
+
+  for (node = line->parent; node->parent != NULL;
+       node = node->parent)
+    {
+      for (siblingPtr = node->parent->children.node;
+           siblingPtr != node; siblingPtr = siblingPtr->next)
+        parity ^= siblingPtr->tag_parity;
+    }
+
+  return parity;
+}
+
 /* It returns an array sorted by tags priority, ready to pass to
  * _gtk_text_attributes_fill_from_tags() */
 GtkTextTag**
 _gtk_text_btree_get_tags (const GtkTextIter *iter,
                          gint *num_tags)
 {
+  GtkTextBTree *tree;
   GtkTextBTreeNode *node;
   GtkTextLine *siblingline;
   GtkTextLineSegment *seg;
@@ -2216,6 +2676,7 @@ _gtk_text_btree_get_tags (const GtkTextIter *iter,
 #define NUM_TAG_INFOS 10
 
   line = _gtk_text_iter_get_text_line (iter);
+  tree = _gtk_text_iter_get_btree (iter);
   byte_index = gtk_text_iter_get_line_index (iter);
 
   tagInfo.numTags = 0;
@@ -2262,25 +2723,48 @@ _gtk_text_btree_get_tags (const GtkTextIter *iter,
 
   /*
    * For each GtkTextBTreeNode in the ancestry of this line, record tag
-   * toggles for all siblings that precede that GtkTextBTreeNode.
+   * toggles for all siblings that precede that GtkTextBTreeNode. Only
+   * odd counts matter, so if all tags have mask bits the parities of
+   * the siblings are enough.
    */
 
-  for (node = line->parent; node->parent != NULL;
-       node = node->parent)
+  if (tree->n_unmasked_tag_infos == 0)
     {
-      GtkTextBTreeNode *siblingPtr;
-      Summary *summary;
+      guint64 parity;
+      GSList *list;
 
-      for (siblingPtr = node->parent->children.node;
-           siblingPtr != node; siblingPtr = siblingPtr->next)
+      parity = get_preceding_tag_parity (line);
+
+      for (list = tree->tag_infos; list != NULL && parity != 0; list = list->next)
         {
-          for (summary = siblingPtr->summary; summary != NULL;
-               summary = summary->next)
+          GtkTextTagInfo *info = list->data;
+
+          if (parity & info->mask)
+            {
+              inc_count (info->tag, 1, &tagInfo);
+              parity &= ~info->mask;
+            }
+        }
+    }
+  else
+    {
+      for (node = line->parent; node->parent != NULL;
+           node = node->parent)
+        {
+          GtkTextBTreeNode *siblingPtr;
+          Summary *summary;
+
+          for (siblingPtr = node->parent->children.node;
+               siblingPtr != node; siblingPtr = siblingPtr->next)
             {
-              if (summary->toggle_count & 1)
+              for (summary = siblingPtr->summary; summary != NULL;
+                   summary = summary->next)
                 {
-                  inc_count (summary->info->tag, summary->toggle_count,
-                             &tagInfo);
+                  if (summary->toggle_count & 1)
+                    {
+                      inc_count (summary->info->tag, summary->toggle_count,
+                                 &tagInfo);
+                    }
                 }
             }
         }
@@ -2545,25 +3029,51 @@ _gtk_text_btree_char_is_invisible (const GtkTextIter *iter)
    * for all siblings that precede that GtkTextBTreeNode.
    */
 
-  for (node = line->parent; node->parent != NULL;
-       node = node->parent)
+  if (tree->n_unmasked_tag_infos == 0)
     {
-      GtkTextBTreeNode *siblingPtr;
-      Summary *summary;
+      guint64 parity;
+      GSList *list;
 
-      for (siblingPtr = node->parent->children.node;
-           siblingPtr != node; siblingPtr = siblingPtr->next)
+      parity = get_preceding_tag_parity (line);
+
+      for (list = tree->tag_infos; list != NULL && parity != 0; list = list->next)
         {
-          for (summary = siblingPtr->summary; summary != NULL;
-               summary = summary->next)
+          GtkTextTagInfo *info = list->data;
+
+          if (parity & info->mask)
             {
-              if (summary->toggle_count & 1)
+              tag = info->tag;
+              if (tag->priv->invisible_set)
                 {
-                  tag = summary->info->tag;
-                  if (tag->priv->invisible_set)
+                  tags[tag->priv->priority] = tag;
+                  tagCnts[tag->priv->priority]++;
+                }
+              parity &= ~info->mask;
+            }
+        }
+    }
+  else
+    {
+      for (node = line->parent; node->parent != NULL;
+           node = node->parent)
+        {
+          GtkTextBTreeNode *siblingPtr;
+          Summary *summary;
+
+          for (siblingPtr = node->parent->children.node;
+               siblingPtr != node; siblingPtr = siblingPtr->next)
+            {
+              for (summary = siblingPtr->summary; summary != NULL;
+                   summary = summary->next)
+                {
+                  if (summary->toggle_count & 1)
                     {
-                      tags[tag->priv->priority] = tag;
-                      tagCnts[tag->priv->priority] += summary->toggle_count;
+                      tag = summary->info->tag;
+                      if (tag->priv->invisible_set)
+                        {
+                          tags[tag->priv->priority] = tag;
+                          tagCnts[tag->priv->priority] += summary->toggle_count;
+                        }
                     }
                 }
             }
@@ -3068,7 +3578,7 @@ _gtk_text_btree_first_could_contain_tag (GtkTextBTree *tree,
           node = node->children.node;
           while (node != NULL)
             {
-              if (gtk_text_btree_node_has_tag (node, tag))
+              if (gtk_text_btree_node_has_tag (node, info))
                 goto continue_outer_loop;
 
               node = node->next;
@@ -3122,7 +3632,7 @@ _gtk_text_btree_last_could_contain_tag (GtkTextBTree *tree,
           node = node->children.node;
           while (node != NULL)
             {
-              if (gtk_text_btree_node_has_tag (node, tag))
+              if (gtk_text_btree_node_has_tag (node, info))
                 last_node = node;
               node = node->next;
             }
@@ -3315,13 +3825,22 @@ find_toggle_outside_current_line (GtkTextLine *line,
         {
           Summary *summary;
 
-          summary = sibling_node->summary;
-          while (summary != NULL)
+          if (info->mask != 0)
             {
-              if (summary->info == info)
-                toggles += summary->toggle_count;
+              /* Only the parity of the count matters */
+              if (sibling_node->tag_parity & info->mask)
+                toggles++;
+            }
+          else
+            {
+              summary = sibling_node->summary;
+              while (summary != NULL)
+                {
+                  if (summary->info == info)
+                    toggles += summary->toggle_count;
 
-              summary = summary->next;
+                  summary = summary->next;
+                }
             }
 
           sibling_node = sibling_node->next;
@@ -4394,7 +4913,7 @@ _gtk_text_line_next_could_contain_tag (GtkTextLine  *line,
             {
               node = node->next;
 
-              if (gtk_text_btree_node_has_tag (node, tag))
+              if (gtk_text_btree_node_has_tag (node, info))
                 goto found;
             }
         }
@@ -4440,7 +4959,7 @@ _gtk_text_line_next_could_contain_tag (GtkTextLine  *line,
       node = node->children.node;
       while (node != NULL)
         {
-          if (gtk_text_btree_node_has_tag (node, tag))
+          if (gtk_text_btree_node_has_tag (node, info))
             break;
           node = node->next;
         }
@@ -4575,7 +5094,7 @@ _gtk_text_line_previous_could_contain_tag (GtkTextLine  *line,
 
               g_assert (this_node != line_ancestor);
 
-              if (gtk_text_btree_node_has_tag (this_node, tag))
+              if (gtk_text_btree_node_has_tag (this_node, info))
                 {
                   found_node = this_node;
                   g_slist_free (child_nodes);
@@ -4650,7 +5169,7 @@ _gtk_text_line_previous_could_contain_tag (GtkTextLine  *line,
       iter = child_nodes;
       while (iter != NULL)
         {
-          if (gtk_text_btree_node_has_tag (iter->data, tag))
+          if (gtk_text_btree_node_has_tag (iter->data, info))
             {
               /* recurse into this node. */
               node = iter->data;
@@ -4866,10 +5385,32 @@ gtk_text_btree_node_new (void)
   node = g_slice_new (GtkTextBTreeNode);
 
   node->node_data = NULL;
+  node->tag_mask = 0;
+  node->tag_parity = 0;
 
   return node;
 }
 
+static inline void
+gtk_text_btree_node_set_tag_masks (GtkTextBTreeNode *node,
+                                   GtkTextTagInfo   *info,
+                                   gint              toggle_count)
+{
+  node->tag_mask |= info->mask;
+  if (toggle_count & 1)
+    node->tag_parity |= info->mask;
+  else
+    node->tag_parity &= ~info->mask;
+}
+
+static inline void
+gtk_text_btree_node_unset_tag_masks (GtkTextBTreeNode *node,
+                                     GtkTextTagInfo   *info)
+{
+  node->tag_mask &= ~info->mask;
+  node->tag_parity &= ~info->mask;
+}
+
 static void
 gtk_text_btree_node_adjust_toggle_count (GtkTextBTreeNode  *node,
                                          GtkTextTagInfo  *info,
@@ -4899,21 +5440,25 @@ gtk_text_btree_node_adjust_toggle_count (GtkTextBTreeNode  *node,
       summary->next = node->summary;
       node->summary = summary;
     }
+
+  gtk_text_btree_node_set_tag_masks (node, info, summary->toggle_count);
 }
 
 /* Note that the tag root and above do not have summaries
    for the tag; only nodes below the tag root have
    the summaries. */
 static gboolean
-gtk_text_btree_node_has_tag (GtkTextBTreeNode *node, GtkTextTag *tag)
+gtk_text_btree_node_has_tag (GtkTextBTreeNode *node, GtkTextTagInfo *info)
 {
   Summary *summary;
 
+  if (info->mask != 0)
+    return (node->tag_mask & info->mask) != 0;
+
   summary = node->summary;
   while (summary != NULL)
     {
-      if (tag == NULL ||
-          summary->info->tag == tag)
+      if (summary->info == info)
         return TRUE;
 
       summary = summary->next;
@@ -5430,6 +5975,93 @@ _gtk_text_btree_validate_line (GtkTextBTree     *tree,
     }
 }
 
+static GtkTextLine *
+gtk_text_btree_node_find_invalid_line (GtkTextBTreeNode *node,
+                                       gpointer          view_id)
+{
+  NodeData *nd = node_data_find (node->node_data, view_id);
+
+  if (nd && nd->valid)
+    return NULL;
+
+  if (node->level == 0)
+    {
+      GtkTextLine *line;
+
+      for (line = node->children.line; line != NULL; line = line->next)
+        {
+          GtkTextLineData *ld = _gtk_text_line_get_data (line, view_id);
+
+          if (!ld || !ld->valid)
+            return line;
+        }
+    }
+  else
+    {
+      GtkTextBTreeNode *child;
+
+      for (child = node->children.node; child != NULL; child = child->next)
+        {
+          GtkTextLine *line = gtk_text_btree_node_find_invalid_line (child, view_id);
+
+          if (line)
+            return line;
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * _gtk_text_btree_find_invalid_line:
+ * @tree: a #GtkTextBTree
+ * @view_id: view ID for the view
+ * @line: (allow-none): line to start after
+ *
+ * Finds the first line after @line, or the first line of the tree
+ * if @line is %NULL, that isn't valid for the given view. Nodes that
+ * are valid are skipped as a whole.
+ *
+ * Returns: an invalid line, or %NULL if there is none after @line
+ **/
+GtkTextLine *
+_gtk_text_btree_find_invalid_line (GtkTextBTree *tree,
+                                   gpointer      view_id,
+                                   GtkTextLine  *line)
+{
+  GtkTextBTreeNode *node;
+  GtkTextLine *next;
+
+  g_return_val_if_fail (tree != NULL, NULL);
+
+  if (line == NULL)
+    return gtk_text_btree_node_find_invalid_line (tree->root_node, view_id);
+
+  /* The rest of the line's node first, then the nodes following
+   * it and each of its parents */
+  for (next = line->next; next != NULL; next = next->next)
+    {
+      GtkTextLineData *ld = _gtk_text_line_get_data (next, view_id);
+
+      if (!ld || !ld->valid)
+        return next;
+    }
+
+  for (node = line->parent; node != NULL; node = node->parent)
+    {
+      GtkTextBTreeNode *sibling;
+
+      for (sibling = node->next; sibling != NULL; sibling = sibling->next)
+        {
+          next = gtk_text_btree_node_find_invalid_line (sibling, view_id);
+          if (next)
+            return next;
+        }
+    }
+
+  return NULL;
+}
+
 static void
 gtk_text_btree_node_remove_view (BTreeView *view, GtkTextBTreeNode *node, gpointer view_id)
 {
@@ -5721,42 +6353,52 @@ gtk_text_btree_rebalance (GtkTextBTree *tree,
 
       /*
        * Check to see if the GtkTextBTreeNode has too many children.  If it does,
-       * then split off all but the first MIN_CHILDREN into a separate
-       * GtkTextBTreeNode following the original one.  Then repeat until the
-       * GtkTextBTreeNode has a decent size.
+       * then divide them evenly among enough GtkTextBTreeNodes following the
+       * original one to have about FILL_CHILDREN children each.
        */
 
       if (node->num_children > MAX_CHILDREN)
         {
-          while (1)
+          int n_children, n_nodes;
+
+          /*
+           * If the GtkTextBTreeNode being split is the root
+           * GtkTextBTreeNode, then make a new root GtkTextBTreeNode above
+           * it first.
+           */
+
+          if (node->parent == NULL)
             {
-              /*
-               * If the GtkTextBTreeNode being split is the root
-               * GtkTextBTreeNode, then make a new root GtkTextBTreeNode above
-               * it first.
-               */
+              new_node = gtk_text_btree_node_new ();
+              new_node->parent = NULL;
+              new_node->next = NULL;
+              new_node->summary = NULL;
+              new_node->level = node->level + 1;
+              new_node->children.node = node;
+              recompute_node_counts (tree, new_node);
+              tree->root_node = new_node;
+            }
+
+          n_children = node->num_children;
+          n_nodes = (n_children + FILL_CHILDREN - 1) / FILL_CHILDREN;
+
+          /* Each GtkTextBTreeNode keeps its share of the children and
+           * passes the rest on to a new one, so the children that
+           * remain are only counted once they have all been divided
+           */
+          for (; n_nodes > 1; n_nodes--)
+            {
+              int n_kept = n_children / n_nodes;
 
-              if (node->parent == NULL)
-                {
-                  new_node = gtk_text_btree_node_new ();
-                  new_node->parent = NULL;
-                  new_node->next = NULL;
-                  new_node->summary = NULL;
-                  new_node->level = node->level + 1;
-                  new_node->children.node = node;
-                  recompute_node_counts (tree, new_node);
-                  tree->root_node = new_node;
-                }
               new_node = gtk_text_btree_node_new ();
               new_node->parent = node->parent;
               new_node->next = node->next;
               node->next = new_node;
               new_node->summary = NULL;
               new_node->level = node->level;
-              new_node->num_children = node->num_children - MIN_CHILDREN;
               if (node->level == 0)
                 {
-                  for (i = MIN_CHILDREN-1,
+                  for (i = n_kept-1,
                          line = node->children.line;
                        i > 0; i--, line = line->next)
                     {
@@ -5767,7 +6409,7 @@ gtk_text_btree_rebalance (GtkTextBTree *tree,
                 }
               else
                 {
-                  for (i = MIN_CHILDREN-1,
+                  for (i = n_kept-1,
                          child = node->children.node;
                        i > 0; i--, child = child->next)
                     {
@@ -5778,13 +6420,12 @@ gtk_text_btree_rebalance (GtkTextBTree *tree,
                 }
               recompute_node_counts (tree, node);
               node->parent->num_children++;
+              n_children -= n_kept;
+              new_node->num_children = n_children;
               node = new_node;
-              if (node->num_children <= MAX_CHILDREN)
-                {
-                  recompute_node_counts (tree, node);
-                  break;
-                }
             }
+
+          recompute_node_counts (tree, node);
         }
 
       while (node->num_children < MIN_CHILDREN)
@@ -6017,6 +6658,13 @@ gtk_text_btree_get_tag_info (GtkTextBTree *tree,
       info->tag_root = NULL;
       info->toggle_count = 0;
 
+      /* Lowest bit that isn't used yet, or 0 if all are */
+      info->mask = ~tree->tag_bits_used & (tree->tag_bits_used + 1);
+      if (info->mask != 0)
+        tree->tag_bits_used |= info->mask;
+      else
+        tree->n_unmasked_tag_infos++;
+
       tree->tag_infos = g_slist_prepend (tree->tag_infos, info);
 
 #if 0
@@ -6061,6 +6709,11 @@ gtk_text_btree_remove_tag_info (GtkTextBTree *tree,
           list->next = NULL;
           g_slist_free (list);
 
+          if (info->mask != 0)
+            tree->tag_bits_used &= ~info->mask;
+          else
+            tree->n_unmasked_tag_infos--;
+
           g_object_unref (info->tag);
 
           g_slice_free (GtkTextTagInfo, info);
@@ -6191,6 +6844,7 @@ recompute_node_counts (GtkTextBTree *tree, GtkTextBTreeNode *node)
       summary->toggle_count = 0;
       summary = summary->next;
     }
+  node->tag_parity = 0;
 
   node->num_children = 0;
   node->num_lines = 0;
@@ -6247,6 +6901,7 @@ recompute_node_counts (GtkTextBTree *tree, GtkTextBTreeNode *node)
            */
           summary->info->tag_root = node;
         }
+      gtk_text_btree_node_unset_tag_masks (node, summary->info);
       if (summary2 != NULL)
         {
           summary2->next = summary->next;
@@ -6311,6 +6966,7 @@ _gtk_change_node_toggle_count (GtkTextBTreeNode *node,
       if (summary != NULL)
         {
           summary->toggle_count += delta;
+          gtk_text_btree_node_set_tag_masks (node, info, summary->toggle_count);
           if (summary->toggle_count > 0 &&
               summary->toggle_count < info->toggle_count)
             {
@@ -6341,6 +6997,7 @@ _gtk_change_node_toggle_count (GtkTextBTreeNode *node,
               prevPtr->next = summary->next;
             }
           summary_destroy (summary);
+          gtk_text_btree_node_unset_tag_masks (node, info);
         }
       else
         {
@@ -6368,6 +7025,8 @@ _gtk_change_node_toggle_count (GtkTextBTreeNode *node,
               summary->toggle_count = info->toggle_count - delta;
               summary->next = rootnode->summary;
               rootnode->summary = summary;
+              gtk_text_btree_node_set_tag_masks (rootnode, info,
+                                                 summary->toggle_count);
               rootnode = rootnode->parent;
               rootLevel = rootnode->level;
               info->tag_root = rootnode;
@@ -6377,6 +7036,7 @@ _gtk_change_node_toggle_count (GtkTextBTreeNode *node,
           summary->toggle_count = delta;
           summary->next = node->summary;
           node->summary = summary;
+          gtk_text_btree_node_set_tag_masks (node, info, delta);
         }
     }
 
@@ -6441,6 +7101,7 @@ _gtk_change_node_toggle_count (GtkTextBTreeNode *node,
               prevPtr->next = summary->next;
             }
           summary_destroy (summary);
+          gtk_text_btree_node_unset_tag_masks (node2Ptr, info);
           info->tag_root = node2Ptr;
           break;
         }
@@ -6693,6 +7354,7 @@ gtk_text_btree_node_check_consistency (GtkTextBTree     *tree,
   GtkTextLine *line;
   GtkTextLineSegment *segPtr;
   int num_children, num_lines, num_chars, toggle_count, min_children;
+  guint64 tag_mask, tag_parity;
   GtkTextLineData *ld;
   NodeData *nd;
 
@@ -6830,6 +7492,20 @@ gtk_text_btree_node_check_consistency (GtkTextBTree     *tree,
                num_chars, node->num_chars);
     }
 
+  tag_mask = 0;
+  tag_parity = 0;
+  for (summary = node->summary; summary != NULL;
+       summary = summary->next)
+    {
+      tag_mask |= summary->info->mask;
+      if (summary->toggle_count & 1)
+        tag_parity |= summary->info->mask;
+    }
+  if (tag_mask != node->tag_mask || tag_parity != node->tag_parity)
+    {
+      g_error ("gtk_text_btree_node_check_consistency: tag masks don't match the summaries");
+    }
+
   for (summary = node->summary; summary != NULL;
        summary = summary->next)
     {
@@ -71,6 +71,16 @@ void _gtk_text_btree_insert        (GtkTextIter *iter,
 void _gtk_text_btree_insert_pixbuf (GtkTextIter *iter,
                                     GdkPixbuf   *pixbuf);
 
+typedef struct _GtkTextBTreeLoader GtkTextBTreeLoader;
+
+GtkTextBTreeLoader *_gtk_text_btree_loader_new    (GtkTextBTree       *tree);
+void                _gtk_text_btree_loader_add    (GtkTextBTreeLoader *loader,
+                                                   const gchar        *text,
+                                                   gint                len);
+void                _gtk_text_btree_loader_finish (GtkTextBTreeLoader *loader,
+                                                   GtkTextIter        *iter);
+void                _gtk_text_btree_loader_free   (GtkTextBTreeLoader *loader);
+
 void _gtk_text_btree_insert_child_anchor (GtkTextIter        *iter,
                                           GtkTextChildAnchor *anchor);
 
@@ -107,6 +117,9 @@ gboolean     _gtk_text_btree_validate          (GtkTextBTree      *tree,
 void         _gtk_text_btree_validate_line     (GtkTextBTree      *tree,
                                                 GtkTextLine       *line,
                                                 gpointer           view_id);
+GtkTextLine *_gtk_text_btree_find_invalid_line (GtkTextBTree      *tree,
+                                                gpointer           view_id,
+                                                GtkTextLine       *line);
 
 /* Tag */
 
@@ -879,6 +879,103 @@ gtk_text_buffer_set_text (GtkTextBuffer *buffer,
 
  
 
+/* Bytes read from a stream at a time */
+#define LOAD_CHUNK_SIZE 65536
+
+/**
+ * gtk_text_buffer_load_from_stream:
+ * @buffer: a #GtkTextBuffer
+ * @stream: a #GInputStream to read UTF-8 text from
+ * @cancellable: (allow-none): a #GCancellable, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Deletes current contents of @buffer, and inserts the text read
+ * from @stream instead, like gtk_text_buffer_set_text(). This is
+ * meant for loading large files: the text is read in chunks and is
+ * never in memory as a whole, and the lines are added to @buffer
+ * in one go once @stream has been read.
+ *
+ * Since the text is not in memory as a whole, it isn't passed to
+ * #GtkTextBuffer::insert-text. #GtkTextBuffer::changed is emitted
+ * once the text has been inserted.
+ *
+ * If @stream can't be read, or doesn't contain valid UTF-8, @buffer
+ * is left unchanged.
+ *
+ * Returns: %TRUE if the text was loaded, %FALSE if there was an error
+ *
+ * Since: 3.16
+ **/
+gboolean
+gtk_text_buffer_load_from_stream (GtkTextBuffer *buffer,
+                                  GInputStream  *stream,
+                                  GCancellable  *cancellable,
+                                  GError       **error)
+{
+  GtkTextBTreeLoader *loader;
+  GtkTextIter start, end;
+  const gchar *valid_end;
+  gchar *chunk;
+  gsize n_pending;
+  gssize n_read;
+
+  g_return_val_if_fail (GTK_IS_TEXT_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (G_IS_INPUT_STREAM (stream), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  loader = _gtk_text_btree_loader_new (get_btree (buffer));
+
+  /* Room for the start of a character that was cut in two
+   * by the previous read, which is at most 3 bytes
+   */
+  chunk = g_malloc (LOAD_CHUNK_SIZE + 3);
+  n_pending = 0;
+
+  while ((n_read = g_input_stream_read (stream, chunk + n_pending, LOAD_CHUNK_SIZE,
+                                        cancellable, error)) > 0)
+    {
+      n_read += n_pending;
+      g_utf8_validate (chunk, n_read, &valid_end);
+      n_pending = chunk + n_read - valid_end;
+
+      /* Anything but an incomplete character at the end is invalid */
+      if (n_pending > 0 &&
+          (n_pending > 3 ||
+           g_utf8_get_char_validated (valid_end, n_pending) != (gunichar) -2))
+        break;
+
+      _gtk_text_btree_loader_add (loader, chunk, valid_end - chunk);
+      memmove (chunk, valid_end, n_pending);
+    }
+
+  g_free (chunk);
+
+  if (n_read < 0)
+    {
+      _gtk_text_btree_loader_free (loader);
+      return FALSE;
+    }
+
+  if (n_pending > 0)
+    {
+      _gtk_text_btree_loader_free (loader);
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                           _("The text is not valid UTF-8"));
+      return FALSE;
+    }
+
+  gtk_text_buffer_get_bounds (buffer, &start, &end);
+  gtk_text_buffer_delete (buffer, &start, &end);
+
+  gtk_text_buffer_get_start_iter (buffer, &start);
+  _gtk_text_btree_loader_finish (loader, &start);
+
+  g_signal_emit (buffer, signals[CHANGED], 0);
+  g_object_notify (G_OBJECT (buffer), "cursor-position");
+
+  return TRUE;
+}
+
 /*
  * Insertion
  */
@@ -167,6 +167,12 @@ void gtk_text_buffer_set_text          (GtkTextBuffer *buffer,
                                         const gchar   *text,
                                         gint           len);
 
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_text_buffer_load_from_stream (GtkTextBuffer *buffer,
+                                           GInputStream  *stream,
+                                           GCancellable  *cancellable,
+                                           GError       **error);
+
 /* Insert into the buffer */
 GDK_AVAILABLE_IN_ALL
 void gtk_text_buffer_insert            (GtkTextBuffer *buffer,
@@ -84,12 +84,15 @@
 #include "gtktextutil.h"
 #include "gtkintl.h"
 
+#include <pango/pangocairo.h>
 #include <stdlib.h>
 #include <string.h>
 
 #define GTK_TEXT_LAYOUT_GET_PRIVATE(o)  ((GtkTextLayoutPrivate *) gtk_text_layout_get_instance_private ((o)))
 
 typedef struct _GtkTextLayoutPrivate GtkTextLayoutPrivate;
+typedef struct _ShapeSettings ShapeSettings;
+typedef struct _ShapeJob ShapeJob;
 
 struct _GtkTextLayoutPrivate
 {
@@ -97,8 +100,82 @@ struct _GtkTextLayoutPrivate
      direction only influences the direction of the cursor line.
   */
   GtkTextLine *cursor_line;
+
+  /* Recently used line displays, most recent first, and their
+   * links in that list by line */
+  GQueue display_lru;
+  GHashTable *display_cache;
+  guint display_cache_size;
+
+  /* See gtk_text_layout_set_background_shaping(). Lines being
+   * shaped by worker threads are in shape_jobs, and come back
+   * through shaped_lines. shaped_line is the job whose results
+   * are being put into the line data. */
+  guint background_shaping : 1;
+  GHashTable *shape_jobs;
+  GAsyncQueue *shaped_lines;
+  ShapeJob *shaped_line;
+};
+
+/* What the PangoContext of a worker thread needs to be set up
+ * like to measure lines the same way as the layout's contexts */
+struct _ShapeSettings
+{
+  volatile gint ref_count;
+  PangoFontDescription *font_desc;
+  PangoLanguage *language;
+  PangoMatrix *matrix;
+  PangoGravity base_gravity;
+  PangoGravityHint gravity_hint;
+  cairo_font_options_t *font_options;
+  gdouble resolution;
+};
+
+/* A snapshot of a line's text, attributes and paragraph values,
+ * taken from a size only line display, that worker threads can
+ * measure without touching the buffer */
+struct _ShapeJob
+{
+  GtkTextLine *line;
+  ShapeSettings *settings;
+  GAsyncQueue *results;
+  volatile gint cancelled;
+
+  gchar *text;
+  PangoAttrList *attrs;
+  PangoTabArray *tabs;
+  PangoDirection base_dir;
+  gboolean auto_dir;
+  PangoAlignment alignment;
+  gboolean justify;
+  gint spacing;
+  gint indent;
+  gint width;
+  PangoWrapMode wrap;
+
+  gint margin_width;
+  gint margin_height;
+
+  PangoRectangle extents;
 };
 
+/* Up to this many lines per worker thread are handed out at a
+ * time, and gtk_text_layout_validate() waits this long (in
+ * microseconds) for results if none are in yet, rather than
+ * going around the main loop for nothing. */
+#define SHAPE_JOBS_PER_THREAD 64
+#define SHAPE_MAX_THREADS 4
+#define SHAPE_WAIT_TIME 2000
+/* Lines that can't be shaped in the background are validated
+ * right away, at most this many per call */
+#define SHAPE_MAX_SYNC_LINES 128
+
+/* We keep the line displays of about two screenfuls of lines, so
+ * that redrawing, scrolling back and forth and pointer motion don't
+ * shape the same paragraphs over and over. */
+#define DISPLAY_CACHE_MIN_SIZE 16
+#define DISPLAY_CACHE_MAX_SIZE 512
+
 static GtkTextLineData *gtk_text_layout_real_wrap (GtkTextLayout *layout,
                                                    GtkTextLine *line,
                                                    /* may be NULL */
@@ -127,6 +204,18 @@ static void gtk_text_layout_emit_changed           (GtkTextLayout     *layout,
 
 static void gtk_text_layout_invalidate_all (GtkTextLayout *layout);
 
+static void display_cache_clear (GtkTextLayout *layout);
+
+static GtkTextLineDisplay *create_line_display (GtkTextLayout *layout,
+                                                GtkTextLine   *line,
+                                                gboolean       size_only,
+                                                gboolean      *invisible,
+                                                gboolean      *has_widgets);
+
+static void shape_job_free   (ShapeJob      *job);
+static void cancel_shape_job (GtkTextLayout *layout,
+                              GtkTextLine   *line);
+
 static PangoAttribute *gtk_text_attr_appearance_new (const GtkTextAppearance *appearance);
 
 static void gtk_text_layout_mark_set_handler    (GtkTextBuffer     *buffer,
@@ -200,6 +289,8 @@ gtk_text_layout_dispose (GObject *object)
       gtk_text_layout_free_line_display (layout, tmp_display);
     }
 
+  display_cache_clear (layout);
+
   if (layout->preedit_attrs != NULL)
     {
       pango_attr_list_unref (layout->preedit_attrs);
@@ -217,6 +308,9 @@ gtk_text_layout_finalize (GObject *object)
   layout = GTK_TEXT_LAYOUT (object);
 
   g_free (layout->preedit_string);
+  g_hash_table_destroy (GTK_TEXT_LAYOUT_GET_PRIVATE (layout)->display_cache);
+  g_hash_table_destroy (GTK_TEXT_LAYOUT_GET_PRIVATE (layout)->shape_jobs);
+  g_async_queue_unref (GTK_TEXT_LAYOUT_GET_PRIVATE (layout)->shaped_lines);
 
   G_OBJECT_CLASS (gtk_text_layout_parent_class)->finalize (object);
 }
@@ -276,7 +370,16 @@ gtk_text_layout_class_init (GtkTextLayoutClass *klass)
 static void
 gtk_text_layout_init (GtkTextLayout *text_layout)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (text_layout);
+
   text_layout->cursor_visible = TRUE;
+
+  g_queue_init (&priv->display_lru);
+  priv->display_cache = g_hash_table_new (NULL, NULL);
+  priv->display_cache_size = DISPLAY_CACHE_MIN_SIZE;
+
+  priv->shape_jobs = g_hash_table_new (NULL, NULL);
+  priv->shaped_lines = g_async_queue_new_full ((GDestroyNotify) shape_job_free);
 }
 
 GtkTextLayout*
@@ -635,8 +738,11 @@ text_layout_changed (GtkTextLayout *layout,
                      gint           new_height,
                      gboolean       cursors_only)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *l, *next;
+
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
    */
   if (layout->one_display_cache)
     {
@@ -649,6 +755,18 @@ text_layout_changed (GtkTextLayout *layout,
 	gtk_text_layout_invalidate_cache (layout, line, cursors_only);
     }
 
+  for (l = priv->display_lru.head; l != NULL; l = next)
+    {
+      GtkTextLineDisplay *display = l->data;
+      gint cache_y = _gtk_text_btree_find_line_top (_gtk_text_buffer_get_btree (layout->buffer),
+						    display->line, layout);
+
+      next = l->next;
+
+      if (cache_y + display->height > y && cache_y < y + old_height)
+	gtk_text_layout_invalidate_cache (layout, display->line, cursors_only);
+    }
+
   gtk_text_layout_emit_changed (layout, y, old_height, new_height);
 }
 
@@ -716,10 +834,12 @@ gtk_text_layout_get_lines (GtkTextLayout *layout,
                            gint bottom_y,
                            gint *first_line_y)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
   GtkTextLine *first_btree_line;
   GtkTextLine *last_btree_line;
   GtkTextLine *line;
   GSList *retval;
+  guint n_lines;
 
   g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), NULL);
   g_return_val_if_fail (bottom_y > top_y, NULL);
@@ -746,10 +866,12 @@ gtk_text_layout_get_lines (GtkTextLayout *layout,
 
   g_assert (last_btree_line != NULL);
 
+  n_lines = 0;
   line = first_btree_line;
   while (TRUE)
     {
       retval = g_slist_prepend (retval, line);
+      n_lines++;
 
       if (line == last_btree_line)
         break;
@@ -759,6 +881,12 @@ gtk_text_layout_get_lines (GtkTextLayout *layout,
 
   retval = g_slist_reverse (retval);
 
+  /* This is what gets drawn, so make room for the line displays
+   * of twice as many lines */
+  priv->display_cache_size = CLAMP (2 * n_lines,
+                                    priv->display_cache_size,
+                                    DISPLAY_CACHE_MAX_SIZE);
+
   return retval;
 }
 
@@ -813,29 +941,122 @@ gtk_text_layout_invalidate_all (GtkTextLayout *layout)
   gtk_text_layout_invalidate (layout, &start, &end);
 }
 
+static void
+free_line_display (GtkTextLineDisplay *display)
+{
+  if (display->layout)
+    g_object_unref (display->layout);
+
+  if (display->cursors)
+    g_array_free (display->cursors, TRUE);
+
+G_GNUC_BEGIN_IGNORE_DEPRECATIONS
+  if (display->pg_bg_color)
+    gdk_color_free (display->pg_bg_color);
+G_GNUC_END_IGNORE_DEPRECATIONS
+
+  if (display->pg_bg_rgba)
+    gdk_rgba_free (display->pg_bg_rgba);
+
+  g_slice_free (GtkTextLineDisplay, display);
+}
+
+static GtkTextLineDisplay *
+display_cache_lookup (GtkTextLayout *layout,
+                      GtkTextLine   *line)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *link;
+
+  link = g_hash_table_lookup (priv->display_cache, line);
+  if (link == NULL)
+    return NULL;
+
+  /* Move it to the front */
+  g_queue_unlink (&priv->display_lru, link);
+  g_queue_push_head_link (&priv->display_lru, link);
+
+  return link->data;
+}
+
+static void
+display_cache_remove (GtkTextLayout      *layout,
+                      GtkTextLineDisplay *display)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *link;
+
+  link = g_hash_table_lookup (priv->display_cache, display->line);
+  g_hash_table_remove (priv->display_cache, display->line);
+  g_queue_delete_link (&priv->display_lru, link);
+
+  free_line_display (display);
+}
+
+static void
+display_cache_insert (GtkTextLayout      *layout,
+                      GtkTextLineDisplay *display)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  g_queue_push_head (&priv->display_lru, display);
+  g_hash_table_insert (priv->display_cache, display->line, priv->display_lru.head);
+
+  while (priv->display_lru.length > priv->display_cache_size)
+    display_cache_remove (layout, g_queue_peek_tail (&priv->display_lru));
+}
+
+static void
+display_cache_clear (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  while (priv->display_lru.length > 0)
+    display_cache_remove (layout, g_queue_peek_tail (&priv->display_lru));
+}
+
+static void
+invalidate_display_cursors (GtkTextLineDisplay *display)
+{
+  if (display->cursors)
+    g_array_free (display->cursors, TRUE);
+  display->cursors = NULL;
+  display->cursors_invalid = TRUE;
+  display->has_block_cursor = FALSE;
+}
+
 static void
 gtk_text_layout_invalidate_cache (GtkTextLayout *layout,
                                   GtkTextLine   *line,
 				  gboolean       cursors_only)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *link;
+
   if (layout->one_display_cache && line == layout->one_display_cache->line)
     {
       GtkTextLineDisplay *display = layout->one_display_cache;
 
       if (cursors_only)
-	{
-          if (display->cursors)
-            g_array_free (display->cursors, TRUE);
-	  display->cursors = NULL;
-	  display->cursors_invalid = TRUE;
-	  display->has_block_cursor = FALSE;
-	}
+	invalidate_display_cursors (display);
       else
 	{
 	  layout->one_display_cache = NULL;
 	  gtk_text_layout_free_line_display (layout, display);
 	}
     }
+
+  link = g_hash_table_lookup (priv->display_cache, line);
+  if (link != NULL)
+    {
+      if (cursors_only)
+	invalidate_display_cursors (link->data);
+      else
+	display_cache_remove (layout, link->data);
+    }
+
+  if (!cursors_only)
+    cancel_shape_job (layout, line);
 }
 
 /* Now invalidate the paragraph containing the cursor
@@ -926,32 +1147,38 @@ gtk_text_layout_real_invalidate_cursors (GtkTextLayout     *layout,
 					 const GtkTextIter *start,
 					 const GtkTextIter *end)
 {
-  /* Check if the range intersects our cached line display,
-   * and invalidate the cached line if so.
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  gint start_line, end_line, line_number;
+  GList *l;
+
+  start_line = gtk_text_iter_get_line (start);
+  end_line = gtk_text_iter_get_line (end);
+  if (start_line > end_line)
+    {
+      gint tmp = start_line;
+      start_line = end_line;
+      end_line = tmp;
+    }
+
+  /* Check if the range intersects our cached line displays,
+   * and invalidate the cached lines if so.
    */
   if (layout->one_display_cache)
     {
-      GtkTextIter line_start, line_end;
       GtkTextLine *line = layout->one_display_cache->line;
 
-      gtk_text_layout_get_iter_at_line (layout, &line_start, line, 0);
-
-      line_end = line_start;
-      if (!gtk_text_iter_ends_line (&line_end))
-	gtk_text_iter_forward_to_line_end (&line_end);
+      line_number = _gtk_text_line_get_number (line);
+      if (line_number >= start_line && line_number <= end_line)
+	gtk_text_layout_invalidate_cache (layout, line, TRUE);
+    }
 
-      if (gtk_text_iter_compare (start, end) > 0)
-	{
-	  const GtkTextIter *tmp = start;
-	  start = end;
-	  end = tmp;
-	}
+  for (l = priv->display_lru.head; l != NULL; l = l->next)
+    {
+      GtkTextLineDisplay *display = l->data;
 
-      if (gtk_text_iter_compare (&line_start, end) <= 0 &&
-	  gtk_text_iter_compare (start, &line_end) <= 0)
-	{
-	  gtk_text_layout_invalidate_cache (layout, line, TRUE);
-	}
+      line_number = _gtk_text_line_get_number (display->line);
+      if (line_number >= start_line && line_number <= end_line)
+	invalidate_display_cursors (display);
     }
 
   gtk_text_layout_invalidated (layout);
@@ -1114,6 +1341,441 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
     }
 }
 
+/*
+ * Background shaping
+ */
+
+static ShapeSettings *
+shape_settings_new (PangoContext *context)
+{
+  ShapeSettings *settings;
+  const PangoMatrix *matrix;
+  const cairo_font_options_t *font_options;
+
+  settings = g_slice_new0 (ShapeSettings);
+  settings->ref_count = 1;
+  settings->font_desc = pango_font_description_copy (pango_context_get_font_description (context));
+  settings->language = pango_context_get_language (context);
+  matrix = pango_context_get_matrix (context);
+  settings->matrix = matrix ? pango_matrix_copy (matrix) : NULL;
+  settings->base_gravity = pango_context_get_base_gravity (context);
+  settings->gravity_hint = pango_context_get_gravity_hint (context);
+  font_options = pango_cairo_context_get_font_options (context);
+  settings->font_options = font_options ? cairo_font_options_copy (font_options) : NULL;
+  settings->resolution = pango_cairo_context_get_resolution (context);
+
+  return settings;
+}
+
+static ShapeSettings *
+shape_settings_ref (ShapeSettings *settings)
+{
+  g_atomic_int_inc (&settings->ref_count);
+
+  return settings;
+}
+
+static void
+shape_settings_unref (ShapeSettings *settings)
+{
+  if (!g_atomic_int_dec_and_test (&settings->ref_count))
+    return;
+
+  pango_font_description_free (settings->font_desc);
+  if (settings->matrix)
+    pango_matrix_free (settings->matrix);
+  if (settings->font_options)
+    cairo_font_options_destroy (settings->font_options);
+  g_slice_free (ShapeSettings, settings);
+}
+
+static ShapeJob *
+shape_job_new (GtkTextLayout      *layout,
+               GtkTextLineDisplay *display,
+               ShapeSettings      *settings)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  PangoLayout *playout = display->layout;
+  PangoAttrList *attrs;
+  ShapeJob *job;
+
+  job = g_slice_new0 (ShapeJob);
+  job->line = display->line;
+  job->settings = shape_settings_ref (settings);
+  job->results = g_async_queue_ref (priv->shaped_lines);
+
+  job->text = g_strdup (pango_layout_get_text (playout));
+  attrs = pango_layout_get_attributes (playout);
+  job->attrs = attrs ? pango_attr_list_copy (attrs) : NULL;
+  job->tabs = pango_layout_get_tabs (playout);
+  job->base_dir = pango_context_get_base_dir (pango_layout_get_context (playout));
+  job->auto_dir = pango_layout_get_auto_dir (playout);
+  job->alignment = pango_layout_get_alignment (playout);
+  job->justify = pango_layout_get_justify (playout);
+  job->spacing = pango_layout_get_spacing (playout);
+  job->indent = pango_layout_get_indent (playout);
+  job->width = pango_layout_get_width (playout);
+  job->wrap = pango_layout_get_wrap (playout);
+
+  job->margin_width = display->left_margin + display->right_margin;
+  job->margin_height = display->height;
+
+  return job;
+}
+
+static void
+shape_job_free (ShapeJob *job)
+{
+  shape_settings_unref (job->settings);
+  g_free (job->text);
+  if (job->attrs)
+    pango_attr_list_unref (job->attrs);
+  if (job->tabs)
+    pango_tab_array_free (job->tabs);
+  g_slice_free (ShapeJob, job);
+}
+
+static void
+cancel_shape_job (GtkTextLayout *layout,
+                  GtkTextLine   *line)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  ShapeJob *job;
+
+  job = g_hash_table_lookup (priv->shape_jobs, line);
+  if (job == NULL)
+    return;
+
+  /* The job is freed when it comes back */
+  g_atomic_int_set (&job->cancelled, TRUE);
+  g_hash_table_remove (priv->shape_jobs, line);
+}
+
+static void
+cancel_shape_jobs (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GHashTableIter iter;
+  ShapeJob *job;
+
+  g_hash_table_iter_init (&iter, priv->shape_jobs);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &job))
+    {
+      g_atomic_int_set (&job->cancelled, TRUE);
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+static GPrivate shape_context = G_PRIVATE_INIT (g_object_unref);
+
+/* Each worker thread measures with a context on its own font map,
+ * Pango font maps can't be shared between threads */
+static PangoContext *
+get_shape_context (ShapeSettings *settings)
+{
+  PangoContext *context;
+
+  context = g_private_get (&shape_context);
+  if (context == NULL)
+    {
+      context = pango_font_map_create_context (pango_cairo_font_map_get_default ());
+      g_private_set (&shape_context, context);
+    }
+
+  pango_context_set_font_description (context, settings->font_desc);
+  pango_context_set_language (context, settings->language);
+  pango_context_set_matrix (context, settings->matrix);
+  pango_context_set_base_gravity (context, settings->base_gravity);
+  pango_context_set_gravity_hint (context, settings->gravity_hint);
+  pango_cairo_context_set_font_options (context, settings->font_options);
+  pango_cairo_context_set_resolution (context, settings->resolution);
+
+  return context;
+}
+
+static void
+shape_line_thread_func (gpointer data,
+                        gpointer user_data)
+{
+  ShapeJob *job = data;
+  GAsyncQueue *results = job->results;
+
+  if (!g_atomic_int_get (&job->cancelled))
+    {
+      PangoContext *context;
+      PangoLayout *layout;
+
+      context = get_shape_context (job->settings);
+      pango_context_set_base_dir (context, job->base_dir);
+
+      layout = pango_layout_new (context);
+      pango_layout_set_auto_dir (layout, job->auto_dir);
+      pango_layout_set_alignment (layout, job->alignment);
+      pango_layout_set_justify (layout, job->justify);
+      pango_layout_set_spacing (layout, job->spacing);
+      pango_layout_set_indent (layout, job->indent);
+      pango_layout_set_tabs (layout, job->tabs);
+      pango_layout_set_width (layout, job->width);
+      pango_layout_set_wrap (layout, job->wrap);
+      pango_layout_set_text (layout, job->text, -1);
+      pango_layout_set_attributes (layout, job->attrs);
+
+      pango_layout_get_extents (layout, NULL, &job->extents);
+
+      g_object_unref (layout);
+    }
+
+  /* The layout may free the job as soon as it has it */
+  g_async_queue_push (results, job);
+  g_async_queue_unref (results);
+}
+
+static GThreadPool *
+get_shape_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      guint n_threads = MIN (g_get_num_processors (), SHAPE_MAX_THREADS + 1);
+
+      /* Leave a core for the main thread, shaping lines
+       * in the background only pays off with another one */
+      if (n_threads > 1)
+        pool = g_thread_pool_new (shape_line_thread_func, NULL,
+                                  n_threads - 1, FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
+/* A run of lines that got validated, that ::changed is
+ * emitted for in one go */
+typedef struct
+{
+  gint y;
+  gint old_height;
+  gint new_height;
+  gboolean pending;
+} ChangedRegion;
+
+static void
+flush_changed_region (GtkTextLayout *layout,
+                      ChangedRegion *region)
+{
+  if (!region->pending)
+    return;
+
+  update_layout_size (layout);
+  gtk_text_layout_emit_changed (layout, region->y,
+                                region->old_height, region->new_height);
+  region->pending = FALSE;
+}
+
+/* Validates @line with the results of @job, or right away if
+ * @job is %NULL
+ */
+static void
+validate_line_into_region (GtkTextLayout *layout,
+                           GtkTextLine   *line,
+                           ShapeJob      *job,
+                           ChangedRegion *region)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextBTree *btree = _gtk_text_buffer_get_btree (layout->buffer);
+  GtkTextLineData *line_data;
+  gint y, old_height;
+
+  /* The line's top doesn't depend on its own height, but on
+   * all lines above, so the region has to go out before a
+   * line somewhere else changes */
+  y = _gtk_text_btree_find_line_top (btree, line, layout);
+  if (region->pending && y != region->y + region->new_height)
+    flush_changed_region (layout, region);
+
+  line_data = _gtk_text_line_get_data (line, layout);
+  old_height = line_data ? line_data->height : 0;
+
+  priv->shaped_line = job;
+  _gtk_text_btree_validate_line (btree, line, layout);
+  priv->shaped_line = NULL;
+
+  line_data = _gtk_text_line_get_data (line, layout);
+
+  if (!region->pending)
+    {
+      region->y = y;
+      region->old_height = 0;
+      region->new_height = 0;
+      region->pending = TRUE;
+    }
+  region->old_height += old_height;
+  region->new_height += line_data ? line_data->height : 0;
+}
+
+/* Puts the measurements that came back into the line data,
+ * waiting up to @timeout microseconds for the first one.
+ * Returns whether any lines were validated. */
+static gboolean
+commit_shaped_lines (GtkTextLayout *layout,
+                     guint64        timeout,
+                     ChangedRegion *region)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  gboolean validated = FALSE;
+  ShapeJob *job;
+
+  if (timeout > 0)
+    job = g_async_queue_timeout_pop (priv->shaped_lines, timeout);
+  else
+    job = g_async_queue_try_pop (priv->shaped_lines);
+
+  for (; job != NULL; job = g_async_queue_try_pop (priv->shaped_lines))
+    {
+      /* Cancelled jobs are out of shape_jobs already, and their
+       * line may be gone */
+      if (!g_atomic_int_get (&job->cancelled))
+        {
+          g_hash_table_remove (priv->shape_jobs, job->line);
+          validate_line_into_region (layout, job->line, job, region);
+          validated = TRUE;
+        }
+
+      shape_job_free (job);
+    }
+
+  return validated;
+}
+
+/* Hands invalid lines to the worker threads until they have
+ * enough to do */
+static void
+queue_invalid_lines (GtkTextLayout *layout,
+                     GThreadPool   *pool,
+                     ShapeSettings *settings,
+                     ChangedRegion *region)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GtkTextBTree *btree = _gtk_text_buffer_get_btree (layout->buffer);
+  guint max_jobs, n_sync_lines;
+  GtkTextLine *line;
+
+  max_jobs = SHAPE_JOBS_PER_THREAD * g_thread_pool_get_max_threads (pool);
+  n_sync_lines = 0;
+  line = NULL;
+
+  while (g_hash_table_size (priv->shape_jobs) < max_jobs &&
+         (line = _gtk_text_btree_find_invalid_line (btree, layout, line)) != NULL)
+    {
+      GtkTextLineDisplay *display;
+      GtkTextLineData *line_data;
+      gboolean invisible, has_widgets;
+      ShapeJob *job;
+
+      if (g_hash_table_contains (priv->shape_jobs, line))
+        continue;
+
+      display = create_line_display (layout, line, TRUE,
+                                     &invisible, &has_widgets);
+
+      /* Invisible lines take no shaping, and child widgets
+       * need to be allocated from here */
+      if (invisible || has_widgets)
+        {
+          free_line_display (display);
+          validate_line_into_region (layout, line, NULL, region);
+
+          if (++n_sync_lines >= SHAPE_MAX_SYNC_LINES)
+            break;
+
+          continue;
+        }
+
+      job = shape_job_new (layout, display, settings);
+      free_line_display (display);
+
+      /* Having line data means we hear about the line going
+       * away, so the job can be cancelled */
+      line_data = _gtk_text_line_get_data (line, layout);
+      if (line_data == NULL)
+        {
+          line_data = _gtk_text_line_data_new (layout, line);
+          _gtk_text_line_add_data (line, line_data);
+        }
+
+      g_hash_table_insert (priv->shape_jobs, line, job);
+      g_thread_pool_push (pool, job, NULL);
+    }
+}
+
+static gboolean
+validate_in_background (GtkTextLayout *layout)
+{
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  ChangedRegion region = { 0, };
+  ShapeSettings *settings;
+  GThreadPool *pool;
+  gboolean validated;
+
+  pool = get_shape_thread_pool ();
+  if (pool == NULL)
+    return FALSE;
+
+  /* Worker threads use their own default font map, so this only
+   * works if the layout measures with the default font map too */
+  if (pango_context_get_font_map (layout->ltr_context) != pango_cairo_font_map_get_default () ||
+      pango_context_get_font_map (layout->rtl_context) != pango_cairo_font_map_get_default ())
+    return FALSE;
+
+  validated = commit_shaped_lines (layout, 0, &region);
+
+  settings = shape_settings_new (layout->ltr_context);
+  queue_invalid_lines (layout, pool, settings, &region);
+  shape_settings_unref (settings);
+
+  if (!validated && g_hash_table_size (priv->shape_jobs) > 0)
+    commit_shaped_lines (layout, SHAPE_WAIT_TIME, &region);
+
+  flush_changed_region (layout, &region);
+
+  return TRUE;
+}
+
+/**
+ * gtk_text_layout_set_background_shaping:
+ * @layout: a #GtkTextLayout
+ * @background_shaping: whether to shape lines on worker threads
+ *
+ * Sets whether gtk_text_layout_validate() has worker threads
+ * shape and measure the lines it validates. The lines are
+ * validated by later calls, as their measurements come in.
+ * This gets large buffers measured a lot faster on machines
+ * with more than one core. gtk_text_layout_validate_yrange()
+ * still validates lines right away.
+ */
+void
+gtk_text_layout_set_background_shaping (GtkTextLayout *layout,
+                                        gboolean       background_shaping)
+{
+  GtkTextLayoutPrivate *priv;
+
+  g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
+
+  priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+
+  background_shaping = background_shaping != FALSE;
+  if (priv->background_shaping == background_shaping)
+    return;
+
+  priv->background_shaping = background_shaping;
+
+  if (!background_shaping)
+    cancel_shape_jobs (layout);
+}
+
 /**
  * gtk_text_layout_validate:
  * @tree: a #GtkTextLayout
@@ -1122,6 +1784,10 @@ gtk_text_layout_validate_yrange (GtkTextLayout *layout,
  *
  * Validate regions of a #GtkTextLayout. The ::changed signal will
  * be emitted for each region validated.
+ *
+ * With background shaping (see gtk_text_layout_set_background_shaping()),
+ * this validates the lines that have been measured since the last call
+ * instead, whatever their height, and hands out more lines to measure.
  **/
 void
 gtk_text_layout_validate (GtkTextLayout *layout,
@@ -1131,6 +1797,10 @@ gtk_text_layout_validate (GtkTextLayout *layout,
 
   g_return_if_fail (GTK_IS_TEXT_LAYOUT (layout));
 
+  if (GTK_TEXT_LAYOUT_GET_PRIVATE (layout)->background_shaping &&
+      validate_in_background (layout))
+    return;
+
   while (max_pixels > 0 &&
          _gtk_text_btree_validate (_gtk_text_buffer_get_btree (layout->buffer),
                                    layout,  max_pixels,
@@ -1149,6 +1819,7 @@ gtk_text_layout_real_wrap (GtkTextLayout   *layout,
                            /* may be NULL */
                            GtkTextLineData *line_data)
 {
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
   GtkTextLineDisplay *display;
 
   g_return_val_if_fail (GTK_IS_TEXT_LAYOUT (layout), NULL);
@@ -1160,6 +1831,21 @@ gtk_text_layout_real_wrap (GtkTextLayout   *layout,
       _gtk_text_line_add_data (line, line_data);
     }
 
+  /* The line was measured by a worker thread */
+  if (priv->shaped_line && priv->shaped_line->line == line)
+    {
+      ShapeJob *job = priv->shaped_line;
+
+      line_data->width = PIXEL_BOUND (job->extents.width) + job->margin_width;
+      line_data->height = job->margin_height + PANGO_PIXELS (job->extents.height);
+      line_data->valid = TRUE;
+
+      return line_data;
+    }
+
+  /* The line is needed now, drop the background job for it */
+  cancel_shape_job (layout, line);
+
   display = gtk_text_layout_get_line_display (layout, line, TRUE);
   line_data->width = display->width;
   line_data->height = display->height;
@@ -2118,10 +2804,15 @@ tags_array_toggle_tag (GPtrArray  *array,
   return array;
 }
 
-GtkTextLineDisplay *
-gtk_text_layout_get_line_display (GtkTextLayout *layout,
-                                  GtkTextLine   *line,
-                                  gboolean       size_only)
+/* Creates a line display with its text, attributes and paragraph
+ * values set up, but doesn't measure it.
+ */
+static GtkTextLineDisplay *
+create_line_display (GtkTextLayout *layout,
+                     GtkTextLine   *line,
+                     gboolean       size_only,
+                     gboolean      *invisible,
+                     gboolean      *has_widgets)
 {
   GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
   GtkTextLineDisplay *display;
@@ -2131,7 +2822,6 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
   gchar *text;
   PangoAttrList *attrs;
   gint text_allocated, layout_byte_offset, buffer_byte_offset;
-  PangoRectangle extents;
   gboolean para_values_set = FALSE;
   GSList *cursor_byte_offsets = NULL;
   GSList *cursor_segs = NULL;
@@ -2140,27 +2830,8 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
   PangoDirection base_dir;
   GPtrArray *tags;
   gboolean initial_toggle_segments;
-  
-  g_return_val_if_fail (line != NULL, NULL);
-
-  if (layout->one_display_cache)
-    {
-      if (line == layout->one_display_cache->line &&
-          (size_only || !layout->one_display_cache->size_only))
-	{
-	  if (!size_only)
-            update_text_display_cursors (layout, line, layout->one_display_cache);
-	  return layout->one_display_cache;
-	}
-      else
-        {
-          GtkTextLineDisplay *tmp_display = layout->one_display_cache;
-          layout->one_display_cache = NULL;
-          gtk_text_layout_free_line_display (layout, tmp_display);
-        }
-    }
 
-  DV (g_print ("creating one line display cache (%s)\n", G_STRLOC));
+  DV (g_print ("creating line display (%s)\n", G_STRLOC));
 
   display = g_slice_new0 (GtkTextLineDisplay);
 
@@ -2178,7 +2849,9 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
 	display->layout = pango_layout_new (layout->rtl_context);
       else
 	display->layout = pango_layout_new (layout->ltr_context);
-      
+
+      *invisible = TRUE;
+      *has_widgets = FALSE;
       return display;
     }
 
@@ -2445,6 +3118,60 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
   g_slist_free (cursor_byte_offsets);
   g_slist_free (cursor_segs);
 
+  /* Free this if we aren't in a loop */
+  if (layout->wrap_loop_count == 0)
+    invalidate_cached_style (layout);
+
+  g_free (text);
+  pango_attr_list_unref (attrs);
+  if (tags != NULL)
+    g_ptr_array_free (tags, TRUE);
+
+  *invisible = FALSE;
+  *has_widgets = saw_widget;
+  return display;
+}
+
+GtkTextLineDisplay *
+gtk_text_layout_get_line_display (GtkTextLayout *layout,
+                                  GtkTextLine   *line,
+                                  gboolean       size_only)
+{
+  GtkTextLineDisplay *display;
+  PangoRectangle extents;
+  gboolean invisible, saw_widget;
+
+  g_return_val_if_fail (line != NULL, NULL);
+
+  /* Full line displays are kept in the display cache, and the one
+   * size only display used while wrapping in one_display_cache */
+  display = display_cache_lookup (layout, line);
+  if (display)
+    {
+      if (!size_only)
+        update_text_display_cursors (layout, line, display);
+      return display;
+    }
+
+  if (layout->one_display_cache)
+    {
+      if (line == layout->one_display_cache->line && size_only)
+	return layout->one_display_cache;
+      else if (line == layout->one_display_cache->line || size_only)
+        {
+          GtkTextLineDisplay *tmp_display = layout->one_display_cache;
+          layout->one_display_cache = NULL;
+          gtk_text_layout_free_line_display (layout, tmp_display);
+        }
+    }
+
+  display = create_line_display (layout, line, size_only,
+                                 &invisible, &saw_widget);
+
+  /* Totally invisible lines are neither measured nor cached */
+  if (invisible)
+    return display;
+
   pango_layout_get_extents (display->layout, NULL, &extents);
 
   display->width = PIXEL_BOUND (extents.width) + display->left_margin + display->right_margin;
@@ -2470,16 +3197,10 @@ gtk_text_layout_get_line_display (GtkTextLayout *layout,
 	}
     }
   
-  /* Free this if we aren't in a loop */
-  if (layout->wrap_loop_count == 0)
-    invalidate_cached_style (layout);
-
-  g_free (text);
-  pango_attr_list_unref (attrs);
-  if (tags != NULL)
-    g_ptr_array_free (tags, TRUE);
-
-  layout->one_display_cache = display;
+  if (size_only)
+    layout->one_display_cache = display;
+  else
+    display_cache_insert (layout, display);
 
   if (saw_widget)
     allocate_child_widgets (layout, display);
@@ -2491,24 +3212,17 @@ void
 gtk_text_layout_free_line_display (GtkTextLayout      *layout,
                                    GtkTextLineDisplay *display)
 {
-  if (display != layout->one_display_cache)
-    {
-      if (display->layout)
-        g_object_unref (display->layout);
-
-      if (display->cursors)
-        g_array_free (display->cursors, TRUE);
+  GtkTextLayoutPrivate *priv = GTK_TEXT_LAYOUT_GET_PRIVATE (layout);
+  GList *link;
 
-G_GNUC_BEGIN_IGNORE_DEPRECATIONS
-      if (display->pg_bg_color)
-        gdk_color_free (display->pg_bg_color);
-G_GNUC_END_IGNORE_DEPRECATIONS
+  if (display == layout->one_display_cache)
+    return;
 
-      if (display->pg_bg_rgba)
-        gdk_rgba_free (display->pg_bg_rgba);
+  link = g_hash_table_lookup (priv->display_cache, display->line);
+  if (link != NULL && link->data == display)
+    return;
 
-      g_slice_free (GtkTextLineDisplay, display);
-    }
+  free_line_display (display);
 }
 
 /* Functions to convert iter <=> index for the line of a GtkTextLineDisplay
@@ -144,8 +144,8 @@ struct _GtkTextLayout
    * over long runs with the same style. */
   GtkTextAttributes *one_style_cache;
 
-  /* A cache of one line display. Getting the same line
-   * many times in a row is the most common case.
+  /* A cache of one size only line display, as used when
+   * wrapping. Full line displays are cached separately.
    */
   GtkTextLineDisplay *one_display_cache;
 
@@ -305,6 +305,10 @@ void     gtk_text_layout_set_cursor_visible (GtkTextLayout     *layout,
 GDK_AVAILABLE_IN_ALL
 gboolean gtk_text_layout_get_cursor_visible (GtkTextLayout     *layout);
 
+GDK_AVAILABLE_IN_ALL
+void     gtk_text_layout_set_background_shaping (GtkTextLayout *layout,
+                                                 gboolean       background_shaping);
+
 /* Getting the size or the lines potentially results in a call to
  * recompute, which is pretty massively expensive. Thus it should
  * basically only be done in an idle handler.
@@ -49,6 +49,8 @@ struct _GtkTextTagInfo {
   GtkTextTag *tag;
   GtkTextBTreeNode *tag_root; /* highest-level node containing the tag */
   gint toggle_count;      /* total toggles of this tag below tag_root */
+  guint64 mask;           /* bit for this tag in the node tag masks,
+                           * or 0 if the tree ran out of bits */
 };
 
 /* Body of a segment that toggles a tag on or off */
@@ -1490,6 +1490,7 @@ gtk_text_view_init (GtkTextView *text_view)
   gtk_widget_set_can_focus (widget, TRUE);
 
   priv->pixel_cache = _gtk_pixel_cache_new ();
+  _gtk_pixel_cache_set_prefetch (priv->pixel_cache, TRUE);
 
   /* Set up default style */
   priv->wrap_mode = GTK_WRAP_NONE;
@@ -7329,6 +7330,9 @@ gtk_text_view_ensure_layout (GtkTextView *text_view)
       
       priv->layout = gtk_text_layout_new ();
 
+      if (g_getenv ("GTK_TEXT_BACKGROUND_SHAPING"))
+        gtk_text_layout_set_background_shaping (priv->layout, TRUE);
+
       g_signal_connect (priv->layout,
 			"invalidated",
 			G_CALLBACK (invalidated_handler),
@@ -8239,6 +8243,8 @@ gtk_text_view_value_changed (GtkAdjustment *adjustment,
     {
       GSList *tmp_list;
 
+      _gtk_pixel_cache_view_moved (priv->pixel_cache);
+
       if (gtk_widget_get_realized (GTK_WIDGET (text_view)))
         {
           if (dy != 0)
@@ -240,6 +240,7 @@
     }G_STMT_END
 
 #define ROW_REF_DATA_STRING "gtk-tree-row-refs"
+#define RANGE_DATA_STRING "gtk-tree-model-ranges"
 
 enum {
   ROW_CHANGED,
@@ -247,6 +248,8 @@ enum {
   ROW_HAS_CHILD_TOGGLED,
   ROW_DELETED,
   ROWS_REORDERED,
+  ROWS_INSERTED,
+  ROWS_DELETED,
   LAST_SIGNAL
 };
 
@@ -264,6 +267,29 @@ typedef struct
   GSList *list;
 } RowRefList;
 
+/* Per-model state for ::rows-inserted and ::rows-deleted, see
+ * gtk_tree_model_handles_ranges() and _gtk_tree_model_begin_batch().
+ */
+typedef struct
+{
+  /* ::row-inserted and ::row-deleted handlers of consumers that
+   * also handle the range signals
+   */
+  GArray      *handler_ids;
+
+  gint         replaying;
+
+  gint         batch_depth;
+  gboolean     batch_merge;
+
+  /* Rows that have been inserted or deleted during a batch but
+   * not announced yet
+   */
+  GtkTreePath *pending_path;
+  gint         pending_n_rows;
+  gboolean     pending_deleted;
+} RangeData;
+
 static void      gtk_tree_model_base_init   (gpointer           g_class);
 
 /* custom closures */
@@ -285,12 +311,26 @@ static void      rows_reordered_marshal     (GClosure          *closure,
                                              const GValue      *param_values,
                                              gpointer           invocation_hint,
                                              gpointer           marshal_data);
+static void      rows_inserted_marshal      (GClosure          *closure,
+                                             GValue /* out */  *return_value,
+                                             guint              n_param_value,
+                                             const GValue      *param_values,
+                                             gpointer           invocation_hint,
+                                             gpointer           marshal_data);
+static void      rows_deleted_marshal       (GClosure          *closure,
+                                             GValue /* out */  *return_value,
+                                             guint              n_param_value,
+                                             const GValue      *param_values,
+                                             gpointer           invocation_hint,
+                                             gpointer           marshal_data);
 
 static void      gtk_tree_row_ref_inserted  (RowRefList        *refs,
                                              GtkTreePath       *path,
-                                             GtkTreeIter       *iter);
+                                             GtkTreeIter       *iter,
+                                             gint               n_rows);
 static void      gtk_tree_row_ref_deleted   (RowRefList        *refs,
-                                             GtkTreePath       *path);
+                                             GtkTreePath       *path,
+                                             gint               n_rows);
 static void      gtk_tree_row_ref_reordered (RowRefList        *refs,
                                              GtkTreePath       *path,
                                              GtkTreeIter       *iter,
@@ -337,6 +377,8 @@ gtk_tree_model_base_init (gpointer g_class)
       GType row_inserted_params[2];
       GType row_deleted_params[1];
       GType rows_reordered_params[3];
+      GType rows_inserted_params[3];
+      GType rows_deleted_params[2];
 
       row_inserted_params[0] = GTK_TYPE_TREE_PATH | G_SIGNAL_TYPE_STATIC_SCOPE;
       row_inserted_params[1] = GTK_TYPE_TREE_ITER;
@@ -347,6 +389,13 @@ gtk_tree_model_base_init (gpointer g_class)
       rows_reordered_params[1] = GTK_TYPE_TREE_ITER;
       rows_reordered_params[2] = G_TYPE_POINTER;
 
+      rows_inserted_params[0] = GTK_TYPE_TREE_PATH | G_SIGNAL_TYPE_STATIC_SCOPE;
+      rows_inserted_params[1] = GTK_TYPE_TREE_ITER;
+      rows_inserted_params[2] = G_TYPE_INT;
+
+      rows_deleted_params[0] = GTK_TYPE_TREE_PATH | G_SIGNAL_TYPE_STATIC_SCOPE;
+      rows_deleted_params[1] = G_TYPE_INT;
+
       /**
        * GtkTreeModel::row-changed:
        * @tree_model: the #GtkTreeModel on which the signal is emitted
@@ -479,6 +528,73 @@ gtk_tree_model_base_init (gpointer g_class)
                        _gtk_marshal_VOID__BOXED_BOXED_POINTER,
                        G_TYPE_NONE, 3,
                        rows_reordered_params);
+
+      /**
+       * GtkTreeModel::rows-inserted:
+       * @tree_model: the #GtkTreeModel on which the signal is emitted
+       * @path: a #GtkTreePath-struct identifying the first new row
+       * @iter: a valid #GtkTreeIter-struct pointing to the first new row
+       * @n_rows: the number of consecutive rows that have been inserted
+       *
+       * This signal is emitted when @n_rows new rows have been inserted
+       * next to each other in the model, instead of emitting
+       * #GtkTreeModel::row-inserted once per row. The new rows don't
+       * have children.
+       *
+       * Consumers that handle this signal have to connect to
+       * #GtkTreeModel::row-inserted as well, since single rows are only
+       * announced with that signal, and pass the id of that handler to
+       * gtk_tree_model_handles_ranges(). Models are expected to emit
+       * this signal only if gtk_tree_model_needs_row_inserted() returns
+       * %FALSE, that is if all ::row-inserted handlers were passed to
+       * gtk_tree_model_handles_ranges().
+       *
+       * Since: 3.16
+       */
+      closure = g_closure_new_simple (sizeof (GClosure), NULL);
+      g_closure_set_marshal (closure, rows_inserted_marshal);
+      tree_model_signals[ROWS_INSERTED] =
+        g_signal_newv (I_("rows-inserted"),
+                       GTK_TYPE_TREE_MODEL,
+                       G_SIGNAL_RUN_FIRST,
+                       closure,
+                       NULL, NULL,
+                       _gtk_marshal_VOID__BOXED_BOXED_INT,
+                       G_TYPE_NONE, 3,
+                       rows_inserted_params);
+
+      /**
+       * GtkTreeModel::rows-deleted:
+       * @tree_model: the #GtkTreeModel on which the signal is emitted
+       * @path: a #GtkTreePath-struct identifying the first deleted row
+       * @n_rows: the number of consecutive rows that have been deleted
+       *
+       * This signal is emitted when @n_rows rows that were next to
+       * each other have been deleted from the model, instead of emitting
+       * #GtkTreeModel::row-deleted once per row.
+       *
+       * The location pointed to by @path is the location that the
+       * first row previously was at. It may not be a valid location
+       * anymore.
+       *
+       * As with #GtkTreeModel::rows-inserted, consumers have to handle
+       * #GtkTreeModel::row-deleted as well and pass that handler to
+       * gtk_tree_model_handles_ranges().
+       *
+       * Since: 3.16
+       */
+      closure = g_closure_new_simple (sizeof (GClosure), NULL);
+      g_closure_set_marshal (closure, rows_deleted_marshal);
+      tree_model_signals[ROWS_DELETED] =
+        g_signal_newv (I_("rows-deleted"),
+                       GTK_TYPE_TREE_MODEL,
+                       G_SIGNAL_RUN_FIRST,
+                       closure,
+                       NULL, NULL,
+                       _gtk_marshal_VOID__BOXED_INT,
+                       G_TYPE_NONE, 2,
+                       rows_deleted_params);
+
       initialized = TRUE;
     }
 }
@@ -500,10 +616,14 @@ row_inserted_marshal (GClosure          *closure,
   GObject *model = g_value_get_object (param_values + 0);
   GtkTreePath *path = (GtkTreePath *)g_value_get_boxed (param_values + 1);
   GtkTreeIter *iter = (GtkTreeIter *)g_value_get_boxed (param_values + 2);
+  RangeData *ranges = g_object_get_data (model, RANGE_DATA_STRING);
 
-  /* first, we need to update internal row references */
-  gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
-                             path, iter);
+  /* first, we need to update internal row references, unless
+   * ::rows-inserted did that already
+   */
+  if (ranges == NULL || ranges->replaying == 0)
+    gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
+                               path, iter, 1);
 
   /* fetch the interface ->row_inserted implementation */
   iface = GTK_TREE_MODEL_GET_IFACE (model);
@@ -529,10 +649,14 @@ row_deleted_marshal (GClosure          *closure,
                                  GtkTreePath  *path) = NULL;
   GObject *model = g_value_get_object (param_values + 0);
   GtkTreePath *path = (GtkTreePath *)g_value_get_boxed (param_values + 1);
+  RangeData *ranges = g_object_get_data (model, RANGE_DATA_STRING);
 
-  /* first, we need to update internal row references */
-  gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
-                            path);
+  /* first, we need to update internal row references, unless
+   * ::rows-deleted did that already
+   */
+  if (ranges == NULL || ranges->replaying == 0)
+    gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
+                              path, 1);
 
   /* fetch the interface ->row_deleted implementation */
   iface = GTK_TREE_MODEL_GET_IFACE (model);
@@ -579,6 +703,42 @@ rows_reordered_marshal (GClosure          *closure,
     rows_reordered_callback (GTK_TREE_MODEL (model), path, iter, new_order);
 }
 
+/* The range signals have no slot in the interface structure, their
+ * class closures only keep the row references up to date.
+ */
+static void
+rows_inserted_marshal (GClosure          *closure,
+                       GValue /* out */  *return_value,
+                       guint              n_param_values,
+                       const GValue      *param_values,
+                       gpointer           invocation_hint,
+                       gpointer           marshal_data)
+{
+  GObject *model = g_value_get_object (param_values + 0);
+  GtkTreePath *path = (GtkTreePath *)g_value_get_boxed (param_values + 1);
+  GtkTreeIter *iter = (GtkTreeIter *)g_value_get_boxed (param_values + 2);
+  gint n_rows = g_value_get_int (param_values + 3);
+
+  gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
+                             path, iter, n_rows);
+}
+
+static void
+rows_deleted_marshal (GClosure          *closure,
+                      GValue /* out */  *return_value,
+                      guint              n_param_values,
+                      const GValue      *param_values,
+                      gpointer           invocation_hint,
+                      gpointer           marshal_data)
+{
+  GObject *model = g_value_get_object (param_values + 0);
+  GtkTreePath *path = (GtkTreePath *)g_value_get_boxed (param_values + 1);
+  gint n_rows = g_value_get_int (param_values + 2);
+
+  gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (model, ROW_REF_DATA_STRING),
+                            path, n_rows);
+}
+
 /**
  * gtk_tree_path_new:
  *
@@ -1812,6 +1972,493 @@ gtk_tree_model_get_valist (GtkTreeModel *tree_model,
     }
 }
 
+static void
+range_data_free (gpointer data)
+{
+  RangeData *ranges = data;
+
+  if (ranges->handler_ids)
+    g_array_free (ranges->handler_ids, TRUE);
+  if (ranges->pending_path)
+    gtk_tree_path_free (ranges->pending_path);
+  g_slice_free (RangeData, ranges);
+}
+
+static RangeData *
+range_data_get (GtkTreeModel *tree_model)
+{
+  RangeData *ranges;
+
+  ranges = g_object_get_data (G_OBJECT (tree_model), RANGE_DATA_STRING);
+  if (ranges == NULL)
+    {
+      ranges = g_slice_new0 (RangeData);
+      g_object_set_data_full (G_OBJECT (tree_model), I_(RANGE_DATA_STRING),
+                              ranges, range_data_free);
+    }
+
+  return ranges;
+}
+
+/* Forgets about consumers that went away */
+static void
+range_handlers_prune (GtkTreeModel *tree_model,
+                      RangeData    *ranges)
+{
+  guint i;
+
+  if (ranges->handler_ids == NULL)
+    return;
+
+  for (i = ranges->handler_ids->len; i > 0; i--)
+    {
+      if (!g_signal_handler_is_connected (tree_model,
+                                          g_array_index (ranges->handler_ids, gulong, i - 1)))
+        g_array_remove_index_fast (ranges->handler_ids, i - 1);
+    }
+}
+
+static void
+range_handlers_block (GtkTreeModel *tree_model,
+                      RangeData    *ranges)
+{
+  guint i;
+
+  if (ranges->handler_ids == NULL)
+    return;
+
+  for (i = 0; i < ranges->handler_ids->len; i++)
+    g_signal_handler_block (tree_model, g_array_index (ranges->handler_ids, gulong, i));
+}
+
+static void
+range_handlers_unblock (GtkTreeModel *tree_model,
+                        RangeData    *ranges)
+{
+  guint i;
+
+  if (ranges->handler_ids == NULL)
+    return;
+
+  for (i = 0; i < ranges->handler_ids->len; i++)
+    g_signal_handler_unblock (tree_model, g_array_index (ranges->handler_ids, gulong, i));
+}
+
+/* Returns whether anybody needs @signal_id to be emitted for every
+ * row, that is whether there are handlers for it that don't also
+ * handle the range signals.
+ */
+static gboolean
+needs_per_row_signal (GtkTreeModel *tree_model,
+                      guint         signal_id,
+                      gsize         vfunc_offset)
+{
+  GtkTreeModelIface *iface;
+  RangeData *ranges;
+  gboolean pending;
+
+  iface = GTK_TREE_MODEL_GET_IFACE (tree_model);
+  if (G_STRUCT_MEMBER (gpointer, iface, vfunc_offset) != NULL)
+    return TRUE;
+
+  ranges = g_object_get_data (G_OBJECT (tree_model), RANGE_DATA_STRING);
+  if (ranges == NULL || ranges->handler_ids == NULL)
+    return g_signal_has_handler_pending (tree_model, signal_id, 0, FALSE);
+
+  range_handlers_prune (tree_model, ranges);
+  range_handlers_block (tree_model, ranges);
+  pending = g_signal_has_handler_pending (tree_model, signal_id, 0, FALSE);
+  range_handlers_unblock (tree_model, ranges);
+
+  return pending;
+}
+
+/**
+ * gtk_tree_model_handles_ranges:
+ * @tree_model: a #GtkTreeModel
+ * @handler_id: the id of a #GtkTreeModel::row-inserted or
+ *     #GtkTreeModel::row-deleted handler
+ *
+ * Tells @tree_model that whoever connected @handler_id also handles
+ * #GtkTreeModel::rows-inserted and #GtkTreeModel::rows-deleted, so the
+ * per-row signals don't need to be emitted for it when rows are
+ * inserted or deleted in bulk. The handler can be disconnected as
+ * usual.
+ *
+ * Views and other consumers that want the range signals should
+ * connect to both the per-row and the range signals and call this
+ * for their #GtkTreeModel::row-inserted and #GtkTreeModel::row-deleted
+ * handlers. Single rows are still announced with the per-row signals
+ * only. Handlers that aren't marked like this make
+ * gtk_tree_model_needs_row_inserted() and
+ * gtk_tree_model_needs_row_deleted() return %TRUE.
+ *
+ * Since: 3.16
+ */
+void
+gtk_tree_model_handles_ranges (GtkTreeModel *tree_model,
+                               gulong        handler_id)
+{
+  RangeData *ranges;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
+  g_return_if_fail (handler_id > 0);
+
+  ranges = range_data_get (tree_model);
+  if (ranges->handler_ids == NULL)
+    ranges->handler_ids = g_array_new (FALSE, FALSE, sizeof (gulong));
+  else
+    range_handlers_prune (tree_model, ranges);
+
+  g_array_append_val (ranges->handler_ids, handler_id);
+}
+
+/**
+ * gtk_tree_model_needs_row_inserted:
+ * @tree_model: a #GtkTreeModel
+ *
+ * Returns whether somebody connected to @tree_model still needs
+ * #GtkTreeModel::row-inserted for every row, that is whether it
+ * has handlers for that signal which were not passed to
+ * gtk_tree_model_handles_ranges().
+ *
+ * Models that insert many rows at once should check this before
+ * making the rows visible. If it returns %TRUE, they must make the
+ * rows visible one at a time and call gtk_tree_model_row_inserted()
+ * after each, so that the model never appears to have more rows than
+ * were announced. Otherwise they can add all of the rows and call
+ * gtk_tree_model_rows_inserted() once.
+ *
+ * Returns: %TRUE if rows should be announced one by one
+ *
+ * Since: 3.16
+ */
+gboolean
+gtk_tree_model_needs_row_inserted (GtkTreeModel *tree_model)
+{
+  g_return_val_if_fail (GTK_IS_TREE_MODEL (tree_model), TRUE);
+
+  return needs_per_row_signal (tree_model, tree_model_signals[ROW_INSERTED],
+                               G_STRUCT_OFFSET (GtkTreeModelIface, row_inserted));
+}
+
+/**
+ * gtk_tree_model_needs_row_deleted:
+ * @tree_model: a #GtkTreeModel
+ *
+ * Like gtk_tree_model_needs_row_inserted(), for deletions. If it
+ * returns %TRUE, models must remove the rows one at a time and call
+ * gtk_tree_model_row_deleted() after each, instead of calling
+ * gtk_tree_model_rows_deleted() once.
+ *
+ * Returns: %TRUE if rows should be removed one by one
+ *
+ * Since: 3.16
+ */
+gboolean
+gtk_tree_model_needs_row_deleted (GtkTreeModel *tree_model)
+{
+  g_return_val_if_fail (GTK_IS_TREE_MODEL (tree_model), TRUE);
+
+  return needs_per_row_signal (tree_model, tree_model_signals[ROW_DELETED],
+                               G_STRUCT_OFFSET (GtkTreeModelIface, row_deleted));
+}
+
+static void
+emit_rows_inserted (GtkTreeModel *tree_model,
+                    GtkTreePath  *path,
+                    GtkTreeIter  *iter,
+                    gint          n_rows)
+{
+  RangeData *ranges;
+  GtkTreePath *row_path;
+  GtkTreeIter row_iter;
+  gboolean replay;
+  gint i;
+
+  if (n_rows == 1)
+    {
+      g_signal_emit (tree_model, tree_model_signals[ROW_INSERTED], 0, path, iter);
+      return;
+    }
+
+  replay = gtk_tree_model_needs_row_inserted (tree_model);
+
+  g_signal_emit (tree_model, tree_model_signals[ROWS_INSERTED], 0, path, iter, n_rows);
+
+  if (!replay)
+    return;
+
+  /* Somebody doesn't know about ranges, give them one signal per row
+   * but keep the others from seeing the rows twice. All the rows are
+   * visible already, which is why models are supposed to check
+   * gtk_tree_model_needs_row_inserted() and not get here; this is
+   * only the best that can be done for those that don't.
+   */
+  ranges = range_data_get (tree_model);
+  range_handlers_block (tree_model, ranges);
+  ranges->replaying++;
+
+  row_path = gtk_tree_path_copy (path);
+  row_iter = *iter;
+  for (i = 0; i < n_rows; i++)
+    {
+      g_signal_emit (tree_model, tree_model_signals[ROW_INSERTED], 0, row_path, &row_iter);
+      gtk_tree_path_next (row_path);
+      gtk_tree_model_iter_next (tree_model, &row_iter);
+    }
+  gtk_tree_path_free (row_path);
+
+  ranges->replaying--;
+  range_handlers_unblock (tree_model, ranges);
+}
+
+static void
+emit_rows_deleted (GtkTreeModel *tree_model,
+                   GtkTreePath  *path,
+                   gint          n_rows)
+{
+  RangeData *ranges;
+  gboolean replay;
+  gint i;
+
+  if (n_rows == 1)
+    {
+      g_signal_emit (tree_model, tree_model_signals[ROW_DELETED], 0, path);
+      return;
+    }
+
+  replay = gtk_tree_model_needs_row_deleted (tree_model);
+
+  g_signal_emit (tree_model, tree_model_signals[ROWS_DELETED], 0, path, n_rows);
+
+  if (!replay)
+    return;
+
+  ranges = range_data_get (tree_model);
+  range_handlers_block (tree_model, ranges);
+  ranges->replaying++;
+
+  for (i = 0; i < n_rows; i++)
+    g_signal_emit (tree_model, tree_model_signals[ROW_DELETED], 0, path);
+
+  ranges->replaying--;
+  range_handlers_unblock (tree_model, ranges);
+}
+
+static gboolean
+path_is_sibling (GtkTreePath *a,
+                 GtkTreePath *b)
+{
+  if (a->depth != b->depth)
+    return FALSE;
+
+  return memcmp (a->indices, b->indices, (a->depth - 1) * sizeof (gint)) == 0;
+}
+
+/* Announces the rows collected during a batch. @changed and @delta
+ * describe an insertion (@delta > 0) or deletion (@delta < 0) that
+ * has already happened in the model but hasn't been announced yet;
+ * it is needed to find the pending rows in the model.
+ */
+static void
+flush_pending_rows (GtkTreeModel *tree_model,
+                    RangeData    *ranges,
+                    GtkTreePath  *changed,
+                    gint          delta)
+{
+  GtkTreePath *path;
+  gint n_rows;
+
+  if (ranges->pending_path == NULL)
+    return;
+
+  path = ranges->pending_path;
+  n_rows = ranges->pending_n_rows;
+  ranges->pending_path = NULL;
+  ranges->pending_n_rows = 0;
+
+  if (ranges->pending_deleted)
+    emit_rows_deleted (tree_model, path, n_rows);
+  else
+    {
+      GtkTreePath *current;
+      GtkTreeIter iter;
+
+      current = gtk_tree_path_copy (path);
+      if (changed && changed->depth <= current->depth &&
+          memcmp (changed->indices, current->indices,
+                  (changed->depth - 1) * sizeof (gint)) == 0)
+        {
+          gint index = changed->indices[changed->depth - 1];
+
+          if (delta > 0 && index <= current->indices[changed->depth - 1])
+            current->indices[changed->depth - 1] += delta;
+          else if (delta < 0 && index < current->indices[changed->depth - 1])
+            current->indices[changed->depth - 1] += delta;
+        }
+
+      if (gtk_tree_model_get_iter (tree_model, &iter, current))
+        emit_rows_inserted (tree_model, path, &iter, n_rows);
+
+      gtk_tree_path_free (current);
+    }
+
+  gtk_tree_path_free (path);
+}
+
+static void
+batch_rows_inserted (GtkTreeModel *tree_model,
+                     RangeData    *ranges,
+                     GtkTreePath  *path,
+                     gint          n_rows)
+{
+  if (ranges->pending_path && !ranges->pending_deleted &&
+      path_is_sibling (ranges->pending_path, path))
+    {
+      gint first = ranges->pending_path->indices[path->depth - 1];
+      gint index = path->indices[path->depth - 1];
+
+      /* Rows inserted before, between or right after the pending rows
+       * make a bigger block of new rows.
+       */
+      if (first <= index && index <= first + ranges->pending_n_rows)
+        {
+          ranges->pending_n_rows += n_rows;
+          return;
+        }
+    }
+
+  flush_pending_rows (tree_model, ranges, path, n_rows);
+
+  ranges->pending_path = gtk_tree_path_copy (path);
+  ranges->pending_n_rows = n_rows;
+  ranges->pending_deleted = FALSE;
+}
+
+static void
+batch_rows_deleted (GtkTreeModel *tree_model,
+                    RangeData    *ranges,
+                    GtkTreePath  *path,
+                    gint          n_rows)
+{
+  if (ranges->pending_path && path_is_sibling (ranges->pending_path, path))
+    {
+      gint first = ranges->pending_path->indices[path->depth - 1];
+      gint index = path->indices[path->depth - 1];
+
+      if (ranges->pending_deleted)
+        {
+          /* @path is in current coordinates, the pending rows are
+           * still in the coordinates the consumers know about.
+           */
+          if (index == first)
+            {
+              ranges->pending_n_rows += n_rows;
+              return;
+            }
+          else if (index + n_rows == first)
+            {
+              ranges->pending_path->indices[path->depth - 1] = index;
+              ranges->pending_n_rows += n_rows;
+              return;
+            }
+        }
+      else if (first <= index && index + n_rows <= first + ranges->pending_n_rows)
+        {
+          /* Nobody has heard of these rows yet */
+          ranges->pending_n_rows -= n_rows;
+          if (ranges->pending_n_rows == 0)
+            {
+              gtk_tree_path_free (ranges->pending_path);
+              ranges->pending_path = NULL;
+            }
+          return;
+        }
+    }
+  else if (ranges->pending_path && !ranges->pending_deleted &&
+           gtk_tree_path_is_ancestor (path, ranges->pending_path))
+    {
+      /* The pending rows went away together with their parent */
+      gtk_tree_path_free (ranges->pending_path);
+      ranges->pending_path = NULL;
+      ranges->pending_n_rows = 0;
+    }
+
+  flush_pending_rows (tree_model, ranges, path, -n_rows);
+
+  ranges->pending_path = gtk_tree_path_copy (path);
+  ranges->pending_n_rows = n_rows;
+  ranges->pending_deleted = TRUE;
+}
+
+static inline RangeData *
+get_batch (GtkTreeModel *tree_model)
+{
+  RangeData *ranges;
+
+  ranges = g_object_get_data (G_OBJECT (tree_model), RANGE_DATA_STRING);
+  if (ranges && ranges->batch_depth > 0)
+    return ranges;
+
+  return NULL;
+}
+
+/**
+ * _gtk_tree_model_begin_batch:
+ * @tree_model: a #GtkTreeModel
+ *
+ * Starts collecting the rows that @tree_model announces with
+ * gtk_tree_model_row_inserted() and gtk_tree_model_row_deleted(), so
+ * that neighbouring rows can be announced with a single
+ * #GtkTreeModel::rows-inserted or #GtkTreeModel::rows-deleted when
+ * _gtk_tree_model_end_batch() is called. Other signals announce the
+ * collected rows first.
+ *
+ * This is meant for models that pass on changes from another model,
+ * like #GtkTreeModelFilter. During a batch the model must not reorder
+ * rows, and consumers must not look at the model, since it may have
+ * rows they haven't heard of yet. If somebody needs every row, the
+ * signals are emitted right away as usual.
+ *
+ * Batches can be nested.
+ */
+void
+_gtk_tree_model_begin_batch (GtkTreeModel *tree_model)
+{
+  RangeData *ranges;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
+
+  ranges = range_data_get (tree_model);
+  if (ranges->batch_depth++ > 0)
+    return;
+
+  ranges->batch_merge = !gtk_tree_model_needs_row_inserted (tree_model) &&
+                        !gtk_tree_model_needs_row_deleted (tree_model);
+}
+
+/**
+ * _gtk_tree_model_end_batch:
+ * @tree_model: a #GtkTreeModel
+ *
+ * Ends a batch started with _gtk_tree_model_begin_batch() and
+ * announces the rows collected since then.
+ */
+void
+_gtk_tree_model_end_batch (GtkTreeModel *tree_model)
+{
+  RangeData *ranges;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
+
+  ranges = get_batch (tree_model);
+  g_return_if_fail (ranges != NULL);
+
+  if (--ranges->batch_depth == 0)
+    flush_pending_rows (tree_model, ranges, NULL, 0);
+}
+
 /**
  * gtk_tree_model_row_changed:
  * @tree_model: a #GtkTreeModel
@@ -1825,10 +2472,15 @@ gtk_tree_model_row_changed (GtkTreeModel *tree_model,
                             GtkTreePath  *path,
                             GtkTreeIter  *iter)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (path != NULL);
   g_return_if_fail (iter != NULL);
 
+  if ((ranges = get_batch (tree_model)))
+    flush_pending_rows (tree_model, ranges, NULL, 0);
+
   g_signal_emit (tree_model, tree_model_signals[ROW_CHANGED], 0, path, iter);
 }
 
@@ -1845,11 +2497,70 @@ gtk_tree_model_row_inserted (GtkTreeModel *tree_model,
                              GtkTreePath  *path,
                              GtkTreeIter  *iter)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (path != NULL);
   g_return_if_fail (iter != NULL);
 
-  g_signal_emit (tree_model, tree_model_signals[ROW_INSERTED], 0, path, iter);
+  if ((ranges = get_batch (tree_model)) && ranges->batch_merge)
+    batch_rows_inserted (tree_model, ranges, path, 1);
+  else
+    g_signal_emit (tree_model, tree_model_signals[ROW_INSERTED], 0, path, iter);
+}
+
+/**
+ * gtk_tree_model_rows_inserted:
+ * @tree_model: a #GtkTreeModel
+ * @path: a #GtkTreePath-struct pointing to the first inserted row
+ * @iter: a valid #GtkTreeIter-struct pointing to the first inserted row
+ * @n_rows: the number of rows that have been inserted
+ *
+ * Emits the #GtkTreeModel::rows-inserted signal on @tree_model,
+ * followed by #GtkTreeModel::row-inserted for each of the rows if
+ * there are handlers that need it. If @n_rows is 1, only
+ * #GtkTreeModel::row-inserted is emitted.
+ *
+ * This should be called by models after inserting @n_rows rows
+ * without children next to each other.
+ *
+ * Handlers of #GtkTreeModel::row-inserted expect the model to have
+ * grown by exactly one row for each emission, which can't be the
+ * case here since all @n_rows rows are in the model already. Models
+ * must therefore only use this function if
+ * gtk_tree_model_needs_row_inserted() returns %FALSE, and insert
+ * the rows one by one with gtk_tree_model_row_inserted() otherwise.
+ *
+ * Since: 3.16
+ */
+void
+gtk_tree_model_rows_inserted (GtkTreeModel *tree_model,
+                              GtkTreePath  *path,
+                              GtkTreeIter  *iter,
+                              gint          n_rows)
+{
+  RangeData *ranges;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (iter != NULL);
+  g_return_if_fail (n_rows >= 0);
+
+  if (n_rows == 0)
+    return;
+
+  if ((ranges = get_batch (tree_model)))
+    {
+      if (ranges->batch_merge)
+        {
+          batch_rows_inserted (tree_model, ranges, path, n_rows);
+          return;
+        }
+
+      flush_pending_rows (tree_model, ranges, path, n_rows);
+    }
+
+  emit_rows_inserted (tree_model, path, iter, n_rows);
 }
 
 /**
@@ -1867,10 +2578,15 @@ gtk_tree_model_row_has_child_toggled (GtkTreeModel *tree_model,
                                       GtkTreePath  *path,
                                       GtkTreeIter  *iter)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (path != NULL);
   g_return_if_fail (iter != NULL);
 
+  if ((ranges = get_batch (tree_model)))
+    flush_pending_rows (tree_model, ranges, NULL, 0);
+
   g_signal_emit (tree_model, tree_model_signals[ROW_HAS_CHILD_TOGGLED], 0, path, iter);
 }
 
@@ -1893,10 +2609,64 @@ void
 gtk_tree_model_row_deleted (GtkTreeModel *tree_model,
                             GtkTreePath  *path)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (path != NULL);
 
-  g_signal_emit (tree_model, tree_model_signals[ROW_DELETED], 0, path);
+  if ((ranges = get_batch (tree_model)) && ranges->batch_merge)
+    batch_rows_deleted (tree_model, ranges, path, 1);
+  else
+    g_signal_emit (tree_model, tree_model_signals[ROW_DELETED], 0, path);
+}
+
+/**
+ * gtk_tree_model_rows_deleted:
+ * @tree_model: a #GtkTreeModel
+ * @path: a #GtkTreePath-struct pointing to the previous location of
+ *     the first deleted row
+ * @n_rows: the number of rows that have been deleted
+ *
+ * Emits the #GtkTreeModel::rows-deleted signal on @tree_model,
+ * followed by #GtkTreeModel::row-deleted @n_rows times if there
+ * are handlers that need it. If @n_rows is 1, only
+ * #GtkTreeModel::row-deleted is emitted.
+ *
+ * This should be called by models after removing @n_rows rows
+ * that were next to each other. The location pointed to by @path
+ * should be the location that the first row previously was at.
+ *
+ * Like gtk_tree_model_rows_inserted(), this must only be used if
+ * gtk_tree_model_needs_row_deleted() returns %FALSE.
+ *
+ * Since: 3.16
+ */
+void
+gtk_tree_model_rows_deleted (GtkTreeModel *tree_model,
+                             GtkTreePath  *path,
+                             gint          n_rows)
+{
+  RangeData *ranges;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
+  g_return_if_fail (path != NULL);
+  g_return_if_fail (n_rows >= 0);
+
+  if (n_rows == 0)
+    return;
+
+  if ((ranges = get_batch (tree_model)))
+    {
+      if (ranges->batch_merge)
+        {
+          batch_rows_deleted (tree_model, ranges, path, n_rows);
+          return;
+        }
+
+      flush_pending_rows (tree_model, ranges, path, -n_rows);
+    }
+
+  emit_rows_deleted (tree_model, path, n_rows);
 }
 
 /**
@@ -1921,9 +2691,14 @@ gtk_tree_model_rows_reordered (GtkTreeModel *tree_model,
                                GtkTreeIter  *iter,
                                gint         *new_order)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (new_order != NULL);
 
+  if ((ranges = get_batch (tree_model)))
+    flush_pending_rows (tree_model, ranges, NULL, 0);
+
   g_signal_emit (tree_model, tree_model_signals[ROWS_REORDERED], 0, path, iter, new_order);
 }
 
@@ -1955,10 +2730,15 @@ gtk_tree_model_rows_reordered_with_length (GtkTreeModel *tree_model,
                                            gint         *new_order,
                                            gint          length)
 {
+  RangeData *ranges;
+
   g_return_if_fail (GTK_IS_TREE_MODEL (tree_model));
   g_return_if_fail (new_order != NULL);
   g_return_if_fail (length == gtk_tree_model_iter_n_children (tree_model, iter));
 
+  if ((ranges = get_batch (tree_model)))
+    flush_pending_rows (tree_model, ranges, NULL, 0);
+
   g_signal_emit (tree_model, tree_model_signals[ROWS_REORDERED], 0, path, iter, new_order);
 }
 
@@ -2073,7 +2853,8 @@ release_row_references (gpointer data)
 static void
 gtk_tree_row_ref_inserted (RowRefList  *refs,
                            GtkTreePath *path,
-                           GtkTreeIter *iter)
+                           GtkTreeIter *iter,
+                           gint         n_rows)
 {
   GSList *tmp_list;
 
@@ -2086,7 +2867,8 @@ gtk_tree_row_ref_inserted (RowRefList  *refs,
    * that the inserted path is in a different "coordinate system" than
    * the old path (e.g. if the inserted path was just before the old
    * path, then inserted path and old path will be the same, and old
-   * path must be moved down one).
+   * path must be moved down one). @n_rows rows have been inserted
+   * starting at @path.
    */
 
   tmp_list = refs->list;
@@ -2115,7 +2897,7 @@ gtk_tree_row_ref_inserted (RowRefList  *refs,
             goto done;
 
           if (path->indices[path->depth-1] <= reference->path->indices[path->depth-1])
-            reference->path->indices[path->depth-1] += 1;
+            reference->path->indices[path->depth-1] += n_rows;
         }
     done:
       tmp_list = g_slist_next (tmp_list);
@@ -2124,7 +2906,8 @@ gtk_tree_row_ref_inserted (RowRefList  *refs,
 
 static void
 gtk_tree_row_ref_deleted (RowRefList  *refs,
-                          GtkTreePath *path)
+                          GtkTreePath *path,
+                          gint         n_rows)
 {
   GSList *tmp_list;
 
@@ -2136,6 +2919,7 @@ gtk_tree_row_ref_deleted (RowRefList  *refs,
    * deletion with the old path of the just-deleted row. Which means
    * that the deleted path is the same now-defunct "coordinate system"
    * as the path saved in the reference, which is what we want to fix.
+   * @n_rows rows starting at @path have been deleted.
    */
 
   tmp_list = refs->list;
@@ -2157,7 +2941,8 @@ gtk_tree_row_ref_deleted (RowRefList  *refs,
             }
 
           /* We know it affects us. */
-          if (path->indices[i] == reference->path->indices[i])
+          if (path->indices[i] <= reference->path->indices[i] &&
+              reference->path->indices[i] < path->indices[i] + n_rows)
             {
               if (reference->path->depth > path->depth)
                 /* some parent was deleted, trying to unref any node
@@ -2172,7 +2957,7 @@ gtk_tree_row_ref_deleted (RowRefList  *refs,
             }
           else if (path->indices[i] < reference->path->indices[i])
             {
-              reference->path->indices[path->depth-1]-=1;
+              reference->path->indices[path->depth-1]-=n_rows;
             }
         }
 
@@ -2518,7 +3303,7 @@ gtk_tree_row_reference_inserted (GObject     *proxy,
 {
   g_return_if_fail (G_IS_OBJECT (proxy));
 
-  gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path, NULL);
+  gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path, NULL, 1);
 }
 
 /**
@@ -2536,7 +3321,29 @@ gtk_tree_row_reference_deleted (GObject     *proxy,
 {
   g_return_if_fail (G_IS_OBJECT (proxy));
 
-  gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path);
+  gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path, 1);
+}
+
+/* Like gtk_tree_row_reference_inserted(), for #GtkTreeModel::rows-inserted */
+void
+_gtk_tree_row_reference_rows_inserted (GObject     *proxy,
+                                       GtkTreePath *path,
+                                       gint         n_rows)
+{
+  g_return_if_fail (G_IS_OBJECT (proxy));
+
+  gtk_tree_row_ref_inserted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path, NULL, n_rows);
+}
+
+/* Like gtk_tree_row_reference_deleted(), for #GtkTreeModel::rows-deleted */
+void
+_gtk_tree_row_reference_rows_deleted (GObject     *proxy,
+                                      GtkTreePath *path,
+                                      gint         n_rows)
+{
+  g_return_if_fail (G_IS_OBJECT (proxy));
+
+  gtk_tree_row_ref_deleted ((RowRefList *)g_object_get_data (proxy, ROW_REF_DATA_STRING), path, n_rows);
 }
 
 /**
@@ -402,6 +402,22 @@ void gtk_tree_model_rows_reordered_with_length (GtkTreeModel *tree_model,
 						GtkTreeIter  *iter,
 						gint         *new_order,
 						gint          length);
+GDK_AVAILABLE_IN_ALL
+void gtk_tree_model_rows_inserted         (GtkTreeModel *tree_model,
+					   GtkTreePath  *path,
+					   GtkTreeIter  *iter,
+					   gint          n_rows);
+GDK_AVAILABLE_IN_ALL
+void gtk_tree_model_rows_deleted          (GtkTreeModel *tree_model,
+					   GtkTreePath  *path,
+					   gint          n_rows);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_tree_model_needs_row_inserted (GtkTreeModel *tree_model);
+GDK_AVAILABLE_IN_ALL
+gboolean gtk_tree_model_needs_row_deleted  (GtkTreeModel *tree_model);
+GDK_AVAILABLE_IN_ALL
+void     gtk_tree_model_handles_ranges     (GtkTreeModel *tree_model,
+                                            gulong        handler_id);
 
 G_END_DECLS
 
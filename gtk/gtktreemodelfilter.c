@@ -21,6 +21,7 @@
 #include "gtkintl.h"
 #include "gtktreednd.h"
 #include "gtkprivate.h"
+#include "gtktreeprivate.h"
 #include <string.h>
 
 
@@ -261,6 +262,45 @@ struct _FilterLevel
 };
 
 
+/* Data for a threaded visible function, shared with the threads */
+typedef struct
+{
+  gint ref_count;
+  gpointer data;
+  GDestroyNotify destroy;
+} ThreadedData;
+
+/* Copies of the values that the threaded visible function looks at,
+ * for all rows of the root level
+ */
+typedef struct
+{
+  gint ref_count;
+  gint n_rows;
+  gint n_columns;
+  GValue *values;
+} RefilterSnapshot;
+
+typedef struct
+{
+  GTask *task;
+  RefilterSnapshot *snapshot;
+  GtkTreeModelFilterThreadedVisibleFunc func;
+  ThreadedData *data;
+  guint child_serial;
+
+  guint8 *visible;
+  volatile gint n_pending_chunks;
+  volatile gint cancelled;
+} RefilterJob;
+
+typedef struct
+{
+  RefilterJob *job;
+  gint first_row;
+  gint n_rows;
+} RefilterChunk;
+
 struct _GtkTreeModelFilterPrivate
 {
   GtkTreeModel *child_model;
@@ -276,6 +316,16 @@ struct _GtkTreeModelFilterPrivate
   gpointer visible_data;
   GDestroyNotify visible_destroy;
 
+  GtkTreeModelFilterThreadedVisibleFunc threaded_visible_func;
+  ThreadedData *threaded_data;
+  gint *threaded_columns;
+  gint threaded_n_columns;
+
+  /* bumped whenever the child model changes */
+  guint child_serial;
+  RefilterSnapshot *snapshot;
+  RefilterJob *refilter_job;
+
   GType *modify_types;
   GtkTreeModelFilterModifyFunc modify_func;
   gpointer modify_data;
@@ -287,6 +337,7 @@ struct _GtkTreeModelFilterPrivate
 
   guint in_row_deleted       : 1;
   guint virtual_root_deleted : 1;
+  guint in_refilter          : 1;
 
   /* signal ids */
   gulong changed_id;
@@ -294,6 +345,8 @@ struct _GtkTreeModelFilterPrivate
   gulong has_child_toggled_id;
   gulong deleted_id;
   gulong reordered_id;
+  gulong rows_inserted_id;
+  gulong rows_deleted_id;
 };
 
 /* properties */
@@ -325,6 +378,12 @@ enum
 #define FILTER_LEVEL(filter_level) ((FilterLevel *)filter_level)
 #define GET_ELT(siter) ((FilterElt*) (siter ? g_sequence_get (siter) : NULL))
 
+/* Number of rows a worker thread checks in one go during
+ * gtk_tree_model_filter_refilter_async(), cancellation is
+ * noticed between chunks.
+ */
+#define REFILTER_CHUNK_SIZE 4096
+
 /* general code (object/interface init, properties, etc) */
 static void         gtk_tree_model_filter_tree_model_init                 (GtkTreeModelIface       *iface);
 static void         gtk_tree_model_filter_drag_source_init                (GtkTreeDragSourceIface  *iface);
@@ -359,6 +418,15 @@ static void         gtk_tree_model_filter_rows_reordered                  (GtkTr
                                                                            GtkTreeIter            *c_iter,
                                                                            gint                   *new_order,
                                                                            gpointer                data);
+static void         gtk_tree_model_filter_rows_inserted                   (GtkTreeModel           *c_model,
+                                                                           GtkTreePath            *c_path,
+                                                                           GtkTreeIter            *c_iter,
+                                                                           gint                    n_rows,
+                                                                           gpointer                data);
+static void         gtk_tree_model_filter_rows_deleted                    (GtkTreeModel           *c_model,
+                                                                           GtkTreePath            *c_path,
+                                                                           gint                    n_rows,
+                                                                           gpointer                data);
 
 /* GtkTreeModel interface */
 static GtkTreeModelFlags gtk_tree_model_filter_get_flags                       (GtkTreeModel           *model);
@@ -490,6 +558,10 @@ static void         gtk_tree_model_filter_emit_row_inserted_for_path      (GtkTr
                                                                            GtkTreeModel           *c_model,
                                                                            GtkTreePath            *c_path,
                                                                            GtkTreeIter            *c_iter);
+static void         gtk_tree_model_filter_child_model_changed             (GtkTreeModelFilter     *filter);
+static ThreadedData *threaded_data_new                                    (gpointer                data,
+                                                                           GDestroyNotify          destroy);
+static void         threaded_data_unref                                   (ThreadedData           *data);
 
 
 G_DEFINE_TYPE_WITH_CODE (GtkTreeModelFilter, gtk_tree_model_filter, G_TYPE_OBJECT,
@@ -603,6 +675,10 @@ gtk_tree_model_filter_finalize (GObject *object)
   if (filter->priv->visible_destroy)
     filter->priv->visible_destroy (filter->priv->visible_data);
 
+  if (filter->priv->threaded_data)
+    threaded_data_unref (filter->priv->threaded_data);
+  g_free (filter->priv->threaded_columns);
+
   /* must chain up */
   G_OBJECT_CLASS (gtk_tree_model_filter_parent_class)->finalize (object);
 }
@@ -1237,7 +1313,9 @@ gtk_tree_model_filter_increment_stamp (GtkTreeModelFilter *filter)
     }
   while (filter->priv->stamp == 0);
 
-  gtk_tree_model_filter_clear_cache (filter);
+  /* Applying a refilter clears the cache once at the end */
+  if (!filter->priv->in_refilter)
+    gtk_tree_model_filter_clear_cache (filter);
 }
 
 static gboolean
@@ -1252,6 +1330,27 @@ gtk_tree_model_filter_real_visible (GtkTreeModelFilter *filter,
 					 filter->priv->visible_data)
 	? TRUE : FALSE;
     }
+  else if (filter->priv->threaded_visible_func)
+    {
+      GValue *values;
+      gboolean visible;
+      gint i;
+
+      values = g_newa (GValue, filter->priv->threaded_n_columns);
+      memset (values, 0, sizeof (GValue) * filter->priv->threaded_n_columns);
+
+      for (i = 0; i < filter->priv->threaded_n_columns; i++)
+        gtk_tree_model_get_value (child_model, child_iter,
+                                  filter->priv->threaded_columns[i], &values[i]);
+
+      visible = filter->priv->threaded_visible_func (values,
+                                                     filter->priv->threaded_data->data);
+
+      for (i = 0; i < filter->priv->threaded_n_columns; i++)
+        g_value_unset (&values[i]);
+
+      return visible ? TRUE : FALSE;
+    }
   else if (filter->priv->visible_column >= 0)
    {
      GValue val = G_VALUE_INIT;
@@ -2004,6 +2103,8 @@ gtk_tree_model_filter_row_changed (GtkTreeModel *c_model,
 
   g_return_if_fail (c_path != NULL || c_iter != NULL);
 
+  gtk_tree_model_filter_child_model_changed (filter);
+
   if (!c_path)
     {
       c_path = gtk_tree_model_get_path (c_model, c_iter);
@@ -2134,6 +2235,8 @@ gtk_tree_model_filter_row_inserted (GtkTreeModel *c_model,
 
   g_return_if_fail (c_path != NULL || c_iter != NULL);
 
+  gtk_tree_model_filter_child_model_changed (filter);
+
   if (!c_path)
     {
       c_path = gtk_tree_model_get_path (c_model, c_iter);
@@ -2545,6 +2648,8 @@ gtk_tree_model_filter_row_deleted (GtkTreeModel *c_model,
 
   g_return_if_fail (c_path != NULL);
 
+  gtk_tree_model_filter_child_model_changed (filter);
+
   /* special case the deletion of an ancestor of the virtual root */
   if (filter->priv->virtual_root &&
       (gtk_tree_path_is_ancestor (c_path, filter->priv->virtual_root) ||
@@ -2706,6 +2811,68 @@ gtk_tree_model_filter_row_deleted (GtkTreeModel *c_model,
   gtk_tree_path_free (path);
 }
 
+static void
+gtk_tree_model_filter_rows_inserted (GtkTreeModel *c_model,
+                                     GtkTreePath  *c_path,
+                                     GtkTreeIter  *c_iter,
+                                     gint          n_rows,
+                                     gpointer      data)
+{
+  GtkTreeModelFilter *filter = GTK_TREE_MODEL_FILTER (data);
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gint i;
+
+  g_return_if_fail (c_path != NULL && c_iter != NULL);
+
+  /* The visible rows of a block of new child rows are next to each
+   * other in the filter too, so handle the rows one by one but let
+   * our consumers hear about them as one block.
+   */
+  _gtk_tree_model_begin_batch (GTK_TREE_MODEL (filter));
+
+  path = gtk_tree_path_copy (c_path);
+  iter = *c_iter;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      gboolean had_root = filter->priv->root != NULL;
+
+      gtk_tree_model_filter_row_inserted (c_model, path, &iter, filter);
+
+      /* Building the root level pulled in the remaining rows too */
+      if (!had_root && filter->priv->root)
+        break;
+
+      gtk_tree_path_next (path);
+      gtk_tree_model_iter_next (c_model, &iter);
+    }
+
+  gtk_tree_path_free (path);
+
+  _gtk_tree_model_end_batch (GTK_TREE_MODEL (filter));
+}
+
+static void
+gtk_tree_model_filter_rows_deleted (GtkTreeModel *c_model,
+                                    GtkTreePath  *c_path,
+                                    gint          n_rows,
+                                    gpointer      data)
+{
+  GtkTreeModelFilter *filter = GTK_TREE_MODEL_FILTER (data);
+  gint i;
+
+  g_return_if_fail (c_path != NULL);
+
+  _gtk_tree_model_begin_batch (GTK_TREE_MODEL (filter));
+
+  /* Each row that goes away moves the next one to @c_path */
+  for (i = 0; i < n_rows; i++)
+    gtk_tree_model_filter_row_deleted (c_model, c_path, filter);
+
+  _gtk_tree_model_end_batch (GTK_TREE_MODEL (filter));
+}
+
 static void
 gtk_tree_model_filter_rows_reordered (GtkTreeModel *c_model,
                                       GtkTreePath  *c_path,
@@ -2729,6 +2896,8 @@ gtk_tree_model_filter_rows_reordered (GtkTreeModel *c_model,
 
   g_return_if_fail (new_order != NULL);
 
+  gtk_tree_model_filter_child_model_changed (filter);
+
   if (c_path == NULL || gtk_tree_path_get_depth (c_path) == 0)
     {
       length = gtk_tree_model_iter_n_children (c_model, NULL);
@@ -3651,6 +3820,10 @@ gtk_tree_model_filter_set_model (GtkTreeModelFilter *filter,
                                    filter->priv->deleted_id);
       g_signal_handler_disconnect (filter->priv->child_model,
                                    filter->priv->reordered_id);
+      g_signal_handler_disconnect (filter->priv->child_model,
+                                   filter->priv->rows_inserted_id);
+      g_signal_handler_disconnect (filter->priv->child_model,
+                                   filter->priv->rows_deleted_id);
 
       /* reset our state */
       if (filter->priv->root)
@@ -3658,6 +3831,7 @@ gtk_tree_model_filter_set_model (GtkTreeModelFilter *filter,
                                           TRUE, TRUE, FALSE);
 
       filter->priv->root = NULL;
+      gtk_tree_model_filter_child_model_changed (filter);
       g_object_unref (filter->priv->child_model);
       filter->priv->visible_column = -1;
 
@@ -3689,6 +3863,16 @@ gtk_tree_model_filter_set_model (GtkTreeModelFilter *filter,
         g_signal_connect (child_model, "rows-reordered",
                           G_CALLBACK (gtk_tree_model_filter_rows_reordered),
                           filter);
+      filter->priv->rows_inserted_id =
+        g_signal_connect (child_model, "rows-inserted",
+                          G_CALLBACK (gtk_tree_model_filter_rows_inserted),
+                          filter);
+      filter->priv->rows_deleted_id =
+        g_signal_connect (child_model, "rows-deleted",
+                          G_CALLBACK (gtk_tree_model_filter_rows_deleted),
+                          filter);
+      gtk_tree_model_handles_ranges (child_model, filter->priv->inserted_id);
+      gtk_tree_model_handles_ranges (child_model, filter->priv->deleted_id);
 
       filter->priv->child_flags = gtk_tree_model_get_flags (child_model);
       filter->priv->stamp = g_random_int ();
@@ -3841,7 +4025,8 @@ gtk_tree_model_filter_get_model (GtkTreeModelFilter *filter)
  * }
  * ]|
  *
- * Note that gtk_tree_model_filter_set_visible_func() or
+ * Note that gtk_tree_model_filter_set_visible_func(),
+ * gtk_tree_model_filter_set_threaded_visible_func() or
  * gtk_tree_model_filter_set_visible_column() can only be called
  * once for a given filter model.
  *
@@ -3908,6 +4093,53 @@ gtk_tree_model_filter_set_modify_func (GtkTreeModelFilter           *filter,
   filter->priv->modify_func_set = TRUE;
 }
 
+/**
+ * gtk_tree_model_filter_set_threaded_visible_func:
+ * @filter: A #GtkTreeModelFilter
+ * @n_columns: The number of columns that @func looks at
+ * @columns: (array length=n_columns): The columns of the child model
+ *   that @func looks at
+ * @func: A #GtkTreeModelFilterThreadedVisibleFunc, the visible function
+ * @data: (allow-none): User data to pass to the visible function, or %NULL
+ * @destroy: (allow-none): Destroy notifier of @data, or %NULL
+ *
+ * Sets the visible function used when filtering the @filter to be @func.
+ * Instead of the row, @func is given the values of @columns for the row.
+ *
+ * Since @func only sees copies of these values, it can be called from
+ * other threads, and gtk_tree_model_filter_refilter_async() will use
+ * all processors to refilter a long list. @func must not change the
+ * values or look at anything else that might change while it runs.
+ *
+ * Note that gtk_tree_model_filter_set_visible_func(),
+ * gtk_tree_model_filter_set_threaded_visible_func() or
+ * gtk_tree_model_filter_set_visible_column() can only be called
+ * once for a given filter model.
+ *
+ * Since: 3.16
+ */
+void
+gtk_tree_model_filter_set_threaded_visible_func (GtkTreeModelFilter                    *filter,
+                                                 gint                                   n_columns,
+                                                 gint                                  *columns,
+                                                 GtkTreeModelFilterThreadedVisibleFunc  func,
+                                                 gpointer                               data,
+                                                 GDestroyNotify                         destroy)
+{
+  g_return_if_fail (GTK_IS_TREE_MODEL_FILTER (filter));
+  g_return_if_fail (n_columns > 0);
+  g_return_if_fail (columns != NULL);
+  g_return_if_fail (func != NULL);
+  g_return_if_fail (filter->priv->visible_method_set == FALSE);
+
+  filter->priv->threaded_n_columns = n_columns;
+  filter->priv->threaded_columns = g_memdup (columns, sizeof (gint) * n_columns);
+  filter->priv->threaded_visible_func = func;
+  filter->priv->threaded_data = threaded_data_new (data, destroy);
+
+  filter->priv->visible_method_set = TRUE;
+}
+
 /**
  * gtk_tree_model_filter_set_visible_column:
  * @filter: A #GtkTreeModelFilter
@@ -3918,7 +4150,8 @@ gtk_tree_model_filter_set_modify_func (GtkTreeModelFilter           *filter,
  * %G_TYPE_BOOLEAN, where %TRUE means that a row is visible, and %FALSE
  * if not.
  *
- * Note that gtk_tree_model_filter_set_visible_func() or
+ * Note that gtk_tree_model_filter_set_visible_func(),
+ * gtk_tree_model_filter_set_threaded_visible_func() or
  * gtk_tree_model_filter_set_visible_column() can only be called
  * once for a given filter model.
  *
@@ -4240,6 +4473,320 @@ gtk_tree_model_filter_convert_path_to_child_path (GtkTreeModelFilter *filter,
   return retval;
 }
 
+static ThreadedData *
+threaded_data_new (gpointer       data,
+                   GDestroyNotify destroy)
+{
+  ThreadedData *threaded_data;
+
+  threaded_data = g_slice_new (ThreadedData);
+  threaded_data->ref_count = 1;
+  threaded_data->data = data;
+  threaded_data->destroy = destroy;
+
+  return threaded_data;
+}
+
+static ThreadedData *
+threaded_data_ref (ThreadedData *data)
+{
+  data->ref_count++;
+
+  return data;
+}
+
+/* Only called from the main thread, running refilters keep
+ * a reference until they are back.
+ */
+static void
+threaded_data_unref (ThreadedData *data)
+{
+  if (--data->ref_count > 0)
+    return;
+
+  if (data->destroy)
+    data->destroy (data->data);
+  g_slice_free (ThreadedData, data);
+}
+
+static RefilterSnapshot *
+refilter_snapshot_new (GtkTreeModelFilter *filter)
+{
+  GtkTreeModel *child_model = filter->priv->child_model;
+  RefilterSnapshot *snapshot;
+  GtkTreeIter parent, iter;
+  GValue *values;
+  gboolean valid;
+  gint i;
+
+  snapshot = g_slice_new (RefilterSnapshot);
+  snapshot->ref_count = 1;
+  snapshot->n_columns = filter->priv->threaded_n_columns;
+
+  if (filter->priv->virtual_root)
+    {
+      gtk_tree_model_get_iter (child_model, &parent, filter->priv->virtual_root);
+      snapshot->n_rows = gtk_tree_model_iter_n_children (child_model, &parent);
+      valid = gtk_tree_model_iter_children (child_model, &iter, &parent);
+    }
+  else
+    {
+      snapshot->n_rows = gtk_tree_model_iter_n_children (child_model, NULL);
+      valid = gtk_tree_model_get_iter_first (child_model, &iter);
+    }
+
+  snapshot->values = g_new0 (GValue, (gsize) snapshot->n_rows * snapshot->n_columns);
+
+  for (values = snapshot->values; valid; values += snapshot->n_columns)
+    {
+      for (i = 0; i < snapshot->n_columns; i++)
+        gtk_tree_model_get_value (child_model, &iter,
+                                  filter->priv->threaded_columns[i],
+                                  &values[i]);
+
+      valid = gtk_tree_model_iter_next (child_model, &iter);
+    }
+
+  return snapshot;
+}
+
+static RefilterSnapshot *
+refilter_snapshot_ref (RefilterSnapshot *snapshot)
+{
+  snapshot->ref_count++;
+
+  return snapshot;
+}
+
+static void
+refilter_snapshot_unref (RefilterSnapshot *snapshot)
+{
+  gsize i;
+
+  if (--snapshot->ref_count > 0)
+    return;
+
+  for (i = 0; i < (gsize) snapshot->n_rows * snapshot->n_columns; i++)
+    {
+      if (G_IS_VALUE (&snapshot->values[i]))
+        g_value_unset (&snapshot->values[i]);
+    }
+
+  g_free (snapshot->values);
+  g_slice_free (RefilterSnapshot, snapshot);
+}
+
+/* The values in a snapshot can't be trusted anymore once the
+ * child model changed, and a running refilter has to start over.
+ */
+static void
+gtk_tree_model_filter_child_model_changed (GtkTreeModelFilter *filter)
+{
+  filter->priv->child_serial++;
+
+  if (filter->priv->snapshot)
+    {
+      refilter_snapshot_unref (filter->priv->snapshot);
+      filter->priv->snapshot = NULL;
+    }
+}
+
+static void
+refilter_job_free (RefilterJob *job)
+{
+  refilter_snapshot_unref (job->snapshot);
+  threaded_data_unref (job->data);
+  g_free (job->visible);
+  g_object_unref (job->task);
+  g_slice_free (RefilterJob, job);
+}
+
+static void
+gtk_tree_model_filter_cancel_refilter (GtkTreeModelFilter *filter)
+{
+  if (filter->priv->refilter_job == NULL)
+    return;
+
+  /* The job is freed when it comes back */
+  g_atomic_int_set (&filter->priv->refilter_job->cancelled, TRUE);
+  filter->priv->refilter_job = NULL;
+}
+
+/* Refiltering from precomputed visibilities is limited to the root
+ * level, which is where long lists live. Child levels that have been
+ * built would need to be refiltered as well.
+ */
+static gboolean
+gtk_tree_model_filter_root_is_flat (GtkTreeModelFilter *filter)
+{
+  FilterLevel *level = FILTER_LEVEL (filter->priv->root);
+  GSequenceIter *siter;
+
+  if (GTK_TREE_MODEL_FILTER_GET_CLASS (filter)->visible != gtk_tree_model_filter_real_visible)
+    return FALSE;
+
+  for (siter = g_sequence_get_begin_iter (level->seq);
+       !g_sequence_iter_is_end (siter);
+       siter = g_sequence_iter_next (siter))
+    {
+      if (GET_ELT (siter)->children)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+gtk_tree_model_filter_can_refilter_async (GtkTreeModelFilter *filter)
+{
+  return filter->priv->threaded_visible_func != NULL &&
+         gtk_tree_model_filter_root_is_flat (filter);
+}
+
+/* Makes the root level match @visible, touching only the rows
+ * whose visibility changed. The changes are batched, so that
+ * neighbouring rows are announced together.
+ */
+static void
+gtk_tree_model_filter_apply_refilter (GtkTreeModelFilter *filter,
+                                      const guint8       *visible,
+                                      gint                n_rows)
+{
+  GtkTreeModel *child_model = filter->priv->child_model;
+  FilterLevel *level = FILTER_LEVEL (filter->priv->root);
+  GSequenceIter *siter;
+  GtkTreePath *c_path;
+  GtkTreeIter c_iter;
+  guint8 *was_visible;
+  gboolean valid;
+  gint i;
+
+  was_visible = g_new0 (guint8, n_rows);
+  for (siter = g_sequence_get_begin_iter (level->visible_seq);
+       !g_sequence_iter_is_end (siter);
+       siter = g_sequence_iter_next (siter))
+    was_visible[GET_ELT (siter)->offset] = TRUE;
+
+  if (filter->priv->virtual_root)
+    {
+      GtkTreeIter parent;
+
+      gtk_tree_model_get_iter (child_model, &parent, filter->priv->virtual_root);
+      valid = gtk_tree_model_iter_children (child_model, &c_iter, &parent);
+      c_path = gtk_tree_path_copy (filter->priv->virtual_root);
+    }
+  else
+    {
+      valid = gtk_tree_model_get_iter_first (child_model, &c_iter);
+      c_path = gtk_tree_path_new ();
+    }
+  gtk_tree_path_append_index (c_path, 0);
+
+  filter->priv->in_refilter = TRUE;
+  _gtk_tree_model_begin_batch (GTK_TREE_MODEL (filter));
+
+  for (i = 0; valid && i < n_rows; i++)
+    {
+      if (visible[i] != was_visible[i])
+        {
+          if (was_visible[i])
+            gtk_tree_model_filter_remove_elt_from_level (filter, level,
+                                                         lookup_elt_with_offset (level->seq, i, NULL));
+          else
+            gtk_tree_model_filter_emit_row_inserted_for_path (filter, child_model,
+                                                              c_path, &c_iter);
+        }
+
+      gtk_tree_path_next (c_path);
+      valid = gtk_tree_model_iter_next (child_model, &c_iter);
+    }
+
+  _gtk_tree_model_end_batch (GTK_TREE_MODEL (filter));
+  filter->priv->in_refilter = FALSE;
+
+  gtk_tree_model_filter_clear_cache (filter);
+
+  gtk_tree_path_free (c_path);
+  g_free (was_visible);
+}
+
+static gboolean
+refilter_job_done (gpointer data)
+{
+  RefilterJob *job = data;
+  GtkTreeModelFilter *filter = g_task_get_source_object (job->task);
+
+  if (filter->priv->refilter_job == job)
+    filter->priv->refilter_job = NULL;
+
+  if (g_atomic_int_get (&job->cancelled))
+    g_task_return_new_error (job->task, G_IO_ERROR, G_IO_ERROR_CANCELLED,
+                             _("Refiltering was cancelled by another refilter"));
+  else if (!g_task_return_error_if_cancelled (job->task))
+    {
+      /* If the child model changed in the meantime, the results
+       * are about rows that aren't there anymore.
+       */
+      if (job->child_serial == filter->priv->child_serial &&
+          filter->priv->root != NULL &&
+          gtk_tree_model_filter_can_refilter_async (filter))
+        gtk_tree_model_filter_apply_refilter (filter, job->visible,
+                                              job->snapshot->n_rows);
+      else
+        gtk_tree_model_filter_refilter (filter);
+
+      g_task_return_boolean (job->task, TRUE);
+    }
+
+  refilter_job_free (job);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+refilter_chunk_thread_func (gpointer data,
+                            gpointer user_data)
+{
+  RefilterChunk *chunk = data;
+  RefilterJob *job = chunk->job;
+
+  if (!g_atomic_int_get (&job->cancelled) &&
+      !g_cancellable_is_cancelled (g_task_get_cancellable (job->task)))
+    {
+      RefilterSnapshot *snapshot = job->snapshot;
+      gint i;
+
+      for (i = chunk->first_row; i < chunk->first_row + chunk->n_rows; i++)
+        job->visible[i] = job->func (snapshot->values + (gsize) i * snapshot->n_columns,
+                                     job->data->data) ? TRUE : FALSE;
+    }
+
+  /* The last chunk hands the job back to the main thread */
+  if (g_atomic_int_dec_and_test (&job->n_pending_chunks))
+    gdk_threads_add_idle (refilter_job_done, job);
+
+  g_slice_free (RefilterChunk, chunk);
+}
+
+static GThreadPool *
+get_refilter_thread_pool (void)
+{
+  static GThreadPool *pool = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized))
+    {
+      /* The main thread is only waiting for the result, so
+       * all cores can be used */
+      pool = g_thread_pool_new (refilter_chunk_thread_func, NULL,
+                                g_get_num_processors (), FALSE, NULL);
+
+      g_once_init_leave (&initialized, 1);
+    }
+
+  return pool;
+}
+
 static gboolean
 gtk_tree_model_filter_refilter_helper (GtkTreeModel *model,
                                        GtkTreePath  *path,
@@ -4266,12 +4813,187 @@ gtk_tree_model_filter_refilter (GtkTreeModelFilter *filter)
 {
   g_return_if_fail (GTK_IS_TREE_MODEL_FILTER (filter));
 
+  gtk_tree_model_filter_cancel_refilter (filter);
+
   /* S L O W */
   gtk_tree_model_foreach (filter->priv->child_model,
                           gtk_tree_model_filter_refilter_helper,
                           filter);
 }
 
+/**
+ * gtk_tree_model_filter_refilter_async:
+ * @filter: A #GtkTreeModelFilter.
+ * @data: (allow-none): New user data for the threaded visible function,
+ *   or %NULL to keep the current data
+ * @destroy: (allow-none): Destroy notifier of @data, or %NULL
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore
+ * @callback: (scope async): a #GAsyncReadyCallback to call when the
+ *   rows have been refiltered
+ * @user_data: (closure): the data to pass to the callback function
+ *
+ * Re-evaluates whether the rows of @filter are visible, like
+ * gtk_tree_model_filter_refilter(), without blocking the main loop.
+ *
+ * If a visible function was set with
+ * gtk_tree_model_filter_set_threaded_visible_func(), it is run on
+ * copies of the rows’ values in worker threads, and the rows whose
+ * visibility changed are inserted and removed when all rows have been
+ * evaluated. Unlike gtk_tree_model_filter_refilter(), this doesn’t emit
+ * #GtkTreeModel::row-changed for rows that stay visible. The copies are
+ * kept until the child model changes, so they only need to be made
+ * once for a series of refilters. Only the toplevel rows are handled
+ * like this, if child rows are shown, or another kind of visible
+ * function is used, @filter is refiltered right away.
+ *
+ * @data replaces the user data of the visible function; this is how a
+ * new search string should be passed, as the previous refilter might
+ * still be looking at the old one.
+ *
+ * Starting another refilter cancels this one, and @callback will get a
+ * %G_IO_ERROR_CANCELLED error, just like when @cancellable is cancelled.
+ *
+ * Since: 3.16
+ */
+void
+gtk_tree_model_filter_refilter_async (GtkTreeModelFilter  *filter,
+                                      gpointer             data,
+                                      GDestroyNotify       destroy,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  GThreadPool *pool;
+  RefilterJob *job;
+  GTask *task;
+  gint n_rows, first_row;
+
+  g_return_if_fail (GTK_IS_TREE_MODEL_FILTER (filter));
+  g_return_if_fail (data == NULL || filter->priv->threaded_visible_func != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (filter, cancellable, callback, user_data);
+  g_task_set_source_tag (task, gtk_tree_model_filter_refilter_async);
+
+  gtk_tree_model_filter_cancel_refilter (filter);
+
+  if (data)
+    {
+      threaded_data_unref (filter->priv->threaded_data);
+      filter->priv->threaded_data = threaded_data_new (data, destroy);
+    }
+
+  /* Nobody has seen any rows yet, they are filtered when they are */
+  if (filter->priv->root == NULL)
+    {
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  if (!gtk_tree_model_filter_can_refilter_async (filter))
+    {
+      gtk_tree_model_filter_refilter (filter);
+      g_task_return_boolean (task, TRUE);
+      g_object_unref (task);
+      return;
+    }
+
+  if (filter->priv->snapshot == NULL)
+    filter->priv->snapshot = refilter_snapshot_new (filter);
+
+  n_rows = filter->priv->snapshot->n_rows;
+
+  job = g_slice_new0 (RefilterJob);
+  job->task = task;
+  job->snapshot = refilter_snapshot_ref (filter->priv->snapshot);
+  job->func = filter->priv->threaded_visible_func;
+  job->data = threaded_data_ref (filter->priv->threaded_data);
+  job->child_serial = filter->priv->child_serial;
+  job->visible = g_new0 (guint8, n_rows);
+
+  filter->priv->refilter_job = job;
+
+  if (n_rows == 0)
+    {
+      gdk_threads_add_idle (refilter_job_done, job);
+      return;
+    }
+
+  job->n_pending_chunks = (n_rows + REFILTER_CHUNK_SIZE - 1) / REFILTER_CHUNK_SIZE;
+
+  pool = get_refilter_thread_pool ();
+  for (first_row = 0; first_row < n_rows; first_row += REFILTER_CHUNK_SIZE)
+    {
+      RefilterChunk *chunk;
+
+      chunk = g_slice_new (RefilterChunk);
+      chunk->job = job;
+      chunk->first_row = first_row;
+      chunk->n_rows = MIN (REFILTER_CHUNK_SIZE, n_rows - first_row);
+
+      g_thread_pool_push (pool, chunk, NULL);
+    }
+}
+
+/**
+ * _gtk_tree_model_filter_refilter_rows:
+ * @filter: A #GtkTreeModelFilter.
+ * @visible: whether each toplevel row of the child model is visible
+ * @n_rows: the number of toplevel rows in the child model
+ *
+ * Refilters @filter with visibilities that the owner of the visible
+ * function has computed in a smarter way than asking for every row,
+ * like #GtkEntryCompletion does. Only the rows whose visibility
+ * changed are touched. The visible function must agree with @visible.
+ *
+ * Returns: %FALSE if @filter can't be refiltered like this, because
+ *   it has a virtual root or child rows are shown. A normal refilter
+ *   is needed then.
+ */
+gboolean
+_gtk_tree_model_filter_refilter_rows (GtkTreeModelFilter *filter,
+                                      const guint8       *visible,
+                                      gint                n_rows)
+{
+  g_return_val_if_fail (GTK_IS_TREE_MODEL_FILTER (filter), FALSE);
+
+  if (filter->priv->root == NULL ||
+      filter->priv->virtual_root != NULL ||
+      !gtk_tree_model_filter_root_is_flat (filter) ||
+      gtk_tree_model_iter_n_children (filter->priv->child_model, NULL) != n_rows)
+    return FALSE;
+
+  gtk_tree_model_filter_cancel_refilter (filter);
+  gtk_tree_model_filter_apply_refilter (filter, visible, n_rows);
+
+  return TRUE;
+}
+
+/**
+ * gtk_tree_model_filter_refilter_finish:
+ * @filter: A #GtkTreeModelFilter.
+ * @result: a #GAsyncResult
+ * @error: (allow-none): return location for a #GError, or %NULL
+ *
+ * Finishes a refilter started with gtk_tree_model_filter_refilter_async().
+ *
+ * Returns: %TRUE if the rows were refiltered, %FALSE if the
+ *   refilter was cancelled
+ *
+ * Since: 3.16
+ */
+gboolean
+gtk_tree_model_filter_refilter_finish (GtkTreeModelFilter  *filter,
+                                       GAsyncResult        *result,
+                                       GError             **error)
+{
+  g_return_val_if_fail (GTK_IS_TREE_MODEL_FILTER (filter), FALSE);
+  g_return_val_if_fail (g_task_is_valid (result, filter), FALSE);
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
 /**
  * gtk_tree_model_filter_clear_cache:
  * @filter: A #GtkTreeModelFilter.
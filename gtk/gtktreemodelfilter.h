@@ -72,6 +72,26 @@ typedef void (* GtkTreeModelFilterModifyFunc) (GtkTreeModel *model,
                                                gint          column,
                                                gpointer      data);
 
+/**
+ * GtkTreeModelFilterThreadedVisibleFunc:
+ * @values: (array): the values of the columns given to
+ *   gtk_tree_model_filter_set_threaded_visible_func(), for the row
+ *   whose visibility is determined
+ * @data: (closure): user data given to
+ *   gtk_tree_model_filter_set_threaded_visible_func() or
+ *   gtk_tree_model_filter_refilter_async()
+ *
+ * A function which decides whether a row is visible, only looking at
+ * some of its values. Unlike #GtkTreeModelFilterVisibleFunc, it may
+ * be called from other threads than the main thread.
+ *
+ * Returns: Whether the row is visible.
+ *
+ * Since: 3.16
+ */
+typedef gboolean (* GtkTreeModelFilterThreadedVisibleFunc) (const GValue *values,
+                                                            gpointer      data);
+
 typedef struct _GtkTreeModelFilter          GtkTreeModelFilter;
 typedef struct _GtkTreeModelFilterClass     GtkTreeModelFilterClass;
 typedef struct _GtkTreeModelFilterPrivate   GtkTreeModelFilterPrivate;
@@ -123,6 +143,13 @@ void          gtk_tree_model_filter_set_modify_func            (GtkTreeModelFilt
                                                                 gpointer                      data,
                                                                 GDestroyNotify                destroy);
 GDK_AVAILABLE_IN_ALL
+void          gtk_tree_model_filter_set_threaded_visible_func  (GtkTreeModelFilter           *filter,
+                                                                gint                          n_columns,
+                                                                gint                         *columns,
+                                                                GtkTreeModelFilterThreadedVisibleFunc func,
+                                                                gpointer                      data,
+                                                                GDestroyNotify                destroy);
+GDK_AVAILABLE_IN_ALL
 void          gtk_tree_model_filter_set_visible_column         (GtkTreeModelFilter           *filter,
                                                                 gint                          column);
 
@@ -149,6 +176,17 @@ GtkTreePath  *gtk_tree_model_filter_convert_path_to_child_path (GtkTreeModelFilt
 GDK_AVAILABLE_IN_ALL
 void          gtk_tree_model_filter_refilter                   (GtkTreeModelFilter           *filter);
 GDK_AVAILABLE_IN_ALL
+void          gtk_tree_model_filter_refilter_async             (GtkTreeModelFilter           *filter,
+                                                                gpointer                      data,
+                                                                GDestroyNotify                destroy,
+                                                                GCancellable                 *cancellable,
+                                                                GAsyncReadyCallback           callback,
+                                                                gpointer                      user_data);
+GDK_AVAILABLE_IN_ALL
+gboolean      gtk_tree_model_filter_refilter_finish            (GtkTreeModelFilter           *filter,
+                                                                GAsyncResult                 *result,
+                                                                GError                      **error);
+GDK_AVAILABLE_IN_ALL
 void          gtk_tree_model_filter_clear_cache                (GtkTreeModelFilter           *filter);
 
 G_END_DECLS
@@ -26,6 +26,7 @@
 #include "gtkintl.h"
 #include "gtkprivate.h"
 #include "gtktreednd.h"
+#include "gtktreeprivate.h"
 
 
 /**
@@ -279,6 +280,8 @@ struct _GtkTreeModelSortPrivate
   gulong has_child_toggled_id;
   gulong deleted_id;
   gulong reordered_id;
+  gulong rows_inserted_id;
+  gulong rows_deleted_id;
 };
 
 /* Set this to 0 to disable caching of child iterators.  This
@@ -339,6 +342,15 @@ static void gtk_tree_model_sort_rows_reordered        (GtkTreeModel          *s_
 						       GtkTreeIter           *s_iter,
 						       gint                  *new_order,
 						       gpointer               data);
+static void gtk_tree_model_sort_rows_inserted         (GtkTreeModel          *s_model,
+						       GtkTreePath           *s_path,
+						       GtkTreeIter           *s_iter,
+						       gint                   n_rows,
+						       gpointer               data);
+static void gtk_tree_model_sort_rows_deleted          (GtkTreeModel          *s_model,
+						       GtkTreePath           *s_path,
+						       gint                   n_rows,
+						       gpointer               data);
 
 /* TreeModel interface */
 static GtkTreeModelFlags gtk_tree_model_sort_get_flags     (GtkTreeModel          *tree_model);
@@ -1085,6 +1097,117 @@ gtk_tree_model_sort_row_deleted (GtkTreeModel *s_model,
   gtk_tree_path_free (path);
 }
 
+/* Takes the @n_rows rows starting at child offset @offset out
+ * of @level again.
+ */
+static void
+gtk_tree_model_sort_level_drop_rows (SortLevel *level,
+                                     gint       offset,
+                                     gint       n_rows)
+{
+  GSequenceIter *siter, *next;
+  SortElt *elt;
+
+  siter = g_sequence_get_begin_iter (level->seq);
+  while (!g_sequence_iter_is_end (siter))
+    {
+      elt = g_sequence_get (siter);
+      next = g_sequence_iter_next (siter);
+
+      if (elt->offset >= offset + n_rows)
+        elt->offset -= n_rows;
+      else if (elt->offset >= offset)
+        g_sequence_remove (siter);
+
+      siter = next;
+    }
+}
+
+static void
+gtk_tree_model_sort_rows_inserted (GtkTreeModel *s_model,
+				   GtkTreePath  *s_path,
+				   GtkTreeIter  *s_iter,
+				   gint          n_rows,
+				   gpointer      data)
+{
+  GtkTreeModelSort *tree_model_sort = GTK_TREE_MODEL_SORT (data);
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  gint i;
+
+  g_return_if_fail (s_path != NULL && s_iter != NULL);
+
+  if (!tree_model_sort->priv->root && gtk_tree_path_get_depth (s_path) == 1)
+    {
+      /* Nobody has seen the root level yet, so build it with all the
+       * new rows in it and announce it as a whole.
+       */
+      gtk_tree_model_sort_build_level (tree_model_sort, NULL, NULL);
+      if (!tree_model_sort->priv->root)
+        return;
+
+      /* Handlers of ::row-inserted must see the level grow one row
+       * per signal, so the new rows are taken out again and go the
+       * row by row way below.
+       */
+      if (gtk_tree_model_needs_row_inserted (GTK_TREE_MODEL (tree_model_sort)))
+        gtk_tree_model_sort_level_drop_rows (SORT_LEVEL (tree_model_sort->priv->root),
+                                             gtk_tree_path_get_indices (s_path)[0],
+                                             n_rows);
+      else
+        {
+          gtk_tree_model_sort_increment_stamp (tree_model_sort);
+
+          path = gtk_tree_path_new_first ();
+          gtk_tree_model_get_iter (GTK_TREE_MODEL (tree_model_sort), &iter, path);
+          gtk_tree_model_rows_inserted (GTK_TREE_MODEL (tree_model_sort), path, &iter,
+                                        g_sequence_get_length (SORT_LEVEL (tree_model_sort->priv->root)->seq));
+          gtk_tree_path_free (path);
+          return;
+        }
+    }
+
+  /* While unsorted the new rows stay next to each other, and when
+   * sorted the ones that end up next to each other are announced
+   * together.
+   */
+  _gtk_tree_model_begin_batch (GTK_TREE_MODEL (tree_model_sort));
+
+  path = gtk_tree_path_copy (s_path);
+  iter = *s_iter;
+
+  for (i = 0; i < n_rows; i++)
+    {
+      gtk_tree_model_sort_row_inserted (s_model, path, &iter, tree_model_sort);
+
+      gtk_tree_path_next (path);
+      gtk_tree_model_iter_next (s_model, &iter);
+    }
+
+  gtk_tree_path_free (path);
+
+  _gtk_tree_model_end_batch (GTK_TREE_MODEL (tree_model_sort));
+}
+
+static void
+gtk_tree_model_sort_rows_deleted (GtkTreeModel *s_model,
+				  GtkTreePath  *s_path,
+				  gint          n_rows,
+				  gpointer      data)
+{
+  GtkTreeModelSort *tree_model_sort = GTK_TREE_MODEL_SORT (data);
+  gint i;
+
+  g_return_if_fail (s_path != NULL);
+
+  _gtk_tree_model_begin_batch (GTK_TREE_MODEL (tree_model_sort));
+
+  for (i = 0; i < n_rows; i++)
+    gtk_tree_model_sort_row_deleted (s_model, s_path, tree_model_sort);
+
+  _gtk_tree_model_end_batch (GTK_TREE_MODEL (tree_model_sort));
+}
+
 static void
 gtk_tree_model_sort_rows_reordered (GtkTreeModel *s_model,
 				    GtkTreePath  *s_path,
@@ -2147,6 +2270,10 @@ gtk_tree_model_sort_set_model (GtkTreeModelSort *tree_model_sort,
                                    priv->deleted_id);
       g_signal_handler_disconnect (priv->child_model,
 				   priv->reordered_id);
+      g_signal_handler_disconnect (priv->child_model,
+                                   priv->rows_inserted_id);
+      g_signal_handler_disconnect (priv->child_model,
+                                   priv->rows_deleted_id);
 
       /* reset our state */
       if (priv->root)
@@ -2184,6 +2311,16 @@ gtk_tree_model_sort_set_model (GtkTreeModelSort *tree_model_sort,
 	g_signal_connect (child_model, "rows-reordered",
 			  G_CALLBACK (gtk_tree_model_sort_rows_reordered),
 			  tree_model_sort);
+      priv->rows_inserted_id =
+        g_signal_connect (child_model, "rows-inserted",
+                          G_CALLBACK (gtk_tree_model_sort_rows_inserted),
+                          tree_model_sort);
+      priv->rows_deleted_id =
+        g_signal_connect (child_model, "rows-deleted",
+                          G_CALLBACK (gtk_tree_model_sort_rows_deleted),
+                          tree_model_sort);
+      gtk_tree_model_handles_ranges (child_model, priv->inserted_id);
+      gtk_tree_model_handles_ranges (child_model, priv->deleted_id);
 
       priv->child_flags = gtk_tree_model_get_flags (child_model);
       n_columns = gtk_tree_model_get_n_columns (child_model);
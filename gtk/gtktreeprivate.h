@@ -21,6 +21,7 @@
 
 #include <gtk/gtktreeview.h>
 #include <gtk/gtktreeselection.h>
+#include <gtk/gtktreemodelfilter.h>
 #include <gtk/gtkrbtree.h>
 
 G_BEGIN_DECLS
@@ -144,6 +145,18 @@ gint              _gtk_tree_view_column_get_drag_x            (GtkTreeViewColumn
 GtkCellAreaContext *_gtk_tree_view_column_get_context         (GtkTreeViewColumn  *column);
 void              _gtk_tree_view_reset_header_styles       (GtkTreeView        *tree_view);
 
+void              _gtk_tree_model_begin_batch             (GtkTreeModel       *tree_model);
+void              _gtk_tree_model_end_batch               (GtkTreeModel       *tree_model);
+gboolean          _gtk_tree_model_filter_refilter_rows    (GtkTreeModelFilter *filter,
+                                                           const guint8       *visible,
+                                                           gint                n_rows);
+void              _gtk_tree_row_reference_rows_inserted   (GObject            *proxy,
+                                                           GtkTreePath        *path,
+                                                           gint                n_rows);
+void              _gtk_tree_row_reference_rows_deleted    (GObject            *proxy,
+                                                           GtkTreePath        *path,
+                                                           gint                n_rows);
+
 
 G_END_DECLS
 
@@ -739,6 +739,7 @@ gtk_tree_selection_selected_foreach (GtkTreeSelection            *selection,
   GtkTreeModel *model;
 
   gulong inserted_id, deleted_id, reordered_id, changed_id;
+  gulong rows_inserted_id, rows_deleted_id;
   gboolean stop = FALSE;
 
   g_return_if_fail (GTK_IS_TREE_SELECTION (selection));
@@ -779,6 +780,14 @@ gtk_tree_selection_selected_foreach (GtkTreeSelection            *selection,
   deleted_id = g_signal_connect_swapped (model, "row-deleted",
 					 G_CALLBACK (model_changed),
 				         &stop);
+  rows_inserted_id = g_signal_connect_swapped (model, "rows-inserted",
+					       G_CALLBACK (model_changed),
+					       &stop);
+  rows_deleted_id = g_signal_connect_swapped (model, "rows-deleted",
+					      G_CALLBACK (model_changed),
+					      &stop);
+  gtk_tree_model_handles_ranges (model, inserted_id);
+  gtk_tree_model_handles_ranges (model, deleted_id);
   reordered_id = g_signal_connect_swapped (model, "rows-reordered",
 					   G_CALLBACK (model_changed),
 				           &stop);
@@ -846,6 +855,8 @@ out:
 
   g_signal_handler_disconnect (model, inserted_id);
   g_signal_handler_disconnect (model, deleted_id);
+  g_signal_handler_disconnect (model, rows_inserted_id);
+  g_signal_handler_disconnect (model, rows_deleted_id);
   g_signal_handler_disconnect (model, reordered_id);
   g_signal_handler_disconnect (priv->tree_view, changed_id);
   g_object_unref (model);
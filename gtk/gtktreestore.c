@@ -25,6 +25,7 @@
 #include "gtkbuildable.h"
 #include "gtkdebug.h"
 #include "gtkintl.h"
+#include "gtktreeprivate.h"
 
 
 /**
@@ -1874,9 +1875,38 @@ gtk_tree_store_increment_stamp (GtkTreeStore *tree_store)
 void
 gtk_tree_store_clear (GtkTreeStore *tree_store)
 {
+  GtkTreeStorePrivate *priv;
+  GNode *root;
+  gint n_rows;
+
   g_return_if_fail (GTK_IS_TREE_STORE (tree_store));
 
-  gtk_tree_store_clear_traverse (tree_store->priv->root, tree_store);
+  priv = tree_store->priv;
+  root = G_NODE (priv->root);
+  n_rows = g_node_n_children (root);
+
+  if (n_rows > 0 &&
+      !gtk_tree_model_needs_row_deleted (GTK_TREE_MODEL (tree_store)))
+    {
+      GtkTreePath *path;
+      GNode *node, *next;
+
+      /* Removing the toplevel rows takes their children with them */
+      for (node = root->children; node; node = next)
+        {
+          next = node->next;
+          g_node_traverse (node, G_POST_ORDER, G_TRAVERSE_ALL,
+                           -1, node_free, priv->column_headers);
+          g_node_destroy (node);
+        }
+
+      path = gtk_tree_path_new_first ();
+      gtk_tree_model_rows_deleted (GTK_TREE_MODEL (tree_store), path, n_rows);
+      gtk_tree_path_free (path);
+    }
+  else
+    gtk_tree_store_clear_traverse (priv->root, tree_store);
+
   gtk_tree_store_increment_stamp (tree_store);
 }
 
@@ -445,6 +445,7 @@ struct _GtkTreeViewPrivate
 
   guint fixed_height_mode : 1;
   guint fixed_height_check : 1;
+  guint row_heights_estimated : 1;
 
   guint activate_on_single_click : 1;
   guint reorderable : 1;
@@ -677,6 +678,15 @@ static void gtk_tree_view_rows_reordered                  (GtkTreeModel    *mode
 							   GtkTreeIter     *iter,
 							   gint            *new_order,
 							   gpointer         data);
+static void gtk_tree_view_rows_inserted                   (GtkTreeModel    *model,
+							   GtkTreePath     *path,
+							   GtkTreeIter     *iter,
+							   gint             n_rows,
+							   gpointer         data);
+static void gtk_tree_view_rows_deleted                    (GtkTreeModel    *model,
+							   GtkTreePath     *path,
+							   gint             n_rows,
+							   gpointer         data);
 
 /* Incremental reflow */
 static gboolean validate_row             (GtkTreeView *tree_view,
@@ -1776,6 +1786,7 @@ gtk_tree_view_init (GtkTreeView *tree_view)
   tree_view->priv->activate_on_single_click = FALSE;
 
   tree_view->priv->pixel_cache = _gtk_pixel_cache_new ();
+  _gtk_pixel_cache_set_prefetch (tree_view->priv->pixel_cache, TRUE);
 
   /* We need some padding */
   tree_view->priv->dy = 0;
@@ -1793,6 +1804,7 @@ gtk_tree_view_init (GtkTreeView *tree_view)
   tree_view->priv->fixed_height = -1;
   tree_view->priv->fixed_height_mode = FALSE;
   tree_view->priv->fixed_height_check = 0;
+  tree_view->priv->row_heights_estimated = 0;
   tree_view->priv->selection = _gtk_tree_selection_new_with_tree_view (tree_view);
   tree_view->priv->enable_search = TRUE;
   tree_view->priv->search_column = -1;
@@ -6670,6 +6682,21 @@ validate_visible_area (GtkTreeView *tree_view)
       area_above -= gtk_tree_view_get_row_height (tree_view, node);
     }
 
+  /* The rows that aren't visible only get validated in the background.
+   * Until then, guess that they are as high as the top row, so that the
+   * scrollbar is about right from the first frame on.
+   */
+  if (size_changed &&
+      !tree_view->priv->fixed_height_check &&
+      !tree_view->priv->row_heights_estimated)
+    {
+      _gtk_tree_view_find_node (tree_view, above_path, &tree, &node);
+      if (node && GTK_RBNODE_GET_HEIGHT (node) > 0)
+        _gtk_rbtree_set_fixed_height (tree_view->priv->tree,
+                                      GTK_RBNODE_GET_HEIGHT (node), FALSE);
+      tree_view->priv->row_heights_estimated = 1;
+    }
+
   /* if we scrolled to a path, we need to set the dy here,
    * and sync the top row accordingly
    */
@@ -8995,45 +9022,37 @@ gtk_tree_view_row_changed (GtkTreeModel *model,
     gtk_tree_path_free (path);
 }
 
+/* Adds the @n_rows rows starting at @path to the rbtree */
 static void
-gtk_tree_view_row_inserted (GtkTreeModel *model,
-			    GtkTreePath  *path,
-			    GtkTreeIter  *iter,
-			    gpointer      data)
+gtk_tree_view_insert_rows (GtkTreeView  *tree_view,
+                           GtkTreeModel *model,
+                           GtkTreePath  *path,
+                           GtkTreeIter  *iter,
+                           gint          n_rows)
 {
-  GtkTreeView *tree_view = (GtkTreeView *) data;
+  GtkTreeIter row_iter;
   gint *indices;
   GtkRBTree *tree;
   GtkRBNode *tmpnode = NULL;
+  GtkRBNode *first_node = NULL;
   gint depth;
   gint i = 0;
   gint height;
-  gboolean free_path = FALSE;
   gboolean node_visible = TRUE;
 
-  g_return_if_fail (path != NULL || iter != NULL);
-
   if (tree_view->priv->fixed_height_mode
       && tree_view->priv->fixed_height >= 0)
     height = tree_view->priv->fixed_height;
   else
     height = 0;
 
-  if (path == NULL)
-    {
-      path = gtk_tree_model_get_path (model, iter);
-      free_path = TRUE;
-    }
-  else if (iter == NULL)
-    gtk_tree_model_get_iter (model, iter, path);
-
   if (tree_view->priv->tree == NULL)
     tree_view->priv->tree = _gtk_rbtree_new ();
 
   tree = tree_view->priv->tree;
 
   /* Update all row-references */
-  gtk_tree_row_reference_inserted (G_OBJECT (data), path);
+  _gtk_tree_row_reference_rows_inserted (G_OBJECT (tree_view), path, n_rows);
   depth = gtk_tree_path_get_depth (path);
   indices = gtk_tree_path_get_indices (path);
 
@@ -9062,7 +9081,7 @@ gtk_tree_view_row_inserted (GtkTreeModel *model,
 	   * try to catch it anyway, just to be safe, in case the model hasn't.
 	   */
 	  GtkTreePath *tmppath = _gtk_tree_path_new_from_rbtree (tree, tmpnode);
-	  gtk_tree_view_row_has_child_toggled (model, tmppath, NULL, data);
+	  gtk_tree_view_row_has_child_toggled (model, tmppath, NULL, tree_view);
 	  gtk_tree_path_free (tmppath);
           goto done;
 	}
@@ -9077,38 +9096,112 @@ gtk_tree_view_row_inserted (GtkTreeModel *model,
       goto done;
     }
 
-  /* ref the node */
-  gtk_tree_model_ref_node (tree_view->priv->model, iter);
-  if (indices[depth - 1] == 0)
+  row_iter = *iter;
+
+  if (n_rows > 1 && _gtk_rbtree_is_nil (tree->root))
     {
-      tmpnode = _gtk_rbtree_find_count (tree, 1);
-      tmpnode = _gtk_rbtree_insert_before (tree, tmpnode, height, FALSE);
+      /* There is nothing to insert in between, so build all nodes
+       * in one go.
+       */
+      _gtk_rbtree_fill (tree, n_rows, height, height > 0);
+
+      for (i = 0; i < n_rows; i++)
+        {
+          gtk_tree_model_ref_node (tree_view->priv->model, &row_iter);
+          gtk_tree_model_iter_next (tree_view->priv->model, &row_iter);
+        }
+
+      _gtk_tree_view_accessible_add (tree_view, tree, NULL);
+
+      first_node = _gtk_rbtree_first (tree);
+      tmpnode = _gtk_rbtree_find_count (tree, n_rows);
+      goto done;
     }
-  else
+
+  for (i = 0; i < n_rows; i++)
     {
-      tmpnode = _gtk_rbtree_find_count (tree, indices[depth - 1]);
-      tmpnode = _gtk_rbtree_insert_after (tree, tmpnode, height, FALSE);
-    }
+      /* ref the node */
+      gtk_tree_model_ref_node (tree_view->priv->model, &row_iter);
+      if (i > 0)
+        tmpnode = _gtk_rbtree_insert_after (tree, tmpnode, height, FALSE);
+      else if (indices[depth - 1] == 0)
+        {
+          tmpnode = _gtk_rbtree_find_count (tree, 1);
+          tmpnode = _gtk_rbtree_insert_before (tree, tmpnode, height, FALSE);
+        }
+      else
+        {
+          tmpnode = _gtk_rbtree_find_count (tree, indices[depth - 1]);
+          tmpnode = _gtk_rbtree_insert_after (tree, tmpnode, height, FALSE);
+        }
+
+      if (height > 0)
+        _gtk_rbtree_node_mark_valid (tree, tmpnode);
+
+      _gtk_tree_view_accessible_add (tree_view, tree, tmpnode);
+
+      if (first_node == NULL)
+        first_node = tmpnode;
 
-  _gtk_tree_view_accessible_add (tree_view, tree, tmpnode);
+      if (i + 1 < n_rows)
+        gtk_tree_model_iter_next (tree_view->priv->model, &row_iter);
+    }
 
  done:
   if (height > 0)
     {
-      if (tree)
-        _gtk_rbtree_node_mark_valid (tree, tmpnode);
-
-      if (node_visible && node_is_visible (tree_view, tree, tmpnode))
+      if (node_visible && first_node &&
+          (node_is_visible (tree_view, tree, first_node) ||
+           node_is_visible (tree_view, tree, tmpnode)))
 	gtk_widget_queue_resize (GTK_WIDGET (tree_view));
       else
 	gtk_widget_queue_resize_no_redraw (GTK_WIDGET (tree_view));
     }
   else
     install_presize_handler (tree_view);
+}
+
+static void
+gtk_tree_view_row_inserted (GtkTreeModel *model,
+			    GtkTreePath  *path,
+			    GtkTreeIter  *iter,
+			    gpointer      data)
+{
+  GtkTreeView *tree_view = (GtkTreeView *) data;
+  GtkTreeIter real_iter;
+  gboolean free_path = FALSE;
+
+  g_return_if_fail (path != NULL || iter != NULL);
+
+  if (path == NULL)
+    {
+      path = gtk_tree_model_get_path (model, iter);
+      free_path = TRUE;
+    }
+  else if (iter == NULL)
+    {
+      gtk_tree_model_get_iter (model, &real_iter, path);
+      iter = &real_iter;
+    }
+
+  gtk_tree_view_insert_rows (tree_view, model, path, iter, 1);
+
   if (free_path)
     gtk_tree_path_free (path);
 }
 
+static void
+gtk_tree_view_rows_inserted (GtkTreeModel *model,
+			     GtkTreePath  *path,
+			     GtkTreeIter  *iter,
+			     gint          n_rows,
+			     gpointer      data)
+{
+  g_return_if_fail (path != NULL && iter != NULL);
+
+  gtk_tree_view_insert_rows (GTK_TREE_VIEW (data), model, path, iter, n_rows);
+}
+
 static void
 gtk_tree_view_row_has_child_toggled (GtkTreeModel *model,
 				     GtkTreePath  *path,
@@ -9211,22 +9304,21 @@ check_selection_helper (GtkRBTree *tree,
     _gtk_rbtree_traverse (node->children, node->children->root, G_POST_ORDER, check_selection_helper, data);
 }
 
+/* Removes the @n_rows rows starting at @path from the rbtree */
 static void
-gtk_tree_view_row_deleted (GtkTreeModel *model,
-			   GtkTreePath  *path,
-			   gpointer      data)
+gtk_tree_view_delete_rows (GtkTreeView *tree_view,
+                           GtkTreePath *path,
+                           gint         n_rows)
 {
-  GtkTreeView *tree_view = (GtkTreeView *)data;
   GtkRBTree *tree;
-  GtkRBNode *node;
+  GtkRBNode *node, *last, *tmpnode;
   GList *list;
   gboolean selection_changed = FALSE, cursor_changed = FALSE;
   GtkRBTree *cursor_tree = NULL;
   GtkRBNode *cursor_node = NULL;
+  gint i;
 
-  g_return_if_fail (path != NULL);
-
-  gtk_tree_row_reference_deleted (G_OBJECT (data), path);
+  _gtk_tree_row_reference_rows_deleted (G_OBJECT (tree_view), path, n_rows);
 
   if (_gtk_tree_view_find_node (tree_view, path, &tree, &node))
     return;
@@ -9234,9 +9326,30 @@ gtk_tree_view_row_deleted (GtkTreeModel *model,
   if (tree == NULL)
     return;
 
+  /* find the last deleted node */
+  last = node;
+  for (i = 1; i < n_rows; i++)
+    {
+      tmpnode = _gtk_rbtree_next (tree, last);
+      if (tmpnode == NULL)
+        break;
+      last = tmpnode;
+    }
+  n_rows = i;
+
   /* check if the selection has been changed */
-  _gtk_rbtree_traverse (tree, node, G_POST_ORDER,
-                        check_selection_helper, &selection_changed);
+  if (n_rows == 1)
+    _gtk_rbtree_traverse (tree, node, G_POST_ORDER,
+                          check_selection_helper, &selection_changed);
+  else
+    {
+      for (tmpnode = node; !selection_changed; tmpnode = _gtk_rbtree_next (tree, tmpnode))
+        {
+          check_selection_helper (tree, tmpnode, &selection_changed);
+          if (tmpnode == last)
+            break;
+        }
+    }
 
   for (list = tree_view->priv->columns; list; list = list->next)
     if (gtk_tree_view_column_get_visible (GTK_TREE_VIEW_COLUMN (list->data)) &&
@@ -9250,15 +9363,28 @@ gtk_tree_view_row_deleted (GtkTreeModel *model,
   gtk_tree_view_stop_editing (tree_view, TRUE);
 
   /* If the cursor row got deleted, move the cursor to the next row */
-  if (tree_view->priv->cursor_node &&
-      (tree_view->priv->cursor_node == node ||
-       (node->children && (tree_view->priv->cursor_tree == node->children ||
-                           _gtk_rbtree_contains (node->children, tree_view->priv->cursor_tree)))))
+  if (tree_view->priv->cursor_node)
+    {
+      for (tmpnode = node; ; tmpnode = _gtk_rbtree_next (tree, tmpnode))
+        {
+          if (tree_view->priv->cursor_node == tmpnode ||
+              (tmpnode->children && (tree_view->priv->cursor_tree == tmpnode->children ||
+                                     _gtk_rbtree_contains (tmpnode->children, tree_view->priv->cursor_tree))))
+            {
+              cursor_changed = TRUE;
+              break;
+            }
+          if (tmpnode == last)
+            break;
+        }
+    }
+
+  if (cursor_changed)
     {
       GtkTreePath *cursor_path;
 
       cursor_tree = tree;
-      cursor_node = _gtk_rbtree_next (tree, node);
+      cursor_node = _gtk_rbtree_next (tree, last);
       /* find the first node that is not going to be deleted */
       while (cursor_node == NULL && cursor_tree->parent_tree)
         {
@@ -9292,19 +9418,22 @@ gtk_tree_view_row_deleted (GtkTreeModel *model,
         }
       else if (cursor_path)
         gtk_tree_path_free (cursor_path);
-
-      cursor_changed = TRUE;
     }
 
   if (tree_view->priv->destroy_count_func)
     {
-      gint child_count = 0;
-      if (node->children)
-	_gtk_rbtree_traverse (node->children, node->children->root, G_POST_ORDER, count_children_helper, &child_count);
-      tree_view->priv->destroy_count_func (tree_view, path, child_count, tree_view->priv->destroy_count_data);
+      for (tmpnode = node; ; tmpnode = _gtk_rbtree_next (tree, tmpnode))
+        {
+          gint child_count = 0;
+          if (tmpnode->children)
+            _gtk_rbtree_traverse (tmpnode->children, tmpnode->children->root, G_POST_ORDER, count_children_helper, &child_count);
+          tree_view->priv->destroy_count_func (tree_view, path, child_count, tree_view->priv->destroy_count_data);
+          if (tmpnode == last)
+            break;
+        }
     }
 
-  if (tree->root->count == 1)
+  if (tree->root->count == n_rows)
     {
       if (tree_view->priv->tree == tree)
 	tree_view->priv->tree = NULL;
@@ -9317,8 +9446,13 @@ gtk_tree_view_row_deleted (GtkTreeModel *model,
     }
   else
     {
-      _gtk_tree_view_accessible_remove (tree_view, tree, node);
-      _gtk_rbtree_remove_node (tree, node);
+      for (i = 0; i < n_rows; i++)
+        {
+          tmpnode = _gtk_rbtree_next (tree, node);
+          _gtk_tree_view_accessible_remove (tree_view, tree, node);
+          _gtk_rbtree_remove_node (tree, node);
+          node = tmpnode;
+        }
     }
 
   if (! gtk_tree_row_reference_valid (tree_view->priv->top_row))
@@ -9346,6 +9480,27 @@ gtk_tree_view_row_deleted (GtkTreeModel *model,
     g_signal_emit_by_name (tree_view->priv->selection, "changed");
 }
 
+static void
+gtk_tree_view_row_deleted (GtkTreeModel *model,
+			   GtkTreePath  *path,
+			   gpointer      data)
+{
+  g_return_if_fail (path != NULL);
+
+  gtk_tree_view_delete_rows (GTK_TREE_VIEW (data), path, 1);
+}
+
+static void
+gtk_tree_view_rows_deleted (GtkTreeModel *model,
+			    GtkTreePath  *path,
+			    gint          n_rows,
+			    gpointer      data)
+{
+  g_return_if_fail (path != NULL);
+
+  gtk_tree_view_delete_rows (GTK_TREE_VIEW (data), path, n_rows);
+}
+
 static void
 gtk_tree_view_rows_reordered (GtkTreeModel *model,
 			      GtkTreePath  *parent,
@@ -9528,20 +9683,28 @@ gtk_tree_view_build_tree (GtkTreeView *tree_view,
 {
   GtkRBNode *temp = NULL;
   GtkTreePath *path = NULL;
+  GtkTreeIter parent;
+  gint n_children;
+
+  /* Create the nodes for all the rows at this level in one go, that
+   * is a lot faster than inserting them one by one for big models.
+   */
+  if (gtk_tree_model_iter_parent (tree_view->priv->model, &parent, iter))
+    n_children = gtk_tree_model_iter_n_children (tree_view->priv->model, &parent);
+  else
+    n_children = gtk_tree_model_iter_n_children (tree_view->priv->model, NULL);
+
+  if (tree_view->priv->fixed_height > 0)
+    _gtk_rbtree_fill (tree, n_children, tree_view->priv->fixed_height, TRUE);
+  else
+    _gtk_rbtree_fill (tree, n_children, 0, FALSE);
+
+  temp = _gtk_rbtree_first (tree);
+  g_return_if_fail (temp != NULL);
 
   do
     {
       gtk_tree_model_ref_node (tree_view->priv->model, iter);
-      temp = _gtk_rbtree_insert_after (tree, temp, 0, FALSE);
-
-      if (tree_view->priv->fixed_height > 0)
-        {
-          if (GTK_RBNODE_FLAG_SET (temp, GTK_RBNODE_INVALID))
-	    {
-              _gtk_rbtree_node_set_height (tree, temp, tree_view->priv->fixed_height);
-	      _gtk_rbtree_node_mark_valid (tree, temp);
-	    }
-        }
 
       if (tree_view->priv->is_list)
         continue;
@@ -9578,7 +9741,8 @@ gtk_tree_view_build_tree (GtkTreeView *tree_view,
 	    temp->flags ^= GTK_RBNODE_IS_PARENT;
 	}
     }
-  while (gtk_tree_model_iter_next (tree_view->priv->model, iter));
+  while ((temp = _gtk_rbtree_next (tree, temp)) != NULL &&
+         gtk_tree_model_iter_next (tree_view->priv->model, iter));
 
   if (path)
     gtk_tree_path_free (path);
@@ -11298,6 +11462,7 @@ gtk_tree_view_adjustment_changed (GtkAdjustment *adjustment,
     {
       gint dy;
 	
+      _gtk_pixel_cache_view_moved (tree_view->priv->pixel_cache);
       gdk_window_move (tree_view->priv->bin_window,
 		       - gtk_adjustment_get_value (tree_view->priv->hadjustment),
 		       gtk_tree_view_get_effective_header_height (tree_view));
@@ -11428,6 +11593,12 @@ gtk_tree_view_set_model (GtkTreeView  *tree_view,
       g_signal_handlers_disconnect_by_func (tree_view->priv->model,
 					    gtk_tree_view_rows_reordered,
 					    tree_view);
+      g_signal_handlers_disconnect_by_func (tree_view->priv->model,
+					    gtk_tree_view_rows_inserted,
+					    tree_view);
+      g_signal_handlers_disconnect_by_func (tree_view->priv->model,
+					    gtk_tree_view_rows_deleted,
+					    tree_view);
 
       for (; tmplist; tmplist = tmplist->next)
 	_gtk_tree_view_column_unset_model (tmplist->data,
@@ -11451,6 +11622,7 @@ gtk_tree_view_set_model (GtkTreeView  *tree_view,
 
       tree_view->priv->search_column = -1;
       tree_view->priv->fixed_height_check = 0;
+      tree_view->priv->row_heights_estimated = 0;
       tree_view->priv->fixed_height = -1;
       tree_view->priv->dy = tree_view->priv->top_row_dy = 0;
     }
@@ -11463,6 +11635,7 @@ gtk_tree_view_set_model (GtkTreeView  *tree_view,
       GtkTreePath *path;
       GtkTreeIter iter;
       GtkTreeModelFlags flags;
+      gulong handler_id;
 
       if (tree_view->priv->search_column == -1)
 	{
@@ -11483,22 +11656,32 @@ gtk_tree_view_set_model (GtkTreeView  *tree_view,
 			"row-changed",
 			G_CALLBACK (gtk_tree_view_row_changed),
 			tree_view);
-      g_signal_connect (tree_view->priv->model,
-			"row-inserted",
-			G_CALLBACK (gtk_tree_view_row_inserted),
-			tree_view);
+      handler_id = g_signal_connect (tree_view->priv->model,
+                                     "row-inserted",
+                                     G_CALLBACK (gtk_tree_view_row_inserted),
+                                     tree_view);
+      gtk_tree_model_handles_ranges (tree_view->priv->model, handler_id);
       g_signal_connect (tree_view->priv->model,
 			"row-has-child-toggled",
 			G_CALLBACK (gtk_tree_view_row_has_child_toggled),
 			tree_view);
-      g_signal_connect (tree_view->priv->model,
-			"row-deleted",
-			G_CALLBACK (gtk_tree_view_row_deleted),
-			tree_view);
+      handler_id = g_signal_connect (tree_view->priv->model,
+                                     "row-deleted",
+                                     G_CALLBACK (gtk_tree_view_row_deleted),
+                                     tree_view);
+      gtk_tree_model_handles_ranges (tree_view->priv->model, handler_id);
       g_signal_connect (tree_view->priv->model,
 			"rows-reordered",
 			G_CALLBACK (gtk_tree_view_rows_reordered),
 			tree_view);
+      g_signal_connect (tree_view->priv->model,
+			"rows-inserted",
+			G_CALLBACK (gtk_tree_view_rows_inserted),
+			tree_view);
+      g_signal_connect (tree_view->priv->model,
+			"rows-deleted",
+			G_CALLBACK (gtk_tree_view_rows_deleted),
+			tree_view);
 
       flags = gtk_tree_model_get_flags (tree_view->priv->model);
       if ((flags & GTK_TREE_MODEL_LIST_ONLY) == GTK_TREE_MODEL_LIST_ONLY)
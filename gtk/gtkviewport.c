@@ -276,6 +276,7 @@ gtk_viewport_init (GtkViewport *viewport)
   priv->vadjustment = NULL;
 
   priv->pixel_cache = _gtk_pixel_cache_new ();
+  _gtk_pixel_cache_set_prefetch (priv->pixel_cache, TRUE);
 
   gtk_style_context_add_class (gtk_widget_get_style_context (GTK_WIDGET (viewport)), GTK_STYLE_CLASS_FRAME);
   viewport_set_adjustment (viewport, GTK_ORIENTATION_HORIZONTAL, NULL);
@@ -997,7 +998,10 @@ gtk_viewport_adjustment_value_changed (GtkAdjustment *adjustment,
       new_y = - gtk_adjustment_get_value (vadjustment);
 
       if (new_x != old_x || new_y != old_y)
-	gdk_window_move (priv->bin_window, new_x, new_y);
+	{
+	  _gtk_pixel_cache_view_moved (priv->pixel_cache);
+	  gdk_window_move (priv->bin_window, new_x, new_y);
+	}
     }
 }
 
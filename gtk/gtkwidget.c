@@ -68,6 +68,8 @@
 #include "a11y/gtkwidgetaccessible.h"
 #include "gtkapplicationprivate.h"
 #include "gtkgestureprivate.h"
+#include "gtkpixelcacheprivate.h"
+#include "gtkprofilerprivate.h"
 
 /* for the use of round() */
 #include "fallback-c89.c"
@@ -598,6 +600,9 @@ struct _GtkWidgetPrivate
 #endif /* G_ENABLE_DEBUG */
 
   GList *event_controllers;
+
+  /* See gtk_widget_set_render_cache() */
+  GtkPixelCache *render_cache;
 };
 
 struct _GtkWidgetClassPrivate
@@ -812,6 +817,8 @@ static void     	gtk_widget_update_pango_context		(GtkWidget	  *widget);
 static void		gtk_widget_propagate_state		(GtkWidget	  *widget,
 								 GtkStateData 	  *data);
 static void             gtk_widget_update_alpha                 (GtkWidget        *widget);
+static void             gtk_widget_invalidate_render_caches     (GtkWidget            *widget,
+                                                                 const cairo_region_t *region);
 
 static gint		gtk_widget_event_internal		(GtkWidget	  *widget,
 								 GdkEvent	  *event);
@@ -948,6 +955,7 @@ static gint             GtkWidget_private_offset = 0;
 static gpointer         gtk_widget_parent_class = NULL;
 static guint            widget_signals[LAST_SIGNAL] = { 0 };
 static guint            composite_child_stack = 0;
+static guint            n_render_caches = 0;
 static GtkTextDirection gtk_default_direction = GTK_TEXT_DIR_LTR;
 static GParamSpecPool  *style_property_spec_pool = NULL;
 
@@ -4678,6 +4686,8 @@ gtk_widget_unparent (GtkWidget *widget)
   if (gtk_container_get_focus_child (GTK_CONTAINER (priv->parent)) == widget)
     gtk_container_set_focus_child (GTK_CONTAINER (priv->parent), NULL);
 
+  _gtk_container_invalidate_draw_index (GTK_CONTAINER (priv->parent));
+
   gtk_widget_queue_draw_child (widget);
 
   /* Reset the width and height here, to force reallocation if we
@@ -5044,8 +5054,14 @@ gtk_widget_map (GtkWidget *widget)
 
       g_signal_emit (widget, widget_signals[MAP], 0);
 
+      if (priv->render_cache)
+        _gtk_pixel_cache_map (priv->render_cache);
+
       if (!gtk_widget_get_has_window (widget))
-        gdk_window_invalidate_rect (priv->window, &priv->clip, FALSE);
+        {
+          gtk_widget_invalidate_render_caches (widget, NULL);
+          gdk_window_invalidate_rect (priv->window, &priv->clip, FALSE);
+        }
 
       if (widget->priv->context)
         _gtk_style_context_update_animating (widget->priv->context);
@@ -5075,7 +5091,10 @@ gtk_widget_unmap (GtkWidget *widget)
       gtk_widget_push_verify_invariants (widget);
 
       if (!gtk_widget_get_has_window (widget))
-	gdk_window_invalidate_rect (priv->window, &priv->clip, FALSE);
+        {
+          gtk_widget_invalidate_render_caches (widget, NULL);
+          gdk_window_invalidate_rect (priv->window, &priv->clip, FALSE);
+        }
       _gtk_tooltip_hide (widget);
 
       if (widget->priv->context)
@@ -5083,6 +5102,9 @@ gtk_widget_unmap (GtkWidget *widget)
 
       g_signal_emit (widget, widget_signals[UNMAP], 0);
 
+      if (priv->render_cache)
+        _gtk_pixel_cache_unmap (priv->render_cache);
+
       gtk_widget_pop_verify_invariants (widget);
     }
 }
@@ -5573,6 +5595,10 @@ gtk_widget_unrealize (GtkWidget *widget)
       g_assert (!widget->priv->mapped);
       gtk_widget_set_realized (widget, FALSE);
 
+      /* The windows the children draw on are gone */
+      if (GTK_IS_CONTAINER (widget))
+        _gtk_container_invalidate_draw_index (GTK_CONTAINER (widget));
+
       g_object_unref (widget);
     }
 
@@ -5592,6 +5618,50 @@ gtk_widget_real_queue_draw_region (GtkWidget         *widget,
   gdk_window_invalidate_region (priv->window, region, TRUE);
 }
 
+/* Drops the parts of the render caches of @widget and its ancestors
+ * that @region covers. @region is in the coordinates that
+ * gtk_widget_queue_draw_region() uses, or %NULL for all of @widget.
+ * The ancestors drop their whole cache, as they may have drawn
+ * @widget anywhere.
+ */
+static void
+gtk_widget_invalidate_render_caches (GtkWidget            *widget,
+                                     const cairo_region_t *region)
+{
+  GtkWidgetPrivate *priv = widget->priv;
+  cairo_region_t *cache_region;
+  GtkWidget *w;
+
+  if (n_render_caches == 0)
+    return;
+
+  if (priv->render_cache)
+    {
+      if (region)
+        {
+          /* The cache surface starts at the top left of the clip */
+          cache_region = cairo_region_copy (region);
+          if (gtk_widget_get_has_window (widget))
+            cairo_region_translate (cache_region,
+                                    priv->allocation.x - priv->clip.x,
+                                    priv->allocation.y - priv->clip.y);
+          else
+            cairo_region_translate (cache_region, -priv->clip.x, -priv->clip.y);
+
+          _gtk_pixel_cache_invalidate (priv->render_cache, cache_region);
+          cairo_region_destroy (cache_region);
+        }
+      else
+        _gtk_pixel_cache_invalidate (priv->render_cache, NULL);
+    }
+
+  for (w = priv->parent; w != NULL; w = w->priv->parent)
+    {
+      if (w->priv->render_cache)
+        _gtk_pixel_cache_invalidate (w->priv->render_cache, NULL);
+    }
+}
+
 /**
  * gtk_widget_queue_draw_region:
  * @widget: a #GtkWidget
@@ -5626,6 +5696,8 @@ gtk_widget_queue_draw_region (GtkWidget            *widget,
     if (!gtk_widget_get_mapped (w))
       return;
 
+  gtk_widget_invalidate_render_caches (widget, region);
+
   WIDGET_CLASS (widget)->queue_draw_region (widget, region);
 }
 
@@ -6089,6 +6161,11 @@ gtk_widget_size_allocate_with_baseline (GtkWidget     *widget,
       priv->clip = priv->allocation;
     }
 
+  if (priv->parent && GTK_IS_CONTAINER (priv->parent))
+    _gtk_container_child_allocated (GTK_CONTAINER (priv->parent), widget);
+
+  gtk_widget_invalidate_render_caches (widget, NULL);
+
   if (gtk_widget_get_mapped (widget) && priv->redraw_on_alloc)
     {
       if (!gtk_widget_get_has_window (widget) && position_changed)
@@ -6920,12 +6997,38 @@ gtk_cairo_should_draw_window (cairo_t *cr,
     event_window == window;
 }
 
+typedef struct {
+  GtkWidget *widget;
+  GdkWindow *window;
+  GdkEventExpose *event;
+} RenderCacheDraw;
+
+static void
+render_cache_draw (cairo_t  *cr,
+                   gpointer  user_data)
+{
+  RenderCacheDraw *data = user_data;
+  gboolean result;
+
+  /* This is either a new context on the cache surface or
+   * the original one; make sure children see the same event
+   * in both cases.
+   */
+  gtk_cairo_set_event_window (cr, data->window);
+  gtk_cairo_set_event (cr, data->event);
+
+  g_signal_emit (data->widget, widget_signals[DRAW],
+                 0, cr,
+                 &result);
+}
+
 static void
 _gtk_widget_draw_internal (GtkWidget *widget,
                            cairo_t   *cr,
                            gboolean   clip_to_size,
 			   GdkWindow *window)
 {
+  GtkWidgetPrivate *priv = widget->priv;
   GdkWindow *tmp_event_window;
 
   if (!gtk_widget_is_drawable (widget))
@@ -6937,20 +7040,49 @@ _gtk_widget_draw_internal (GtkWidget *widget,
   if (clip_to_size)
     {
       cairo_rectangle (cr,
-                       widget->priv->clip.x - widget->priv->allocation.x,
-                       widget->priv->clip.y - widget->priv->allocation.y,
-                       widget->priv->clip.width,
-                       widget->priv->clip.height);
+                       priv->clip.x - priv->allocation.x,
+                       priv->clip.y - priv->allocation.y,
+                       priv->clip.width,
+                       priv->clip.height);
       cairo_clip (cr);
     }
 
   if (gdk_cairo_get_clip_rectangle (cr, NULL))
     {
       gboolean result;
+      gint64 start_time;
+
+      start_time = _gtk_profiler_begin ();
 
-      g_signal_emit (widget, widget_signals[DRAW],
-                     0, cr,
-                     &result);
+      if (priv->render_cache && clip_to_size && window == priv->window)
+        {
+          cairo_rectangle_int_t view_rect, canvas_rect;
+          RenderCacheDraw data;
+
+          view_rect.x = priv->clip.x - priv->allocation.x;
+          view_rect.y = priv->clip.y - priv->allocation.y;
+          view_rect.width = priv->clip.width;
+          view_rect.height = priv->clip.height;
+
+          canvas_rect.x = 0;
+          canvas_rect.y = 0;
+          canvas_rect.width = priv->clip.width;
+          canvas_rect.height = priv->clip.height;
+
+          data.widget = widget;
+          data.window = window;
+          data.event = _gtk_cairo_get_event (cr);
+
+          _gtk_pixel_cache_draw (priv->render_cache, cr, window,
+                                 &view_rect, &canvas_rect,
+                                 render_cache_draw, &data);
+        }
+      else
+        g_signal_emit (widget, widget_signals[DRAW],
+                       0, cr,
+                       &result);
+
+      _gtk_profiler_end (GTK_PROFILER_DRAW, widget, start_time);
 
 #ifdef G_ENABLE_DEBUG
       if (G_UNLIKELY (gtk_get_debug_flags () & GTK_DEBUG_BASELINES))
@@ -9341,6 +9473,81 @@ gtk_widget_get_double_buffered (GtkWidget *widget)
   return widget->priv->double_buffered;
 }
 
+/**
+ * gtk_widget_set_render_cache:
+ * @widget: a #GtkWidget
+ * @render_cache: %TRUE to keep the rendering of @widget around
+ *
+ * Sets whether @widget keeps its last rendering, including that of
+ * its children, in an offscreen surface. The surface is used instead
+ * of emitting #GtkWidget::draw until a part of @widget or one of its
+ * children is invalidated with gtk_widget_queue_draw() or
+ * gtk_widget_queue_draw_region(), or @widget is allocated again.
+ *
+ * This helps with widgets that are expensive to draw and rarely change,
+ * in windows that are redrawn often. It is only correct if everything
+ * that changes the rendering of @widget goes through
+ * gtk_widget_queue_draw() or gtk_widget_queue_resize();
+ * gdk_window_invalidate_rect() alone does not update the surface.
+ *
+ * The surfaces of all widgets share a limited amount of memory; the
+ * ones that were drawn least recently are dropped first, and so are
+ * the ones of widgets that have not been drawn for a while.
+ *
+ * Since: 3.16
+ **/
+void
+gtk_widget_set_render_cache (GtkWidget *widget,
+                             gboolean   render_cache)
+{
+  GtkWidgetPrivate *priv;
+
+  g_return_if_fail (GTK_IS_WIDGET (widget));
+
+  priv = widget->priv;
+  render_cache = (render_cache != FALSE);
+
+  if (render_cache == (priv->render_cache != NULL))
+    return;
+
+  if (render_cache)
+    {
+      priv->render_cache = _gtk_pixel_cache_new ();
+      _gtk_pixel_cache_set_always_cache (priv->render_cache, TRUE);
+      /* Whatever is below the widget shows through */
+      _gtk_pixel_cache_set_content (priv->render_cache, CAIRO_CONTENT_COLOR_ALPHA);
+      n_render_caches++;
+    }
+  else
+    {
+      _gtk_pixel_cache_unmap (priv->render_cache);
+      _gtk_pixel_cache_free (priv->render_cache);
+      priv->render_cache = NULL;
+      n_render_caches--;
+    }
+
+  gtk_widget_queue_draw (widget);
+}
+
+/**
+ * gtk_widget_get_render_cache:
+ * @widget: a #GtkWidget
+ *
+ * Returns whether @widget keeps its rendering around.
+ * See gtk_widget_set_render_cache().
+ *
+ * Returns: %TRUE if @widget keeps its rendering around
+ *
+ * Since: 3.16
+ **/
+gboolean
+gtk_widget_get_render_cache (GtkWidget *widget)
+{
+  g_return_val_if_fail (GTK_IS_WIDGET (widget), FALSE);
+
+  return widget->priv->render_cache != NULL;
+}
+
 /**
  * gtk_widget_set_redraw_on_allocate:
  * @widget: a #GtkWidget
@@ -9511,6 +9718,9 @@ gtk_widget_set_parent (GtkWidget *widget,
 
   priv->parent = parent;
 
+  if (GTK_IS_CONTAINER (parent))
+    _gtk_container_invalidate_draw_index (GTK_CONTAINER (parent));
+
   parent_flags = gtk_widget_get_state_flags (parent);
 
   /* Merge both old state and current parent state,
@@ -12159,6 +12369,15 @@ gtk_widget_finalize (GObject *object)
 
   _gtk_size_request_cache_free (&priv->requests);
 
+  _gtk_profiler_forget_widget (widget);
+
+  if (priv->render_cache)
+    {
+      _gtk_pixel_cache_unmap (priv->render_cache);
+      _gtk_pixel_cache_free (priv->render_cache);
+      n_render_caches--;
+    }
+
   if (g_object_is_floating (object))
     g_warning ("A floating object was finalized. This means that someone\n"
                "called g_object_unref() on an object that had only a floating\n"
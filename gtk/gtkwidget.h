@@ -897,6 +897,11 @@ void                  gtk_widget_set_double_buffered    (GtkWidget    *widget,
 							 gboolean      double_buffered);
 GDK_DEPRECATED_IN_3_14
 gboolean              gtk_widget_get_double_buffered    (GtkWidget    *widget);
+GDK_AVAILABLE_IN_ALL
+void                  gtk_widget_set_render_cache       (GtkWidget    *widget,
+							 gboolean      render_cache);
+GDK_AVAILABLE_IN_ALL
+gboolean              gtk_widget_get_render_cache       (GtkWidget    *widget);
 
 GDK_AVAILABLE_IN_ALL
 void                  gtk_widget_set_redraw_on_allocate (GtkWidget    *widget,
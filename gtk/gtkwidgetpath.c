@@ -20,7 +20,7 @@
 #include <string.h>
 
 #include "gtkwidget.h"
-#include "gtkwidgetpath.h"
+#include "gtkwidgetpathprivate.h"
 #include "gtkstylecontextprivate.h"
 #include "gtktypebuiltins.h"
 
@@ -976,6 +976,44 @@ gtk_widget_path_iter_list_classes (const GtkWidgetPath *path,
   return g_slist_reverse (list);
 }
 
+/*
+ * _gtk_widget_path_iter_get_qclasses:
+ * @path: a #GtkWidgetPath
+ * @pos: position to query, -1 for the path head
+ * @n_classes: (out): return location for the number of classes
+ *
+ * Returns the sorted array of class quarks of the element at @pos
+ * without copying it. The array is owned by @path and only valid
+ * until the element's classes change.
+ *
+ * Returns: the classes of the element, or %NULL if it has none
+ */
+const GQuark *
+_gtk_widget_path_iter_get_qclasses (const GtkWidgetPath *path,
+                                    gint                 pos,
+                                    guint               *n_classes)
+{
+  GtkPathElement *elem;
+
+  g_return_val_if_fail (path != NULL, NULL);
+  g_return_val_if_fail (path->elems->len != 0, NULL);
+  g_return_val_if_fail (n_classes != NULL, NULL);
+
+  if (pos < 0 || pos >= path->elems->len)
+    pos = path->elems->len - 1;
+
+  elem = &g_array_index (path->elems, GtkPathElement, pos);
+
+  if (!elem->classes || elem->classes->len == 0)
+    {
+      *n_classes = 0;
+      return NULL;
+    }
+
+  *n_classes = elem->classes->len;
+  return (const GQuark *) elem->classes->data;
+}
+
 /**
  * gtk_widget_path_iter_has_qclass:
  * @path: a #GtkWidgetPath
@@ -32,6 +32,7 @@
 #include <limits.h>
 
 #include "gtkprivate.h"
+#include "gtkprofilerprivate.h"
 #include "gtkwindowprivate.h"
 #include "gtkaccelgroupprivate.h"
 #include "gtkbindings.h"
@@ -6924,6 +6925,8 @@ gtk_window_realize (GtkWidget *widget)
   gtk_widget_register_window (widget, gdk_window);
   gtk_widget_set_realized (widget, TRUE);
 
+  _gtk_profiler_add_frame_clock (gdk_window_get_frame_clock (gdk_window));
+
   /* We don't need to set a background on the GdkWindow; with decorations
    * we draw the background ourself
    */
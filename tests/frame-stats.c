@@ -7,6 +7,22 @@
 
 typedef struct FrameStats FrameStats;
 
+static const struct {
+  GdkFrameClockPhase phase;
+  const char *description;
+  const char *column;
+} phases[] = {
+  { GDK_FRAME_CLOCK_PHASE_FLUSH_EVENTS,  "Flush events ", "flush_events" },
+  { GDK_FRAME_CLOCK_PHASE_BEFORE_PAINT,  "Before paint ", "before_paint" },
+  { GDK_FRAME_CLOCK_PHASE_UPDATE,        "Update       ", "update" },
+  { GDK_FRAME_CLOCK_PHASE_LAYOUT,        "Layout       ", "layout" },
+  { GDK_FRAME_CLOCK_PHASE_PAINT,         "Paint        ", "paint" },
+  { GDK_FRAME_CLOCK_PHASE_AFTER_PAINT,   "After paint  ", "after_paint" },
+  { GDK_FRAME_CLOCK_PHASE_RESUME_EVENTS, "Resume events", "resume_events" }
+};
+
+#define N_PHASES G_N_ELEMENTS (phases)
+
 struct FrameStats
 {
   GdkFrameClock *frame_clock;
@@ -15,8 +31,10 @@ struct FrameStats
   double last_print_time;
   int frames_since_last_print;
   gint64 last_handled_frame;
+  gint64 last_phases_frame;
 
   Variable latency;
+  Variable phase_time[N_PHASES];
 };
 
 static int max_stats = -1;
@@ -76,6 +94,7 @@ on_frame_clock_after_paint (GdkFrameClock *frame_clock,
 {
   gint64 frame_counter;
   gint64 current_time;
+  guint i;
 
   current_time = g_get_monotonic_time ();
   if (current_time >= frame_stats->last_print_time + 1000000 * statistics_time)
@@ -84,7 +103,10 @@ on_frame_clock_after_paint (GdkFrameClock *frame_clock,
         {
           if (frame_stats->num_stats == 0 && machine_readable)
             {
-              g_print ("# load_factor frame_rate latency\n");
+              g_print ("# load_factor frame_rate latency");
+              for (i = 0; i < N_PHASES; i++)
+                g_print (" %s", phases[i].column);
+              g_print ("\n");
             }
 
           frame_stats->num_stats++;
@@ -94,12 +116,17 @@ on_frame_clock_after_paint (GdkFrameClock *frame_clock,
 
           print_variable ("Latency", &frame_stats->latency);
 
+          for (i = 0; i < N_PHASES; i++)
+            print_variable (phases[i].description, &frame_stats->phase_time[i]);
+
           g_print ("\n");
         }
 
       frame_stats->last_print_time = current_time;
       frame_stats->frames_since_last_print = 0;
       variable_init (&frame_stats->latency);
+      for (i = 0; i < N_PHASES; i++)
+        variable_init (&frame_stats->phase_time[i]);
 
       if (frame_stats->num_stats == max_stats)
         gtk_main_quit ();
@@ -126,6 +153,20 @@ on_frame_clock_after_paint (GdkFrameClock *frame_clock,
 
           variable_add_weighted (&frame_stats->latency, frame_latency, display_time);
         }
+
+      /* Time spent in each phase, in milliseconds, for frames that ran it */
+      if (timings && gdk_frame_timings_get_complete (timings) &&
+          frame_counter > frame_stats->last_phases_frame)
+        {
+          frame_stats->last_phases_frame = frame_counter;
+
+          for (i = 0; i < N_PHASES; i++)
+            {
+              if (gdk_frame_timings_get_phase_start_time (timings, phases[i].phase) != 0)
+                variable_add (&frame_stats->phase_time[i],
+                              gdk_frame_timings_get_phase_duration (timings, phases[i].phase) / 1000.);
+            }
+        }
     }
 }
 
@@ -159,6 +200,7 @@ void
 frame_stats_ensure (GtkWindow *window)
 {
   FrameStats *frame_stats;
+  guint i;
 
   frame_stats = g_object_get_data (G_OBJECT (window), "frame-stats");
   if (frame_stats != NULL)
@@ -168,7 +210,10 @@ frame_stats_ensure (GtkWindow *window)
   g_object_set_data (G_OBJECT (window), "frame-stats", frame_stats);
 
   variable_init (&frame_stats->latency);
+  for (i = 0; i < N_PHASES; i++)
+    variable_init (&frame_stats->phase_time[i]);
   frame_stats->last_handled_frame = -1;
+  frame_stats->last_phases_frame = -1;
 
   g_signal_connect (window, "realize",
                     G_CALLBACK (on_window_realize), frame_stats);
@@ -0,0 +1,174 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Loads a large, log-like text into a GtkTextBuffer and prints how
+ * long that took and how much memory the buffer uses per megabyte
+ * of text.
+ *
+ * The text can be loaded with one gtk_text_buffer_set_text() call,
+ * with gtk_text_buffer_load_from_stream(), or one line at a time the
+ * way many applications do it, which doesn't use the bulk loading
+ * path of the text btree. Run it once per method, the memory numbers
+ * are only meaningful for the first load in a process.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+#include <unistd.h>
+
+static int size = 50;
+static char *method = NULL;
+
+static GOptionEntry options[] = {
+  { "size", 's', 0, G_OPTION_ARG_INT, &size, "Megabytes of text to load", "MB" },
+  { "method", 'm', 0, G_OPTION_ARG_STRING, &method, "How to load the text: set-text, stream or lines", "METHOD" },
+  { NULL }
+};
+
+static gchar *
+generate_text (gsize *length)
+{
+  GString *text;
+  gsize target = (gsize) size * 1024 * 1024;
+  guint i, j;
+
+  text = g_string_sized_new (target + 256);
+
+  for (i = 0; text->len < target; i++)
+    {
+      g_string_append_printf (text, "2014-10-%02u 12:%02u:%02u host daemon[%u]: ",
+                              1 + i % 28, i / 60 % 60, i % 60, 1000 + i % 5000);
+      for (j = 0; j < 4 + i % 11; j++)
+        g_string_append (text, j % 4 ? "request handled " : "connection from client ");
+      g_string_append_c (text, '\n');
+    }
+
+  *length = text->len;
+  return g_string_free (text, FALSE);
+}
+
+/* Resident memory in bytes, or 0 if we can't tell */
+static gsize
+get_resident_memory (void)
+{
+  gchar *contents;
+  gsize resident = 0;
+  gchar **fields;
+
+  if (!g_file_get_contents ("/proc/self/statm", &contents, NULL, NULL))
+    return 0;
+
+  fields = g_strsplit (contents, " ", 3);
+  if (fields[0] && fields[1])
+    resident = g_ascii_strtoull (fields[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+
+  g_strfreev (fields);
+  g_free (contents);
+
+  return resident;
+}
+
+static void
+load_set_text (GtkTextBuffer *buffer,
+               const gchar   *text,
+               gsize          length)
+{
+  gtk_text_buffer_set_text (buffer, text, length);
+}
+
+static void
+load_stream (GtkTextBuffer *buffer,
+             const gchar   *text,
+             gsize          length)
+{
+  GInputStream *stream;
+  GError *error = NULL;
+
+  stream = g_memory_input_stream_new_from_data (text, length, NULL);
+  if (!gtk_text_buffer_load_from_stream (buffer, stream, NULL, &error))
+    g_error ("Loading failed: %s", error->message);
+  g_object_unref (stream);
+}
+
+static void
+load_lines (GtkTextBuffer *buffer,
+            const gchar   *text,
+            gsize          length)
+{
+  const gchar *line, *end;
+  GtkTextIter iter;
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+
+  for (line = text; line < text + length; line = end + 1)
+    {
+      end = memchr (line, '\n', text + length - line);
+      if (end == NULL)
+        end = text + length - 1;
+
+      gtk_text_buffer_insert (buffer, &iter, line, end + 1 - line);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  void (* load) (GtkTextBuffer *, const gchar *, gsize);
+  GOptionContext *context;
+  GError *error = NULL;
+  GtkTextBuffer *buffer;
+  gchar *text;
+  gsize length, memory_before, memory_after;
+  gint64 start, elapsed;
+  gdouble megabytes;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+  g_option_context_free (context);
+
+  if (method == NULL || g_str_equal (method, "set-text"))
+    load = load_set_text;
+  else if (g_str_equal (method, "stream"))
+    load = load_stream;
+  else if (g_str_equal (method, "lines"))
+    load = load_lines;
+  else
+    {
+      g_printerr ("Unknown method %s\n", method);
+      return 1;
+    }
+
+  text = generate_text (&length);
+  megabytes = length / (1024. * 1024.);
+
+  buffer = gtk_text_buffer_new (NULL);
+
+  memory_before = get_resident_memory ();
+  start = g_get_monotonic_time ();
+
+  load (buffer, text, length);
+
+  elapsed = g_get_monotonic_time () - start;
+  memory_after = get_resident_memory ();
+
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==, g_utf8_strlen (text, length));
+
+  g_print ("%s: %.1f MB, %d lines in %.2f s (%.1f MB/s)",
+           method ? method : "set-text", megabytes,
+           gtk_text_buffer_get_line_count (buffer),
+           elapsed / (double) G_USEC_PER_SEC,
+           megabytes * G_USEC_PER_SEC / elapsed);
+  if (memory_before > 0)
+    g_print (", %.2f MB of memory per MB of text",
+             (memory_after - memory_before) / (1024. * 1024.) / megabytes);
+  g_print ("\n");
+
+  g_object_unref (buffer);
+  g_free (text);
+
+  return 0;
+}
@@ -0,0 +1,160 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Scrolls a text view with many lines up and down by a few lines
+ * every frame, and prints how long drawing the text view took
+ * along with the frame statistics. */
+
+#include <gtk/gtk.h>
+#include <math.h>
+
+#include "frame-stats.h"
+#include "variable.h"
+
+static int n_lines = 100000;
+static gboolean wrap = FALSE;
+static double scroll_speed = 2.;
+
+static gint64 draw_start;
+static Variable draw_time;
+static double last_print_time;
+
+static GOptionEntry options[] = {
+  { "lines", 'l', 0, G_OPTION_ARG_INT, &n_lines, "Number of lines in the buffer", "N" },
+  { "wrap", 'w', 0, G_OPTION_ARG_NONE, &wrap, "Wrap lines", NULL },
+  { "speed", 0, 0, G_OPTION_ARG_DOUBLE, &scroll_speed, "Lines scrolled per frame at most", "LINES" },
+  { NULL }
+};
+
+static void
+fill_buffer (GtkTextBuffer *buffer)
+{
+  GString *text;
+  GtkTextIter iter;
+  int i, j;
+
+  text = g_string_new ("");
+
+  for (i = 0; i < n_lines; i++)
+    {
+      g_string_append_printf (text, "%06d ", i);
+      for (j = 0; j < 8 + i % 5; j++)
+        g_string_append (text, j % 3 ? "lorem ipsum " : "dolor sit amet ");
+      g_string_append_c (text, '\n');
+    }
+
+  gtk_text_buffer_get_end_iter (buffer, &iter);
+  gtk_text_buffer_insert (buffer, &iter, text->str, text->len);
+  g_string_free (text, TRUE);
+}
+
+static gboolean
+scroll_text_view (GtkWidget     *text_view,
+                  GdkFrameClock *frame_clock,
+                  gpointer       user_data)
+{
+  static gint64 start_time;
+  gint64 now = gdk_frame_clock_get_frame_time (frame_clock);
+  GtkAdjustment *vadjustment;
+  gdouble elapsed, line_height, value;
+
+  if (start_time == 0)
+    start_time = now;
+
+  elapsed = (now - start_time) / 1000000.;
+
+  vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (text_view));
+  line_height = gtk_adjustment_get_step_increment (vadjustment);
+  if (line_height <= 0)
+    return G_SOURCE_CONTINUE;
+
+  /* Go back and forth over a few screenfuls in the middle, the
+   * way one reads through a log, at most scroll_speed lines per
+   * frame at 60 frames per second */
+  value = gtk_adjustment_get_upper (vadjustment) / 2 +
+          sin (elapsed) * scroll_speed * 60 * line_height;
+  gtk_adjustment_set_value (vadjustment, value);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+draw_before (GtkWidget *widget,
+             cairo_t   *cr,
+             gpointer   user_data)
+{
+  draw_start = g_get_monotonic_time ();
+
+  return FALSE;
+}
+
+static gboolean
+draw_after (GtkWidget *widget,
+            cairo_t   *cr,
+            gpointer   user_data)
+{
+  double now = g_get_monotonic_time () / 1000000.;
+
+  variable_add (&draw_time, (g_get_monotonic_time () - draw_start) / 1000.);
+
+  if (last_print_time == 0)
+    last_print_time = now;
+  else if (now - last_print_time > 5.)
+    {
+      g_print ("text view draw time (ms): %g +/- %g\n",
+               variable_mean (&draw_time),
+               variable_standard_deviation (&draw_time));
+      variable_reset (&draw_time);
+      last_print_time = now;
+    }
+
+  return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window;
+  GtkWidget *scrolled_window;
+  GtkWidget *text_view;
+  GError *error = NULL;
+
+  GOptionContext *context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  frame_stats_add_options (g_option_context_get_main_group (context));
+  g_option_context_add_group (context,
+                              gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  frame_stats_ensure (GTK_WINDOW (window));
+  gtk_window_set_default_size (GTK_WINDOW (window), 800, 600);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+
+  text_view = gtk_text_view_new ();
+  gtk_text_view_set_wrap_mode (GTK_TEXT_VIEW (text_view),
+                               wrap ? GTK_WRAP_WORD_CHAR : GTK_WRAP_NONE);
+  fill_buffer (gtk_text_view_get_buffer (GTK_TEXT_VIEW (text_view)));
+  gtk_container_add (GTK_CONTAINER (scrolled_window), text_view);
+
+  g_signal_connect (text_view, "draw", G_CALLBACK (draw_before), NULL);
+  g_signal_connect_after (text_view, "draw", G_CALLBACK (draw_after), NULL);
+
+  gtk_widget_add_tick_callback (text_view,
+                                scroll_text_view,
+                                NULL,
+                                NULL);
+
+  gtk_widget_show_all (window);
+  g_signal_connect (window, "destroy",
+                    G_CALLBACK (gtk_main_quit), NULL);
+  gtk_main ();
+
+  return 0;
+}
@@ -0,0 +1,158 @@
+/* -*- mode: C; c-basic-offset: 2; indent-tabs-mode: nil; -*- */
+
+/* Sets a GtkListStore with many rows as the model of a shown tree
+ * view and prints how long setting the model took and how long it
+ * took until the first frame with the rows was drawn.
+ *
+ * Run it with --rows 1000000 and --rows 5000000 to see how attaching
+ * big models scales, and with --fixed-height to compare with
+ * fixed-height mode.
+ */
+
+#include <gtk/gtk.h>
+
+static int n_rows = 1000000;
+static gboolean fixed_height = FALSE;
+
+static GtkWidget *tree_view;
+static GtkListStore *store;
+static gint64 start_time;
+static gint64 set_model_time;
+
+static GOptionEntry options[] = {
+  { "rows", 'r', 0, G_OPTION_ARG_INT, &n_rows, "Number of rows in the model", "N" },
+  { "fixed-height", 'f', 0, G_OPTION_ARG_NONE, &fixed_height, "Use fixed-height mode", NULL },
+  { NULL }
+};
+
+static GtkListStore *
+create_store (void)
+{
+  GtkListStore *list_store;
+  int i;
+
+  list_store = gtk_list_store_new (2, G_TYPE_INT, G_TYPE_STRING);
+
+  for (i = 0; i < n_rows; i++)
+    gtk_list_store_insert_with_values (list_store, NULL, -1,
+                                       0, i,
+                                       1, i % 3 ? "regular row" : "a somewhat longer row",
+                                       -1);
+
+  return list_store;
+}
+
+static gboolean
+set_model (gpointer data)
+{
+  start_time = g_get_monotonic_time ();
+  gtk_tree_view_set_model (GTK_TREE_VIEW (tree_view), GTK_TREE_MODEL (store));
+  set_model_time = g_get_monotonic_time () - start_time;
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+on_after_paint (GdkFrameClock *frame_clock,
+                gpointer       data)
+{
+  static gboolean model_set = FALSE;
+  gint64 first_frame_time;
+
+  if (!model_set)
+    {
+      /* The window is up, now time attaching the model */
+      g_idle_add (set_model, NULL);
+      model_set = TRUE;
+      return;
+    }
+
+  if (start_time == 0)
+    return;
+
+  first_frame_time = g_get_monotonic_time () - start_time;
+
+  g_print ("%d rows%s: model set in %.3f s, first frame after %.3f s\n",
+           n_rows, fixed_height ? " (fixed height)" : "",
+           set_model_time / (double) G_USEC_PER_SEC,
+           first_frame_time / (double) G_USEC_PER_SEC);
+
+  g_signal_handlers_disconnect_by_func (frame_clock, on_after_paint, data);
+  gtk_main_quit ();
+}
+
+static void
+on_realize (GtkWidget *widget,
+            gpointer   data)
+{
+  g_signal_connect (gtk_widget_get_frame_clock (widget), "after-paint",
+                    G_CALLBACK (on_after_paint), NULL);
+}
+
+int
+main (int argc, char **argv)
+{
+  GtkWidget *window;
+  GtkWidget *scrolled_window;
+  GtkCellRenderer *renderer;
+  GError *error = NULL;
+  gint64 start;
+
+  GOptionContext *context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, options, NULL);
+  g_option_context_add_group (context,
+                              gtk_get_option_group (TRUE));
+
+  if (!g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("Option parsing failed: %s\n", error->message);
+      return 1;
+    }
+
+  start = g_get_monotonic_time ();
+  store = create_store ();
+  g_print ("%d rows created in %.3f s\n", n_rows,
+           (g_get_monotonic_time () - start) / (double) G_USEC_PER_SEC);
+
+  window = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+  gtk_window_set_default_size (GTK_WINDOW (window), 600, 800);
+
+  scrolled_window = gtk_scrolled_window_new (NULL, NULL);
+  gtk_container_add (GTK_CONTAINER (window), scrolled_window);
+
+  tree_view = gtk_tree_view_new ();
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (tree_view), -1,
+                                               "Number", renderer,
+                                               "text", 0,
+                                               NULL);
+  renderer = gtk_cell_renderer_text_new ();
+  gtk_tree_view_insert_column_with_attributes (GTK_TREE_VIEW (tree_view), -1,
+                                               "Text", renderer,
+                                               "text", 1,
+                                               NULL);
+  if (fixed_height)
+    {
+      GList *columns, *l;
+
+      columns = gtk_tree_view_get_columns (GTK_TREE_VIEW (tree_view));
+      for (l = columns; l; l = l->next)
+        {
+          gtk_tree_view_column_set_sizing (l->data, GTK_TREE_VIEW_COLUMN_FIXED);
+          gtk_tree_view_column_set_fixed_width (l->data, 200);
+        }
+      g_list_free (columns);
+
+      gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (tree_view), TRUE);
+    }
+  gtk_container_add (GTK_CONTAINER (scrolled_window), tree_view);
+
+  g_signal_connect (tree_view, "realize", G_CALLBACK (on_realize), NULL);
+
+  gtk_widget_show_all (window);
+  g_signal_connect (window, "destroy",
+                    G_CALLBACK (gtk_main_quit), NULL);
+  gtk_main ();
+
+  return 0;
+}
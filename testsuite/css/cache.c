@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <utime.h>
+
+#include "gtk/gtkcssproviderprivate.h"
+
+static const char main_css[] =
+  "@import url(\"imported.css\");\n"
+  "\n"
+  "@define-color main_color #102030;\n"
+  "@define-color derived_color shade(@main_color, 1.2);\n"
+  "\n"
+  "@keyframes pulse {\n"
+  "  from { opacity: 0.5; }\n"
+  "  to { opacity: 1.0; }\n"
+  "}\n"
+  "\n"
+  "* {\n"
+  "  color: @main_color;\n"
+  "  -GtkWidget-focus-line-width: 2;\n"
+  "}\n"
+  "\n"
+  "GtkButton:hover, GtkLabel.title {\n"
+  "  background-color: @derived_color;\n"
+  "  animation: pulse 1s infinite;\n"
+  "}\n"
+  "\n"
+  "GtkBox > GtkEntry:focus {\n"
+  "  border-width: 1px 2px;\n"
+  "  padding: 3px;\n"
+  "}\n";
+
+static const char imported_css[] =
+  "GtkWindow {\n"
+  "  background-color: #ff0000;\n"
+  "}\n"
+  "\n"
+  "#name .class:backdrop {\n"
+  "  font: Sans 12;\n"
+  "}\n";
+
+/* The same size as imported_css */
+static const char changed_css[] =
+  "GtkWindow {\n"
+  "  background-color: #00ff00;\n"
+  "}\n"
+  "\n"
+  "#name .class:backdrop {\n"
+  "  font: Sans 14;\n"
+  "}\n";
+
+static char *
+load_to_string (const char *path)
+{
+  GtkCssProvider *provider;
+  GError *error = NULL;
+  char *result;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_path (provider, path, &error);
+  g_assert_no_error (error);
+
+  result = gtk_css_provider_to_string (provider);
+  g_object_unref (provider);
+
+  return result;
+}
+
+static void
+write_file (const char *path,
+            const char *contents,
+            gssize      length)
+{
+  GError *error = NULL;
+
+  g_file_set_contents (path, contents, length, &error);
+  g_assert_no_error (error);
+}
+
+static void
+compile (const char *path,
+         const char *cache_path)
+{
+  GError *error = NULL;
+  GBytes *bytes;
+  GFile *file;
+
+  file = g_file_new_for_path (path);
+  bytes = _gtk_css_provider_compile (file, &error);
+  g_assert_no_error (error);
+  g_object_unref (file);
+
+  write_file (cache_path, g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+  g_bytes_unref (bytes);
+}
+
+static void
+test_round_trip (void)
+{
+  char *dir, *path, *imported_path, *cache_path, *contents;
+  char *uncached, *cached, *expected;
+  struct utimbuf times;
+  GStatBuf st;
+  gsize length;
+
+  dir = g_dir_make_tmp ("css-cache-XXXXXX", NULL);
+  g_assert (dir != NULL);
+  path = g_build_filename (dir, "main.css", NULL);
+  imported_path = g_build_filename (dir, "imported.css", NULL);
+  cache_path = g_strconcat (path, ".cache", NULL);
+
+  write_file (path, main_css, -1);
+  write_file (imported_path, imported_css, -1);
+
+  uncached = load_to_string (path);
+
+  /* Loading from the cache gives the same style sheet */
+  compile (path, cache_path);
+  cached = load_to_string (path);
+  g_assert_cmpstr (cached, ==, uncached);
+  g_free (cached);
+
+  /* An import that changed within the same second, keeping its size,
+   * makes the cache stale */
+  g_assert_cmpint (g_stat (imported_path, &st), ==, 0);
+  write_file (imported_path, changed_css, -1);
+  times.actime = st.st_atime;
+  times.modtime = st.st_mtime;
+  g_assert_cmpint (g_utime (imported_path, &times), ==, 0);
+
+  g_unlink (cache_path);
+  expected = load_to_string (path);
+  g_assert_cmpstr (expected, !=, uncached);
+
+  write_file (imported_path, imported_css, -1);
+  compile (path, cache_path);
+  write_file (imported_path, changed_css, -1);
+  g_assert_cmpint (g_utime (imported_path, &times), ==, 0);
+
+  cached = load_to_string (path);
+  g_assert_cmpstr (cached, ==, expected);
+  g_free (cached);
+
+  /* A truncated cache is ignored */
+  compile (path, cache_path);
+  g_file_get_contents (cache_path, &contents, &length, NULL);
+  write_file (cache_path, contents, length / 2);
+
+  cached = load_to_string (path);
+  g_assert_cmpstr (cached, ==, expected);
+  g_free (cached);
+
+  /* So is garbage of the right size */
+  memset (contents, 0xa5, length);
+  write_file (cache_path, contents, length);
+  g_free (contents);
+
+  cached = load_to_string (path);
+  g_assert_cmpstr (cached, ==, expected);
+  g_free (cached);
+
+  g_unlink (cache_path);
+  g_unlink (imported_path);
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (uncached);
+  g_free (expected);
+  g_free (cache_path);
+  g_free (imported_path);
+  g_free (path);
+  g_free (dir);
+}
+
+/* With GTK_CSS_DEBUG set, sections are kept, so the
+ * cache must not be used */
+static void
+test_sections (void)
+{
+  GtkStyleContext *context;
+  GtkCssProvider *provider;
+  GtkWidgetPath *widget_path;
+  GtkCssSection *section;
+  char *dir, *path, *imported_path, *cache_path, *basename;
+
+  if (!g_test_subprocess ())
+    {
+      g_setenv ("GTK_CSS_DEBUG", "1", TRUE);
+      g_test_trap_subprocess (NULL, 0, 0);
+      g_unsetenv ("GTK_CSS_DEBUG");
+      g_test_trap_assert_passed ();
+      return;
+    }
+
+  dir = g_dir_make_tmp ("css-cache-XXXXXX", NULL);
+  g_assert (dir != NULL);
+  path = g_build_filename (dir, "main.css", NULL);
+  imported_path = g_build_filename (dir, "imported.css", NULL);
+  cache_path = g_strconcat (path, ".cache", NULL);
+
+  write_file (path, main_css, -1);
+  write_file (imported_path, imported_css, -1);
+  compile (path, cache_path);
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_path (provider, path, NULL);
+
+  widget_path = gtk_widget_path_new ();
+  gtk_widget_path_append_type (widget_path, GTK_TYPE_WINDOW);
+  context = gtk_style_context_new ();
+  gtk_style_context_set_path (context, widget_path);
+  gtk_style_context_add_provider (context, GTK_STYLE_PROVIDER (provider),
+                                  GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  section = gtk_style_context_get_section (context, "background-color");
+  g_assert (section != NULL);
+  basename = g_file_get_basename (gtk_css_section_get_file (section));
+  g_assert_cmpstr (basename, ==, "imported.css");
+  g_free (basename);
+
+  g_object_unref (context);
+  gtk_widget_path_unref (widget_path);
+  g_object_unref (provider);
+
+  g_unlink (cache_path);
+  g_unlink (imported_path);
+  g_unlink (path);
+  g_rmdir (dir);
+
+  g_free (cache_path);
+  g_free (imported_path);
+  g_free (path);
+  g_free (dir);
+}
+
+int
+main (int argc, char *argv[])
+{
+  gtk_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/css/cache/round-trip", test_round_trip);
+  g_test_add_func ("/css/cache/sections", test_sections);
+
+  return g_test_run ();
+}
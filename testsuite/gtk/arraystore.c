@@ -0,0 +1,724 @@
+/* GtkArrayStore tests.
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+
+#include "treemodel.h"
+
+enum {
+  COLUMN_INT,
+  COLUMN_STRING,
+  COLUMN_DOUBLE,
+  N_COLUMNS
+};
+
+static const gint ints[] = { 30, 40, 10, 20, 60 };
+static const gchar *strings[] = { "bravo", "delta", "alpha", NULL, "charlie" };
+static const gdouble doubles[] = { 0.5, 1.5, -2.0, 3.25, 0.0 };
+
+static GtkArrayStore *
+create_store (void)
+{
+  GtkArrayStore *store;
+
+  store = gtk_array_store_new (N_COLUMNS,
+                               G_TYPE_INT, G_TYPE_STRING, G_TYPE_DOUBLE);
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (ints),
+                               COLUMN_INT, ints,
+                               COLUMN_STRING, strings,
+                               COLUMN_DOUBLE, doubles,
+                               -1);
+
+  return store;
+}
+
+static void
+check_row (GtkArrayStore *store,
+           gint           row,
+           gint           original_row)
+{
+  GtkTreeIter iter;
+  gint i;
+  gchar *s;
+  gdouble d;
+
+  g_assert (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, row));
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+                      COLUMN_INT, &i,
+                      COLUMN_STRING, &s,
+                      COLUMN_DOUBLE, &d,
+                      -1);
+
+  g_assert_cmpint (i, ==, ints[original_row]);
+  g_assert_cmpstr (s, ==, strings[original_row]);
+  g_assert_cmpfloat (d, ==, doubles[original_row]);
+
+  g_free (s);
+}
+
+static void
+array_store_test_append_rows (void)
+{
+  GtkArrayStore *store;
+  SignalMonitor *monitor;
+  gint more_ints[] = { 1, 2, 3 };
+  gint i;
+
+  store = create_store ();
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 5);
+  for (i = 0; i < 5; i++)
+    check_row (store, i, i);
+
+  monitor = signal_monitor_new (GTK_TREE_MODEL (store));
+  signal_monitor_append_signal (monitor, ROW_INSERTED, "5");
+  signal_monitor_append_signal (monitor, ROW_INSERTED, "6");
+  signal_monitor_append_signal (monitor, ROW_INSERTED, "7");
+
+  gtk_array_store_append_rows (store, 3, COLUMN_INT, more_ints, -1);
+
+  signal_monitor_assert_is_empty (monitor);
+  signal_monitor_free (monitor);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 8);
+  for (i = 5; i < 8; i++)
+    {
+      GtkTreeIter iter;
+      gint value;
+      gchar *s;
+
+      gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, i);
+      gtk_tree_model_get (GTK_TREE_MODEL (store), &iter,
+                          COLUMN_INT, &value,
+                          COLUMN_STRING, &s,
+                          -1);
+      g_assert_cmpint (value, ==, more_ints[i - 5]);
+      g_assert (s == NULL);
+    }
+
+  g_object_unref (store);
+}
+
+static void
+array_store_test_set_rows (void)
+{
+  GtkArrayStore *store;
+  SignalMonitor *monitor;
+  const gchar *new_strings[] = { "x-ray", "yankee" };
+  GtkTreeIter iter;
+  gchar *s;
+
+  store = create_store ();
+
+  monitor = signal_monitor_new (GTK_TREE_MODEL (store));
+  signal_monitor_append_signal (monitor, ROW_CHANGED, "2");
+  signal_monitor_append_signal (monitor, ROW_CHANGED, "3");
+
+  gtk_array_store_set_rows (store, 2, 2, COLUMN_STRING, new_strings, -1);
+
+  signal_monitor_assert_is_empty (monitor);
+  signal_monitor_free (monitor);
+
+  gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, 3);
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_STRING, &s, -1);
+  g_assert_cmpstr (s, ==, "yankee");
+  g_free (s);
+
+  check_row (store, 1, 1);
+  check_row (store, 4, 4);
+
+  g_object_unref (store);
+}
+
+static void
+array_store_test_insert_remove (void)
+{
+  GtkArrayStore *store;
+  GtkTreeIter iter;
+  gint value;
+
+  store = create_store ();
+
+  gtk_array_store_insert (store, &iter, 1);
+  g_assert (gtk_array_store_iter_is_valid (store, &iter));
+  gtk_array_store_set (store, &iter, COLUMN_INT, 99, -1);
+
+  gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, 1);
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_INT, &value, -1);
+  g_assert_cmpint (value, ==, 99);
+  check_row (store, 0, 0);
+  check_row (store, 2, 1);
+
+  g_assert (gtk_array_store_remove (store, &iter));
+  check_row (store, 1, 1);
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_INT, &value, -1);
+  g_assert_cmpint (value, ==, ints[1]);
+
+  gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, 4);
+  g_assert (!gtk_array_store_remove (store, &iter));
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 4);
+
+  gtk_array_store_clear (store);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 0);
+  g_assert (!gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter));
+
+  g_object_unref (store);
+}
+
+static void
+array_store_test_sort (void)
+{
+  GtkArrayStore *store;
+  SignalMonitor *monitor;
+  GtkTreePath *path;
+  int ascending[] = { 2, 3, 0, 1, 4 };
+  int descending[] = { 4, 3, 2, 1, 0 };
+  int by_string[] = { 3, 2, 0, 4, 1 };
+  int from_descending[] = { 3, 4, 2, 0, 1 };
+  gint i;
+
+  store = create_store ();
+  monitor = signal_monitor_new (GTK_TREE_MODEL (store));
+  path = gtk_tree_path_new ();
+
+  signal_monitor_append_signal_reordered (monitor, ROWS_REORDERED,
+                                          path, ascending, 5);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        COLUMN_INT, GTK_SORT_ASCENDING);
+  signal_monitor_assert_is_empty (monitor);
+  for (i = 0; i < 5; i++)
+    check_row (store, i, ascending[i]);
+
+  signal_monitor_append_signal_reordered (monitor, ROWS_REORDERED,
+                                          path, descending, 5);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        COLUMN_INT, GTK_SORT_DESCENDING);
+  signal_monitor_assert_is_empty (monitor);
+
+  /* A NULL string sorts like an empty one */
+  signal_monitor_append_signal_reordered (monitor, ROWS_REORDERED,
+                                          path, from_descending, 5);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        COLUMN_STRING, GTK_SORT_ASCENDING);
+  signal_monitor_assert_is_empty (monitor);
+  for (i = 0; i < 5; i++)
+    check_row (store, i, by_string[i]);
+
+  gtk_tree_path_free (path);
+  signal_monitor_free (monitor);
+  g_object_unref (store);
+}
+
+static void
+array_store_test_sort_set_value (void)
+{
+  GtkArrayStore *store;
+  GtkTreeIter iter;
+  GtkTreePath *path;
+  gint value;
+
+  store = create_store ();
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        COLUMN_INT, GTK_SORT_ASCENDING);
+
+  /* 10 20 30 40 60: move 20 to the end, the iter has to follow it */
+  gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, 1);
+  gtk_array_store_set (store, &iter, COLUMN_INT, 50, -1);
+
+  path = gtk_tree_model_get_path (GTK_TREE_MODEL (store), &iter);
+  g_assert_cmpint (gtk_tree_path_get_indices (path)[0], ==, 3);
+  gtk_tree_path_free (path);
+
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_INT, &value, -1);
+  g_assert_cmpint (value, ==, 50);
+
+  /* Appended rows are sorted into place */
+  value = 0;
+  gtk_array_store_append_rows (store, 1, COLUMN_INT, &value, -1);
+  gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter);
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_INT, &value, -1);
+  g_assert_cmpint (value, ==, 0);
+
+  g_object_unref (store);
+}
+
+static gint
+compare_doubles (GtkTreeModel *model,
+                 GtkTreeIter  *a,
+                 GtkTreeIter  *b,
+                 gpointer      data)
+{
+  gdouble da, db;
+
+  gtk_tree_model_get (model, a, COLUMN_DOUBLE, &da, -1);
+  gtk_tree_model_get (model, b, COLUMN_DOUBLE, &db, -1);
+
+  return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+static void
+array_store_test_sort_func (void)
+{
+  GtkArrayStore *store;
+  int by_double[] = { 2, 4, 0, 1, 3 };
+  gint i;
+
+  store = create_store ();
+
+  gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (store), COLUMN_INT,
+                                   compare_doubles, NULL, NULL);
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store),
+                                        COLUMN_INT, GTK_SORT_ASCENDING);
+  for (i = 0; i < 5; i++)
+    check_row (store, i, by_double[i]);
+
+  g_object_unref (store);
+}
+
+static void
+array_store_test_objects (void)
+{
+  GtkArrayStore *store;
+  GObject *objects[2];
+  GObject *object;
+  GtkTreeIter iter;
+
+  objects[0] = g_object_new (G_TYPE_OBJECT, NULL);
+  objects[1] = g_object_new (G_TYPE_OBJECT, NULL);
+
+  store = gtk_array_store_new (1, G_TYPE_OBJECT);
+  gtk_array_store_append_rows (store, 2, 0, objects, -1);
+  g_assert_cmpint (objects[0]->ref_count, ==, 2);
+  g_assert_cmpint (objects[1]->ref_count, ==, 2);
+
+  gtk_tree_model_get_iter_first (GTK_TREE_MODEL (store), &iter);
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, 0, &object, -1);
+  g_assert (object == objects[0]);
+  g_object_unref (object);
+
+  gtk_array_store_set (store, &iter, 0, objects[1], -1);
+  g_assert_cmpint (objects[0]->ref_count, ==, 1);
+  g_assert_cmpint (objects[1]->ref_count, ==, 3);
+
+  gtk_array_store_remove (store, &iter);
+  g_assert_cmpint (objects[1]->ref_count, ==, 2);
+
+  g_object_unref (store);
+  g_assert_cmpint (objects[1]->ref_count, ==, 1);
+
+  g_object_unref (objects[0]);
+  g_object_unref (objects[1]);
+}
+
+typedef struct
+{
+  gint n_emissions;
+  gchar *path;
+  gint n_rows;
+} RangeSignal;
+
+static void
+rows_inserted_cb (GtkTreeModel *model,
+                  GtkTreePath  *path,
+                  GtkTreeIter  *iter,
+                  gint          n_rows,
+                  RangeSignal  *signal)
+{
+  signal->n_emissions++;
+  g_free (signal->path);
+  signal->path = gtk_tree_path_to_string (path);
+  signal->n_rows = n_rows;
+}
+
+static void
+rows_deleted_cb (GtkTreeModel *model,
+                 GtkTreePath  *path,
+                 gint          n_rows,
+                 RangeSignal  *signal)
+{
+  signal->n_emissions++;
+  g_free (signal->path);
+  signal->path = gtk_tree_path_to_string (path);
+  signal->n_rows = n_rows;
+}
+
+static void
+row_inserted_cb (GtkTreeModel *model,
+                 GtkTreePath  *path,
+                 GtkTreeIter  *iter,
+                 gint         *count)
+{
+  (*count)++;
+}
+
+static void
+array_store_test_rows_inserted (void)
+{
+  GtkArrayStore *store;
+  RangeSignal signal = { 0, };
+  gint more_ints[] = { 1, 2, 3 };
+  gint n_row_inserted = 0;
+  gulong id;
+
+  store = create_store ();
+  g_signal_connect (store, "rows-inserted",
+                    G_CALLBACK (rows_inserted_cb), &signal);
+
+  /* Nobody needs single rows, so one signal is enough */
+  gtk_array_store_append_rows (store, 3, COLUMN_INT, more_ints, -1);
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpstr (signal.path, ==, "5");
+  g_assert_cmpint (signal.n_rows, ==, 3);
+
+  /* Somebody listening to row-inserted gets every row */
+  id = g_signal_connect (store, "row-inserted",
+                         G_CALLBACK (row_inserted_cb), &n_row_inserted);
+  gtk_array_store_append_rows (store, 3, COLUMN_INT, more_ints, -1);
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpint (n_row_inserted, ==, 3);
+
+  g_signal_handler_disconnect (store, id);
+  gtk_array_store_append_rows (store, 2, COLUMN_INT, more_ints, -1);
+  g_assert_cmpint (signal.n_emissions, ==, 2);
+  g_assert_cmpstr (signal.path, ==, "11");
+  g_assert_cmpint (signal.n_rows, ==, 2);
+  g_assert_cmpint (n_row_inserted, ==, 3);
+
+  g_free (signal.path);
+  g_object_unref (store);
+}
+
+/* How a view outside of GTK+ gets the range signals */
+static void
+array_store_test_handles_ranges (void)
+{
+  GtkArrayStore *store;
+  RangeSignal signal = { 0, };
+  gint more_ints[] = { 1, 2, 3 };
+  gint n_row_inserted = 0;
+  gulong id;
+
+  store = create_store ();
+  id = g_signal_connect (store, "row-inserted",
+                         G_CALLBACK (row_inserted_cb), &n_row_inserted);
+  g_assert (gtk_tree_model_needs_row_inserted (GTK_TREE_MODEL (store)));
+
+  g_signal_connect (store, "rows-inserted",
+                    G_CALLBACK (rows_inserted_cb), &signal);
+  gtk_tree_model_handles_ranges (GTK_TREE_MODEL (store), id);
+  g_assert (!gtk_tree_model_needs_row_inserted (GTK_TREE_MODEL (store)));
+
+  gtk_array_store_append_rows (store, 3, COLUMN_INT, more_ints, -1);
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpint (signal.n_rows, ==, 3);
+  g_assert_cmpint (n_row_inserted, ==, 0);
+
+  /* Single rows still come as ::row-inserted */
+  gtk_array_store_append_rows (store, 1, COLUMN_INT, more_ints, -1);
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpint (n_row_inserted, ==, 1);
+
+  g_free (signal.path);
+  g_object_unref (store);
+}
+
+static void
+array_store_test_rows_deleted (void)
+{
+  GtkArrayStore *store;
+  GtkTreeRowReference *ref;
+  GtkTreePath *path;
+  RangeSignal signal = { 0, };
+
+  store = create_store ();
+  g_signal_connect (store, "rows-deleted",
+                    G_CALLBACK (rows_deleted_cb), &signal);
+
+  path = gtk_tree_path_new_from_indices (2, -1);
+  ref = gtk_tree_row_reference_new (GTK_TREE_MODEL (store), path);
+  gtk_tree_path_free (path);
+
+  gtk_array_store_clear (store);
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpstr (signal.path, ==, "0");
+  g_assert_cmpint (signal.n_rows, ==, 5);
+  g_assert (!gtk_tree_row_reference_valid (ref));
+
+  gtk_tree_row_reference_free (ref);
+  g_free (signal.path);
+  g_object_unref (store);
+}
+
+static void
+array_store_test_rows_inserted_replay (void)
+{
+  GtkListStore *store;
+  GtkTreeRowReference *ref;
+  GtkTreePath *path;
+  GtkTreeIter iter;
+  RangeSignal signal = { 0, };
+  gint n_row_inserted = 0;
+  gint i;
+
+  store = gtk_list_store_new (1, G_TYPE_INT);
+  for (i = 0; i < 5; i++)
+    gtk_list_store_insert_with_values (store, NULL, -1, 0, i, -1);
+
+  path = gtk_tree_path_new_from_indices (1, -1);
+  ref = gtk_tree_row_reference_new (GTK_TREE_MODEL (store), path);
+  gtk_tree_path_free (path);
+
+  g_signal_connect (store, "rows-inserted",
+                    G_CALLBACK (rows_inserted_cb), &signal);
+  g_signal_connect (store, "row-inserted",
+                    G_CALLBACK (row_inserted_cb), &n_row_inserted);
+
+  /* Pretend the first three rows were just inserted */
+  path = gtk_tree_path_new_first ();
+  gtk_tree_model_get_iter (GTK_TREE_MODEL (store), &iter, path);
+  gtk_tree_model_rows_inserted (GTK_TREE_MODEL (store), path, &iter, 3);
+
+  g_assert_cmpint (signal.n_emissions, ==, 1);
+  g_assert_cmpint (signal.n_rows, ==, 3);
+  g_assert_cmpint (n_row_inserted, ==, 3);
+
+  /* The row reference is only moved once */
+  gtk_tree_path_free (path);
+  path = gtk_tree_row_reference_get_path (ref);
+  g_assert_cmpint (gtk_tree_path_get_indices (path)[0], ==, 4);
+
+  gtk_tree_path_free (path);
+  gtk_tree_row_reference_free (ref);
+  g_free (signal.path);
+  g_object_unref (store);
+}
+
+/* A handler that doesn't know about ranges counts on the model
+ * growing by one row for each signal */
+static void
+row_inserted_check_cb (GtkTreeModel *model,
+                       GtkTreePath  *path,
+                       GtkTreeIter  *iter,
+                       gint         *n_rows)
+{
+  (*n_rows)++;
+  g_assert_cmpint (gtk_tree_model_iter_n_children (model, NULL), ==, *n_rows);
+}
+
+static void
+array_store_test_row_inserted_legacy (void)
+{
+  GtkArrayStore *store;
+  GtkTreeModel *sort, *sort_built;
+  gint values[] = { 5, 1, 4, 2, 3 };
+  gint n_store_rows, n_sort_rows, n_sort_built_rows;
+  GtkTreeIter iter;
+
+  store = create_store ();
+  n_store_rows = gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL);
+  g_signal_connect (store, "row-inserted",
+                    G_CALLBACK (row_inserted_check_cb), &n_store_rows);
+
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (values),
+                               COLUMN_INT, values, -1);
+  g_assert_cmpint (n_store_rows, ==, 10);
+  g_signal_handlers_disconnect_by_func (store, row_inserted_check_cb, &n_store_rows);
+
+  /* A sort model that hasn't built its root level yet */
+  sort = gtk_tree_model_sort_new_with_model (GTK_TREE_MODEL (store));
+  n_sort_rows = 10;
+  g_signal_connect (sort, "row-inserted",
+                    G_CALLBACK (row_inserted_check_cb), &n_sort_rows);
+
+  /* And a sorted one that has */
+  sort_built = gtk_tree_model_sort_new_with_model (GTK_TREE_MODEL (store));
+  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (sort_built),
+                                        COLUMN_INT, GTK_SORT_ASCENDING);
+  g_assert (gtk_tree_model_get_iter_first (sort_built, &iter));
+  n_sort_built_rows = 10;
+  g_signal_connect (sort_built, "row-inserted",
+                    G_CALLBACK (row_inserted_check_cb), &n_sort_built_rows);
+
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (values),
+                               COLUMN_INT, values, -1);
+  g_assert_cmpint (n_sort_rows, ==, 15);
+  g_assert_cmpint (n_sort_built_rows, ==, 15);
+
+  g_object_unref (sort_built);
+  g_object_unref (sort);
+  g_object_unref (store);
+}
+
+static void
+row_inserted_clear_cb (GtkTreeModel *model,
+                       GtkTreePath  *path,
+                       GtkTreeIter  *iter,
+                       gint         *n_emissions)
+{
+  if ((*n_emissions)++ == 0)
+    gtk_array_store_clear (GTK_ARRAY_STORE (model));
+}
+
+static void
+row_inserted_remove_cb (GtkTreeModel *model,
+                        GtkTreePath  *path,
+                        GtkTreeIter  *iter,
+                        gint         *n_emissions)
+{
+  GtkTreeIter first;
+
+  if ((*n_emissions)++ == 0)
+    {
+      g_assert (gtk_tree_model_get_iter_first (model, &first));
+      gtk_array_store_remove (GTK_ARRAY_STORE (model), &first);
+    }
+}
+
+static gint
+get_int (GtkArrayStore *store,
+         gint           row)
+{
+  GtkTreeIter iter;
+  gint value;
+
+  g_assert (gtk_tree_model_iter_nth_child (GTK_TREE_MODEL (store), &iter, NULL, row));
+  gtk_tree_model_get (GTK_TREE_MODEL (store), &iter, COLUMN_INT, &value, -1);
+
+  return value;
+}
+
+/* Handlers that change the store while it announces appended rows */
+static void
+array_store_test_row_inserted_reentrant (void)
+{
+  GtkArrayStore *store;
+  gint values[] = { 5, 1, 4, 2, 3 };
+  gint n_emissions;
+
+  store = create_store ();
+  n_emissions = 0;
+  g_signal_connect (store, "row-inserted",
+                    G_CALLBACK (row_inserted_clear_cb), &n_emissions);
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (values),
+                               COLUMN_INT, values, -1);
+  g_assert_cmpint (n_emissions, ==, 1);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 0);
+  g_object_unref (store);
+
+  store = create_store ();
+  n_emissions = 0;
+  g_signal_connect (store, "row-inserted",
+                    G_CALLBACK (row_inserted_remove_cb), &n_emissions);
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (values),
+                               COLUMN_INT, values, -1);
+  g_assert_cmpint (n_emissions, ==, 5);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (GTK_TREE_MODEL (store), NULL), ==, 9);
+  g_assert_cmpint (get_int (store, 0), ==, ints[1]);
+  g_assert_cmpint (get_int (store, 3), ==, ints[4]);
+  g_assert_cmpint (get_int (store, 4), ==, values[0]);
+  g_assert_cmpint (get_int (store, 8), ==, values[4]);
+  g_object_unref (store);
+}
+
+static gboolean
+even_visible (GtkTreeModel *model,
+              GtkTreeIter  *iter,
+              gpointer      data)
+{
+  gint value;
+
+  gtk_tree_model_get (model, iter, COLUMN_INT, &value, -1);
+
+  return value % 2 == 0;
+}
+
+static void
+array_store_test_filter_ranges (void)
+{
+  GtkArrayStore *store;
+  GtkTreeModel *filter;
+  RangeSignal inserted = { 0, };
+  RangeSignal deleted = { 0, };
+  gint values[] = { 1, 2, 3, 4, 5, 6, 7 };
+  GtkTreeIter iter;
+
+  store = gtk_array_store_new (N_COLUMNS,
+                               G_TYPE_INT, G_TYPE_STRING, G_TYPE_DOUBLE);
+  gtk_array_store_append_rows (store, 1, COLUMN_INT, values + 1, -1);
+
+  filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
+  gtk_tree_model_filter_set_visible_func (GTK_TREE_MODEL_FILTER (filter),
+                                          even_visible, NULL, NULL);
+  g_assert (gtk_tree_model_get_iter_first (filter, &iter));
+
+  g_signal_connect (filter, "rows-inserted",
+                    G_CALLBACK (rows_inserted_cb), &inserted);
+  g_signal_connect (filter, "rows-deleted",
+                    G_CALLBACK (rows_deleted_cb), &deleted);
+
+  /* The visible ones of the new rows come out as one block */
+  gtk_array_store_append_rows (store, G_N_ELEMENTS (values),
+                               COLUMN_INT, values, -1);
+  g_assert_cmpint (inserted.n_emissions, ==, 1);
+  g_assert_cmpstr (inserted.path, ==, "1");
+  g_assert_cmpint (inserted.n_rows, ==, 3);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 4);
+
+  gtk_array_store_clear (store);
+  g_assert_cmpint (deleted.n_emissions, ==, 1);
+  g_assert_cmpstr (deleted.path, ==, "0");
+  g_assert_cmpint (deleted.n_rows, ==, 4);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 0);
+
+  g_free (inserted.path);
+  g_free (deleted.path);
+  g_object_unref (filter);
+  g_object_unref (store);
+}
+
+void
+register_array_store_tests (void)
+{
+  g_test_add_func ("/ArrayStore/append-rows",
+                   array_store_test_append_rows);
+  g_test_add_func ("/ArrayStore/set-rows",
+                   array_store_test_set_rows);
+  g_test_add_func ("/ArrayStore/insert-remove",
+                   array_store_test_insert_remove);
+  g_test_add_func ("/ArrayStore/sort",
+                   array_store_test_sort);
+  g_test_add_func ("/ArrayStore/sort-set-value",
+                   array_store_test_sort_set_value);
+  g_test_add_func ("/ArrayStore/sort-func",
+                   array_store_test_sort_func);
+  g_test_add_func ("/ArrayStore/objects",
+                   array_store_test_objects);
+  g_test_add_func ("/ArrayStore/rows-inserted",
+                   array_store_test_rows_inserted);
+  g_test_add_func ("/ArrayStore/handles-ranges",
+                   array_store_test_handles_ranges);
+  g_test_add_func ("/ArrayStore/rows-deleted",
+                   array_store_test_rows_deleted);
+  g_test_add_func ("/ArrayStore/rows-inserted-replay",
+                   array_store_test_rows_inserted_replay);
+  g_test_add_func ("/ArrayStore/row-inserted-legacy",
+                   array_store_test_row_inserted_legacy);
+  g_test_add_func ("/ArrayStore/row-inserted-reentrant",
+                   array_store_test_row_inserted_reentrant);
+  g_test_add_func ("/ArrayStore/filter-ranges",
+                   array_store_test_filter_ranges);
+}
@@ -0,0 +1,283 @@
+/* GtkCairoBlur tests.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+
+#include "../../gtk/gtkcairoblurprivate.h"
+
+#include <string.h>
+
+/* REFERENCE IMPLEMENTATION
+ *
+ * This is the straightforward transposing box blur the optimized
+ * version in gtkcairoblur.c has to match bit by bit.
+ */
+
+static void
+reference_blur_xspan (guchar *row,
+                      guchar *tmp_buffer,
+                      int     row_width,
+                      int     d,
+                      int     shift)
+{
+  int offset;
+  int sum = 0;
+  int i;
+
+  if (d % 2 == 1)
+    offset = d / 2;
+  else
+    offset = (d - shift) / 2;
+
+  for (i = -d + offset; i < row_width + offset; i++)
+    {
+      if (i >= 0 && i < row_width)
+        sum += row[i];
+
+      if (i >= offset)
+        {
+          if (i >= d)
+            sum -= row[i - d];
+
+          tmp_buffer[i - offset] = (sum + d / 2) / d;
+        }
+    }
+
+  memcpy (row, tmp_buffer, row_width);
+}
+
+static void
+reference_blur_rows (guchar *buffer,
+                     guchar *tmp_buffer,
+                     int     width,
+                     int     height,
+                     int     d)
+{
+  int i;
+
+  for (i = 0; i < height; i++)
+    {
+      guchar *row = buffer + i * width;
+
+      if (d % 2 == 1)
+        {
+          reference_blur_xspan (row, tmp_buffer, width, d, 0);
+          reference_blur_xspan (row, tmp_buffer, width, d, 0);
+          reference_blur_xspan (row, tmp_buffer, width, d, 0);
+        }
+      else
+        {
+          reference_blur_xspan (row, tmp_buffer, width, d, 1);
+          reference_blur_xspan (row, tmp_buffer, width, d, -1);
+          reference_blur_xspan (row, tmp_buffer, width, d + 1, 0);
+        }
+    }
+}
+
+static void
+reference_flip (guchar *dst,
+                guchar *src,
+                int     width,
+                int     height)
+{
+  int i, j;
+
+  for (i = 0; i < width; i++)
+    for (j = 0; j < height; j++)
+      dst[i * height + j] = src[j * width + i];
+}
+
+static void
+reference_blur_surface (cairo_surface_t *surface,
+                        int              radius)
+{
+  guchar *buffer, *flipped;
+  int width, height;
+
+  cairo_surface_flush (surface);
+
+  buffer = cairo_image_surface_get_data (surface);
+  width = cairo_image_surface_get_stride (surface);
+  height = cairo_image_surface_get_height (surface);
+  flipped = g_malloc (width * height);
+
+  reference_flip (flipped, buffer, width, height);
+  reference_blur_rows (flipped, buffer, height, width, radius);
+  reference_flip (buffer, flipped, height, width);
+  reference_blur_rows (buffer, flipped, width, height, radius);
+
+  g_free (flipped);
+
+  cairo_surface_mark_dirty (surface);
+}
+
+/* UTILITIES */
+
+static cairo_surface_t *
+create_random_surface (int width,
+                       int height)
+{
+  cairo_surface_t *surface;
+  guchar *data;
+  int stride, i;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, width, height);
+  cairo_surface_flush (surface);
+
+  data = cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
+
+  /* mix of noise and hard edges, like the masks we blur for shadows */
+  for (i = 0; i < stride * height; i++)
+    {
+      if (g_test_rand_bit ())
+        data[i] = g_test_rand_int_range (0, 256);
+      else
+        data[i] = (i % stride) < width / 2 ? 255 : 0;
+    }
+
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+static cairo_surface_t *
+copy_surface (cairo_surface_t *surface)
+{
+  cairo_surface_t *copy;
+
+  copy = cairo_image_surface_create (CAIRO_FORMAT_A8,
+                                     cairo_image_surface_get_width (surface),
+                                     cairo_image_surface_get_height (surface));
+  g_assert_cmpint (cairo_image_surface_get_stride (copy), ==, cairo_image_surface_get_stride (surface));
+
+  cairo_surface_flush (surface);
+  cairo_surface_flush (copy);
+  memcpy (cairo_image_surface_get_data (copy),
+          cairo_image_surface_get_data (surface),
+          cairo_image_surface_get_stride (surface) * cairo_image_surface_get_height (surface));
+  cairo_surface_mark_dirty (copy);
+
+  return copy;
+}
+
+static void
+assert_surfaces_equal (cairo_surface_t *surface,
+                       cairo_surface_t *other)
+{
+  int stride, height, i;
+  guchar *data, *other_data;
+
+  stride = cairo_image_surface_get_stride (surface);
+  height = cairo_image_surface_get_height (surface);
+  data = cairo_image_surface_get_data (surface);
+  other_data = cairo_image_surface_get_data (other);
+
+  for (i = 0; i < stride * height; i++)
+    {
+      if (data[i] != other_data[i])
+        g_error ("surfaces differ at %d,%d: %u != %u",
+                 i % stride, i / stride, data[i], other_data[i]);
+    }
+}
+
+/* TESTS */
+
+static const struct {
+  int width;
+  int height;
+} sizes[] = {
+  { 1, 1 },
+  { 7, 3 },
+  { 32, 200 },
+  { 64, 64 },
+  { 300, 257 },
+  { 1024, 768 }
+};
+
+static const int radii[] = { 1, 2, 3, 8, 13, 32, 75 };
+
+static void
+test_exact (void)
+{
+  guint i, j;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    for (j = 0; j < G_N_ELEMENTS (radii); j++)
+      {
+        cairo_surface_t *surface, *reference;
+
+        surface = create_random_surface (sizes[i].width, sizes[i].height);
+        reference = copy_surface (surface);
+
+        _gtk_cairo_blur_surface (surface, radii[j]);
+        reference_blur_surface (reference, radii[j]);
+
+        assert_surfaces_equal (surface, reference);
+
+        cairo_surface_destroy (surface);
+        cairo_surface_destroy (reference);
+      }
+}
+
+static void
+test_performance (void)
+{
+  guint i, j, n;
+
+  if (!g_test_perf ())
+    return;
+
+  for (i = 0; i < G_N_ELEMENTS (sizes); i++)
+    for (j = 0; j < G_N_ELEMENTS (radii); j++)
+      {
+        cairo_surface_t *surface;
+        double elapsed, reference_elapsed;
+
+        surface = create_random_surface (sizes[i].width, sizes[i].height);
+
+        g_test_timer_start ();
+        for (n = 0; n < 10; n++)
+          _gtk_cairo_blur_surface (surface, radii[j]);
+        elapsed = g_test_timer_elapsed () / 10;
+
+        g_test_timer_start ();
+        for (n = 0; n < 10; n++)
+          reference_blur_surface (surface, radii[j]);
+        reference_elapsed = g_test_timer_elapsed () / 10;
+
+        g_test_minimized_result (elapsed,
+                                 "blurring %dx%d with radius %d: %gms (reference %gms)",
+                                 sizes[i].width, sizes[i].height, radii[j],
+                                 elapsed * 1000, reference_elapsed * 1000);
+
+        cairo_surface_destroy (surface);
+      }
+}
+
+int
+main (int argc, char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+  setlocale (LC_ALL, "C");
+
+  g_test_add_func ("/cairoblur/exact", test_exact);
+  g_test_add_func ("/cairoblur/performance", test_performance);
+
+  return g_test_run ();
+}
@@ -0,0 +1,132 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+
+#define N_COLUMNS 20
+#define N_CHILDREN (N_COLUMNS * N_COLUMNS)
+
+static gboolean
+count_draw (GtkWidget *widget,
+            cairo_t   *cr,
+            gint      *count)
+{
+  (*count)++;
+
+  return FALSE;
+}
+
+static gint
+draw_clipped (GtkWidget *widget,
+              gint       x,
+              gint       y,
+              gint       width,
+              gint       height,
+              gint      *counts)
+{
+  cairo_surface_t *surface;
+  cairo_t *cr;
+  gint i, n;
+
+  memset (counts, 0, N_CHILDREN * sizeof (gint));
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, 400, 400);
+  cr = cairo_create (surface);
+  cairo_rectangle (cr, x, y, width, height);
+  cairo_clip (cr);
+
+  gtk_widget_draw (widget, cr);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
+  for (i = 0, n = 0; i < N_CHILDREN; i++)
+    n += counts[i];
+
+  return n;
+}
+
+/* Children of containers with lots of children are only
+ * drawn when they intersect the clip */
+static void
+test_draw_clip (void)
+{
+  GtkWidget *window, *fixed, *child;
+  GtkWidget *children[N_CHILDREN];
+  gint counts[N_CHILDREN];
+  gint i;
+
+  window = gtk_offscreen_window_new ();
+  fixed = gtk_fixed_new ();
+  gtk_container_add (GTK_CONTAINER (window), fixed);
+
+  for (i = 0; i < N_CHILDREN; i++)
+    {
+      child = gtk_drawing_area_new ();
+      gtk_widget_set_size_request (child, 10, 10);
+      gtk_fixed_put (GTK_FIXED (fixed), child,
+                     (i % N_COLUMNS) * 20, (i / N_COLUMNS) * 20);
+      g_signal_connect (child, "draw", G_CALLBACK (count_draw), &counts[i]);
+      children[i] = child;
+    }
+
+  gtk_widget_show_all (window);
+  gtk_container_check_resize (GTK_CONTAINER (window));
+
+  /* Everything */
+  g_assert_cmpint (draw_clipped (fixed, 0, 0, 400, 400, counts), ==, N_CHILDREN);
+
+  /* Two children of the third row */
+  g_assert_cmpint (draw_clipped (fixed, 25, 45, 30, 10, counts), ==, 2);
+  g_assert_cmpint (counts[2 * N_COLUMNS + 1], ==, 1);
+  g_assert_cmpint (counts[2 * N_COLUMNS + 2], ==, 1);
+
+  /* Nothing but gaps */
+  g_assert_cmpint (draw_clipped (fixed, 10, 10, 10, 10, counts), ==, 0);
+
+  /* Moved children are found at their new place... */
+  gtk_fixed_move (GTK_FIXED (fixed), children[0], 30, 40);
+  gtk_container_check_resize (GTK_CONTAINER (window));
+  g_assert_cmpint (draw_clipped (fixed, 25, 45, 30, 10, counts), ==, 3);
+  g_assert_cmpint (counts[0], ==, 1);
+
+  /* ...and hidden ones aren't drawn */
+  gtk_widget_hide (children[0]);
+  gtk_container_check_resize (GTK_CONTAINER (window));
+  g_assert_cmpint (draw_clipped (fixed, 25, 45, 30, 10, counts), ==, 2);
+
+  /* Removing children works, too */
+  gtk_widget_destroy (children[2 * N_COLUMNS + 1]);
+  children[2 * N_COLUMNS + 1] = NULL;
+  gtk_container_check_resize (GTK_CONTAINER (window));
+  g_assert_cmpint (draw_clipped (fixed, 25, 45, 30, 10, counts), ==, 1);
+  g_assert_cmpint (counts[2 * N_COLUMNS + 2], ==, 1);
+
+  gtk_widget_destroy (window);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/container/draw-clip", test_draw_clip);
+
+  return g_test_run ();
+}
@@ -306,6 +306,74 @@ test_delete (void)
   g_object_unref (entry);
 }
 
+static void
+no_matches (GtkEntryCompletion *completion,
+            gint               *count)
+{
+  (*count)++;
+}
+
+static void
+check_prefix (GtkEntryCompletion *completion,
+              GtkEntry           *entry,
+              const gchar        *text,
+              const gchar        *expected)
+{
+  gchar *prefix;
+
+  gtk_entry_set_text (entry, text);
+  gtk_entry_completion_complete (completion);
+
+  prefix = gtk_entry_completion_compute_prefix (completion, text);
+  g_assert_cmpstr (prefix, ==, expected);
+  g_free (prefix);
+}
+
+static void
+test_completion_prefix (void)
+{
+  GtkWidget *entry;
+  GtkEntryCompletion *completion;
+  GtkListStore *store;
+  gint count = 0;
+
+  store = gtk_list_store_new (1, G_TYPE_STRING);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "apricot", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "banana", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, NULL, -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "applesauce", -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, "apple", -1);
+
+  entry = gtk_entry_new ();
+  g_object_ref_sink (entry);
+  completion = gtk_entry_completion_new ();
+  gtk_entry_completion_set_model (completion, GTK_TREE_MODEL (store));
+  gtk_entry_completion_set_text_column (completion, 0);
+  gtk_entry_set_completion (GTK_ENTRY (entry), completion);
+  g_signal_connect (completion, "no-matches", G_CALLBACK (no_matches), &count);
+
+  /* Narrowing the key... */
+  check_prefix (completion, GTK_ENTRY (entry), "a", "ap");
+  check_prefix (completion, GTK_ENTRY (entry), "app", "apple");
+  check_prefix (completion, GTK_ENTRY (entry), "apples", "applesauce");
+  g_assert_cmpint (count, ==, 0);
+  check_prefix (completion, GTK_ENTRY (entry), "applex", NULL);
+  g_assert_cmpint (count, ==, 1);
+
+  /* ...and widening it again */
+  check_prefix (completion, GTK_ENTRY (entry), "ap", "ap");
+  check_prefix (completion, GTK_ENTRY (entry), "b", "banana");
+
+  /* Changes to the model are picked up */
+  gtk_list_store_insert_with_values (store, NULL, 0, 0, "bandana", -1);
+  check_prefix (completion, GTK_ENTRY (entry), "ban", "ban");
+  check_prefix (completion, GTK_ENTRY (entry), "band", "bandana");
+
+  g_object_unref (completion);
+  g_object_unref (entry);
+  g_object_unref (store);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -314,6 +382,7 @@ main (int   argc,
 
   g_test_add_func ("/entry/delete", test_delete);
   g_test_add_func ("/entry/insert", test_insert);
+  g_test_add_func ("/entry/completion-prefix", test_completion_prefix);
 
   return g_test_run();
 }
@@ -6783,6 +6783,87 @@ specific_bug_679910 (void)
   g_object_unref (store);
 }
 
+typedef struct
+{
+  gboolean done;
+  GError *error;
+} RefilterResult;
+
+static gboolean
+threaded_multiple_visible_func (const GValue *values,
+                                gpointer      data)
+{
+  return g_value_get_int (&values[0]) % GPOINTER_TO_INT (data) == 0;
+}
+
+static void
+refilter_async_done (GObject      *source,
+                     GAsyncResult *result,
+                     gpointer      data)
+{
+  RefilterResult *refilter_result = data;
+
+  gtk_tree_model_filter_refilter_finish (GTK_TREE_MODEL_FILTER (source),
+                                         result, &refilter_result->error);
+  refilter_result->done = TRUE;
+}
+
+static void
+specific_refilter_async (void)
+{
+  RefilterResult first = { FALSE, NULL };
+  RefilterResult second = { FALSE, NULL };
+  GtkTreeModel *filter;
+  GtkListStore *store;
+  GtkTreeIter iter;
+  GtkWidget *view;
+  gint column = 0;
+  gint value;
+  gint i;
+
+  store = gtk_list_store_new (1, G_TYPE_INT);
+  for (i = 0; i < 10000; i++)
+    gtk_list_store_insert_with_values (store, NULL, i, 0, i, -1);
+
+  filter = gtk_tree_model_filter_new (GTK_TREE_MODEL (store), NULL);
+  gtk_tree_model_filter_set_threaded_visible_func (GTK_TREE_MODEL_FILTER (filter),
+                                                   1, &column,
+                                                   threaded_multiple_visible_func,
+                                                   GINT_TO_POINTER (2), NULL);
+  view = gtk_tree_view_new_with_model (filter);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 5000);
+
+  /* The second refilter cancels the first one */
+  gtk_tree_model_filter_refilter_async (GTK_TREE_MODEL_FILTER (filter),
+                                        GINT_TO_POINTER (3), NULL, NULL,
+                                        refilter_async_done, &first);
+  gtk_tree_model_filter_refilter_async (GTK_TREE_MODEL_FILTER (filter),
+                                        GINT_TO_POINTER (5), NULL, NULL,
+                                        refilter_async_done, &second);
+
+  while (!first.done || !second.done)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_error (first.error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+  g_assert_no_error (second.error);
+  g_error_free (first.error);
+
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 2000);
+  g_assert (gtk_tree_model_iter_nth_child (filter, &iter, NULL, 1));
+  gtk_tree_model_get (filter, &iter, 0, &value, -1);
+  g_assert_cmpint (value, ==, 5);
+
+  /* New rows are filtered with the new data */
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, 10000, -1);
+  gtk_list_store_insert_with_values (store, NULL, -1, 0, 10002, -1);
+  g_assert_cmpint (gtk_tree_model_iter_n_children (filter, NULL), ==, 2001);
+
+  gtk_widget_destroy (view);
+  g_object_unref (filter);
+  g_object_unref (store);
+}
+
 /* main */
 
 void
@@ -7144,4 +7225,6 @@ register_filter_model_tests (void)
                    specific_bug_659022_row_deleted_free_level);
   g_test_add_func ("/TreeModelFilter/specific/bug-679910",
                    specific_bug_679910);
+  g_test_add_func ("/TreeModelFilter/specific/refilter-async",
+                   specific_refilter_async);
 }
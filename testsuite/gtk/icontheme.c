@@ -1,6 +1,9 @@
 #include <gtk/gtk.h>
+#include <glib/gstdio.h>
 
 #include <string.h>
+#include <time.h>
+#include <utime.h>
 
 #define SCALABLE_IMAGE_SIZE (128)
 
@@ -698,9 +701,234 @@ test_inherit (void)
                       "/icons2/scalable/one-two-symbolic-rtl.svg");
 }
 
+static const char user_cache_index[] =
+  "[Icon Theme]\n"
+  "Name=User cache\n"
+  "Directories=16x16/apps,24x24/apps,scalable/apps\n"
+  "\n"
+  "[16x16/apps]\n"
+  "Size=16\n"
+  "Type=Fixed\n"
+  "\n"
+  "[24x24/apps]\n"
+  "Size=24\n"
+  "Type=Fixed\n"
+  "\n"
+  "[scalable/apps]\n"
+  "Size=48\n"
+  "MinSize=8\n"
+  "MaxSize=256\n"
+  "Type=Scalable\n";
+
+static const char user_cache_icon_file[] =
+  "[Icon Data]\n"
+  "EmbeddedTextRectangle=1,2,14,15\n"
+  "AttachPoints=3,4|12,13\n"
+  "DisplayName=Cached Display Name\n"
+  "DisplayName[de]=Zwischengespeichert\n";
+
+static void
+write_file (const char *dir,
+            const char *name,
+            const char *contents)
+{
+  GError *error = NULL;
+  char *path;
+
+  path = g_build_filename (dir, name, NULL);
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+  g_free (path);
+}
+
+/* Creates a theme without an icon-theme.cache in @icons_dir */
+static char *
+create_user_cache_theme (const char *icons_dir)
+{
+  char *theme_dir, *dir;
+
+  theme_dir = g_build_filename (icons_dir, "usercache", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (theme_dir, 0755), ==, 0);
+  write_file (theme_dir, "index.theme", user_cache_index);
+
+  dir = g_build_filename (theme_dir, "16x16", "apps", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+  write_file (dir, "foo.png", "");
+  write_file (dir, "foo.icon", user_cache_icon_file);
+  write_file (dir, "no-image.icon", user_cache_icon_file);
+  write_file (dir, "ignored.txt", "");
+  g_free (dir);
+
+  dir = g_build_filename (theme_dir, "24x24", "apps", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+  write_file (dir, "bar.png", "");
+  write_file (dir, "bar.xpm", "");
+  g_free (dir);
+
+  dir = g_build_filename (theme_dir, "scalable", "apps", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (dir, 0755), ==, 0);
+  write_file (dir, "foo.svg", "");
+  write_file (dir, "baz.svg", "");
+  g_free (dir);
+
+  return theme_dir;
+}
+
+/* Returns a description of what a fresh theme finds for a few lookups */
+static char *
+describe_user_cache_theme (const char *icons_dir)
+{
+  const char *names[] = { "foo", "bar", "baz", "new", "no-image", "ignored" };
+  const int sizes[] = { 16, 24, 48 };
+  const GtkIconLookupFlags flags[] = { 0, GTK_ICON_LOOKUP_NO_SVG, GTK_ICON_LOOKUP_FORCE_SVG };
+  GtkIconTheme *theme;
+  GtkIconInfo *info;
+  GString *string;
+  GList *list, *l;
+  int i, j, k;
+
+  theme = gtk_icon_theme_new ();
+  gtk_icon_theme_set_custom_theme (theme, "usercache");
+  gtk_icon_theme_set_search_path (theme, &icons_dir, 1);
+
+  string = g_string_new (NULL);
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++)
+    for (j = 0; j < G_N_ELEMENTS (sizes); j++)
+      for (k = 0; k < G_N_ELEMENTS (flags); k++)
+        {
+          info = gtk_icon_theme_lookup_icon (theme, names[i], sizes[j], flags[k]);
+          g_string_append_printf (string, "%s %d %d: %s\n",
+                                  names[i], sizes[j], flags[k],
+                                  info ? gtk_icon_info_get_filename (info) : "none");
+          g_clear_object (&info);
+        }
+
+  list = gtk_icon_theme_list_icons (theme, NULL);
+  list = g_list_sort (list, (GCompareFunc) g_strcmp0);
+  for (l = list; l; l = l->next)
+    g_string_append_printf (string, "listed: %s\n", (char *) l->data);
+  g_list_free_full (list, g_free);
+
+  g_object_unref (theme);
+
+  return g_string_free (string, FALSE);
+}
+
+static gboolean
+contains (GBytes     *bytes,
+          const char *string)
+{
+  const guint8 *data;
+  gsize size, len, i;
+
+  data = g_bytes_get_data (bytes, &size);
+  len = strlen (string);
+
+  for (i = 0; i + len <= size; i++)
+    {
+      if (memcmp (data + i, string, len) == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static GBytes *
+read_file (const char *path)
+{
+  GError *error = NULL;
+  char *contents;
+  gsize length;
+
+  g_file_get_contents (path, &contents, &length, &error);
+  g_assert_no_error (error);
+
+  return g_bytes_new_take (contents, length);
+}
+
+/* Themes without an icon-theme.cache get one in the user cache
+ * directory, which must give the same results as reading the theme.
+ */
+static void
+test_user_cache (void)
+{
+  char *tmp_dir, *icons_dir, *theme_dir, *checksum, *cache_file, *dir;
+  char *uncached, *cached, *updated;
+  GBytes *old_cache, *new_cache;
+  struct utimbuf times;
+
+  tmp_dir = g_dir_make_tmp ("icontheme-XXXXXX", NULL);
+  g_assert (tmp_dir != NULL);
+  icons_dir = g_build_filename (tmp_dir, "icons", NULL);
+  theme_dir = create_user_cache_theme (icons_dir);
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, theme_dir, -1);
+  cache_file = g_build_filename (g_get_user_cache_dir (), "gtk-3.0", "icon-cache",
+                                 checksum, NULL);
+  g_free (checksum);
+
+  /* A directory in the place of the cache can't be replaced,
+   * so this reads the theme without a cache
+   */
+  g_assert_cmpint (g_mkdir_with_parents (cache_file, 0700), ==, 0);
+  uncached = describe_user_cache_theme (icons_dir);
+  g_assert (g_file_test (cache_file, G_FILE_TEST_IS_DIR));
+  g_assert_cmpint (g_rmdir (cache_file), ==, 0);
+
+  cached = describe_user_cache_theme (icons_dir);
+  g_assert_cmpstr (cached, ==, uncached);
+  g_assert (g_file_test (cache_file, G_FILE_TEST_IS_REGULAR));
+
+  /* The .icon data is kept */
+  old_cache = read_file (cache_file);
+  g_assert (contains (old_cache, "Cached Display Name"));
+  g_assert (contains (old_cache, "Zwischengespeichert"));
+
+  /* Using the cache gives the same results */
+  g_free (cached);
+  cached = describe_user_cache_theme (icons_dir);
+  g_assert_cmpstr (cached, ==, uncached);
+
+  /* Changing a directory regenerates it. The modification
+   * time is in the future to not depend on timing.
+   */
+  dir = g_build_filename (theme_dir, "24x24", "apps", NULL);
+  write_file (dir, "new.png", "");
+  times.actime = times.modtime = time (NULL) + 10;
+  g_assert_cmpint (g_utime (dir, &times), ==, 0);
+  g_free (dir);
+
+  updated = describe_user_cache_theme (icons_dir);
+  g_assert (strstr (updated, "new 24 0: ") != NULL);
+  g_assert (strstr (updated, "new 24 0: none") == NULL);
+  g_assert (strstr (updated, "listed: new\n") != NULL);
+
+  new_cache = read_file (cache_file);
+  g_assert (!g_bytes_equal (old_cache, new_cache));
+  g_assert (contains (new_cache, "new"));
+
+  g_bytes_unref (old_cache);
+  g_bytes_unref (new_cache);
+  g_free (uncached);
+  g_free (cached);
+  g_free (updated);
+  g_free (cache_file);
+  g_free (theme_dir);
+  g_free (icons_dir);
+  g_free (tmp_dir);
+}
+
 int
 main (int argc, char *argv[])
 {
+  char *cache_dir;
+
+  /* Keep the user caches of the test themes out of the real one */
+  cache_dir = g_dir_make_tmp ("icontheme-cache-XXXXXX", NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+  g_free (cache_dir);
+
   gtk_test_init (&argc, &argv);
 
   g_test_add_func ("/icontheme/basics", test_basics);
@@ -716,6 +944,7 @@ main (int argc, char *argv[])
   g_test_add_func ("/icontheme/list", test_list);
   g_test_add_func ("/icontheme/async", test_async);
   g_test_add_func ("/icontheme/inherit", test_inherit);
+  g_test_add_func ("/icontheme/user-cache", test_user_cache);
 
   return g_test_run();
 }
@@ -0,0 +1,168 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+
+#define VIEW_SIZE 200
+#define CANVAS_HEIGHT 4000
+#define SCROLL_STEP 24
+#define N_FRAMES 30
+
+/* Every row gets its own color, so anything drawn
+ * at the wrong offset shows up */
+static gboolean
+draw_rows (GtkWidget *widget,
+           cairo_t   *cr,
+           gpointer   data)
+{
+  double x1, y1, x2, y2;
+  int y;
+
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+  for (y = MAX (0, (int) y1); y < MIN (CANVAS_HEIGHT, (int) y2 + 1); y++)
+    {
+      cairo_set_source_rgb (cr,
+                            (y % 256) / 255.0,
+                            (y / 256) / 15.0,
+                            0.5);
+      cairo_rectangle (cr, 0, y, VIEW_SIZE, 1);
+      cairo_fill (cr);
+    }
+
+  return TRUE;
+}
+
+static cairo_surface_t *
+to_image (cairo_surface_t *surface)
+{
+  cairo_surface_t *image;
+  cairo_t *cr;
+
+  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, VIEW_SIZE, VIEW_SIZE);
+  cr = cairo_create (image);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return image;
+}
+
+/* Renders @window without going through any pixel cache: those
+ * only use their surface when drawing to a surface of the same type */
+static cairo_surface_t *
+render_uncached (GtkWidget *window)
+{
+  cairo_rectangle_t extents = { 0, 0, VIEW_SIZE, VIEW_SIZE };
+  cairo_surface_t *recording, *image;
+  cairo_t *cr;
+
+  recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, &extents);
+  cr = cairo_create (recording);
+  gtk_widget_draw (window, cr);
+  cairo_destroy (cr);
+
+  image = to_image (recording);
+  cairo_surface_destroy (recording);
+
+  return image;
+}
+
+static void
+assert_surfaces_equal (cairo_surface_t *a,
+                       cairo_surface_t *b,
+                       double           value)
+{
+  guchar *data_a, *data_b;
+  int stride_a, stride_b;
+  int y;
+
+  cairo_surface_flush (a);
+  cairo_surface_flush (b);
+  data_a = cairo_image_surface_get_data (a);
+  data_b = cairo_image_surface_get_data (b);
+  stride_a = cairo_image_surface_get_stride (a);
+  stride_b = cairo_image_surface_get_stride (b);
+
+  for (y = 0; y < VIEW_SIZE; y++)
+    {
+      if (memcmp (data_a + y * stride_a, data_b + y * stride_b, VIEW_SIZE * 4) != 0)
+        g_error ("row %d differs from the uncached rendering when scrolled to %g",
+                 y, value);
+    }
+}
+
+/* The viewport prefetches the rows below the view while it scrolls
+ * down. The view moving between the prefetch and the next frame must
+ * not leave rows rendered at the old offset behind.
+ */
+static void
+test_prefetch_scroll (void)
+{
+  GtkWidget *window, *viewport, *area;
+  GtkAdjustment *vadjustment;
+  cairo_surface_t *cached, *uncached;
+  int i;
+
+  window = gtk_offscreen_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (window), VIEW_SIZE, VIEW_SIZE);
+
+  viewport = gtk_viewport_new (NULL, NULL);
+  gtk_viewport_set_shadow_type (GTK_VIEWPORT (viewport), GTK_SHADOW_NONE);
+  gtk_container_add (GTK_CONTAINER (window), viewport);
+
+  area = gtk_drawing_area_new ();
+  gtk_widget_set_size_request (area, VIEW_SIZE, CANVAS_HEIGHT);
+  g_signal_connect (area, "draw", G_CALLBACK (draw_rows), NULL);
+  gtk_container_add (GTK_CONTAINER (viewport), area);
+
+  gtk_widget_show_all (window);
+  gtk_test_widget_wait_for_draw (window);
+
+  vadjustment = gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (viewport));
+
+  for (i = 0; i < N_FRAMES; i++)
+    {
+      gtk_adjustment_set_value (vadjustment,
+                                gtk_adjustment_get_value (vadjustment) + SCROLL_STEP);
+
+      /* Give the prefetch idle a chance to run before the frame */
+      while (g_main_context_iteration (NULL, FALSE));
+
+      gtk_test_widget_wait_for_draw (window);
+
+      cached = to_image (gtk_offscreen_window_get_surface (GTK_OFFSCREEN_WINDOW (window)));
+      uncached = render_uncached (window);
+      assert_surfaces_equal (cached, uncached, gtk_adjustment_get_value (vadjustment));
+      cairo_surface_destroy (cached);
+      cairo_surface_destroy (uncached);
+    }
+
+  gtk_widget_destroy (window);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/pixelcache/prefetch-scroll", test_prefetch_scroll);
+
+  return g_test_run ();
+}
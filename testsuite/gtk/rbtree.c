@@ -507,6 +507,94 @@ test_reorder (void)
   _gtk_rbtree_free (tree);
 }
 
+static void
+test_fill (void)
+{
+  guint i;
+  GtkRBTree *tree;
+
+  for (i = 0; i <= 100; i++)
+    {
+      tree = _gtk_rbtree_new ();
+      _gtk_rbtree_fill (tree, i, 3, TRUE);
+      _gtk_rbtree_test (tree);
+      g_assert (tree->root->count == i);
+      g_assert (tree->root->total_count == i);
+      g_assert (tree->root->offset == i * 3);
+      _gtk_rbtree_free (tree);
+    }
+}
+
+static void
+test_fill_children (void)
+{
+  GtkRBTree *tree;
+  GtkRBNode *node;
+
+  tree = _gtk_rbtree_new ();
+  _gtk_rbtree_fill (tree, 10, 5, TRUE);
+
+  node = _gtk_rbtree_find_count (tree, 4);
+  node->children = _gtk_rbtree_new ();
+  node->children->parent_tree = tree;
+  node->children->parent_node = node;
+  _gtk_rbtree_fill (node->children, 20, 0, FALSE);
+
+  _gtk_rbtree_test (tree);
+  g_assert (tree->root->total_count == 30);
+  g_assert (tree->root->offset == 50);
+  g_assert (GTK_RBNODE_FLAG_SET (tree->root, GTK_RBNODE_DESCENDANTS_INVALID));
+
+  /* Estimating the heights keeps the nodes invalid */
+  _gtk_rbtree_set_fixed_height (tree, 2, FALSE);
+  _gtk_rbtree_test (tree);
+  g_assert (tree->root->offset == 90);
+  g_assert (GTK_RBNODE_FLAG_SET (tree->root, GTK_RBNODE_DESCENDANTS_INVALID));
+
+  _gtk_rbtree_set_fixed_height (node->children, 1, TRUE);
+  _gtk_rbtree_test (tree);
+  g_assert (tree->root->offset == 70);
+  g_assert (!GTK_RBNODE_FLAG_SET (tree->root, GTK_RBNODE_DESCENDANTS_INVALID));
+
+  _gtk_rbtree_free (tree);
+}
+
+static void
+test_fill_perf (void)
+{
+  guint n = g_test_perf () ? 1000000 : 1000;
+  GtkRBTree *tree;
+  GtkRBNode *node;
+  double elapsed;
+  guint i;
+
+  g_test_timer_start ();
+
+  tree = _gtk_rbtree_new ();
+  for (i = 0, node = NULL; i < n; i++)
+    node = _gtk_rbtree_insert_after (tree, node, 0, FALSE);
+
+  elapsed = g_test_timer_elapsed ();
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "inserting %u nodes one by one: %gsec", n, elapsed);
+
+  _gtk_rbtree_free (tree);
+
+  g_test_timer_start ();
+
+  tree = _gtk_rbtree_new ();
+  _gtk_rbtree_fill (tree, n, 0, FALSE);
+
+  elapsed = g_test_timer_elapsed ();
+  if (g_test_perf ())
+    g_test_minimized_result (elapsed, "filling a tree with %u nodes: %gsec", n, elapsed);
+
+  _gtk_rbtree_test (tree);
+  g_assert (tree->root->count == n);
+
+  _gtk_rbtree_free (tree);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -520,6 +608,9 @@ main (int argc, char *argv[])
   g_test_add_func ("/rbtree/remove_node", test_remove_node);
   g_test_add_func ("/rbtree/remove_root", test_remove_root);
   g_test_add_func ("/rbtree/reorder", test_reorder);
+  g_test_add_func ("/rbtree/fill", test_fill);
+  g_test_add_func ("/rbtree/fill_children", test_fill_children);
+  g_test_add_func ("/rbtree/fill_perf", test_fill_perf);
 
   return g_test_run ();
 }
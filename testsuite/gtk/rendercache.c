@@ -0,0 +1,219 @@
+/* GTK - The GIMP Toolkit
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <gtk/gtk.h>
+#include <string.h>
+
+#define WINDOW_SIZE 200
+#define CHILD_SIZE 100
+
+static int n_window_draws;
+static int n_child_draws;
+static GdkRGBA child_color;
+
+static gboolean
+count_window_draw (GtkWidget *widget,
+                   cairo_t   *cr,
+                   gpointer   data)
+{
+  n_window_draws++;
+
+  return FALSE;
+}
+
+static gboolean
+draw_child (GtkWidget *widget,
+            cairo_t   *cr,
+            gpointer   data)
+{
+  n_child_draws++;
+
+  gdk_cairo_set_source_rgba (cr, &child_color);
+  cairo_paint (cr);
+
+  return TRUE;
+}
+
+static cairo_surface_t *
+to_image (cairo_surface_t *surface)
+{
+  cairo_surface_t *image;
+  cairo_t *cr;
+
+  image = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, WINDOW_SIZE, WINDOW_SIZE);
+  cr = cairo_create (image);
+  cairo_set_source_surface (cr, surface, 0, 0);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+
+  return image;
+}
+
+/* Render caches are only used when drawing to a surface
+ * of the same type, so this draws everything again
+ */
+static cairo_surface_t *
+render_uncached (GtkWidget *window)
+{
+  cairo_rectangle_t extents = { 0, 0, WINDOW_SIZE, WINDOW_SIZE };
+  cairo_surface_t *recording, *image;
+  cairo_t *cr;
+
+  recording = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, &extents);
+  cr = cairo_create (recording);
+  gtk_widget_draw (window, cr);
+  cairo_destroy (cr);
+
+  image = to_image (recording);
+  cairo_surface_destroy (recording);
+
+  return image;
+}
+
+/* Checks that what is on screen matches what @window would draw now */
+static void
+assert_no_stale_pixels (GtkWidget  *window,
+                        const char *step)
+{
+  cairo_surface_t *cached, *uncached;
+  guchar *data_cached, *data_uncached;
+  int stride_cached, stride_uncached;
+  int y;
+
+  cached = to_image (gtk_offscreen_window_get_surface (GTK_OFFSCREEN_WINDOW (window)));
+  uncached = render_uncached (window);
+
+  data_cached = cairo_image_surface_get_data (cached);
+  data_uncached = cairo_image_surface_get_data (uncached);
+  stride_cached = cairo_image_surface_get_stride (cached);
+  stride_uncached = cairo_image_surface_get_stride (uncached);
+
+  for (y = 0; y < WINDOW_SIZE; y++)
+    {
+      if (memcmp (data_cached + y * stride_cached,
+                  data_uncached + y * stride_uncached,
+                  WINDOW_SIZE * 4) != 0)
+        g_error ("row %d is stale after %s", y, step);
+    }
+
+  cairo_surface_destroy (cached);
+  cairo_surface_destroy (uncached);
+}
+
+static void
+redraw_window (GtkWidget *window)
+{
+  gdk_window_invalidate_rect (gtk_widget_get_window (window), NULL, TRUE);
+  gtk_test_widget_wait_for_draw (window);
+}
+
+static void
+reset_counts (void)
+{
+  n_window_draws = 0;
+  n_child_draws = 0;
+}
+
+static void
+test_draw (void)
+{
+  GtkWidget *window, *box, *child;
+
+  window = gtk_offscreen_window_new ();
+  gtk_window_set_default_size (GTK_WINDOW (window), WINDOW_SIZE, WINDOW_SIZE);
+  g_signal_connect (window, "draw", G_CALLBACK (count_window_draw), NULL);
+
+  box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 0);
+  gtk_widget_set_render_cache (box, TRUE);
+  g_assert (gtk_widget_get_render_cache (box));
+  gtk_container_add (GTK_CONTAINER (window), box);
+
+  child = gtk_drawing_area_new ();
+  gtk_widget_set_has_window (child, FALSE);
+  gtk_widget_set_size_request (child, CHILD_SIZE, CHILD_SIZE);
+  gtk_widget_set_halign (child, GTK_ALIGN_START);
+  gtk_widget_set_valign (child, GTK_ALIGN_START);
+  g_signal_connect (child, "draw", G_CALLBACK (draw_child), NULL);
+  gtk_box_pack_start (GTK_BOX (box), child, FALSE, FALSE, 0);
+
+  gdk_rgba_parse (&child_color, "red");
+  gtk_widget_show_all (window);
+  gtk_test_widget_wait_for_draw (window);
+  g_assert_cmpint (n_child_draws, >, 0);
+  assert_no_stale_pixels (window, "the first draw");
+
+  /* Redrawing the window uses the cache */
+  reset_counts ();
+  redraw_window (window);
+  g_assert_cmpint (n_window_draws, >, 0);
+  g_assert_cmpint (n_child_draws, ==, 0);
+
+  /* Queueing a draw on the child invalidates it */
+  gdk_rgba_parse (&child_color, "blue");
+  reset_counts ();
+  gtk_widget_queue_draw (child);
+  gtk_test_widget_wait_for_draw (window);
+  g_assert_cmpint (n_child_draws, >, 0);
+  assert_no_stale_pixels (window, "queueing a draw");
+
+  reset_counts ();
+  redraw_window (window);
+  g_assert_cmpint (n_child_draws, ==, 0);
+
+  /* So does a new allocation, without queueing a draw */
+  gdk_rgba_parse (&child_color, "green");
+  reset_counts ();
+  gtk_widget_set_size_request (child, CHILD_SIZE + 20, CHILD_SIZE - 20);
+  gtk_test_widget_wait_for_draw (window);
+  g_assert_cmpint (n_child_draws, >, 0);
+  assert_no_stale_pixels (window, "a new allocation");
+
+  /* Hiding the child must not leave it behind in the cache */
+  gtk_widget_hide (child);
+  gtk_test_widget_wait_for_draw (window);
+  redraw_window (window);
+  assert_no_stale_pixels (window, "hiding the child");
+
+  gdk_rgba_parse (&child_color, "yellow");
+  reset_counts ();
+  gtk_widget_show (child);
+  gtk_test_widget_wait_for_draw (window);
+  g_assert_cmpint (n_child_draws, >, 0);
+  redraw_window (window);
+  assert_no_stale_pixels (window, "showing the child");
+
+  /* Turning the cache off draws the child again each time */
+  gtk_widget_set_render_cache (box, FALSE);
+  g_assert (!gtk_widget_get_render_cache (box));
+  gtk_test_widget_wait_for_draw (window);
+  reset_counts ();
+  redraw_window (window);
+  g_assert_cmpint (n_child_draws, >, 0);
+
+  gtk_widget_destroy (window);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gtk_test_init (&argc, &argv);
+
+  g_test_add_func ("/rendercache/draw", test_draw);
+
+  return g_test_run ();
+}
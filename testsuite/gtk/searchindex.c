@@ -0,0 +1,564 @@
+/* File search index tests.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <string.h>
+#include <utime.h>
+
+#include <glib/gstdio.h>
+
+#include "../../gtk/gtksearchindex.h"
+#include "../../gtk/gtksearchenginesimple.h"
+
+/* Shared with the subprocesses through the environment */
+#define TEST_DIR_VARIABLE "GTK_TEST_SEARCH_INDEX_DIR"
+
+static gchar *test_dir;
+
+static const gchar *tree_files[] = {
+  "alpha.txt",
+  "beta.txt",
+  "sub/alphabet.c",
+  "sub/Alpha-Upper.TXT",
+  "sub/deep/gamma-alpha",
+  "sub/deep/delta",
+  ".hidden/alpha-hidden",
+  "other/alphadir/epsilon",
+  "other/zeta",
+  NULL
+};
+
+static void
+write_file (const gchar *root,
+            const gchar *name)
+{
+  gchar *path, *dirname;
+
+  path = g_build_filename (root, name, NULL);
+  dirname = g_path_get_dirname (path);
+  g_assert_cmpint (g_mkdir_with_parents (dirname, 0755), ==, 0);
+  g_assert (g_file_set_contents (path, "", 0, NULL));
+  g_free (dirname);
+  g_free (path);
+}
+
+static gchar *
+make_tree (const gchar *name)
+{
+  gchar *root;
+  guint i;
+
+  root = g_build_filename (test_dir, name, NULL);
+  for (i = 0; tree_files[i] != NULL; i++)
+    write_file (root, tree_files[i]);
+
+  return root;
+}
+
+static void
+remove_tree (const gchar *path)
+{
+  const gchar *name;
+  gchar *child;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          child = g_build_filename (path, name, NULL);
+          remove_tree (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+    }
+
+  g_remove (path);
+}
+
+/* Makes sure that a change shows up, even within the same second */
+static void
+bump_mtime (const gchar *root,
+            const gchar *name,
+            gint         seconds)
+{
+  struct utimbuf times;
+  struct stat st;
+  gchar *path;
+
+  path = g_build_filename (root, name, NULL);
+  g_assert_cmpint (g_stat (path, &st), ==, 0);
+  times.actime = st.st_atime;
+  times.modtime = st.st_mtime + seconds;
+  g_assert_cmpint (g_utime (path, &times), ==, 0);
+  g_free (path);
+}
+
+static gboolean
+name_matches (const gchar  *name,
+              gchar       **words)
+{
+  gchar *lower;
+  gboolean hit = TRUE;
+  guint i;
+
+  lower = g_ascii_strdown (name, -1);
+  for (i = 0; words[i] != NULL && hit; i++)
+    hit = strstr (lower, words[i]) != NULL;
+  g_free (lower);
+
+  return hit;
+}
+
+/* What a serial walk of the file system finds */
+static void
+walk (const gchar  *path,
+      gchar       **words,
+      GPtrArray    *hits)
+{
+  const gchar *name;
+  gchar *child;
+  GDir *dir;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      if (name[0] == '.')
+        continue;
+
+      child = g_build_filename (path, name, NULL);
+      if (name_matches (name, words))
+        g_ptr_array_add (hits, g_strdup (child));
+      if (g_file_test (child, G_FILE_TEST_IS_DIR) &&
+          !g_file_test (child, G_FILE_TEST_IS_SYMLINK))
+        walk (child, words, hits);
+      g_free (child);
+    }
+
+  g_dir_close (dir);
+}
+
+static gint
+compare_paths (gconstpointer a,
+               gconstpointer b)
+{
+  return strcmp (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* Consumes @hits */
+static void
+assert_hits (GPtrArray   *hits,
+             const gchar *path,
+             const gchar *text)
+{
+  GPtrArray *expected;
+  gchar **words;
+  guint i;
+
+  g_assert (hits != NULL);
+
+  words = g_strsplit (text, " ", -1);
+  expected = g_ptr_array_new_with_free_func (g_free);
+  walk (path, words, expected);
+
+  g_ptr_array_sort (hits, compare_paths);
+  g_ptr_array_sort (expected, compare_paths);
+
+  for (i = 0; i < MIN (hits->len, expected->len); i++)
+    g_assert_cmpstr (g_ptr_array_index (hits, i), ==, g_ptr_array_index (expected, i));
+  g_assert_cmpuint (hits->len, ==, expected->len);
+
+  g_ptr_array_unref (expected);
+  g_ptr_array_unref (hits);
+  g_strfreev (words);
+}
+
+static void
+build_index (const gchar *root)
+{
+  GtkSearchIndex *index;
+  GQueue paths = G_QUEUE_INIT;
+  GQueue ids = G_QUEUE_INIT;
+  GPtrArray *files, *dirs;
+  guint32 *dir_ids;
+  gchar *path;
+  gint64 mtime;
+  guint32 id;
+  guint i;
+
+  index = _gtk_search_index_new (root);
+
+  g_queue_push_tail (&paths, g_strdup (root));
+  g_queue_push_tail (&ids, GUINT_TO_POINTER (0));
+
+  while ((path = g_queue_pop_head (&paths)) != NULL)
+    {
+      id = GPOINTER_TO_UINT (g_queue_pop_head (&ids));
+
+      files = g_ptr_array_new_with_free_func (g_free);
+      dirs = g_ptr_array_new_with_free_func (g_free);
+      g_assert (_gtk_search_read_directory (path, &mtime, files, dirs));
+
+      dir_ids = g_new (guint32, dirs->len);
+      g_assert (_gtk_search_index_add_directory (index, id, mtime, files, dirs, dir_ids));
+
+      for (i = 0; i < dirs->len; i++)
+        {
+          g_queue_push_tail (&paths, g_build_filename (path, g_ptr_array_index (dirs, i), NULL));
+          g_queue_push_tail (&ids, GUINT_TO_POINTER (dir_ids[i]));
+        }
+
+      g_free (dir_ids);
+      g_ptr_array_unref (files);
+      g_ptr_array_unref (dirs);
+      g_free (path);
+    }
+
+  _gtk_search_index_publish (index);
+}
+
+static void
+add_hit (const gchar *path,
+         gpointer     data)
+{
+  g_ptr_array_add (data, g_strdup (path));
+}
+
+/* Returns %NULL if there is no usable index for @path */
+static GPtrArray *
+search_index (const gchar *path,
+              const gchar *text)
+{
+  GtkSearchIndex *index;
+  volatile gboolean cancelled = FALSE;
+  GPtrArray *hits;
+  gchar **words;
+  gboolean result;
+
+  index = _gtk_search_index_lookup (path);
+  if (index == NULL)
+    return NULL;
+
+  words = g_strsplit (text, " ", -1);
+  hits = g_ptr_array_new_with_free_func (g_free);
+  result = _gtk_search_index_search (index, path, words, &cancelled, add_hit, hits);
+  g_strfreev (words);
+  _gtk_search_index_unref (index);
+
+  if (!result)
+    {
+      g_ptr_array_unref (hits);
+      return NULL;
+    }
+
+  return hits;
+}
+
+static void
+test_build (void)
+{
+  gchar *root, *sub;
+
+  root = make_tree ("build");
+  build_index (root);
+
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+  assert_hits (search_index (root, "alpha txt"), root, "alpha txt");
+  assert_hits (search_index (root, "eta"), root, "eta");
+  assert_hits (search_index (root, "nothing"), root, "nothing");
+  /* Too short to have a trigram */
+  assert_hits (search_index (root, "a"), root, "a");
+
+  /* Searches below the root use the same index */
+  sub = g_build_filename (root, "sub", NULL);
+  assert_hits (search_index (sub, "alpha"), sub, "alpha");
+  g_free (sub);
+
+  g_free (root);
+}
+
+static void
+test_update (void)
+{
+  gchar *root, *path, *name;
+  guint i;
+
+  root = make_tree ("update");
+  for (i = 0; i < 40; i++)
+    {
+      name = g_strdup_printf ("bulk/file-%u", i);
+      write_file (root, name);
+      g_free (name);
+    }
+  build_index (root);
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+
+  /* Added files show up */
+  write_file (root, "sub/new-alpha.txt");
+  bump_mtime (root, "sub", 10);
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+
+  /* Removed ones go away */
+  path = g_build_filename (root, "alpha.txt", NULL);
+  g_remove (path);
+  g_free (path);
+  bump_mtime (root, ".", 10);
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+
+  /* So do whole directories */
+  path = g_build_filename (root, "sub", "deep", NULL);
+  remove_tree (path);
+  g_free (path);
+  bump_mtime (root, "sub", 20);
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+  assert_hits (search_index (root, "delta"), root, "delta");
+
+  /* Once most of it is gone, the index is stale and has to be
+   * rebuilt, as the search engine does */
+  path = g_build_filename (root, "bulk", NULL);
+  remove_tree (path);
+  g_free (path);
+  bump_mtime (root, ".", 20);
+  g_assert (search_index (root, "alpha") == NULL);
+
+  build_index (root);
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+  assert_hits (search_index (root, "file"), root, "file");
+
+  g_free (root);
+}
+
+static gchar *
+get_corrupt_root (void)
+{
+  return g_build_filename (test_dir, "corrupt", NULL);
+}
+
+static void
+test_corrupt_subprocess_build (void)
+{
+  gchar *root;
+
+  root = get_corrupt_root ();
+  build_index (root);
+  g_free (root);
+}
+
+static void
+test_corrupt_subprocess_load (void)
+{
+  gchar *root;
+
+  root = get_corrupt_root ();
+  assert_hits (search_index (root, "alpha"), root, "alpha");
+  g_free (root);
+}
+
+static void
+test_corrupt_subprocess_reject (void)
+{
+  gchar *root;
+
+  root = get_corrupt_root ();
+  g_assert (search_index (root, "alpha") == NULL);
+  g_free (root);
+}
+
+/* Each subprocess starts without any index in memory */
+static void
+run_subprocess (const gchar *mode)
+{
+  gchar *path;
+
+  path = g_strdup_printf ("/searchindex/corrupt/subprocess/%s", mode);
+  g_test_trap_subprocess (path, 0, 0);
+  g_test_trap_assert_passed ();
+  g_free (path);
+}
+
+/* Replaces the saved index with @length bytes of @contents,
+ * then checks that it is not used and gets rebuilt */
+static void
+check_corrupt (const gchar *filename,
+               const gchar *contents,
+               gsize        length)
+{
+  g_assert (g_file_set_contents (filename, contents, length, NULL));
+
+  run_subprocess ("reject");
+  run_subprocess ("build");
+  run_subprocess ("load");
+}
+
+static void
+test_corrupt (void)
+{
+  gchar *root, *checksum, *filename, *contents;
+  gsize length, entries;
+
+  root = make_tree ("corrupt");
+  run_subprocess ("build");
+  run_subprocess ("load");
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, root, -1);
+  filename = g_build_filename (g_get_user_cache_dir (), "gtk-3.0", "search-index",
+                               checksum, NULL);
+  g_assert (g_file_get_contents (filename, &contents, &length, NULL));
+
+  /* Truncated */
+  check_corrupt (filename, contents, length / 2);
+  check_corrupt (filename, contents, length - 1);
+
+  /* Not an index */
+  contents[0] ^= 0xff;
+  check_corrupt (filename, contents, length);
+  contents[0] ^= 0xff;
+
+  /* The second entry claims to be a root; entries follow
+   * the header of 24 bytes and the root path */
+  entries = 24 + strlen (root);
+  g_assert_cmpuint (length, >, entries + 2 * 24);
+  memset (contents + entries + 24, 0xff, 4);
+  check_corrupt (filename, contents, length);
+
+  g_free (contents);
+  g_free (filename);
+  g_free (checksum);
+  g_free (root);
+}
+
+static void
+hits_added (GtkSearchEngine *engine,
+            GList           *uris,
+            GPtrArray       *hits)
+{
+  GList *l;
+
+  for (l = uris; l; l = l->next)
+    g_ptr_array_add (hits, g_filename_from_uri (l->data, NULL, NULL));
+}
+
+static GPtrArray *
+search_engine (const gchar *path,
+               const gchar *text)
+{
+  GtkSearchEngine *engine;
+  GtkQuery *query;
+  GMainLoop *loop;
+  GPtrArray *hits;
+  gchar *uri;
+
+  hits = g_ptr_array_new_with_free_func (g_free);
+  loop = g_main_loop_new (NULL, FALSE);
+
+  query = _gtk_query_new ();
+  _gtk_query_set_text (query, text);
+  uri = g_filename_to_uri (path, NULL, NULL);
+  _gtk_query_set_location (query, uri);
+  g_free (uri);
+
+  engine = _gtk_search_engine_simple_new ();
+  _gtk_search_engine_set_query (engine, query);
+  g_signal_connect (engine, "hits-added", G_CALLBACK (hits_added), hits);
+  g_signal_connect_swapped (engine, "finished", G_CALLBACK (g_main_loop_quit), loop);
+
+  _gtk_search_engine_start (engine);
+  g_main_loop_run (loop);
+
+  g_object_unref (engine);
+  g_object_unref (query);
+  g_main_loop_unref (loop);
+
+  return hits;
+}
+
+static void
+test_crawl (void)
+{
+  gchar *root, *name, *sub;
+  guint i, j;
+
+  /* Enough directories to keep all crawler threads busy */
+  root = make_tree ("crawl");
+  for (i = 0; i < 16; i++)
+    for (j = 0; j < 16; j++)
+      {
+        name = g_strdup_printf ("d%02u/e%02u/alpha-%u-%u", i, j, i, j);
+        write_file (root, name);
+        g_free (name);
+        name = g_strdup_printf ("d%02u/e%02u/file-%u-%u.txt", i, j, i, j);
+        write_file (root, name);
+        g_free (name);
+      }
+
+  /* There is no index yet, so this crawls and builds one */
+  assert_hits (search_engine (root, "alpha"), root, "alpha");
+  assert_hits (search_engine (root, "Alpha 1"), root, "alpha 1");
+
+  /* Those use the index */
+  g_assert (search_index (root, "alpha") != NULL);
+  assert_hits (search_engine (root, "alpha"), root, "alpha");
+  sub = g_build_filename (root, "d03", NULL);
+  assert_hits (search_engine (sub, "txt"), sub, "txt");
+  g_free (sub);
+
+  g_free (root);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  gchar *cache_dir;
+  int result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  test_dir = g_strdup (g_getenv (TEST_DIR_VARIABLE));
+  if (test_dir == NULL)
+    {
+      test_dir = g_dir_make_tmp ("gtk-search-index-XXXXXX", NULL);
+      g_assert (test_dir != NULL);
+      g_setenv (TEST_DIR_VARIABLE, test_dir, TRUE);
+    }
+
+  /* Keep the saved indexes out of the user's cache */
+  cache_dir = g_build_filename (test_dir, "cache", NULL);
+  g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+  g_setenv ("GTK_FILE_SEARCH_INDEX", "1", TRUE);
+  g_free (cache_dir);
+
+  g_test_add_func ("/searchindex/build", test_build);
+  g_test_add_func ("/searchindex/update", test_update);
+  g_test_add_func ("/searchindex/corrupt", test_corrupt);
+  g_test_add_func ("/searchindex/corrupt/subprocess/build", test_corrupt_subprocess_build);
+  g_test_add_func ("/searchindex/corrupt/subprocess/load", test_corrupt_subprocess_load);
+  g_test_add_func ("/searchindex/corrupt/subprocess/reject", test_corrupt_subprocess_reject);
+  g_test_add_func ("/searchindex/crawl", test_crawl);
+
+  result = g_test_run ();
+
+  if (!g_test_subprocess ())
+    remove_tree (test_dir);
+  g_free (test_dir);
+
+  return result;
+}
@@ -0,0 +1,176 @@
+/* Size request cache tests.
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <locale.h>
+
+#include "../../gtk/gtksizerequestcacheprivate.h"
+
+/* Pretends to be a label that wraps to one more line
+ * for every 10 pixels less width */
+static gint
+height_for_width (gint width)
+{
+  return 1000 - width / 10;
+}
+
+static gboolean
+lookup_height (SizeRequestCache *cache,
+               gint              width,
+               gint             *height)
+{
+  gint natural, minimum_baseline, natural_baseline;
+
+  return _gtk_size_request_cache_lookup (cache, GTK_ORIENTATION_VERTICAL, width,
+                                         height, &natural,
+                                         &minimum_baseline, &natural_baseline);
+}
+
+static gboolean
+request_height (SizeRequestCache *cache,
+                gint              width)
+{
+  gint height;
+
+  if (lookup_height (cache, width, &height))
+    {
+      g_assert_cmpint (height, ==, height_for_width (width));
+      return TRUE;
+    }
+
+  height = height_for_width (width);
+  _gtk_size_request_cache_commit (cache, GTK_ORIENTATION_VERTICAL, width,
+                                  height, height, -1, -1);
+  return FALSE;
+}
+
+static void
+test_ranges (void)
+{
+  SizeRequestCache cache;
+  gint height;
+
+  _gtk_size_request_cache_init (&cache);
+
+  g_assert (!request_height (&cache, 100));
+  g_assert (!request_height (&cache, 105));
+  g_assert (request_height (&cache, 102));
+  g_assert (request_height (&cache, 100));
+  g_assert (request_height (&cache, 105));
+  g_assert (!request_height (&cache, 99));
+  g_assert (!request_height (&cache, 110));
+
+  g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].n_cached_requests, ==, 3);
+  g_assert (!lookup_height (&cache, 109, &height));
+
+  _gtk_size_request_cache_free (&cache);
+}
+
+static void
+test_grow (void)
+{
+  SizeRequestCache cache;
+  gint width;
+
+  _gtk_size_request_cache_init (&cache);
+
+  /* A resize drag over many wrapping points misses every time
+   * until the cache is big enough to hold all of them */
+  for (width = 100; width < 300; width += 10)
+    request_height (&cache, width);
+
+  g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests, >=, 20);
+
+  for (width = 290; width >= 100; width -= 10)
+    g_assert (request_height (&cache, width));
+
+  _gtk_size_request_cache_free (&cache);
+  g_assert_cmpuint (_gtk_size_request_cache_get_memory_usage (), ==, 0);
+}
+
+static void
+test_no_grow (void)
+{
+  SizeRequestCache cache;
+  gint i, width;
+
+  _gtk_size_request_cache_init (&cache);
+
+  for (width = 100; width < 100 + 10 * GTK_SIZE_REQUEST_CACHED_SIZES; width += 10)
+    request_height (&cache, width);
+
+  for (i = 0; i < 10; i++)
+    for (width = 100; width < 100 + 10 * GTK_SIZE_REQUEST_CACHED_SIZES; width += 10)
+      g_assert (request_height (&cache, width));
+
+  /* Mostly hits, so evict instead of growing */
+  g_assert (_gtk_size_request_cache_commit (&cache, GTK_ORIENTATION_VERTICAL, 500,
+                                            height_for_width (500), height_for_width (500),
+                                            -1, -1));
+  g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests, ==, GTK_SIZE_REQUEST_CACHED_SIZES);
+  g_assert (request_height (&cache, 500));
+
+  _gtk_size_request_cache_free (&cache);
+}
+
+static void
+test_clear (void)
+{
+  SizeRequestCache cache;
+  gint width;
+  guint max_sizes;
+
+  _gtk_size_request_cache_init (&cache);
+
+  for (width = 100; width < 500; width += 10)
+    request_height (&cache, width);
+
+  max_sizes = cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests;
+  g_assert_cmpuint (max_sizes, >, GTK_SIZE_REQUEST_CACHED_SIZES);
+
+  /* Clearing keeps the learned size... */
+  _gtk_size_request_cache_clear (&cache);
+  g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].n_cached_requests, ==, 0);
+  g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests, ==, max_sizes);
+  g_assert (!request_height (&cache, 100));
+
+  /* ...until it turns out not to be needed */
+  while (cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests > GTK_SIZE_REQUEST_CACHED_SIZES)
+    {
+      max_sizes = cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests;
+      _gtk_size_request_cache_clear (&cache);
+      g_assert_cmpuint (cache.flags[GTK_ORIENTATION_VERTICAL].max_cached_requests, <, max_sizes);
+      request_height (&cache, 100);
+    }
+
+  _gtk_size_request_cache_free (&cache);
+  g_assert_cmpuint (_gtk_size_request_cache_get_memory_usage (), ==, 0);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "C");
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/sizerequestcache/ranges", test_ranges);
+  g_test_add_func ("/sizerequestcache/grow", test_grow);
+  g_test_add_func ("/sizerequestcache/no-grow", test_no_grow);
+  g_test_add_func ("/sizerequestcache/clear", test_clear);
+
+  return g_test_run ();
+}
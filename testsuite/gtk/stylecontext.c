@@ -259,6 +259,155 @@ test_match (void)
   g_object_unref (context);
 }
 
+static void
+assert_color (GtkStyleContext *context,
+              const char      *data,
+              const char      *expected_color)
+{
+  GtkCssProvider *provider;
+  GError *error = NULL;
+  GdkRGBA color, expected;
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, data, -1, &error);
+  g_assert_no_error (error);
+  gtk_style_context_add_provider (context,
+                                  GTK_STYLE_PROVIDER (provider),
+                                  GTK_STYLE_PROVIDER_PRIORITY_USER);
+
+  gdk_rgba_parse (&expected, expected_color);
+  gtk_style_context_get_color (context, GTK_STATE_FLAG_NORMAL, &color);
+  g_assert (gdk_rgba_equal (&color, &expected));
+
+  gtk_style_context_remove_provider (context, GTK_STYLE_PROVIDER (provider));
+  g_object_unref (provider);
+}
+
+static void
+test_match_ancestors (void)
+{
+  GtkStyleContext *context;
+  GtkWidgetPath *path;
+
+  context = gtk_style_context_new ();
+
+  path = gtk_widget_path_new ();
+  gtk_widget_path_append_type (path, GTK_TYPE_WINDOW);
+  gtk_widget_path_append_type (path, GTK_TYPE_BOX);
+  gtk_widget_path_append_type (path, GTK_TYPE_NOTEBOOK);
+  gtk_widget_path_append_type (path, GTK_TYPE_BOX);
+  gtk_widget_path_append_type (path, GTK_TYPE_TOGGLE_BUTTON);
+  gtk_widget_path_iter_set_name (path, 0, "mywindow");
+  gtk_widget_path_iter_add_class (path, 0, "background");
+  gtk_widget_path_iter_add_class (path, 2, "notebook");
+  gtk_widget_path_iter_add_class (path, 4, "button");
+  gtk_style_context_set_path (context, path);
+  gtk_widget_path_free (path);
+
+  /* the ancestor filter must not hide matches */
+  assert_color (context,
+                "* { color: #f00 }\n"
+                ".background .button { color: #fff }",
+                "#fff");
+  assert_color (context,
+                "* { color: #f00 }\n"
+                "#mywindow .notebook GtkButton { color: #fff }",
+                "#fff");
+  assert_color (context,
+                "* { color: #f00 }\n"
+                "GtkContainer GtkBin .button { color: #fff }",
+                "#fff");
+  assert_color (context,
+                "* { color: #f00 }\n"
+                "GtkBuildable .button { color: #fff }",
+                "#fff");
+
+  /* ...but must reject ancestors that aren't there */
+  assert_color (context,
+                "* { color: #fff }\n"
+                ".button .button { color: #f00 }",
+                "#fff");
+  assert_color (context,
+                "* { color: #fff }\n"
+                ".view .button { color: #f00 }",
+                "#fff");
+  assert_color (context,
+                "* { color: #fff }\n"
+                "#otherwindow .button { color: #f00 }",
+                "#fff");
+  assert_color (context,
+                "* { color: #fff }\n"
+                "GtkToggleButton .button { color: #f00 }",
+                "#fff");
+  assert_color (context,
+                "* { color: #fff }\n"
+                "GtkNonexistentType .button { color: #f00 }",
+                "#fff");
+
+  g_object_unref (context);
+}
+
+static void
+test_match_performance (void)
+{
+  GtkCssProvider *provider;
+  GtkWidgetPath *path;
+  GParamSpec *pspec;
+  GString *data;
+  GError *error = NULL;
+  GValue value = G_VALUE_INIT;
+  double elapsed;
+  int i, n;
+
+  if (!g_test_perf ())
+    return;
+
+  /* A theme sized stylesheet where almost all rules have ancestors
+   * that aren't in the path */
+  data = g_string_new (NULL);
+  for (i = 0; i < 2000; i++)
+    g_string_append_printf (data,
+                            ".class%d .button, .class%d GtkLabel:hover { color: #%03x }\n",
+                            i, i, i % 0x1000);
+  g_string_append (data, "GtkWindow .button { -GtkWidget-focus-line-width: 3 }\n");
+
+  provider = gtk_css_provider_new ();
+  gtk_css_provider_load_from_data (provider, data->str, -1, &error);
+  g_assert_no_error (error);
+  g_string_free (data, TRUE);
+
+  path = gtk_widget_path_new ();
+  gtk_widget_path_append_type (path, GTK_TYPE_WINDOW);
+  for (i = 0; i < 20; i++)
+    {
+      gtk_widget_path_append_type (path, GTK_TYPE_BOX);
+      gtk_widget_path_iter_add_class (path, -1, "horizontal");
+    }
+  gtk_widget_path_append_type (path, GTK_TYPE_BUTTON);
+  gtk_widget_path_iter_add_class (path, -1, "button");
+
+  pspec = gtk_widget_class_find_style_property (g_type_class_ref (GTK_TYPE_BUTTON),
+                                                "focus-line-width");
+  g_value_init (&value, G_TYPE_INT);
+
+  g_test_timer_start ();
+  for (n = 0; n < 200; n++)
+    {
+      g_assert (gtk_style_provider_get_style_property (GTK_STYLE_PROVIDER (provider),
+                                                       path, 0, pspec, &value));
+      g_assert_cmpint (g_value_get_int (&value), ==, 3);
+    }
+  elapsed = g_test_timer_elapsed () / n;
+
+  g_test_minimized_result (elapsed,
+                           "matching a path of depth %d: %gms",
+                           gtk_widget_path_length (path), elapsed * 1000);
+
+  g_value_unset (&value);
+  gtk_widget_path_free (path);
+  g_object_unref (provider);
+}
+
 static void
 test_basic_properties (void)
 {
@@ -298,6 +447,8 @@ main (int argc, char *argv[])
   g_test_add_func ("/style/parse/selectors", test_parse_selectors);
   g_test_add_func ("/style/path", test_path);
   g_test_add_func ("/style/match", test_match);
+  g_test_add_func ("/style/match/ancestors", test_match_ancestors);
+  g_test_add_func ("/style/match/performance", test_match_performance);
   g_test_add_func ("/style/basic", test_basic_properties);
 
   return g_test_run ();
@@ -1345,6 +1345,116 @@ test_tag (void)
   g_object_unref (buffer);
 }
 
+/* Tags every line of a big buffer the way syntax highlighting
+ * does, with more tags than the btree has mask bits for in the
+ * second round, then moves through the buffer by tag toggles and
+ * looks up the tags of every line.
+ */
+static void
+test_many_tags (void)
+{
+  guint n_lines = g_test_perf () ? 100000 : 500;
+  guint n_tags_list[] = { 48, 96 };
+  guint debug_flags;
+  guint round;
+
+  /* Checking the btree after every change is too slow for this */
+  debug_flags = gtk_get_debug_flags ();
+  if (g_test_perf ())
+    gtk_set_debug_flags (debug_flags & ~GTK_DEBUG_TEXT);
+
+  for (round = 0; round < G_N_ELEMENTS (n_tags_list); round++)
+    {
+      guint n_tags = n_tags_list[round];
+      GtkTextBuffer *buffer;
+      GtkTextTag **tags;
+      guint *n_ranges;
+      GtkTextIter start, end, iter;
+      GString *text;
+      double elapsed;
+      guint i, n_toggles, expected_toggles;
+
+      buffer = gtk_text_buffer_new (NULL);
+      tags = g_new (GtkTextTag *, n_tags);
+      n_ranges = g_new0 (guint, n_tags);
+
+      for (i = 0; i < n_tags; i++)
+        {
+          gchar *name = g_strdup_printf ("highlight%u", i);
+          tags[i] = gtk_text_buffer_create_tag (buffer, name, NULL);
+          g_free (name);
+        }
+
+      text = g_string_new ("");
+      for (i = 0; i < n_lines; i++)
+        g_string_append_printf (text, "if (x) %08u;\n", i);
+      gtk_text_buffer_set_text (buffer, text->str, text->len);
+      g_string_free (text, TRUE);
+
+      /* Two separate ranges on every line, which may use the same tag */
+      for (i = 0; i < n_lines; i++)
+        {
+          guint tag1 = i % n_tags;
+          guint tag2 = (i * 7) % n_tags;
+
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &start, i, 0);
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &end, i, 2);
+          gtk_text_buffer_apply_tag (buffer, tags[tag1], &start, &end);
+          n_ranges[tag1]++;
+
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &start, i, 7);
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &end, i, 15);
+          gtk_text_buffer_apply_tag (buffer, tags[tag2], &start, &end);
+          n_ranges[tag2]++;
+        }
+
+      g_test_timer_start ();
+
+      n_toggles = 0;
+      expected_toggles = 0;
+      for (i = 0; i < n_tags; i++)
+        {
+          gtk_text_buffer_get_start_iter (buffer, &iter);
+          while (gtk_text_iter_forward_to_tag_toggle (&iter, tags[i]))
+            n_toggles++;
+          expected_toggles += 2 * n_ranges[i];
+        }
+      g_assert_cmpuint (n_toggles, ==, expected_toggles);
+
+      elapsed = g_test_timer_elapsed ();
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed, "moving over %u toggles of %u tags in %u lines: %gsec",
+                                 n_toggles, n_tags, n_lines, elapsed);
+
+      g_test_timer_start ();
+
+      for (i = 0; i < n_lines; i++)
+        {
+          GSList *iter_tags;
+
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &iter, i, 1);
+          iter_tags = gtk_text_iter_get_tags (&iter);
+          g_assert_cmpuint (g_slist_length (iter_tags), ==, 1);
+          g_assert (iter_tags->data == tags[i % n_tags]);
+          g_slist_free (iter_tags);
+
+          gtk_text_buffer_get_iter_at_line_offset (buffer, &iter, i, 4);
+          g_assert (gtk_text_iter_get_tags (&iter) == NULL);
+        }
+
+      elapsed = g_test_timer_elapsed ();
+      if (g_test_perf ())
+        g_test_minimized_result (elapsed, "getting tags on %u lines with %u tags: %gsec",
+                                 n_lines, n_tags, elapsed);
+
+      g_free (n_ranges);
+      g_free (tags);
+      g_object_unref (buffer);
+    }
+
+  gtk_set_debug_flags (debug_flags);
+}
+
 static void
 check_buffer_contents (GtkTextBuffer *buffer,
                        const gchar   *contents)
@@ -1434,6 +1544,133 @@ test_clipboard (void)
   g_object_unref (buffer);
 }
 
+/* Text of a few thousand lines. The stream is read 65536 bytes at a
+ * time, so the first \r\n and the first multibyte character are
+ * each split between two reads.
+ */
+static gchar *
+create_load_text (gsize *length,
+                  gint  *n_lines)
+{
+  GString *text;
+  guint i;
+
+  text = g_string_new ("");
+  *n_lines = 1;
+
+  for (i = 0; text->len < 3 * 65536; i++)
+    {
+      if (text->len == 65535)
+        {
+          g_string_append (text, "\r\n");
+          (*n_lines)++;
+        }
+      else if (text->len == 2 * 65536 - 1)
+        g_string_append (text, "\xc3\xa9");
+      else if (i % 37 == 0)
+        {
+          g_string_append_c (text, '\n');
+          (*n_lines)++;
+        }
+      else
+        g_string_append_c (text, 'a' + i % 26);
+    }
+
+  *length = text->len;
+  return g_string_free (text, FALSE);
+}
+
+static void
+test_load_from_stream (void)
+{
+  GtkTextBuffer *buffer;
+  GInputStream *stream;
+  GError *error = NULL;
+  gchar *text;
+  gsize length;
+  gint n_lines;
+
+  text = create_load_text (&length, &n_lines);
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "old", -1);
+
+  stream = g_memory_input_stream_new_from_data (text, length, NULL);
+  g_assert (gtk_text_buffer_load_from_stream (buffer, stream, NULL, &error));
+  g_assert_no_error (error);
+  g_object_unref (stream);
+
+  check_buffer_contents (buffer, text);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, n_lines);
+  g_assert_cmpint (gtk_text_buffer_get_char_count (buffer), ==, g_utf8_strlen (text, length));
+
+  /* Invalid text leaves the buffer alone */
+  text[length - 10] = '\xff';
+  stream = g_memory_input_stream_new_from_data (text, length, NULL);
+  g_assert (!gtk_text_buffer_load_from_stream (buffer, stream, NULL, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+  g_clear_error (&error);
+  g_object_unref (stream);
+
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, n_lines);
+
+  g_object_unref (buffer);
+  g_free (text);
+}
+
+/* Inserting a lot of text at once builds the new lines separately,
+ * so check that what was around the insertion point ends up in the
+ * right place.
+ */
+static void
+test_bulk_insert (void)
+{
+  GtkTextBuffer *buffer;
+  GtkTextMark *left_mark, *right_mark;
+  GtkTextTag *tag;
+  GtkTextIter iter, start, end;
+  gchar *text, *expected;
+  gsize length;
+  gint n_lines, n_chars;
+
+  text = create_load_text (&length, &n_lines);
+  n_chars = g_utf8_strlen (text, length);
+
+  buffer = gtk_text_buffer_new (NULL);
+  gtk_text_buffer_set_text (buffer, "ab\ncd", -1);
+  tag = gtk_text_buffer_create_tag (buffer, "bold", NULL);
+  gtk_text_buffer_get_iter_at_offset (buffer, &start, 1);
+  gtk_text_buffer_get_iter_at_offset (buffer, &end, 4);
+  gtk_text_buffer_apply_tag (buffer, tag, &start, &end);
+
+  gtk_text_buffer_get_iter_at_offset (buffer, &iter, 2);
+  left_mark = gtk_text_buffer_create_mark (buffer, NULL, &iter, TRUE);
+  right_mark = gtk_text_buffer_create_mark (buffer, NULL, &iter, FALSE);
+
+  gtk_text_buffer_insert (buffer, &iter, text, length);
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 2 + n_chars);
+
+  expected = g_strconcat ("ab", text, "\ncd", NULL);
+  check_buffer_contents (buffer, expected);
+  g_free (expected);
+  g_assert_cmpint (gtk_text_buffer_get_line_count (buffer), ==, n_lines + 1);
+
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, left_mark);
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 2);
+  gtk_text_buffer_get_iter_at_mark (buffer, &iter, right_mark);
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 2 + n_chars);
+
+  /* The text went into the tagged range, which now covers it */
+  gtk_text_buffer_get_start_iter (buffer, &iter);
+  g_assert (gtk_text_iter_forward_to_tag_toggle (&iter, tag));
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 1);
+  g_assert (gtk_text_iter_forward_to_tag_toggle (&iter, tag));
+  g_assert_cmpint (gtk_text_iter_get_offset (&iter), ==, 4 + n_chars);
+  g_assert (!gtk_text_iter_forward_to_tag_toggle (&iter, tag));
+
+  g_object_unref (buffer);
+  g_free (text);
+}
+
 int
 main (int argc, char** argv)
 {
@@ -1451,7 +1688,10 @@ main (int argc, char** argv)
   g_test_add_func ("/TextBuffer/Get and Set", test_get_set);
   g_test_add_func ("/TextBuffer/Fill and Empty", test_fill_empty);
   g_test_add_func ("/TextBuffer/Tag", test_tag);
+  g_test_add_func ("/TextBuffer/Many tags", test_many_tags);
   g_test_add_func ("/TextBuffer/Clipboard", test_clipboard);
+  g_test_add_func ("/TextBuffer/Load from stream", test_load_from_stream);
+  g_test_add_func ("/TextBuffer/Bulk insert", test_bulk_insert);
 
   return g_test_run();
 }